@@ -6,6 +6,9 @@
 #include <BLEServer.h>
 #include <BLECharacteristic.h>
 #include <BLE2902.h>
+#include "AppStateChannel.h"
+#include "ScoreBeacon.h"
+#include "EpeeJudge.h"
 
 // =====================【硬件引脚定义-ESP32-C3专属 全部合法可用 无冲突】=====================
 #define LED_APP_CONN      2   // 小程序BLE连接指示灯
@@ -27,10 +30,12 @@
 #define BLE_SLAVE_NAME    "epee"           // 本机小程序连接的广播名称
 #define UUID_SLAVE_SRV    "12345678-1234-5678-1234-56789abcdef0" // 小程序服务UUID
 #define UUID_SLAVE_CHAR   "87654321-4321-8765-4321-0fedcba987654" // 小程序特征值UUID
+#define UUID_STATE_CHAR   "87654321-4321-8765-4321-0fedcba98701"  // 小程序二进制状态增量（Notify）
+#define UUID_SNAP_CHAR    "87654321-4321-8765-4321-0fedcba98702"  // 小程序二进制全量状态（Read，重连后同步）
 
 // =====================【业务逻辑常量配置】=====================
-const int DOUBLE_HIT        = 40;    // 互中判定时间阈值(ms)
-const int BUZZ_HIT          = 500;   // 击中蜂鸣长鸣时长(ms)
+const int DOUBLE_HIT        = 40;    // 互中判定时间阈值(ms)，交给判定引擎 EpeeJudge.h
+const int BUZZ_HIT          = 500;   // 击中蜂鸣长鸣时长(ms)，判定后也按此自动解锁（本机没有下一剑按键）
 const int BUZZ_CONF         = 100;   // 确认蜂鸣短鸣时长(ms)
 const unsigned long SCAN_TIMEOUT_MS = 15000;  // 扫描超时15秒
 const unsigned long KEY_DEB = 200;   // 按键消抖时间
@@ -57,6 +62,19 @@ unsigned long greenDisconnectFirstTime = 0;
 bool redDisconnectFlag = false;
 bool greenDisconnectFlag = false;
 
+// =====================【小程序二进制状态通道-旧文本特征值保留给旧版小程序（未订阅则不发）】=====================
+BLECharacteristic* pStateChar = nullptr;
+BLECharacteristic* pSnapChar = nullptr;
+AppStateChannel appChannel;
+portMUX_TYPE appChannelMux = portMUX_INITIALIZER_UNLOCKED; // 读回调在蓝牙任务里
+uint32_t appConnIntervalMs = 30;  // 小程序连接间隔，每个间隔最多推一帧
+unsigned long lastAppFlush = 0;
+
+// =====================【无连接比分广播-小程序连上后改为不可连接广播继续发，观众端被动扫描即可】=====================
+BLEAdvertising* pAdv = nullptr;
+ScoreBeacon scoreBeacon;
+unsigned long lastBeaconUpdate = 0;
+
 // =====================【按键/蜂鸣/指示灯状态变量】=====================
 uint8_t keyMainCnt = 0;                       
 unsigned long lastKeyMain = 0;                
@@ -74,8 +92,20 @@ bool grnHit = false;
 bool doubleHit = false;                       
 int redScore = 0;                             
 int grnScore = 0;                             
-unsigned long lastHit = 0;                    
-String lastSide = "";                         
+
+// =====================【判定引擎-EpeeJudge.h 各主机目标共用 击中回调只登记到达时间 主循环喂给引擎出判定】=====================
+// 两把剑的时钟互不相关，按本机到达时间判定（帧里的 time: 只做格式校验）
+portMUX_TYPE hitMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool hitPending[2] = {false, false};
+uint32_t hitPendingMs[2] = {0, 0};
+void applyVerdict(const JudgeVerdict& v);
+struct MillisClock {
+  uint32_t now() const { return millis(); }
+};
+struct VerdictSink {
+  void onVerdict(const JudgeVerdict& v) { applyVerdict(v); }
+};
+EpeeJudge<MillisClock, VerdictSink> judge(MillisClock(), VerdictSink(), DOUBLE_HIT, JUDGE_EVAL_DELAY_MS, BUZZ_HIT);
 
 struct HitSource {
   bool isRed = false;
@@ -94,6 +124,9 @@ void setupBleNotify(BLEClient* pClient, bool isRedSide);
 void scanStart();
 void scanStop();
 void sendToApp();
+void flushAppState();
+void updateBeacon();
+void startAppAdvertising(bool connectable);
 void sysReset();
 static void hitCb(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify, bool isRed);
 void hwInit();
@@ -102,6 +135,7 @@ void handleKeyConfirm();
 void handleBuzzer();
 void handleLedFlash();
 void handleHitLed();
+void serviceJudge();
 void checkReconnect();
 bool isDeviceReallyConnected(BLEClient* pClient);
 void releaseBleClient(BLEClient* &pClient);
@@ -114,12 +148,35 @@ class MyServerCb : public BLEServerCallbacks {
     appConn = true;
     digitalWrite(LED_APP_CONN, HIGH);
     Serial.println("\n✅【小程序链路】小程序BLE连接成功，指示灯常亮");
+    startAppAdvertising(false); // 连接期间继续广播比分，但不再接受连接
+  }
+  void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    // 连接间隔单位 1.25ms，下一帧状态带全部字段
+    appConnIntervalMs = (param->connect.conn_params.interval * 5) / 4;
+    if (appConnIntervalMs == 0) appConnIntervalMs = 30;
+    portENTER_CRITICAL(&appChannelMux);
+    appChannel.resync();
+    portEXIT_CRITICAL(&appChannelMux);
+    Serial.printf("✅【小程序链路】连接间隔：%lu ms，状态帧按间隔合并推送\n", appConnIntervalMs);
   }
   void onDisconnect(BLEServer* pServer) {
     appConn = false;
     digitalWrite(LED_APP_CONN, LOW);
     Serial.println("\n❌【小程序链路】小程序BLE断开连接，重启广播");
-    BLEDevice::startAdvertising();
+    startAppAdvertising(true);
+  }
+};
+
+/**
+ * @brief 全量状态读回调 - 小程序重连后先读全量帧，再按序号应用增量帧
+ */
+class SnapReadCb : public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* pCharacteristic) {
+    uint8_t buf[APP_FRAME_MAX_LEN];
+    portENTER_CRITICAL(&appChannelMux);
+    size_t n = appChannel.buildFull(buf);
+    portEXIT_CRITICAL(&appChannelMux);
+    pCharacteristic->setValue(buf, n);
   }
 };
 
@@ -190,81 +247,90 @@ class MyScanCb : public BLEAdvertisedDeviceCallbacks {
   }
 };
 
+// 击中帧须带 time: 字段
+static bool hitFrameValid(const uint8_t* data, size_t len) {
+  for (size_t i = 0; i + 5 <= len; i++) {
+    if (memcmp(data + i, "time:", 5) == 0) return true;
+  }
+  return false;
+}
+
 /**
- * @brief ✅✅✅ 击中信号处理核心函数 + 极致详细日志 逻辑无修改 完美解析数据
+ * @brief 击中信号回调（蓝牙任务）：校验格式后只登记到达时间，互中判定交给主循环里的判定引擎
  */
 static void hitCb(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify, bool isRed) {
   if(pData == nullptr || len == 0) {
     Serial.println("\n❌【击中链路-异常】收到空数据/长度为0的无效击中信号，直接跳过！");
     return;
   }
-  String data = String((char*)pData).substring(0, len);
-  String side = isRed ? "RED(epee_red)" : "GRN(epee_green)";
-  String sideFlag = isRed ? "🔴【红方击中链路】" : "🟢【绿方击中链路】";
+  unsigned long now = millis();
+  const char* sideFlag = isRed ? "🔴【红方击中链路】" : "🟢【绿方击中链路】";
 
   Serial.println("\n=====================================================");
-  Serial.printf("%s【原始数据接收】来源设备：%s | 数据长度：%dByte | 是否是Notify通知：%s\n", sideFlag.c_str(), side.c_str(), len, isNotify?"✅是":"❌否");
-  Serial.printf("%s【原始数据接收】完整原始数据：%s\n", sideFlag.c_str(), data.c_str());
-
-  int tStart = data.indexOf("time:") + 5;
-  int tEnd = data.indexOf("|");
-  if (tStart == 4 || tEnd == -1) {
-    Serial.printf("%s【数据解析-异常】❌ 未找到time:关键字 或 数据格式错误！原始数据：%s\n", sideFlag.c_str(), data.c_str());
+  Serial.printf("%s【原始数据接收】来源设备：%s | 数据长度：%dByte | 是否是Notify通知：%s\n", sideFlag, isRed ? "RED(epee_red)" : "GRN(epee_green)", len, isNotify?"✅是":"❌否");
+  Serial.printf("%s【原始数据接收】完整原始数据：%.*s\n", sideFlag, (int)len, (const char*)pData);
+  if (!hitFrameValid(pData, len)) {
+    Serial.printf("%s【数据解析-异常】❌ 未找到time:关键字 或 数据格式错误！\n", sideFlag);
     Serial.println("=====================================================\n");
     return;
   }
-  unsigned long hitTime = data.substring(tStart, tEnd).toInt();
-  Serial.printf("%s【数据解析-成功】✅ 解析出击中时间戳：%lu ms\n", sideFlag.c_str(), hitTime);
 
-  buzzHit = true;
-  lastBuzzHit = millis();
-  redHit = false;
-  grnHit = false;
-  doubleHit = false;
-  Serial.printf("%s【硬件触发】✅ 置位击中蜂鸣标志位，蜂鸣器即将响铃(%dms)\n", sideFlag.c_str(), BUZZ_HIT);
-
-  Serial.printf("%s【互中判定】当前阈值：%dms | 上一次击中时间戳：%lu | 上一次击中来源：%s\n", sideFlag.c_str(), DOUBLE_HIT, lastHit, lastSide.c_str());
-  if (lastHit != 0 && lastSide != "" && lastSide != side) {
-    unsigned long diff = hitTime - lastHit;
-    Serial.printf("%s【互中判定】两次击中时间差：%lu ms | 阈值对比：%lu <= %d ? %s\n", sideFlag.c_str(), diff, diff, DOUBLE_HIT, diff<=DOUBLE_HIT?"✅是":"❌否");
-    if (diff <= DOUBLE_HIT) {
-      doubleHit = true;
-      redHit = true;
-      grnHit = true;
-      int oldRed = redScore;
-      int oldGreen = grnScore;
-      redScore++;
-      grnScore++;
-      Serial.printf("💥【互中判定-生效】✅ 判定为双方互中！分数更新：红[%d→%d] | 绿[%d→%d]\n", oldRed, redScore, oldGreen, grnScore);
-      sendToApp();
-      lastHit = 0;
-      lastSide = "";
-      Serial.println("=====================================================\n");
-      return;
-    } else {
-      Serial.printf("%s【互中判定-失效】❌ 时间差超过阈值，判定为单次有效击中\n", sideFlag.c_str());
-    }
+  int side = isRed ? JUDGE_RED : JUDGE_GREEN;
+  portENTER_CRITICAL(&hitMux);
+  if (!hitPending[side]) {
+    hitPendingMs[side] = now;
+    hitPending[side] = true;
   }
+  portEXIT_CRITICAL(&hitMux);
+  Serial.printf("%s【判定登记】✅ 到达时间：%lu ms，交给判定引擎（互中窗口 %dms）\n", sideFlag, now, DOUBLE_HIT);
+  Serial.println("=====================================================\n");
+}
 
-  int oldScore = 0;
-  if (isRed) {
-    redHit = true;
-    oldScore = redScore;
-    redScore++;
-    Serial.printf("%s【计分逻辑-红方击中】✅ epee_red击中有效！分数更新：红[%d→%d] | 绿[%d]\n", sideFlag.c_str(), oldScore, redScore, grnScore);
-  } else {
-    grnHit = true;
-    oldScore = grnScore;
-    grnScore++;
-    Serial.printf("%s【计分逻辑-绿方击中】✅ epee_green击中有效！分数更新：红[%d] | 绿[%d→%d]\n", sideFlag.c_str(), redScore, oldScore, grnScore);
+/**
+ * @brief 取走回调登记的击中喂给判定引擎，到期出判定（主循环里调用）
+ */
+void serviceJudge() {
+  for (int side = JUDGE_RED; side <= JUDGE_GREEN; side++) {
+    portENTER_CRITICAL(&hitMux);
+    bool pending = hitPending[side];
+    uint32_t at = hitPendingMs[side];
+    hitPending[side] = false;
+    portEXIT_CRITICAL(&hitMux);
+    if (!pending) continue;
+    JudgeHitResult r = judge.hit(side, at);
+    const char* sideFlag = side == JUDGE_RED ? "🔴【红方击中链路】" : "🟢【绿方击中链路】";
+    if (r == JUDGE_HIT_FIRST) Serial.printf("%s【互中判定】首击，开启 %dms 窗口\n", sideFlag, DOUBLE_HIT);
+    else if (r == JUDGE_HIT_ACCEPTED) Serial.printf("%s【互中判定】落在窗口内，与首击差 %ldms\n", sideFlag, (long)(at - judge.firstHitMs()));
+    else if (r == JUDGE_HIT_OUTSIDE) Serial.printf("%s【互中判定-失效】❌ 超过窗口，不计\n", sideFlag);
+    else if (r == JUDGE_HIT_LOCKED) Serial.printf("%s【互中判定-失效】❌ 本剑已判定，不计\n", sideFlag);
   }
+  judge.poll();
+}
 
-  lastHit = hitTime;
-  lastSide = side;
-  Serial.printf("%s【状态更新】✅ 记录本次击中时间戳：%lu | 击中来源：%s\n", sideFlag.c_str(), hitTime, side.c_str());
-  Serial.printf("%s【小程序推送】✅ 准备推送最新计分数据到小程序\n", sideFlag.c_str());
+/**
+ * @brief 判定结果（引擎回调）：计分、蜂鸣、推送小程序
+ */
+void applyVerdict(const JudgeVerdict& v) {
+  buzzHit = true;
+  lastBuzzHit = millis();
+  int oldRed = redScore;
+  int oldGreen = grnScore;
+  redHit = v.red;
+  grnHit = v.green;
+  doubleHit = v.red && v.green;
+  if (v.red) redScore++;
+  if (v.green) grnScore++;
+  Serial.printf("🔔【硬件触发】✅ 置位击中蜂鸣标志位，蜂鸣器即将响铃(%dms)\n", BUZZ_HIT);
+  if (doubleHit) {
+    Serial.printf("💥【互中判定-生效】✅ 判定为双方互中！时间差：%ldms | 分数更新：红[%d→%d] | 绿[%d→%d]\n",
+                  (long)v.redMinusGreenMs, oldRed, redScore, oldGreen, grnScore);
+  } else if (v.red) {
+    Serial.printf("🔴【计分逻辑-红方击中】✅ epee_red击中有效！分数更新：红[%d→%d] | 绿[%d]\n", oldRed, redScore, grnScore);
+  } else {
+    Serial.printf("🟢【计分逻辑-绿方击中】✅ epee_green击中有效！分数更新：红[%d] | 绿[%d→%d]\n", redScore, oldGreen, grnScore);
+  }
+  Serial.println("📤【小程序推送】✅ 准备推送最新计分数据到小程序");
   sendToApp();
-  Serial.println("=====================================================\n");
 }
 
 //✅ 标准红方回调转发函数 100%触发
@@ -520,8 +586,10 @@ void sysReset() {
 
   redScore = 0;
   grnScore = 0;
-  lastHit = 0;
-  lastSide = "";
+  judge.reset();
+  portENTER_CRITICAL(&hitMux);
+  hitPending[JUDGE_RED] = hitPending[JUDGE_GREEN] = false;
+  portEXIT_CRITICAL(&hitMux);
   redHit = false;
   grnHit = false;
   doubleHit = false;
@@ -656,6 +724,74 @@ void sendToApp() {
   doubleHit = false;
 }
 
+/**
+ * @brief 当前计分状态转换为二进制状态帧字段
+ */
+AppState currentAppState() {
+  AppState st;
+  st.redScore = (uint8_t)constrain(redScore, 0, 255);
+  st.grnScore = (uint8_t)constrain(grnScore, 0, 255);
+  st.lamps = 0;
+  if (redHit) st.lamps |= APP_LAMP_RED;
+  if (grnHit) st.lamps |= APP_LAMP_GRN;
+  if (isDeviceReallyConnected(pRed)) st.lamps |= APP_LAMP_RED_LINK;
+  if (isDeviceReallyConnected(pGreen)) st.lamps |= APP_LAMP_GRN_LINK;
+  st.timerSec = APP_TIMER_NONE;
+  if (redHit && grnHit) st.phase = APP_PHASE_DOUBLE;
+  else if (redHit) st.phase = APP_PHASE_RED_HIT;
+  else if (grnHit) st.phase = APP_PHASE_GRN_HIT;
+  else if (scanning) st.phase = APP_PHASE_SCANNING;
+  else st.phase = APP_PHASE_IDLE;
+  return st;
+}
+
+/**
+ * @brief 推送二进制状态增量 - 同一连接间隔内的多次变化（击中+确认等）合并成一帧
+ */
+void flushAppState() {
+  AppState st = currentAppState();
+  uint8_t buf[APP_FRAME_MAX_LEN];
+  size_t n = 0;
+  portENTER_CRITICAL(&appChannelMux);
+  appChannel.update(st);
+  if (appConn && pStateChar != nullptr && millis() - lastAppFlush >= appConnIntervalMs) {
+    n = appChannel.buildDelta(buf);
+  }
+  portEXIT_CRITICAL(&appChannelMux);
+  if (n == 0) return;
+  lastAppFlush = millis();
+  pStateChar->setValue(buf, n);
+  pStateChar->notify();
+  Serial.printf("📤【小程序推送-状态帧】seq=%u | 字段=0x%02X | 长度=%uByte | 累计变化%lu次/发出%lu帧\n",
+                buf[1], buf[2], (unsigned)n, appChannel.updates(), appChannel.frames());
+}
+
+/**
+ * @brief 重启广播 - 主包放比分厂商数据，名称和服务UUID放扫描响应
+ */
+void startAppAdvertising(bool connectable) {
+  pAdv->stop();
+  pAdv->setAdvertisementType(connectable ? ADV_TYPE_IND : ADV_TYPE_SCAN_IND);
+  pAdv->start();
+}
+
+/**
+ * @brief 比分变化时刷新广播数据（限速，广播本身按间隔周期发送，观众端数量不限）
+ */
+void updateBeacon() {
+  if (millis() - lastBeaconUpdate < BEACON_MIN_UPDATE_MS) return;
+  if (!scoreBeacon.update(currentAppState())) return;
+  lastBeaconUpdate = millis();
+
+  uint8_t buf[BEACON_DATA_LEN];
+  size_t n = scoreBeacon.build(buf);
+  BLEAdvertisementData adv;
+  adv.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+  adv.setManufacturerData(String((const char*)buf, n));
+  pAdv->setAdvertisementData(adv);
+  Serial.printf("📡【比分广播】广播数据更新：seq=%u | 红:%d 绿:%d\n", scoreBeacon.seq(), redScore, grnScore);
+}
+
 void setup() {
   Serial.begin(115200);
   delay(1000);
@@ -673,9 +809,17 @@ void setup() {
   BLEService* pSrv = pServer->createService(UUID_SLAVE_SRV);
   pChar = pSrv->createCharacteristic(UUID_SLAVE_CHAR, BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_READ);
   pChar->addDescriptor(new BLE2902());
+  pStateChar = pSrv->createCharacteristic(UUID_STATE_CHAR, BLECharacteristic::PROPERTY_NOTIFY);
+  pStateChar->addDescriptor(new BLE2902());
+  pSnapChar = pSrv->createCharacteristic(UUID_SNAP_CHAR, BLECharacteristic::PROPERTY_READ);
+  pSnapChar->setCallbacks(new SnapReadCb());
   pSrv->start();
-  BLEAdvertising* pAdv = BLEDevice::getAdvertising();
-  pAdv->addServiceUUID(UUID_SLAVE_SRV);
+  pAdv = BLEDevice::getAdvertising();
+  BLEAdvertisementData scanResp;
+  scanResp.setName(BLE_SLAVE_NAME);
+  scanResp.setCompleteServices(BLEUUID(UUID_SLAVE_SRV));
+  pAdv->setScanResponseData(scanResp);
+  updateBeacon();
   pAdv->start();
 
   pScan = BLEDevice::getScan();
@@ -692,9 +836,12 @@ void loop() {
   handleKeyMain();
   handleKeyConfirm();
   handleLedFlash();
+  serviceJudge();
   handleHitLed();
   handleBuzzer();
   //checkReconnect();  //✅ 重连逻辑正常开启 无错
+  flushAppState();
+  updateBeacon();
   digitalWrite(LED_APP_CONN, appConn ? HIGH : LOW);
   
   delay(20);
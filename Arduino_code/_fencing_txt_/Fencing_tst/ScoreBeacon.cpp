@@ -0,0 +1,49 @@
+#include "ScoreBeacon.h"
+#include <string.h>
+
+ScoreBeacon::ScoreBeacon()
+  : m_seq(0)
+  , m_valid(false) {
+  memset(&m_state, 0, sizeof(m_state));
+  m_state.timerSec = APP_TIMER_NONE;
+}
+
+bool ScoreBeacon::update(const AppState& st) {
+  if (m_valid &&
+      st.redScore == m_state.redScore && st.grnScore == m_state.grnScore &&
+      st.lamps == m_state.lamps && st.timerSec == m_state.timerSec && st.phase == m_state.phase) {
+    return false;
+  }
+  m_state = st;
+  m_valid = true;
+  m_seq++;
+  return true;
+}
+
+size_t ScoreBeacon::build(uint8_t* buf) const {
+  buf[0] = (uint8_t)(BEACON_COMPANY_ID & 0xFF);
+  buf[1] = (uint8_t)(BEACON_COMPANY_ID >> 8);
+  buf[2] = BEACON_MAGIC;
+  buf[3] = BEACON_VERSION;
+  buf[4] = m_seq;
+  buf[5] = m_state.redScore;
+  buf[6] = m_state.grnScore;
+  buf[7] = m_state.lamps;
+  buf[8] = (uint8_t)(m_state.timerSec & 0xFF);
+  buf[9] = (uint8_t)(m_state.timerSec >> 8);
+  buf[10] = m_state.phase;
+  return BEACON_DATA_LEN;
+}
+
+bool ScoreBeacon::parse(const uint8_t* data, size_t len, uint8_t& seq, AppState& out) {
+  if (data == nullptr || len < BEACON_DATA_LEN) return false;
+  if ((uint16_t)(data[0] | (data[1] << 8)) != BEACON_COMPANY_ID) return false;
+  if (data[2] != BEACON_MAGIC || data[3] != BEACON_VERSION) return false;
+  seq = data[4];
+  out.redScore = data[5];
+  out.grnScore = data[6];
+  out.lamps = data[7];
+  out.timerSec = (uint16_t)(data[8] | (data[9] << 8));
+  out.phase = data[10];
+  return true;
+}
\ No newline at end of file
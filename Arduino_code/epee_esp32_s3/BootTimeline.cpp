@@ -0,0 +1,55 @@
+#include "BootTimeline.h"
+#include <esp_timer.h>
+#include <esp_system.h>
+
+static const char* const PHASE_NAMES[BOOT_PHASE_COUNT] = {
+    "进入setup",
+    "蓝牙就绪",
+    "直连已知剑端",
+    "开始扫描",
+    "核心就绪",
+    "首把剑上线",
+    "双剑上线",
+    "可以判定"
+};
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON:  return "上电";
+        case ESP_RST_BROWNOUT: return "欠压";
+        case ESP_RST_SW:       return "软件重启";
+        case ESP_RST_PANIC:    return "异常";
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:      return "看门狗";
+        case ESP_RST_DEEPSLEEP: return "深睡唤醒";
+        default:               return "其他";
+    }
+}
+
+BootTimeline::BootTimeline() {
+    m_mux = portMUX_INITIALIZER_UNLOCKED;
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) m_us[i] = -1;
+}
+
+void BootTimeline::mark(BootPhase phase) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&m_mux);
+    if (m_us[phase] < 0) m_us[phase] = now;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void BootTimeline::report(void (*printFn)(const char*, ...)) const {
+    printFn("[启动] 复位原因: %s\n", resetReasonName(esp_reset_reason()));
+    int64_t prev = 0;
+    for (int i = 0; i < BOOT_PHASE_COUNT; i++) {
+        int64_t t = m_us[i];
+        if (t < 0) {
+            printFn("[启动] %-12s   未到达\n", PHASE_NAMES[i]);
+            continue;
+        }
+        // 各阶段有并行的，差值按时间先后算，可能为负（表示比上一行早）
+        printFn("[启动] %-12s %6ld ms (%+ld)\n", PHASE_NAMES[i], (long)(t / 1000), (long)((t - prev) / 1000));
+        prev = t;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+
+// 启动时间线：记录从上电到可以判定的各阶段时间点，串口 'b' 打印
+// 时间基准为 esp_timer（应用启动时从0开始，不含ROM/bootloader约几十毫秒）
+
+enum BootPhase {
+    BOOT_SETUP = 0,       // 进入 setup()
+    BOOT_RADIO_UP,        // 蓝牙协议栈初始化完成
+    BOOT_PEER_TRY,        // 开始直连上次的剑端（已知地址，免扫描）
+    BOOT_SCAN_START,      // 第一次开始扫描
+    BOOT_CORE_READY,      // 比分/计时/显示初始化完成（与蓝牙并行）
+    BOOT_FIRST_POINTER,   // 第一把剑上线
+    BOOT_BOTH_POINTERS,   // 两把剑都上线
+    BOOT_READY,           // 可以判定：两把剑在线且核心已就绪
+    BOOT_PHASE_COUNT
+};
+
+class BootTimeline {
+public:
+    BootTimeline();
+
+    // 记录阶段时间点，只记第一次（任意任务可调用）
+    void mark(BootPhase phase);
+    bool reached(BootPhase phase) const { return m_us[phase] >= 0; }
+    int64_t at(BootPhase phase) const { return m_us[phase]; }
+
+    // 逐行输出时间线，printFn 与 printf 同签名（如 lockedPrintf）
+    void report(void (*printFn)(const char*, ...)) const;
+
+private:
+    volatile int64_t m_us[BOOT_PHASE_COUNT];  // -1 = 未到达
+    portMUX_TYPE m_mux;
+};
+
+#endif // BOOT_TIMELINE_H
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "BoutStats.h"
+#include <stdio.h>
+#include <string.h>
+
+void StatsAccum::reset() {
+  count = 0;
+  sum = 0;
+  min = 0;
+  max = 0;
+}
+
+void StatsAccum::add(int32_t v) {
+  if (count == 0 || v < min) min = v;
+  if (count == 0 || v > max) max = v;
+  count++;
+  sum += v;
+}
+
+BoutStats::BoutStats() {
+  reset();
+}
+
+void BoutStats::reset() {
+  m_verdicts = 0;
+  m_doubles = 0;
+  m_amended = 0;
+  for (int i = 0; i < 2; i++) {
+    m_touches[i] = 0;
+    m_singles[i] = 0;
+    m_firstInDouble[i] = 0;
+    m_waitBy[i].reset();
+  }
+  memset(m_diffHist, 0, sizeof(m_diffHist));
+  memset(m_waitHist, 0, sizeof(m_waitHist));
+  m_diff.reset();
+  m_wait.reset();
+  m_running = false;
+  m_runStartMs = 0;
+  m_runMs = 0;
+  m_waitingFirst = false;
+  m_restartMs = 0;
+}
+
+void BoutStats::timerRunning(bool running, uint32_t nowMs) {
+  if (running == m_running) return;
+  m_running = running;
+  if (running) {
+    m_runStartMs = nowMs;
+    m_restartMs = nowMs;
+    m_waitingFirst = true;
+  } else {
+    m_runMs += nowMs - m_runStartMs;
+  }
+}
+
+uint32_t BoutStats::runningMs(uint32_t nowMs) const {
+  return m_runMs + (m_running ? nowMs - m_runStartMs : 0);
+}
+
+void BoutStats::addDiff(int32_t diffMs) {
+  m_diff.add(diffMs);
+  if (diffMs < -STATS_DIFF_RANGE_MS) diffMs = -STATS_DIFF_RANGE_MS;
+  if (diffMs > STATS_DIFF_RANGE_MS) diffMs = STATS_DIFF_RANGE_MS;
+  m_diffHist[(diffMs + STATS_DIFF_RANGE_MS) / STATS_DIFF_BIN_MS]++;
+}
+
+void BoutStats::verdict(bool red, bool green, int32_t diffMs, uint32_t firstHitMs) {
+  if (!red && !green) return;
+  m_verdicts++;
+  if (red) m_touches[0]++;
+  if (green) m_touches[1]++;
+  if (red && green) {
+    m_doubles++;
+    if (diffMs != 0) m_firstInDouble[diffMs < 0 ? 0 : 1]++;
+    addDiff(diffMs);
+  } else {
+    m_singles[red ? 0 : 1]++;
+  }
+
+  // 击中时间早于开始计时（暂停前就击中、补发到达）的不算等待时间
+  int32_t waitMs = (int32_t)(firstHitMs - m_restartMs);
+  if (m_waitingFirst && waitMs >= 0) {
+    m_wait.add(waitMs);
+    if (red) m_waitBy[0].add(waitMs);
+    if (green) m_waitBy[1].add(waitMs);
+    int bin = 0;
+    for (uint32_t s = (uint32_t)waitMs / 1000; s > 0 && bin < STATS_WAIT_BINS - 1; s >>= 1) bin++;
+    m_waitHist[bin]++;
+  }
+  m_waitingFirst = false;
+}
+
+void BoutStats::amended(bool red, int32_t diffMs) {
+  int side = red ? 0 : 1;
+  int other = 1 - side;
+  m_touches[side]++;
+  if (m_singles[other] > 0) m_singles[other]--;
+  m_doubles++;
+  m_amended++;
+  if (diffMs != 0) m_firstInDouble[diffMs < 0 ? 0 : 1]++;
+  addDiff(diffMs);
+}
+
+void BoutStats::report(void (*printFn)(const char*, ...), const char* title, uint32_t nowMs) const {
+  uint32_t runMs = runningMs(nowMs);
+  uint32_t runSec = runMs / 1000;
+  printFn("[统计] %s：判定 %lu 次，计时运行 %lu:%02lu\n", title, (unsigned long)m_verdicts,
+          (unsigned long)(runSec / 60), (unsigned long)(runSec % 60));
+  if (m_verdicts == 0) return;
+
+  const char* names[2] = {"红方", "绿方"};
+  for (int i = 0; i < 2; i++) {
+    // 每分钟得分保留一位小数，用整数算
+    uint32_t perMin10 = runMs ? (uint32_t)((uint64_t)m_touches[i] * 600000 / runMs) : 0;
+    printFn("[统计]   %s 得分 %lu（单中 %lu）每分钟 %lu.%lu 剑 | 双中先中 %lu 次 | 开始→击中 平均 %ld.%01ld 秒\n",
+            names[i], (unsigned long)m_touches[i], (unsigned long)m_singles[i],
+            (unsigned long)(perMin10 / 10), (unsigned long)(perMin10 % 10), (unsigned long)m_firstInDouble[i],
+            (long)(m_waitBy[i].mean() / 1000), (long)(m_waitBy[i].mean() % 1000 / 100));
+  }
+  uint32_t doublePct10 = m_doubles * 1000 / m_verdicts;
+  printFn("[统计]   双中 %lu 次（补判 %lu）占 %lu.%lu%%\n", (unsigned long)m_doubles, (unsigned long)m_amended,
+          (unsigned long)(doublePct10 / 10), (unsigned long)(doublePct10 % 10));
+
+  if (m_diff.count > 0) {
+    char line[STATS_DIFF_BINS * 12 + 1];
+    size_t pos = 0;
+    for (int i = 0; i < STATS_DIFF_BINS; i++) {
+      if (m_diffHist[i] == 0) continue;
+      int center = i * STATS_DIFF_BIN_MS - (STATS_DIFF_BINS / 2) * STATS_DIFF_BIN_MS;
+      int n = snprintf(line + pos, sizeof(line) - pos, " %+d:%lu", center, (unsigned long)m_diffHist[i]);
+      if (n < 0 || (size_t)n >= sizeof(line) - pos) break;
+      pos += n;
+    }
+    line[pos] = '\0';
+    printFn("[统计]   双中时间差(红-绿) 平均 %+ld ms 范围 %+ld~%+ld ms | 分布(ms:次)%s\n",
+            (long)m_diff.mean(), (long)m_diff.min, (long)m_diff.max, line);
+  }
+
+  if (m_wait.count > 0) {
+    static const char* WAIT_LABELS[STATS_WAIT_BINS] = {"<1s", "<2s", "<4s", "<8s", "<16s", "<32s", "<64s", ">64s"};
+    char line[STATS_WAIT_BINS * 14 + 1];
+    size_t pos = 0;
+    for (int i = 0; i < STATS_WAIT_BINS; i++) {
+      int n = snprintf(line + pos, sizeof(line) - pos, " %s:%lu", WAIT_LABELS[i], (unsigned long)m_waitHist[i]);
+      if (n < 0 || (size_t)n >= sizeof(line) - pos) break;
+      pos += n;
+    }
+    line[pos] = '\0';
+    printFn("[统计]   开始→首击 %lu 次 平均 %ld.%01ld 秒 最短 %ld.%01ld 最长 %ld.%01ld |%s\n", (unsigned long)m_wait.count,
+            (long)(m_wait.mean() / 1000), (long)(m_wait.mean() % 1000 / 100),
+            (long)(m_wait.min / 1000), (long)(m_wait.min % 1000 / 100),
+            (long)(m_wait.max / 1000), (long)(m_wait.max % 1000 / 100), line);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef BOUT_STATS_H
+#define BOUT_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 比赛统计：每次判定 O(1) 更新固定大小的计数和直方图，不存逐剑记录
+//   每方得分、单中/双中、计时运行时间折算的每分钟得分
+//   双中时红绿击中时间差分布（判定窗口内，5ms 一格）
+//   下一分开始计时到首击的等待时间分布（按秒对数分格）
+// 一局一份（全局重置时打印并清零），另一份从上电累计；不依赖 Arduino.h
+
+#define STATS_DIFF_BIN_MS   5
+#define STATS_DIFF_RANGE_MS 42      // 时间差 ±42ms 以内按格计，更远的计入两端格
+#define STATS_DIFF_BINS     17      // 格中心 -40,-35,...,+40
+#define STATS_WAIT_BINS     8       // <1s,<2s,<4s,<8s,<16s,<32s,<64s,更久
+
+// 单个量的计数/总和/最小/最大
+struct StatsAccum {
+  uint32_t count;
+  int64_t sum;
+  int32_t min;
+  int32_t max;
+
+  void reset();
+  void add(int32_t v);
+  int32_t mean() const { return count ? (int32_t)(sum / (int64_t)count) : 0; }
+};
+
+class BoutStats {
+public:
+  BoutStats();
+  void reset();
+
+  // 每个判定周期调用：计时开始/暂停的跳变时记运行时间，开始时刻作为“下一分”起点
+  void timerRunning(bool running, uint32_t nowMs);
+
+  // 一次判定；diffMs = 红击中时间 - 绿击中时间（只在双中时有意义）
+  void verdict(bool red, bool green, int32_t diffMs, uint32_t firstHitMs);
+
+  // 判定后迟到补判为双中：red=补上的是红方
+  void amended(bool red, int32_t diffMs);
+
+  uint32_t verdicts() const { return m_verdicts; }
+  uint32_t runningMs(uint32_t nowMs) const;
+
+  // 逐行输出，printFn 与 printf 同签名（如 lockedPrintf）
+  void report(void (*printFn)(const char*, ...), const char* title, uint32_t nowMs) const;
+
+private:
+  uint32_t m_verdicts;
+  uint32_t m_touches[2];          // 按 HitSide 索引，双中两边各算一剑
+  uint32_t m_singles[2];
+  uint32_t m_doubles;
+  uint32_t m_amended;
+  uint32_t m_firstInDouble[2];    // 双中里先击中的一方
+  uint32_t m_diffHist[STATS_DIFF_BINS];
+  StatsAccum m_diff;
+  uint32_t m_waitHist[STATS_WAIT_BINS];
+  StatsAccum m_wait;
+  StatsAccum m_waitBy[2];         // 按得分方统计等待时间（双中两边都记）
+
+  bool m_running;
+  uint32_t m_runStartMs;
+  uint32_t m_runMs;
+  bool m_waitingFirst;            // 本次开始计时后还没有判定
+  uint32_t m_restartMs;
+
+  void addDiff(int32_t diffMs);
+};
+
+#endif // BOUT_STATS_H
\ No newline at end of file
@@ -0,0 +1,182 @@
+#ifndef EPEE_JUDGE_H
+#define EPEE_JUDGE_H
+
+#include <stdint.h>
+
+// 重剑击中判定引擎：所有主机目标（epee_esp32_s3 的 FencingCore、epee_sup_min、esp32_repeater、Fencing_tst）
+// 编译同一份，窗口/判定延时/补判规则只在这里改；各目录里的副本与 epee_esp32_s3 保持一致
+// 规则：
+//   按击中时间（而非到达顺序）放入窗口：首击后 windowMs 内另一方击中算同时击中，迟到的更早击中成为新的首击
+//   首击后超过 evalDelayMs 出判定并锁定；锁定期间补发的迟到击中若落在本剑窗口内、灯还亮着，改判为同时击中
+//   判定后等 reset()（裁判按下一剑），或 rearmMs 到期自动解锁（没有下一剑按键的计分端）
+// 时钟和输出是模板参数：Clock 提供 uint32_t now()，Sink 提供 void onVerdict(const JudgeVerdict&)
+// 不分配内存、不加锁：只在一个任务里调用（通知回调里只记到达时间，由判定任务喂进来）
+// 不依赖 Arduino.h，主机端仿真可直接编译；一致性检查和单剑耗时见 host_tools/judge_bench
+
+#define JUDGE_WINDOW_MS      40   // 同时击中窗口（FIE 重剑 40~50ms）
+#define JUDGE_EVAL_DELAY_MS  45   // 首击后多久出判定：比窗口多等一点，给另一方的通知留到达时间
+
+enum JudgeSide {
+  JUDGE_RED = 0,
+  JUDGE_GREEN = 1
+};
+
+enum JudgeHitResult {
+  JUDGE_HIT_FIRST = 0,     // 本剑首击（或更早的迟到击中取代原首击），开窗口
+  JUDGE_HIT_ACCEPTED,      // 另一方落在窗口内
+  JUDGE_HIT_REPEAT,        // 该方本剑已记过，不变
+  JUDGE_HIT_OUTSIDE,       // 晚于窗口，丢弃
+  JUDGE_HIT_LOCKED,        // 已判定，丢弃
+  JUDGE_HIT_AMENDED,       // 补发迟到击中改判为同时击中（已回调 Sink）
+  JUDGE_HIT_LATE_REJECTED  // 补发迟到击中不在本剑窗口内，仅记录
+};
+
+// 一次判定或补判的结果
+struct JudgeVerdict {
+  bool red;                // 红灯
+  bool green;
+  bool amended;            // 补判：迟到补发改判为同时击中
+  bool amendRed;           // 补判补上的是红方
+  uint32_t firstHitMs;     // 本剑首击时间（调用方时间基准）
+  int32_t redMinusGreenMs; // 双方都中时红减绿的击中时间差，单中为 0
+};
+
+template <typename Clock, typename Sink>
+class EpeeJudge {
+public:
+  EpeeJudge(const Clock& clock, const Sink& sink, uint16_t windowMs = JUDGE_WINDOW_MS,
+            uint16_t evalDelayMs = JUDGE_EVAL_DELAY_MS, uint32_t rearmMs = 0)
+    : m_clock(clock), m_sink(sink), m_windowMs(windowMs), m_evalDelayMs(evalDelayMs), m_rearmMs(rearmMs) {
+    reset();
+  }
+
+  // 一方击中；late=补发的迟到击中（只有它在锁定后还能补判）
+  JudgeHitResult hit(uint8_t side, uint32_t timeMs, bool late = false) {
+    side = side ? JUDGE_GREEN : JUDGE_RED;
+    if (m_locked) return late ? amend(side, timeMs) : JUDGE_HIT_LOCKED;
+    if (!m_open) {
+      m_open = true;
+      m_firstMs = timeMs;
+      mark(side, timeMs);
+      return JUDGE_HIT_FIRST;
+    }
+    int32_t diff = (int32_t)(timeMs - m_firstMs);
+    if (diff >= 0) {
+      if (diff > (int32_t)m_windowMs) return JUDGE_HIT_OUTSIDE;
+      if (m_received[side]) return JUDGE_HIT_REPEAT;
+      mark(side, timeMs);
+      return JUDGE_HIT_ACCEPTED;
+    }
+    // 比当前首击更早：另一方的击中离这一击超过窗口就不算（按另一方自己的击中时间比，不是原首击）
+    uint8_t other = 1 - side;
+    if (m_received[other] && (int32_t)(m_hitMs[other] - timeMs) > (int32_t)m_windowMs) m_received[other] = false;
+    mark(side, timeMs);
+    refirst();
+    return JUDGE_HIT_FIRST;
+  }
+
+  // 判定任务每拍调用：到期出判定（回调 Sink）返回 true；锁定中按 rearmMs 自动解锁
+  bool poll() {
+    uint32_t now = m_clock.now();
+    if (m_locked) {
+      if (m_rearmMs > 0 && now - m_lockedMs >= m_rearmMs) reset();
+      return false;
+    }
+    // 有符号比较：对时后的击中时间可能略晚于本机当前时间，不能当成早已到期
+    if (!m_open || (int32_t)(now - m_firstMs) <= (int32_t)m_evalDelayMs) return false;
+    m_locked = true;
+    m_lampOn = true;
+    m_lockedMs = now;
+    JudgeVerdict v;
+    fill(v, false, false);
+    m_sink.onVerdict(v);
+    return true;
+  }
+
+  // 灯灭：之后补发的迟到击中不再改判
+  void lampOff() { m_lampOn = false; }
+
+  // 下一剑/全局重置
+  void reset() {
+    m_open = false;
+    m_locked = false;
+    m_lampOn = false;
+    m_received[0] = m_received[1] = false;
+    m_firstMs = m_lockedMs = 0;
+    m_hitMs[0] = m_hitMs[1] = 0;
+    m_lateDiffMs = 0;
+  }
+
+  // 热备接管：套用对方的锁定/亮灯状态，没有首击时间，不再补判
+  void restore(bool locked, bool red, bool green) {
+    reset();
+    m_locked = locked;
+    if (locked) {
+      m_received[JUDGE_RED] = red;
+      m_received[JUDGE_GREEN] = green;
+    }
+  }
+
+  bool locked() const { return m_locked; }
+  bool open() const { return m_open; }
+  bool received(uint8_t side) const { return m_received[side ? 1 : 0]; }
+  uint32_t firstHitMs() const { return m_firstMs; }
+  // 最近一次补发迟到击中相对本剑首击的时间差（日志用）
+  int32_t lateDiffMs() const { return m_lateDiffMs; }
+  uint16_t windowMs() const { return m_windowMs; }
+  Sink& sink() { return m_sink; }
+
+private:
+  Clock m_clock;
+  Sink m_sink;
+  uint16_t m_windowMs;
+  uint16_t m_evalDelayMs;
+  uint32_t m_rearmMs;
+  bool m_open;             // 本剑已有首击
+  bool m_locked;           // 已判定
+  bool m_lampOn;           // 判定后灯还亮（可补判）
+  bool m_received[2];
+  uint32_t m_firstMs;
+  uint32_t m_lockedMs;
+  uint32_t m_hitMs[2];
+  int32_t m_lateDiffMs;
+
+  void mark(uint8_t side, uint32_t timeMs) {
+    m_received[side] = true;
+    m_hitMs[side] = timeMs;
+  }
+
+  // 首击 = 还记着的击中里最早的一个
+  void refirst() {
+    bool red = m_received[JUDGE_RED], green = m_received[JUDGE_GREEN];
+    if (red && green) {
+      m_firstMs = (int32_t)(m_hitMs[JUDGE_RED] - m_hitMs[JUDGE_GREEN]) <= 0 ? m_hitMs[JUDGE_RED] : m_hitMs[JUDGE_GREEN];
+    } else if (red || green) {
+      m_firstMs = m_hitMs[red ? JUDGE_RED : JUDGE_GREEN];
+    }
+  }
+
+  void fill(JudgeVerdict& v, bool amended, bool amendRed) const {
+    v.red = m_received[JUDGE_RED];
+    v.green = m_received[JUDGE_GREEN];
+    v.amended = amended;
+    v.amendRed = amendRed;
+    v.firstHitMs = m_firstMs;
+    v.redMinusGreenMs = (v.red && v.green) ? (int32_t)(m_hitMs[JUDGE_RED] - m_hitMs[JUDGE_GREEN]) : 0;
+  }
+
+  JudgeHitResult amend(uint8_t side, uint32_t timeMs) {
+    int32_t diff = (int32_t)(timeMs - m_firstMs);
+    m_lateDiffMs = diff;
+    if (m_received[side] || !m_lampOn || !m_open || diff > (int32_t)m_windowMs || -diff > (int32_t)m_windowMs) {
+      return JUDGE_HIT_LATE_REJECTED;
+    }
+    mark(side, timeMs);
+    JudgeVerdict v;
+    fill(v, true, side == JUDGE_RED);
+    m_sink.onVerdict(v);
+    return JUDGE_HIT_AMENDED;
+  }
+};
+
+#endif // EPEE_JUDGE_H
\ No newline at end of file
@@ -19,7 +19,7 @@ const int FencingCore::TIMER_CLK_PIN = 1;
 const int FencingCore::TIMER_DIO_PIN = 2;
 
 const unsigned long FencingCore::LIGHT_DURATION = 3000;
-const unsigned long FencingCore::BEEP_DURATION = 800;
+const unsigned long FencingCore::BEEP_DURATION = 800; // 与 ToneEngine 的 TONE_TOUCH 时长一致
 const int FencingCore::HIT_TIME_WINDOW = 40;
 const int FencingCore::HIT_EVAL_DELAY = 45;
 
@@ -38,12 +38,16 @@ FencingCore::FencingCore()
     , m_greenHitRaw(false)
     , m_redHitTimestamp(0)
     , m_greenHitTimestamp(0)
-    , m_firstHitTime(0)
-    , m_isLocked(false)
-    , m_redHitReceived(false)
-    , m_greenHitReceived(false)
+    , m_redHitLate(false)
+    , m_greenHitLate(false)
     , m_effectActive(false)
-    , m_hitEffectStartTime(0) {
+    , m_hitEffectStartTime(0)
+    , m_injectedButtons(0)
+    , m_verdictCallback(nullptr)
+    , m_touchCallback(nullptr)
+    , m_timerStartCallback(nullptr)
+    , m_statsPrinter(nullptr)
+    , m_judge(JudgeClock(), JudgeSink{this}, HIT_TIME_WINDOW, HIT_EVAL_DELAY) {
     // 修复：注册静态回调函数（适配普通函数指针）
     m_scoreManager.setScoreChangeCallback(staticScoreChangeCallback);
 }
@@ -59,7 +63,7 @@ void FencingCore::init() {
     // 初始化引脚（不变）
     pinMode(PIN_RED_LED, OUTPUT);
     pinMode(PIN_GRN_LED, OUTPUT);
-    pinMode(PIN_BUZZER, OUTPUT);
+    m_toneEngine.begin(PIN_BUZZER, false); // 有源蜂鸣器，LEDC+定时器驱动，不阻塞判定
     pinMode(BTN_NEXT, INPUT_PULLUP);
     pinMode(BTN_RESET, INPUT_PULLUP);
     pinMode(BTN_PHASE, INPUT_PULLUP);
@@ -80,46 +84,62 @@ void FencingCore::init() {
 
 // ===================== 其他方法（完全不变，无需修改）=====================
 void FencingCore::updateTimer() {
+    bool wasRunning = m_fencingTimer.isTimerRunning();
     m_fencingTimer.update();
+    bool running = m_fencingTimer.isTimerRunning();
+    m_boutStats.timerRunning(running, millis());
+    m_sessionStats.timerRunning(running, millis());
+    if (wasRunning && !m_fencingTimer.isTimerRunning() && m_fencingTimer.getRemainingSeconds() <= 0) {
+        m_toneEngine.play(TONE_PERIOD_END);
+        Serial.println("[计时] 时间到");
+    }
 }
 
 void FencingCore::processHitDetection() {
-    if (m_isLocked) return;
-    if (!m_fencingTimer.isTimerRunning()) {
+    // 已判定时引擎只收补发的迟到击中（按击中时间看是否落在本剑窗口内）；未判定且暂停计时的击中丢弃
+    if (!m_judge.locked() && !m_fencingTimer.isTimerRunning()) {
         m_redHitRaw = false;
         m_greenHitRaw = false;
         return;
     }
 
     if (m_redHitRaw) {
-        if (m_firstHitTime == 0) m_firstHitTime = m_redHitTimestamp;
-        if (m_redHitTimestamp - m_firstHitTime <= HIT_TIME_WINDOW) {
-            m_redHitReceived = true;
-        }
+        feedHit(JUDGE_RED, m_redHitTimestamp, m_redHitLate);
         m_redHitRaw = false;
     }
 
     if (m_greenHitRaw) {
-        if (m_firstHitTime == 0) m_firstHitTime = m_greenHitTimestamp;
-        if (m_greenHitTimestamp - m_firstHitTime <= HIT_TIME_WINDOW) {
-            m_greenHitReceived = true;
-        }
+        feedHit(JUDGE_GREEN, m_greenHitTimestamp, m_greenHitLate);
         m_greenHitRaw = false;
     }
 
-    if (m_firstHitTime > 0 && (millis() - m_firstHitTime > HIT_EVAL_DELAY)) {
-        evaluateHit();
+    m_judge.poll(); // 到期出判定，回调 applyVerdict
+}
+
+void FencingCore::feedHit(uint8_t side, uint32_t timestamp, bool late) {
+    JudgeHitResult result = m_judge.hit(side, timestamp, late);
+    if (result == JUDGE_HIT_LATE_REJECTED) {
+        Serial.printf("[补发] %s迟到击中不在本剑窗口内 (差 %d 毫秒)，仅记录\n", side == JUDGE_RED ? "red" : "green",
+                      (int)m_judge.lateDiffMs());
+    }
+    if (m_touchCallback != nullptr) {
+        CoreTouch t;
+        t.red = side == JUDGE_RED;
+        t.late = late;
+        t.result = (uint8_t)result;
+        t.hitTimeMs = timestamp;
+        m_touchCallback(t);
     }
 }
 
 void FencingCore::handleHitEffects() {
     if (!m_effectActive) return;
     unsigned long elapsed = millis() - m_hitEffectStartTime;
-    if (elapsed > BEEP_DURATION) digitalWrite(PIN_BUZZER, LOW);
     if (elapsed > LIGHT_DURATION) {
         digitalWrite(PIN_RED_LED, LOW);
         digitalWrite(PIN_GRN_LED, LOW);
         m_effectActive = false;
+        m_judge.lampOff();
         Serial.println("[系统] 声光效果结束，等待重置");
     }
 }
@@ -128,23 +148,17 @@ void FencingCore::checkButtons() {
     static bool lastNext = HIGH, lastReset = HIGH, lastPhase = HIGH, lastMode = HIGH;
     static bool lastRedAdd = HIGH, lastRedSub = HIGH, lastGreenAdd = HIGH, lastGreenSub = HIGH;
 
+    // 串口注入的按键（不消抖）
+    uint32_t injected = __atomic_exchange_n(&m_injectedButtons, 0, __ATOMIC_ACQ_REL);
+    for (int i = 0; i < CORE_BTN_COUNT; i++) {
+        if (injected & (1u << i)) pressButton((CoreButton)i);
+    }
+
     // BTN_NEXT
     bool currNext = digitalRead(BTN_NEXT);
     if (lastNext == HIGH && currNext == LOW) {
         vTaskDelay(pdMS_TO_TICKS(50));
-        if (digitalRead(BTN_NEXT) == LOW) {
-            if (m_isLocked) {
-                Serial.println("[按键] 下一分准备 (灭灯)");
-                resetMatch(false);
-                if (!m_fencingTimer.isTimerRunning()) {
-                    m_fencingTimer.toggleStartPause();
-                    Serial.println("[计时] 恢复比赛计时");
-                }
-            } else {
-                m_fencingTimer.toggleStartPause();
-                Serial.printf("[计时] %s\n", m_fencingTimer.isTimerRunning() ? "开始" : "暂停");
-            }
-        }
+        if (digitalRead(BTN_NEXT) == LOW) pressButton(CORE_BTN_NEXT);
     }
     lastNext = currNext;
 
@@ -152,11 +166,7 @@ void FencingCore::checkButtons() {
     bool currReset = digitalRead(BTN_RESET);
     if (lastReset == HIGH && currReset == LOW) {
         vTaskDelay(pdMS_TO_TICKS(50));
-        if (digitalRead(BTN_RESET) == LOW) {
-            Serial.println("[按键] 全局重置 (分数+时间)");
-            resetMatch(true);
-            m_fencingTimer.resetTimer();
-        }
+        if (digitalRead(BTN_RESET) == LOW) pressButton(CORE_BTN_RESET);
     }
     lastReset = currReset;
 
@@ -164,10 +174,7 @@ void FencingCore::checkButtons() {
     bool currPhase = digitalRead(BTN_PHASE);
     if (lastPhase == HIGH && currPhase == LOW) {
         vTaskDelay(pdMS_TO_TICKS(50));
-        if (digitalRead(BTN_PHASE) == LOW) {
-            m_fencingTimer.nextPhase();
-            Serial.println(m_fencingTimer.isResting() ? "[计时] 进入休息模式" : "[计时] 重回比赛模式");
-        }
+        if (digitalRead(BTN_PHASE) == LOW) pressButton(CORE_BTN_PHASE);
     }
     lastPhase = currPhase;
 
@@ -175,10 +182,7 @@ void FencingCore::checkButtons() {
     bool currMode = digitalRead(BTN_MODE);
     if (lastMode == HIGH && currMode == LOW) {
         vTaskDelay(pdMS_TO_TICKS(50));
-        if (digitalRead(BTN_MODE) == LOW) {
-            m_fencingTimer.toggleDurationMode();
-            Serial.printf("[计时] 切换至 %d 分钟赛制\n", m_fencingTimer.getCurrentDurationMode());
-        }
+        if (digitalRead(BTN_MODE) == LOW) pressButton(CORE_BTN_MODE);
     }
     lastMode = currMode;
 
@@ -188,10 +192,10 @@ void FencingCore::checkButtons() {
     bool currGreenAdd = digitalRead(BTN_GREEN_ADD);
     bool currGreenSub = digitalRead(BTN_GREEN_SUB);
 
-    if (lastRedAdd == HIGH && currRedAdd == LOW) {vTaskDelay(50);if(digitalRead(BTN_RED_ADD)==LOW){Serial.println("[按键] 手动红方+1分");m_scoreManager.addRedScore();}}
-    if (lastRedSub == HIGH && currRedSub == LOW) {vTaskDelay(50);if(digitalRead(BTN_RED_SUB)==LOW){Serial.println("[按键] 手动红方-1分");m_scoreManager.subtractRedScore();}}
-    if (lastGreenAdd == HIGH && currGreenAdd == LOW) {vTaskDelay(50);if(digitalRead(BTN_GREEN_ADD)==LOW){Serial.println("[按键] 手动绿方+1分");m_scoreManager.addGreenScore();}}
-    if (lastGreenSub == HIGH && currGreenSub == LOW) {vTaskDelay(50);if(digitalRead(BTN_GREEN_SUB)==LOW){Serial.println("[按键] 手动绿方-1分");m_scoreManager.subtractGreenScore();}}
+    if (lastRedAdd == HIGH && currRedAdd == LOW) {vTaskDelay(50);if(digitalRead(BTN_RED_ADD)==LOW)pressButton(CORE_BTN_RED_ADD);}
+    if (lastRedSub == HIGH && currRedSub == LOW) {vTaskDelay(50);if(digitalRead(BTN_RED_SUB)==LOW)pressButton(CORE_BTN_RED_SUB);}
+    if (lastGreenAdd == HIGH && currGreenAdd == LOW) {vTaskDelay(50);if(digitalRead(BTN_GREEN_ADD)==LOW)pressButton(CORE_BTN_GREEN_ADD);}
+    if (lastGreenSub == HIGH && currGreenSub == LOW) {vTaskDelay(50);if(digitalRead(BTN_GREEN_SUB)==LOW)pressButton(CORE_BTN_GREEN_SUB);}
 
     lastRedAdd = currRedAdd;
     lastRedSub = currRedSub;
@@ -199,33 +203,103 @@ void FencingCore::checkButtons() {
     lastGreenSub = currGreenSub;
 }
 
+// 按键动作（实体按键消抖后、注入按键都走这里）
+void FencingCore::pressButton(CoreButton button) {
+    switch (button) {
+        case CORE_BTN_NEXT: {
+            bool wasRunning = m_fencingTimer.isTimerRunning();
+            m_toneEngine.play(TONE_CONFIRM);
+            if (m_judge.locked()) {
+                Serial.println("[按键] 下一分准备 (灭灯)");
+                resetMatch(false);
+                if (!m_fencingTimer.isTimerRunning()) {
+                    m_fencingTimer.toggleStartPause();
+                    Serial.println("[计时] 恢复比赛计时");
+                }
+            } else {
+                m_fencingTimer.toggleStartPause();
+                Serial.printf("[计时] %s\n", m_fencingTimer.isTimerRunning() ? "开始" : "暂停");
+            }
+            if (!wasRunning && m_fencingTimer.isTimerRunning() && m_timerStartCallback != nullptr) {
+                m_timerStartCallback(millis());
+            }
+            break;
+        }
+        case CORE_BTN_RESET:
+            Serial.println("[按键] 全局重置 (分数+时间)");
+            if (m_statsPrinter != nullptr && m_boutStats.verdicts() > 0) m_boutStats.report(m_statsPrinter, "本局", millis());
+            m_boutStats.reset();
+            resetMatch(true);
+            m_fencingTimer.resetTimer();
+            break;
+        case CORE_BTN_PHASE:
+            m_fencingTimer.nextPhase();
+            Serial.println(m_fencingTimer.isResting() ? "[计时] 进入休息模式" : "[计时] 重回比赛模式");
+            break;
+        case CORE_BTN_MODE:
+            m_fencingTimer.toggleDurationMode();
+            Serial.printf("[计时] 切换至 %d 分钟赛制\n", m_fencingTimer.getCurrentDurationMode());
+            break;
+        case CORE_BTN_RED_ADD:   Serial.println("[按键] 手动红方+1分"); m_scoreManager.addRedScore(); break;
+        case CORE_BTN_RED_SUB:   Serial.println("[按键] 手动红方-1分"); m_scoreManager.subtractRedScore(); break;
+        case CORE_BTN_GREEN_ADD: Serial.println("[按键] 手动绿方+1分"); m_scoreManager.addGreenScore(); break;
+        case CORE_BTN_GREEN_SUB: Serial.println("[按键] 手动绿方-1分"); m_scoreManager.subtractGreenScore(); break;
+        default:
+            break;
+    }
+}
+
+void FencingCore::injectButton(CoreButton button) {
+    if ((int)button < 0 || button >= CORE_BTN_COUNT) return;
+    __atomic_fetch_or(&m_injectedButtons, 1u << button, __ATOMIC_ACQ_REL);
+}
+
+void FencingCore::notifyVerdict(const JudgeVerdict& verdict) {
+    if (m_verdictCallback == nullptr) return;
+    CoreVerdict v;
+    v.redLamp = verdict.red;
+    v.greenLamp = verdict.green;
+    v.amended = verdict.amended;
+    v.redScore = m_scoreManager.getRedScore();
+    v.greenScore = m_scoreManager.getGreenScore();
+    v.firstHitMs = verdict.firstHitMs;
+    m_verdictCallback(v);
+}
+
 void FencingCore::setRedHit() {
-    if (!m_isLocked) {
+    setRedHit(millis(), false);
+}
+
+void FencingCore::setGreenHit() {
+    setGreenHit(millis(), false);
+}
+
+void FencingCore::setRedHit(uint32_t hitTimeMs, bool late) {
+    if (!m_judge.locked() || late) {
+        m_redHitTimestamp = hitTimeMs;
+        m_redHitLate = late;
         m_redHitRaw = true;
-        m_redHitTimestamp = millis();
-        Serial.printf("[信号] red击中信号触发 时间戳: %u\n", m_redHitTimestamp);
+        Serial.printf("[信号] red击中信号触发 时间戳: %u%s\n", m_redHitTimestamp, late ? " (补发)" : "");
     }
 }
 
-void FencingCore::setGreenHit() {
-    if (!m_isLocked) {
+void FencingCore::setGreenHit(uint32_t hitTimeMs, bool late) {
+    if (!m_judge.locked() || late) {
+        m_greenHitTimestamp = hitTimeMs;
+        m_greenHitLate = late;
         m_greenHitRaw = true;
-        m_greenHitTimestamp = millis();
-        Serial.printf("[信号] green击中信号触发 时间戳: %u\n", m_greenHitTimestamp);
+        Serial.printf("[信号] green击中信号触发 时间戳: %u%s\n", m_greenHitTimestamp, late ? " (补发)" : "");
     }
 }
 
 void FencingCore::resetMatch(bool total) {
     m_scoreManager.reset(total);
-    m_isLocked = false;
-    m_redHitReceived = false;
-    m_greenHitReceived = false;
-    m_firstHitTime = 0;
+    m_judge.reset();
     m_redHitRaw = false;
     m_greenHitRaw = false;
     digitalWrite(PIN_RED_LED, LOW);
     digitalWrite(PIN_GRN_LED, LOW);
-    digitalWrite(PIN_BUZZER, LOW);
+    m_toneEngine.stop();
     m_effectActive = false;
 
     int red = m_scoreManager.getRedScore();
@@ -233,6 +307,42 @@ void FencingCore::resetMatch(bool total) {
     Serial.printf("[系统] %s | 比分: 红%d - 绿%d\n", total ? "全部重置" : "下一分开始", red, green);
 }
 
+// 读取状态快照：字段各自原子读取，跨核读取只用于显示
+void FencingCore::getBoutState(BoutState& out) {
+    out.redScore = m_scoreManager.getRedScore();
+    out.greenScore = m_scoreManager.getGreenScore();
+    out.redLamp = m_effectActive && m_judge.received(JUDGE_RED);
+    out.greenLamp = m_effectActive && m_judge.received(JUDGE_GREEN);
+    out.locked = m_judge.locked();
+    out.timerRunning = m_fencingTimer.isTimerRunning();
+    out.resting = m_fencingTimer.isResting();
+    out.remainingSeconds = m_fencingTimer.getRemainingSeconds();
+}
+
+void FencingCore::getMirrorState(MirrorState& out) {
+    getBoutState(out.bout);
+    out.savedMatchSeconds = m_fencingTimer.getSavedMatchSeconds();
+    out.maxDurationSeconds = m_fencingTimer.getMaxDurationSeconds();
+}
+
+void FencingCore::applyMirrorState(const MirrorState& st) {
+    if (st.bout.redScore != m_scoreManager.getRedScore() || st.bout.greenScore != m_scoreManager.getGreenScore()) {
+        m_scoreManager.setScores(st.bout.redScore, st.bout.greenScore);
+    }
+    m_fencingTimer.restore(st.bout.remainingSeconds, st.bout.timerRunning, st.bout.resting,
+                           st.savedMatchSeconds, st.maxDurationSeconds);
+    m_judge.restore(st.bout.locked, st.bout.redLamp, st.bout.greenLamp);
+    m_redHitRaw = false;
+    m_greenHitRaw = false;
+}
+
+void FencingCore::reportStats(CorePrintFn printFn) {
+    BoutStats bout = m_boutStats;
+    BoutStats session = m_sessionStats;
+    bout.report(printFn, "本局", millis());
+    session.report(printFn, "上电以来", millis());
+}
+
 void FencingCore::onScoreChanged(int redScore, int greenScore, bool isReset) {
     if (isReset) {
         Serial.printf("[比分回调] 分数重置 | 红%d - 绿%d\n", redScore, greenScore);
@@ -245,32 +355,56 @@ void FencingCore::onScoreChanged(int redScore, int greenScore, bool isReset) {
     }
 }
 
-void FencingCore::evaluateHit() {
-    m_isLocked = true;
+// 判定引擎出判定或补判（判定任务里回调）：声光、计分、统计
+void FencingCore::applyVerdict(const JudgeVerdict& v) {
+    if (v.amended) {
+        // 判定后才到的补发击中落在本剑窗口内：改判为双方同时击中
+        const char* side = v.amendRed ? "red" : "green";
+        int diff = v.amendRed ? v.redMinusGreenMs : -v.redMinusGreenMs;
+        m_boutStats.amended(v.amendRed, v.redMinusGreenMs);
+        m_sessionStats.amended(v.amendRed, v.redMinusGreenMs);
+        m_toneEngine.play(TONE_DOUBLE_TOUCH, true);
+        if (v.amendRed) {
+            m_scoreManager.addRedScore();
+            digitalWrite(PIN_RED_LED, HIGH);
+        } else {
+            m_scoreManager.addGreenScore();
+            digitalWrite(PIN_GRN_LED, HIGH);
+        }
+        Serial.printf("[补判] %s迟到击中在窗口内 (差 %d 毫秒)，改判双方同时击中 | 比分: 红%d - 绿%d\n",
+                      side, diff, m_scoreManager.getRedScore(), m_scoreManager.getGreenScore());
+        notifyVerdict(v);
+        return;
+    }
+
     m_hitEffectStartTime = millis();
     m_effectActive = true;
-    digitalWrite(PIN_BUZZER, HIGH);
+    m_toneEngine.play((v.red && v.green) ? TONE_DOUBLE_TOUCH : TONE_TOUCH, true);
 
     if (m_fencingTimer.isTimerRunning()) {
         m_fencingTimer.toggleStartPause();
     }
 
-    if (m_redHitReceived && m_greenHitReceived) {
+    if (v.red && v.green) {
         m_scoreManager.addBothScores();
         digitalWrite(PIN_RED_LED, HIGH);
         digitalWrite(PIN_GRN_LED, HIGH);
-        Serial.printf("[裁判] 双方同时击中! (时间差: %d 毫秒)\n", abs((int)(m_redHitTimestamp - m_greenHitTimestamp)));
-    } else if (m_redHitReceived) {
+        Serial.printf("[裁判] 双方同时击中! (时间差: %d 毫秒)\n", abs((int)v.redMinusGreenMs));
+    } else if (v.red) {
         m_scoreManager.addRedScore();
         digitalWrite(PIN_RED_LED, HIGH);
         Serial.println("[裁判] red得分");
-    } else if (m_greenHitReceived) {
+    } else if (v.green) {
         m_scoreManager.addGreenScore();
         digitalWrite(PIN_GRN_LED, HIGH);
         Serial.println("[裁判] green得分");
     }
-    
+
+    m_boutStats.verdict(v.red, v.green, v.redMinusGreenMs, v.firstHitMs);
+    m_sessionStats.verdict(v.red, v.green, v.redMinusGreenMs, v.firstHitMs);
+
     int red = m_scoreManager.getRedScore();
     int green = m_scoreManager.getGreenScore();
     Serial.printf("[比分] red %d : %d green\n", red, green);
+    notifyVerdict(v);
 }
\ No newline at end of file
@@ -5,6 +5,64 @@
 #include "ScoreManager.h"
 #include "ScoreDisplay.h"
 #include "FencingTimer.h"
+#include "ToneEngine.h"
+#include "BoutStats.h"
+#include "EpeeJudge.h"
+
+// 比赛状态快照（供计分板等外部输出读取，不参与判定）
+struct BoutState {
+    int redScore;
+    int greenScore;
+    bool redLamp;           // 红灯亮（本剑判定红方得分）
+    bool greenLamp;
+    bool locked;            // 已判定，等待下一分
+    bool timerRunning;
+    bool resting;           // 休息计时中
+    int remainingSeconds;
+};
+
+// 热备镜像用的状态：比 BoutState 多出比赛断点和局时长，接管后切阶段/重置与主用一致
+struct MirrorState {
+    BoutState bout;
+    int savedMatchSeconds;
+    int maxDurationSeconds;
+};
+
+// 按键编号（串口注入按编号模拟按下，与实体按键走同一处理）
+enum CoreButton {
+    CORE_BTN_NEXT = 0,
+    CORE_BTN_RESET,
+    CORE_BTN_PHASE,
+    CORE_BTN_MODE,
+    CORE_BTN_RED_ADD,
+    CORE_BTN_RED_SUB,
+    CORE_BTN_GREEN_ADD,
+    CORE_BTN_GREEN_SUB,
+    CORE_BTN_COUNT
+};
+
+// 一次判定结果（判定或补判完成后回调，在判定任务里调用，回调里不要阻塞）
+struct CoreVerdict {
+    bool redLamp;
+    bool greenLamp;
+    bool amended;           // 迟到补发改判为双方同时击中
+    int redScore;
+    int greenScore;
+    uint32_t firstHitMs;    // 本剑首击时间（主机时间基准）
+};
+typedef void (*VerdictCallback)(const CoreVerdict& verdict);
+
+// 击中交给判定引擎（判定任务里回调，回调里不要阻塞）
+struct CoreTouch {
+    bool red;
+    bool late;              // 补发迟到
+    uint8_t result;         // JudgeHitResult
+    uint32_t hitTimeMs;     // 主机时间基准
+};
+typedef void (*TouchCallback)(const CoreTouch& touch);
+// 比赛计时开始/恢复（判定任务里回调，nowMs 为按键处理时的 millis()）
+typedef void (*TimerStartCallback)(uint32_t nowMs);
+typedef void (*CorePrintFn)(const char* format, ...);
 
 class FencingCore {
 public:
@@ -39,9 +97,25 @@ public:
     void checkButtons();
     void setRedHit();
     void setGreenHit();
+    // 带击中时间的版本：时间为主机时间基准，late=补发迟到（锁定后仍可在窗口内补判）
+    void setRedHit(uint32_t hitTimeMs, bool late);
+    void setGreenHit(uint32_t hitTimeMs, bool late);
     void resetMatch(bool total);
-    bool isLocked() const { return m_isLocked; }
+    bool isLocked() const { return m_judge.locked(); }
     bool isTimerRunning() const { return m_fencingTimer.isTimerRunning(); } // const 匹配
+    void getBoutState(BoutState& out);
+    void getMirrorState(MirrorState& out);
+    // 热备主机套用主用主机的状态：只改比分/计时/锁定，不亮灯不响（在判定任务里调用）
+    void applyMirrorState(const MirrorState& st);
+    // 模拟按下一个按键（任意任务可调用，下一次 checkButtons 时处理）
+    void injectButton(CoreButton button);
+    void setVerdictCallback(VerdictCallback cb) { m_verdictCallback = cb; }
+    void setTouchCallback(TouchCallback cb) { m_touchCallback = cb; }
+    void setTimerStartCallback(TimerStartCallback cb) { m_timerStartCallback = cb; }
+    // 比赛统计：全局重置时用 printFn 打印本局统计（不设置则不打印）
+    void setStatsPrinter(CorePrintFn printFn) { m_statsPrinter = printFn; }
+    // 打印本局和上电以来的统计（跨核读取，只用于显示）
+    void reportStats(CorePrintFn printFn);
 
 private:
     // ===================== 私有成员（不变）=====================
@@ -55,21 +129,40 @@ private:
     ScoreManager m_scoreManager;
     ScoreDisplay m_scoreDisplay;
     FencingTimer m_fencingTimer;
+    ToneEngine m_toneEngine;
 
     volatile bool m_redHitRaw;
     volatile bool m_greenHitRaw;
     volatile uint32_t m_redHitTimestamp;
     volatile uint32_t m_greenHitTimestamp;
-    unsigned long m_firstHitTime;
-    bool m_isLocked;
-    bool m_redHitReceived;
-    bool m_greenHitReceived;
+    volatile bool m_redHitLate;
+    volatile bool m_greenHitLate;
     bool m_effectActive;
     unsigned long m_hitEffectStartTime;
+    volatile uint32_t m_injectedButtons;   // bit n = CoreButton n 待处理
+    VerdictCallback m_verdictCallback;
+    TouchCallback m_touchCallback;
+    TimerStartCallback m_timerStartCallback;
+    BoutStats m_boutStats;                 // 本局（全局重置时打印并清零）
+    BoutStats m_sessionStats;              // 上电以来
+    CorePrintFn m_statsPrinter;
+
+    // 判定引擎（EpeeJudge.h，各主机目标共用）：时钟取 millis()，判定/补判回调 applyVerdict
+    struct JudgeClock {
+        uint32_t now() const { return millis(); }
+    };
+    struct JudgeSink {
+        FencingCore* core;
+        void onVerdict(const JudgeVerdict& v) { core->applyVerdict(v); }
+    };
+    EpeeJudge<JudgeClock, JudgeSink> m_judge;
 
     // ===================== 内部方法（新增静态回调）=====================
     void onScoreChanged(int redScore, int greenScore, bool isReset);
-    void evaluateHit();
+    void feedHit(uint8_t side, uint32_t timestamp, bool late);
+    void applyVerdict(const JudgeVerdict& v);
+    void pressButton(CoreButton button);
+    void notifyVerdict(const JudgeVerdict& v);
     // 静态回调函数（适配ScoreManager的普通函数指针）
     static void staticScoreChangeCallback(int red, int green, bool isReset);
 };
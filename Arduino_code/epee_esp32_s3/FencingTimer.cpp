@@ -92,6 +92,21 @@ void FencingTimer::toggleDurationMode() {
     resetTimer();
 }
 
+void FencingTimer::restore(int remaining, bool running, bool resting, int savedMatch, int maxDuration) {
+    isRestMode = resting;
+    savedMatchSeconds = savedMatch;
+    currentMaxDuration = maxDuration;
+    if (running != isRunning) {
+        isRunning = running;
+        lastTick = millis();
+    }
+    if (remaining != remainingSeconds) {
+        remainingSeconds = remaining;
+        lastTick = millis(); // 接管后从这一秒重新计
+        refreshDisplay();
+    }
+}
+
 void FencingTimer::refreshDisplay() {
     int minutes = remainingSeconds / 60;
     int seconds = remainingSeconds % 60;
@@ -101,4 +116,5 @@ void FencingTimer::refreshDisplay() {
 
 bool FencingTimer::isTimerRunning() const { return isRunning; }
 int FencingTimer::getCurrentDurationMode() { return currentMaxDuration / 60; }
-bool FencingTimer::isResting() { return isRestMode; }
\ No newline at end of file
+bool FencingTimer::isResting() { return isRestMode; }
+int FencingTimer::getRemainingSeconds() const { return remainingSeconds; }
\ No newline at end of file
@@ -24,6 +24,11 @@ public:
   bool isTimerRunning() const;
   int getCurrentDurationMode();
   bool isResting(); 
+  int getRemainingSeconds() const;
+  int getSavedMatchSeconds() const { return savedMatchSeconds; }
+  int getMaxDurationSeconds() const { return currentMaxDuration; }
+  // 热备镜像：直接套用主用主机的计时状态，秒数变了才刷新显示
+  void restore(int remaining, bool running, bool resting, int savedMatch, int maxDuration);
 
 private:
   TM1637Display display;
@@ -0,0 +1,157 @@
+#include "HitLink.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+HitLink::HitLink() {
+  memset(m_side, 0, sizeof(m_side));
+}
+
+void HitLink::resetStats() {
+  for (int i = 0; i < 2; i++) {
+    memset(&m_side[i].stats, 0, sizeof(HitLinkStats));
+  }
+}
+
+// 逐段解析 key:value，未知字段忽略，保证以后加字段旧主机也能用
+bool HitLink::parseFrame(const uint8_t* data, size_t len, HitFrame& out) {
+  if (data == nullptr || len == 0) return false;
+  char buf[96];
+  if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+  memcpy(buf, data, len);
+  buf[len] = '\0';
+
+  memset(&out, 0, sizeof(out));
+  bool hasTime = false;
+  bool hasSid = false;
+  bool hasOld = false;
+  char* save = nullptr;
+  for (char* tok = strtok_r(buf, "|", &save); tok != nullptr; tok = strtok_r(nullptr, "|", &save)) {
+    char* colon = strchr(tok, ':');
+    if (colon == nullptr) continue;
+    *colon = '\0';
+    const char* key = tok;
+    const char* val = colon + 1;
+    if (strcmp(key, "time") == 0) {
+      out.pointerTimeMs = strtoul(val, nullptr, 10);
+      hasTime = true;
+    } else if (strcmp(key, "RED") == 0 || strcmp(key, "GREEN") == 0) {
+      out.score = (uint16_t)strtoul(val, nullptr, 10);
+    } else if (strcmp(key, "seq") == 0) {
+      out.seq = (uint16_t)strtoul(val, nullptr, 10);
+      out.hasSeq = true;
+    } else if (strcmp(key, "sid") == 0) {
+      out.sid = (uint16_t)strtoul(val, nullptr, 16);
+      hasSid = true;
+    } else if (strcmp(key, "age") == 0) {
+      out.ageMs = strtoul(val, nullptr, 10);
+    } else if (strcmp(key, "old") == 0) {
+      out.oldest = (uint16_t)strtoul(val, nullptr, 10);
+      hasOld = true;
+    } else if (strcmp(key, "clk") == 0) {
+      out.pointerTimeMs = strtoul(val, nullptr, 10);
+      out.isClock = true;
+    }
+  }
+  if (out.isClock) return hasSid && !hasTime;
+  // 序号要配会话号和最旧序号才能去重/确认，缺一个按旧固件处理
+  if (out.hasSeq && (!hasSid || !hasOld)) out.hasSeq = false;
+  return hasTime;
+}
+
+bool HitLink::isReceived(const SideState& st, uint16_t seq) {
+  int16_t back = (int16_t)(st.highest - seq);
+  if (back < 0) return false;
+  if (back >= HIT_DEDUP_WINDOW) return true; // 窗口外的早已确认过
+  return (st.mask >> back) & 1u;
+}
+
+HitFrameResult HitLink::accept(HitSide side, const HitFrame& frame, uint32_t arrivalMs, uint32_t& hitTimeMs) {
+  SideState& st = m_side[side];
+  if (frame.isClock) {
+    trackClock(st, frame.sid, arrivalMs - frame.pointerTimeMs, arrivalMs);
+    return HIT_FRAME_CLOCK;
+  }
+  st.stats.received++;
+
+  // 旧固件：没有序号，按到达时间处理
+  if (!frame.hasSeq) {
+    hitTimeMs = arrivalMs;
+    return HIT_FRAME_FRESH;
+  }
+
+  bool newSession = !st.synced || st.sid != frame.sid;
+  if (newSession) {
+    // 新会话（首次、剑端重启或主机重启）：确认起点是剑端声明的最旧序号之前，之后的缺口等补发
+    st.synced = true;
+    st.sid = frame.sid;
+    st.highest = frame.seq;
+    st.mask = 1;
+    st.ackSeq = (uint16_t)(frame.oldest - 1);
+  }
+  // 每帧击中（含重复帧）也是一次时钟样本
+  trackClock(st, frame.sid, arrivalMs - frame.ageMs - frame.pointerTimeMs, arrivalMs);
+  if (!newSession) {
+    int16_t ahead = (int16_t)(frame.seq - st.highest);
+    if (ahead > 0) {
+      st.mask = (ahead >= HIT_DEDUP_WINDOW) ? 0 : (st.mask << ahead);
+      st.mask |= 1;
+      st.highest = frame.seq;
+    } else {
+      int16_t back = -ahead;
+      if (back >= HIT_DEDUP_WINDOW || ((st.mask >> back) & 1u)) {
+        // 重复：剑端没收到确认才会重发，再确认一次
+        st.stats.duplicates++;
+        st.ackDirty = true;
+        return HIT_FRAME_DUPLICATE;
+      }
+      st.mask |= (1u << back);
+    }
+  }
+
+  // 剑端不再持有的序号（被另一台主机确认过，或暂存溢出丢弃）不会再来，确认起点跟上，免得卡在缺口
+  if ((int16_t)(frame.oldest - 1 - st.ackSeq) > 0 && (int16_t)(st.highest - (frame.oldest - 1)) >= 0) {
+    st.ackSeq = (uint16_t)(frame.oldest - 1);
+  }
+  while (isReceived(st, (uint16_t)(st.ackSeq + 1)) && st.ackSeq != st.highest) {
+    st.ackSeq++;
+  }
+  st.ackDirty = true;
+
+  // 剑端击中时刻换算到主机时间基准：按时钟差估计，本帧多出来的空口时延（排队、链路层重传）不算进去
+  hitTimeMs = frame.pointerTimeMs + st.clockOffset;
+  if (frame.ageMs > HIT_STALE_MS) {
+    st.stats.stale++;
+    return HIT_FRAME_STALE;
+  }
+  if (frame.ageMs > HIT_LATE_MS) {
+    st.stats.late++;
+    return HIT_FRAME_LATE;
+  }
+  return HIT_FRAME_FRESH;
+}
+
+// 样本 = 到达 - 剑端发送时刻 = 两边时钟差 + 本帧空口时延，取最小的（空口最快的一帧）；
+// 估计值按 HIT_CLOCK_CREEP_MS 缓慢上浮，跟上两边晶振的相对漂移（反方向的漂移由新样本取最小跟上）
+void HitLink::trackClock(SideState& st, uint16_t sid, uint32_t sample, uint32_t arrivalMs) {
+  if (!st.clockSet || st.clockSid != sid) {
+    st.clockSet = true;
+    st.clockSid = sid;
+    st.clockOffset = sample;
+    st.clockAtMs = arrivalMs;
+    return;
+  }
+  uint32_t creep = (arrivalMs - st.clockAtMs) / HIT_CLOCK_CREEP_MS;
+  st.clockOffset += creep;
+  st.clockAtMs += creep * HIT_CLOCK_CREEP_MS;
+  if ((int32_t)(sample - st.clockOffset) < 0) st.clockOffset = sample;
+}
+
+bool HitLink::takeAck(HitSide side, char* buf, size_t len) {
+  SideState& st = m_side[side];
+  if (!st.ackDirty) return false;
+  st.ackDirty = false;
+  st.stats.acks++;
+  snprintf(buf, len, "ack:%u", (unsigned)st.ackSeq);
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef HIT_LINK_H
+#define HIT_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 击中帧接收：解析、按序号去重、累积确认、迟到判定
+// 不依赖 Arduino.h，时间由调用方传入，主机端仿真可直接编译
+
+#define HIT_LATE_MS       60    // 击中到发送超过这个时间，视为补发迟到（按击中时间判定）
+#define HIT_STALE_MS      3000  // 超过这个时间的补发只记录，不再参与判定
+#define HIT_DEDUP_WINDOW  32    // 去重窗口（序号个数）
+#define HIT_CLOCK_CREEP_MS 10000 // 剑端时钟差估计每这么多毫秒上浮 1ms（100ppm，盖住两边晶振的相对漂移）
+
+enum HitSide {
+  HIT_SIDE_RED = 0,
+  HIT_SIDE_GREEN = 1
+};
+
+enum HitFrameResult {
+  HIT_FRAME_FRESH,      // 正常送达
+  HIT_FRAME_LATE,       // 补发迟到，仍按击中时间参与判定
+  HIT_FRAME_STALE,      // 太旧的补发，只记录
+  HIT_FRAME_DUPLICATE,  // 重复帧，丢弃（并重发确认）
+  HIT_FRAME_MALFORMED,  // 格式错误
+  HIT_FRAME_CLOCK       // 时钟样本帧（不是击中），只更新时钟差估计
+};
+
+// 一帧击中数据："time:<ms>|RED:<分>|seq:<序号>|sid:<会话>|age:<击中到发送ms>|old:<暂存环最旧序号>"
+// old 之前的序号剑端已不再持有（确认过或暂存溢出丢弃），主机的累积确认从这里接上，不会确认没收到的序号
+// 时钟样本帧："clk:<剑端发送时 millis>|sid:<会话>"（剑端收到 hello 后发几帧，没有 time: 字段，旧主机当格式错误丢弃）
+struct HitFrame {
+  uint32_t pointerTimeMs;  // 击中时剑端 millis()
+  uint16_t score;
+  uint16_t seq;
+  uint16_t sid;
+  uint32_t ageMs;          // 击中到本帧发出经过的时间
+  uint16_t oldest;         // 剑端暂存环里最旧的未确认序号（含本帧）
+  bool hasSeq;             // 旧固件只有 time/分数，没有序号
+  bool isClock;            // 时钟样本帧：pointerTimeMs 为发送时刻
+};
+
+// 单方链路计数
+struct HitLinkStats {
+  uint32_t received;    // 收到的帧
+  uint32_t duplicates;  // 重复帧（剑端重发且主机已收过）
+  uint32_t late;        // 迟到补发
+  uint32_t stale;       // 过期补发
+  uint32_t malformed;   // 格式错误
+  uint32_t authFailed;  // 认证标签校验失败（已配对的一方）
+  uint32_t acks;        // 发出的确认
+};
+
+class HitLink {
+public:
+  HitLink();
+
+  // 解析一帧，失败返回 false
+  static bool parseFrame(const uint8_t* data, size_t len, HitFrame& out);
+
+  // 接收一帧：去重并换算成主机时间基准下的击中时间 hitTimeMs（按本会话时钟样本和各帧估出的剑端时钟差）
+  HitFrameResult accept(HitSide side, const HitFrame& frame, uint32_t arrivalMs, uint32_t& hitTimeMs);
+
+  // 记录一帧格式错误
+  void countMalformed(HitSide side) { m_side[side].stats.malformed++; }
+
+  // 记录一帧认证失败
+  void countAuthFailed(HitSide side) { m_side[side].stats.authFailed++; }
+
+  // 有待发确认时写入 "ack:<序号>" 并返回 true
+  bool takeAck(HitSide side, char* buf, size_t len);
+
+  const HitLinkStats& stats(HitSide side) const { return m_side[side].stats; }
+  void resetStats();
+
+private:
+  struct SideState {
+    bool synced;       // 已收到过带序号的帧
+    uint16_t sid;      // 当前会话号（剑端重启后改变）
+    uint16_t highest;  // 收到的最大序号
+    uint32_t mask;     // bit n = highest-n 已收到
+    uint16_t ackSeq;   // 连续收到的最大序号（累积确认）
+    bool ackDirty;     // 需要发确认
+    bool clockSet;        // clockSid 会话已有时钟差估计
+    uint16_t clockSid;    // 时钟差估计所属会话（时钟样本可能先于该会话的第一帧击中到达）
+    uint32_t clockOffset; // 主机 millis - 剑端 millis（含最小空口时延，两方相当，判定时抵消）
+    uint32_t clockAtMs;   // 估计值上次上浮的主机时刻
+    HitLinkStats stats;
+  };
+
+  SideState m_side[2];
+
+  static bool isReceived(const SideState& st, uint16_t seq);
+  static void trackClock(SideState& st, uint16_t sid, uint32_t sample, uint32_t arrivalMs);
+};
+
+#endif // HIT_LINK_H
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include "InjectPort.h"
+#include <string.h>
+
+InjectParser::InjectParser() : m_state(WAIT_SYNC0), m_pos(0), m_crcErrors(0) {
+  memset(&m_msg, 0, sizeof(m_msg));
+}
+
+uint8_t InjectParser::crc8(const uint8_t* data, size_t len, uint8_t crc) {
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+size_t InjectParser::encode(uint8_t type, const void* payload, uint8_t len, uint8_t* out, size_t cap) {
+  if (len > INJECT_MAX_PAYLOAD || cap < (size_t)len + 5) return 0;
+  out[0] = INJECT_SYNC0;
+  out[1] = INJECT_SYNC1;
+  out[2] = type;
+  out[3] = len;
+  if (len > 0) memcpy(out + 4, payload, len);
+  out[4 + len] = crc8(out + 2, len + 2);
+  return len + 5;
+}
+
+bool InjectParser::feed(uint8_t b, InjectMsg& out) {
+  switch (m_state) {
+    case WAIT_SYNC0:
+      if (b == INJECT_SYNC0) m_state = WAIT_SYNC1;
+      return false;
+    case WAIT_SYNC1:
+      // A5 A5 5A 也能同步上
+      if (b == INJECT_SYNC1) m_state = WAIT_TYPE;
+      else if (b != INJECT_SYNC0) m_state = WAIT_SYNC0;
+      return false;
+    case WAIT_TYPE:
+      m_msg.type = b;
+      m_state = WAIT_LEN;
+      return false;
+    case WAIT_LEN:
+      if (b > INJECT_MAX_PAYLOAD) {
+        m_crcErrors++;
+        m_state = WAIT_SYNC0;
+        return false;
+      }
+      m_msg.len = b;
+      m_pos = 0;
+      m_state = (b == 0) ? WAIT_CRC : WAIT_PAYLOAD;
+      return false;
+    case WAIT_PAYLOAD:
+      m_msg.payload[m_pos++] = b;
+      if (m_pos >= m_msg.len) m_state = WAIT_CRC;
+      return false;
+    case WAIT_CRC: {
+      m_state = WAIT_SYNC0;
+      uint8_t hdr[2] = {m_msg.type, m_msg.len};
+      uint8_t crc = crc8(m_msg.payload, m_msg.len, crc8(hdr, 2));
+      if (crc != b) {
+        m_crcErrors++;
+        return false;
+      }
+      out = m_msg;
+      return true;
+    }
+  }
+  return false;
+}
\ No newline at end of file
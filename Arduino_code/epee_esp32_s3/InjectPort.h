@@ -0,0 +1,154 @@
+#ifndef INJECT_PORT_H
+#define INJECT_PORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 串口二进制注入口：压测/硬件在环时由 Linux 脚本高速注入合成击中、按键、链路事件，
+// 主机回传判定结果和各段耗时。与 ASCII 单字符命令共用串口：帧以 0xA5 0x5A 开头，
+// 其他字节仍按单字符命令处理
+// 帧格式：A5 5A <类型> <长度> <负载...> <CRC8>，CRC8(多项式 0x07) 覆盖 类型+长度+负载
+// 负载为小端紧凑结构体（ESP32 与 x86 主机字节序相同）
+// 不依赖 Arduino.h，主机端工具直接包含
+
+#define INJECT_SYNC0        0xA5
+#define INJECT_SYNC1        0x5A
+#define INJECT_MAX_PAYLOAD  32
+#define INJECT_FRAME_MAX    (INJECT_MAX_PAYLOAD + 5)
+
+enum InjectType {
+  // 主机 → 设备
+  INJECT_TOUCH   = 0x01,  // 合成击中：按剑端帧格式走认证/去重/补发/判定全路径
+  INJECT_BUTTON  = 0x02,  // 按键：进入 FencingCore 按键处理（跳过消抖）
+  INJECT_LINK    = 0x03,  // 链路事件
+  INJECT_CONFIG  = 0x04,  // 注入模式设置
+  INJECT_ECHO    = 0x05,  // 回显（测串口往返）
+  INJECT_STATS   = 0x06,  // 查询统计
+  // 设备 → 主机
+  INJECT_TOUCH_ACK = 0x81,  // 击中已处理（交给判定核心或被丢弃）
+  INJECT_VERDICT   = 0x82,  // 判定结果
+  INJECT_ECHO_REPLY = 0x85,
+  INJECT_STATS_REPLY = 0x86
+};
+
+// 按键编号（与 FencingCore::CoreButton 一致）
+enum InjectButtonId {
+  INJECT_BTN_NEXT = 0,
+  INJECT_BTN_RESET,
+  INJECT_BTN_PHASE,
+  INJECT_BTN_MODE,
+  INJECT_BTN_RED_ADD,
+  INJECT_BTN_RED_SUB,
+  INJECT_BTN_GREEN_ADD,
+  INJECT_BTN_GREEN_SUB,
+  INJECT_BTN_COUNT
+};
+
+enum InjectLinkEvent {
+  INJECT_LINK_DROP = 0,   // 断开该方真实蓝牙连接（走正常掉线/重连流程）
+  INJECT_LINK_RESCAN = 1  // 清零重试次数，立即重新扫描
+};
+
+// 击中处理结果（INJECT_TOUCH_ACK.result），前几项与 HitFrameResult 一致
+enum InjectTouchResult {
+  INJECT_RESULT_FRESH = 0,
+  INJECT_RESULT_LATE,
+  INJECT_RESULT_STALE,
+  INJECT_RESULT_DUPLICATE,
+  INJECT_RESULT_MALFORMED,
+  INJECT_RESULT_AUTH_FAILED,
+  INJECT_RESULT_NOT_READY,  // 判定核心未就绪
+  INJECT_RESULT_CLOCK       // 剑端时钟样本帧，不是击中（注入不会产生）
+};
+
+#define INJECT_NO_SEQ  0xFFFF    // 判定结果里该方没有注入的击中
+
+#pragma pack(push, 1)
+struct InjectTouchMsg {
+  uint8_t side;      // HitSide
+  uint16_t seq;      // 同时作为回传标签；重复序号用来测去重
+  uint16_t ageMs;    // 击中到“发送”经过的时间，>60 走补发迟到路径
+};
+
+struct InjectButtonMsg {
+  uint8_t button;    // InjectButtonId
+};
+
+struct InjectLinkMsg {
+  uint8_t side;
+  uint8_t event;     // InjectLinkEvent
+};
+
+struct InjectConfigMsg {
+  uint8_t quiet;     // 1=关闭 lockedPrintf 日志（高速注入时串口带宽留给回传帧）
+};
+
+struct InjectEchoMsg {
+  uint32_t hostUs;   // 原样返回
+};
+
+struct InjectTouchAckMsg {
+  uint16_t seq;
+  uint8_t side;
+  uint8_t result;    // InjectTouchResult
+  uint32_t handleUs; // 收到注入帧 → 交给判定核心（或丢弃）的耗时
+};
+
+struct InjectVerdictMsg {
+  uint32_t deviceMs;     // 判定时设备 millis()
+  uint16_t redSeq;       // 计入本次判定的注入击中序号（INJECT_NO_SEQ=非注入或未亮灯）
+  uint16_t greenSeq;
+  uint32_t latencyUs;    // 本剑第一个注入击中到达串口 → 判定完成（含 45ms 判定等待和显示更新）
+  uint8_t lamps;         // bit0=红灯 bit1=绿灯
+  uint8_t amended;       // 1=迟到补发改判为双方同时击中
+  uint8_t redScore;
+  uint8_t greenScore;
+};
+
+struct InjectStatsMsg {
+  uint32_t touches;        // 收到的注入击中
+  uint32_t verdicts;       // 回传的判定
+  uint32_t verdictDrops;   // 判定队列满被丢弃
+  uint32_t crcErrors;      // 注入帧校验失败
+  uint32_t logicLoops;     // 判定循环次数
+  uint32_t logicMaxLateUs; // 判定循环超出周期的最大值
+  uint32_t boardSkipped;   // 计分板背压跳过（未开计分板为 0）
+  uint8_t locked;
+  uint8_t timerRunning;
+};
+#pragma pack(pop)
+
+// 一条解析完成的注入帧
+struct InjectMsg {
+  uint8_t type;
+  uint8_t len;
+  uint8_t payload[INJECT_MAX_PAYLOAD];
+};
+
+// 逐字节解析；返回 true 表示 out 里是一条完整且校验通过的帧
+class InjectParser {
+public:
+  InjectParser();
+
+  bool feed(uint8_t b, InjectMsg& out);
+
+  // 空闲（不在帧内）时收到的非同步字节交给 ASCII 命令处理
+  bool idle() const { return m_state == WAIT_SYNC0; }
+
+  uint32_t crcErrors() const { return m_crcErrors; }
+
+  static uint8_t crc8(const uint8_t* data, size_t len, uint8_t crc = 0);
+
+  // 编码一帧，返回总长度（cap 不够返回 0）
+  static size_t encode(uint8_t type, const void* payload, uint8_t len, uint8_t* out, size_t cap);
+
+private:
+  enum State { WAIT_SYNC0, WAIT_SYNC1, WAIT_TYPE, WAIT_LEN, WAIT_PAYLOAD, WAIT_CRC };
+
+  State m_state;
+  uint8_t m_pos;
+  uint32_t m_crcErrors;
+  InjectMsg m_msg;
+};
+
+#endif // INJECT_PORT_H
\ No newline at end of file
@@ -0,0 +1,131 @@
+#include "LinkMonitor.h"
+#include <string.h>
+#include <stdio.h>
+
+LinkMonitor::LinkMonitor() {
+  reset(0);
+}
+
+void LinkMonitor::reset(uint32_t nowMs) {
+  memset(m_rssi, 0, sizeof(m_rssi));
+  memset(m_rtt, 0, sizeof(m_rtt));
+  m_rssiCount = m_rssiHead = 0;
+  m_rttCount = m_rttHead = 0;
+  m_lastHeardMs = nowMs;
+  m_pingFails = 0;
+  m_pingFailStreak = 0;
+  m_intervalUs = LINK_DEFAULT_INTERVAL_US;
+  m_latency = 0;
+  m_timeoutMs = LINK_DEFAULT_TIMEOUT_MS;
+}
+
+void LinkMonitor::setConnParams(uint16_t interval, uint16_t latency, uint16_t timeout) {
+  if (interval > 0) m_intervalUs = (uint32_t)interval * 1250;
+  m_latency = latency;
+  if (timeout > 0) m_timeoutMs = (uint32_t)timeout * 10;
+}
+
+void LinkMonitor::heard(uint32_t nowMs) {
+  m_lastHeardMs = nowMs;
+}
+
+void LinkMonitor::addRssi(int rssi) {
+  if (rssi < -127) rssi = -127;
+  if (rssi > 20) rssi = 20;
+  m_rssi[m_rssiHead] = (int8_t)rssi;
+  m_rssiHead = (m_rssiHead + 1) % LINK_WINDOW;
+  if (m_rssiCount < LINK_WINDOW) m_rssiCount++;
+}
+
+void LinkMonitor::addPing(bool ok, uint32_t rttMs, uint32_t nowMs) {
+  if (!ok) {
+    m_pingFails++;
+    if (m_pingFailStreak < 255) m_pingFailStreak++;
+    return;
+  }
+  m_pingFailStreak = 0;
+  m_rtt[m_rttHead] = rttMs > 0xFFFF ? 0xFFFF : (uint16_t)rttMs;
+  m_rttHead = (m_rttHead + 1) % LINK_WINDOW;
+  if (m_rttCount < LINK_WINDOW) m_rttCount++;
+  heard(nowMs);
+}
+
+LinkLevel LinkMonitor::evaluate(uint32_t nowMs, LinkMetrics& out) const {
+  memset(&out, 0, sizeof(out));
+  out.pingFails = m_pingFails;
+  uint8_t marginal = 0;
+  uint8_t critical = 0;
+
+  // RSSI：窗口均值/最小值，按时间先后分两半比较得到趋势
+  if (m_rssiCount > 0) {
+    int sum = 0, firstSum = 0, secondSum = 0;
+    int minV = 127;
+    int half = m_rssiCount / 2;
+    int oldest = (m_rssiHead + LINK_WINDOW - m_rssiCount) % LINK_WINDOW;
+    for (int i = 0; i < m_rssiCount; i++) {
+      int v = m_rssi[(oldest + i) % LINK_WINDOW];
+      sum += v;
+      if (v < minV) minV = v;
+      if (i < half) firstSum += v;
+      else secondSum += v;
+    }
+    out.rssiAvg = (int16_t)(sum / m_rssiCount);
+    out.rssiMin = (int16_t)minV;
+    if (half > 0) {
+      out.rssiTrend = (int16_t)(secondSum / (m_rssiCount - half) - firstSum / half);
+    }
+    if (out.rssiAvg < LINK_RSSI_CRITICAL) critical |= LINK_REASON_RSSI;
+    else if (out.rssiAvg < LINK_RSSI_MARGINAL) marginal |= LINK_REASON_RSSI;
+    if (out.rssiTrend <= -LINK_RSSI_DROP_DB) marginal |= LINK_REASON_TREND;
+  }
+
+  // 往返：读特征值正常一到两个连接间隔完成，多出来的按错过的连接事件计（从机延迟允许跳过的不算）
+  if (m_rttCount > 0) {
+    uint32_t sum = 0, maxV = 0;
+    for (int i = 0; i < m_rttCount; i++) {
+      sum += m_rtt[i];
+      if (m_rtt[i] > maxV) maxV = m_rtt[i];
+    }
+    out.rttAvgMs = (uint16_t)(sum / m_rttCount);
+    out.rttMaxMs = (uint16_t)maxV;
+    uint32_t events = (maxV * 1000 + m_intervalUs - 1) / m_intervalUs;
+    uint32_t allowed = 2 + m_latency;
+    out.missedMax = (uint16_t)(events > allowed ? events - allowed : 0);
+    if (out.missedMax >= LINK_MISSED_CRITICAL) critical |= LINK_REASON_MISSED;
+    else if (out.missedMax >= LINK_MISSED_MARGINAL) marginal |= LINK_REASON_MISSED;
+  }
+
+  // 静默：控制器在监督超时内收不到对端任何包就会断开，这里提前看占比
+  uint32_t silent = nowMs - m_lastHeardMs;
+  out.silencePct = (uint16_t)(silent * 100 / m_timeoutMs);
+  if (out.silencePct >= LINK_SILENCE_CRITICAL_PCT) critical |= LINK_REASON_SILENCE;
+  else if (out.silencePct >= LINK_SILENCE_MARGINAL_PCT) marginal |= LINK_REASON_SILENCE;
+
+  if (m_pingFailStreak >= LINK_PING_FAIL_CRITICAL) critical |= LINK_REASON_PINGFAIL;
+  else if (m_pingFailStreak > 0) marginal |= LINK_REASON_PINGFAIL;
+
+  out.reasons = marginal | critical;
+  out.level = critical ? LINK_LEVEL_CRITICAL : (marginal ? LINK_LEVEL_MARGINAL : LINK_LEVEL_OK);
+  return (LinkLevel)out.level;
+}
+
+const char* LinkMonitor::levelName(uint8_t level) {
+  switch (level) {
+    case LINK_LEVEL_OK:       return "良好";
+    case LINK_LEVEL_MARGINAL: return "边缘";
+    case LINK_LEVEL_CRITICAL: return "危险";
+    default:                  return "未知";
+  }
+}
+
+void LinkMonitor::reasonText(uint8_t reasons, char* buf, size_t len) {
+  static const char* const names[] = {"信号弱", "信号下降", "错过连接事件", "接近超时", "探测失败"};
+  size_t used = 0;
+  buf[0] = '\0';
+  for (int i = 0; i < 5; i++) {
+    if (!(reasons & (1 << i))) continue;
+    int n = snprintf(buf + used, len - used, "%s%s", used ? "," : "", names[i]);
+    if (n < 0 || (size_t)n >= len - used) break;
+    used += n;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,527 @@
+#include "OtaLink.h"
+#include <string.h>
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+// 标准 CRC32（多项式 0xEDB88320），与 zlib/binascii.crc32 结果一致
+uint32_t otaCrc32(uint32_t crc, const uint8_t* data, size_t len) {
+  crc = ~crc;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+  }
+  return ~crc;
+}
+
+size_t otaHeaderBuild(const OtaHeader& h, uint8_t* buf) {
+  put32(buf, OTA_MAGIC);
+  buf[4] = OTA_VERSION;
+  buf[5] = h.codec;
+  put16(buf + 6, h.chunkMax);
+  put32(buf + 8, h.outSize);
+  put32(buf + 12, h.outCrc);
+  put32(buf + 16, h.streamSize);
+  put32(buf + 20, h.baseSize);
+  put32(buf + 24, h.baseCrc);
+  put32(buf + 28, 0);
+  return OTA_HEADER_LEN;
+}
+
+bool otaHeaderParse(const uint8_t* data, size_t len, OtaHeader& out) {
+  if (data == nullptr || len < OTA_HEADER_LEN) return false;
+  if (get32(data) != OTA_MAGIC || data[4] != OTA_VERSION) return false;
+  out.codec = data[5];
+  out.chunkMax = get16(data + 6);
+  out.outSize = get32(data + 8);
+  out.outCrc = get32(data + 12);
+  out.streamSize = get32(data + 16);
+  out.baseSize = get32(data + 20);
+  out.baseCrc = get32(data + 24);
+  if (out.codec != OTA_CODEC_RAW && out.codec != OTA_CODEC_XOR_RLE) return false;
+  if (out.chunkMax == 0 || out.outSize == 0) return false;
+  return true;
+}
+
+size_t otaStatusBuild(const OtaStatus& s, uint8_t* buf) {
+  buf[0] = OTA_MSG_STATUS;
+  buf[1] = s.state;
+  buf[2] = s.reason;
+  put32(buf + 3, s.nextStream);
+  put32(buf + 7, s.nextOut);
+  buf[11] = s.error;
+  return OTA_STATUS_LEN;
+}
+
+bool otaStatusParse(const uint8_t* data, size_t len, OtaStatus& out) {
+  if (data == nullptr || len != OTA_STATUS_LEN || data[0] != OTA_MSG_STATUS) return false;
+  out.state = data[1];
+  out.reason = data[2];
+  out.nextStream = get32(data + 3);
+  out.nextOut = get32(data + 7);
+  out.error = data[11];
+  return true;
+}
+
+const char* otaErrorName(uint8_t error) {
+  switch (error) {
+    case OTA_ERR_NONE:          return "无";
+    case OTA_ERR_BAD_HEADER:    return "镜像头错误";
+    case OTA_ERR_TOO_BIG:       return "超过分区大小";
+    case OTA_ERR_BASE_MISMATCH: return "差分基准与剑端固件不一致";
+    case OTA_ERR_CHUNK:         return "块格式错误";
+    case OTA_ERR_FLASH:         return "闪存擦写失败";
+    case OTA_ERR_IMAGE_CRC:     return "整包校验失败";
+    case OTA_ERR_ACTIVATE:      return "设置启动分区失败";
+    case OTA_ERR_NOT_STARTED:   return "没有进行中的升级";
+    default:                    return "未知";
+  }
+}
+
+// =====================【剑端：接收】=====================
+OtaReceiver::OtaReceiver(OtaFlash& flash)
+  : m_flash(flash), m_state(OTA_STATE_IDLE), m_error(OTA_ERR_NONE), m_nextStream(0), m_nextOut(0),
+    m_persistedOut(0), m_sinceAck(0), m_lastGapAt(0xFFFFFFFFu), m_outLen(0), m_outBufOff(0),
+    m_baseBufOff(0), m_baseBufLen(0) {
+  memset(&m_header, 0, sizeof(m_header));
+  memset(m_rawHeader, 0, sizeof(m_rawHeader));
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+size_t OtaReceiver::status(uint8_t reason, uint8_t* reply) {
+  OtaStatus s;
+  s.state = m_state;
+  s.reason = reason;
+  s.nextStream = m_nextStream;
+  s.nextOut = m_nextOut;
+  s.error = m_error;
+  return otaStatusBuild(s, reply);
+}
+
+size_t OtaReceiver::fail(uint8_t error, uint8_t reason, uint8_t* reply) {
+  m_state = OTA_STATE_ERROR;
+  m_error = error;
+  m_flash.clearProgress();
+  return status(reason, reply);
+}
+
+bool OtaReceiver::handle(const uint8_t* msg, size_t len, uint8_t* reply, size_t& replyLen) {
+  replyLen = 0;
+  if (msg == nullptr || len == 0) return false;
+  switch (msg[0]) {
+    case OTA_MSG_BEGIN:
+      if (!begin(msg + 1, len - 1)) {
+        replyLen = fail(m_error, OTA_REASON_BEGIN, reply);
+      } else {
+        replyLen = status(OTA_REASON_BEGIN, reply);
+      }
+      return true;
+
+    case OTA_MSG_QUERY:
+      replyLen = status(OTA_REASON_QUERY, reply);
+      return true;
+
+    case OTA_MSG_ABORT:
+      m_flash.clearProgress();
+      m_state = OTA_STATE_IDLE;
+      m_error = OTA_ERR_NONE;
+      replyLen = status(OTA_REASON_PROGRESS, reply);
+      return true;
+
+    case OTA_MSG_END:
+      if (m_state == OTA_STATE_DONE) {
+        replyLen = status(OTA_REASON_END, reply); // 主机没收到上一次的 DONE
+        return true;
+      }
+      if (m_state != OTA_STATE_RECEIVING) {
+        m_error = OTA_ERR_NOT_STARTED;
+        replyLen = status(OTA_REASON_END, reply);
+        return true;
+      }
+      if (m_nextStream != m_header.streamSize || m_nextOut != m_header.outSize) {
+        replyLen = status(OTA_REASON_GAP, reply);
+        return true;
+      }
+      if (!verifyImage()) {
+        replyLen = fail(OTA_ERR_IMAGE_CRC, OTA_REASON_END, reply);
+        return true;
+      }
+      if (!m_flash.activate()) {
+        replyLen = fail(OTA_ERR_ACTIVATE, OTA_REASON_END, reply);
+        return true;
+      }
+      m_flash.clearProgress();
+      m_state = OTA_STATE_DONE;
+      replyLen = status(OTA_REASON_END, reply);
+      return true;
+
+    case OTA_MSG_DATA:
+      break;
+
+    default:
+      return false;
+  }
+
+  // ---- DATA ----
+  if (m_state != OTA_STATE_RECEIVING) {
+    if (m_state == OTA_STATE_DONE) return false;
+    m_error = m_state == OTA_STATE_ERROR ? m_error : (uint8_t)OTA_ERR_NOT_STARTED;
+    replyLen = status(OTA_REASON_GAP, reply);
+    return true;
+  }
+  if (len < 1 + 4 + OTA_CHUNK_HEADER_LEN) {
+    m_stats.crcErrors++;
+    return false;
+  }
+  uint32_t streamOff = get32(msg + 1);
+  const uint8_t* chunk = msg + 5;
+  uint16_t chunkLen = get16(chunk);
+  uint32_t outOff = get32(chunk + 2);
+  uint32_t crc = get32(chunk + 6);
+  const uint8_t* payload = chunk + OTA_CHUNK_HEADER_LEN;
+
+  if (streamOff < m_nextStream) {
+    m_stats.duplicates++;
+    return false;
+  }
+  bool intact = streamOff == m_nextStream && chunkLen <= m_header.chunkMax &&
+                len == 1 + 4 + OTA_CHUNK_HEADER_LEN + (size_t)chunkLen &&
+                outOff == m_nextOut && otaCrc32(0, payload, chunkLen) == crc;
+  if (!intact) {
+    if (streamOff == m_nextStream) m_stats.crcErrors++;
+    if (m_lastGapAt == m_nextStream) return false;
+    m_lastGapAt = m_nextStream;
+    m_stats.gaps++;
+    replyLen = status(OTA_REASON_GAP, reply);
+    return true;
+  }
+
+  uint32_t produced = 0;
+  if (!decodeChunk(payload, chunkLen, outOff, produced)) {
+    replyLen = fail(m_error == OTA_ERR_NONE ? (uint8_t)OTA_ERR_CHUNK : m_error, OTA_REASON_PROGRESS, reply);
+    return true;
+  }
+  m_nextStream += OTA_CHUNK_HEADER_LEN + chunkLen;
+  m_nextOut += produced;
+  m_lastGapAt = 0xFFFFFFFFu;
+  m_stats.chunks++;
+  if (m_nextOut - m_persistedOut >= OTA_PERSIST_BYTES) persist();
+  if (++m_sinceAck >= OTA_ACK_EVERY || m_nextStream >= m_header.streamSize) {
+    m_sinceAck = 0;
+    replyLen = status(OTA_REASON_PROGRESS, reply);
+    return true;
+  }
+  return false;
+}
+
+bool OtaReceiver::begin(const uint8_t* hdr, size_t len) {
+  OtaHeader h;
+  m_error = OTA_ERR_NONE;
+  if (!otaHeaderParse(hdr, len, h)) {
+    m_error = OTA_ERR_BAD_HEADER;
+    return false;
+  }
+  if (h.outSize > m_flash.capacity()) {
+    m_error = OTA_ERR_TOO_BIG;
+    return false;
+  }
+
+  // 同一镜像：内存里还在接收（只是掉线重连）就接着来，否则看 NVS 里的进度
+  bool same = m_state == OTA_STATE_RECEIVING && memcmp(m_rawHeader, hdr, OTA_HEADER_LEN) == 0;
+  if (!same && h.baseSize > 0) {
+    if (h.baseSize > m_flash.baseCapacity()) {
+      m_error = OTA_ERR_BASE_MISMATCH;
+      return false;
+    }
+    uint8_t buf[256];
+    uint32_t crc = 0;
+    for (uint32_t off = 0; off < h.baseSize; off += sizeof(buf)) {
+      size_t n = h.baseSize - off < sizeof(buf) ? h.baseSize - off : sizeof(buf);
+      if (!m_flash.readBase(off, buf, n)) {
+        m_error = OTA_ERR_FLASH;
+        return false;
+      }
+      crc = otaCrc32(crc, buf, n);
+    }
+    if (crc != h.baseCrc) {
+      m_error = OTA_ERR_BASE_MISMATCH;
+      return false;
+    }
+  }
+  m_baseBufLen = 0;
+  m_outLen = 0;
+  m_sinceAck = 0;
+  m_lastGapAt = 0xFFFFFFFFu;
+  if (same) {
+    m_stats.resumes++;
+    return true;
+  }
+
+  m_header = h;
+  memcpy(m_rawHeader, hdr, OTA_HEADER_LEN);
+  OtaProgress p;
+  if (m_flash.loadProgress(p) && memcmp(p.header, hdr, OTA_HEADER_LEN) == 0 &&
+      p.nextStream <= h.streamSize && p.nextOut <= h.outSize) {
+    m_nextStream = p.nextStream;
+    m_nextOut = p.nextOut;
+    m_stats.resumes++;
+  } else {
+    m_nextStream = 0;
+    m_nextOut = 0;
+  }
+  m_state = OTA_STATE_RECEIVING;
+  persist();
+  return true;
+}
+
+void OtaReceiver::persist() {
+  OtaProgress p;
+  memcpy(p.header, m_rawHeader, OTA_HEADER_LEN);
+  p.nextStream = m_nextStream;
+  p.nextOut = m_nextOut;
+  m_flash.saveProgress(p);
+  m_persistedOut = m_nextOut;
+}
+
+bool OtaReceiver::baseByte(uint32_t off, uint8_t& b) {
+  if (off >= m_header.baseSize) {
+    b = 0;
+    return true;
+  }
+  if (m_baseBufLen == 0 || off < m_baseBufOff || off >= m_baseBufOff + m_baseBufLen) {
+    m_baseBufOff = off & ~(uint32_t)(sizeof(m_baseBuf) - 1);
+    uint32_t left = m_header.baseSize - m_baseBufOff;
+    m_baseBufLen = left < sizeof(m_baseBuf) ? left : sizeof(m_baseBuf);
+    if (!m_flash.readBase(m_baseBufOff, m_baseBuf, m_baseBufLen)) {
+      m_baseBufLen = 0;
+      return false;
+    }
+  }
+  b = m_baseBuf[off - m_baseBufOff];
+  return true;
+}
+
+bool OtaReceiver::emit(uint8_t b) {
+  if (m_outBufOff + m_outLen >= m_header.outSize) return false; // 超出镜像声明的大小
+  m_outBuf[m_outLen++] = b;
+  if (m_outLen == sizeof(m_outBuf)) return flushOut();
+  return true;
+}
+
+bool OtaReceiver::flushOut() {
+  if (m_outLen == 0) return true;
+  bool ok = writeOut(m_outBufOff, m_outBuf, m_outLen);
+  m_outBufOff += m_outLen;
+  m_outLen = 0;
+  return ok;
+}
+
+// 写到哪个扇区的开头就先擦哪个扇区；续传从扇区中间开始时该扇区之前已擦过，重写相同内容不影响
+bool OtaReceiver::writeOut(uint32_t off, const uint8_t* data, size_t n) {
+  uint32_t sector = (off + OTA_SECTOR - 1) / OTA_SECTOR * OTA_SECTOR;
+  for (; sector < off + n; sector += OTA_SECTOR) {
+    if (!m_flash.erase(sector, OTA_SECTOR)) return false;
+  }
+  return m_flash.write(off, data, n);
+}
+
+bool OtaReceiver::decodeChunk(const uint8_t* payload, uint16_t len, uint32_t outOff, uint32_t& produced) {
+  m_outBufOff = outOff;
+  m_outLen = 0;
+  uint8_t b;
+  if (m_header.codec == OTA_CODEC_RAW) {
+    for (uint16_t i = 0; i < len; i++) {
+      if (!emit(payload[i])) return false;
+    }
+  } else {
+    // XOR_RLE：c<0x80 后跟 c+1 个异或字节；c>=0x80 与下一字节组成 15 位长度-1，这么多字节与基准相同
+    uint16_t pos = 0;
+    while (pos < len) {
+      uint8_t c = payload[pos++];
+      if (c < 0x80) {
+        uint16_t n = c + 1;
+        if (pos + n > len) return false;
+        for (uint16_t i = 0; i < n; i++) {
+          if (!baseByte(m_outBufOff + m_outLen, b) || !emit(payload[pos + i] ^ b)) return false;
+        }
+        pos += n;
+      } else {
+        if (pos >= len) return false;
+        uint32_t n = (((uint32_t)(c & 0x7F) << 8) | payload[pos++]) + 1;
+        for (uint32_t i = 0; i < n; i++) {
+          if (!baseByte(m_outBufOff + m_outLen, b) || !emit(b)) return false;
+        }
+      }
+    }
+  }
+  produced = m_outBufOff + m_outLen - outOff;
+  if (!flushOut()) {
+    m_error = OTA_ERR_FLASH;
+    return false;
+  }
+  return true;
+}
+
+bool OtaReceiver::verifyImage() {
+  uint8_t buf[256];
+  uint32_t crc = 0;
+  for (uint32_t off = 0; off < m_header.outSize; off += sizeof(buf)) {
+    size_t n = m_header.outSize - off < sizeof(buf) ? m_header.outSize - off : sizeof(buf);
+    if (!m_flash.readBack(off, buf, n)) return false;
+    crc = otaCrc32(crc, buf, n);
+  }
+  return crc == m_header.outCrc;
+}
+
+// =====================【主机：发送】=====================
+OtaSender::OtaSender()
+  : m_reader(nullptr), m_state(OTA_SEND_IDLE), m_error(OTA_ERR_NONE), m_sent(0), m_acked(0),
+    m_resumedFrom(0), m_lastTxMs(0), m_lastStatusMs(0), m_retries(0) {
+  memset(&m_header, 0, sizeof(m_header));
+  memset(m_rawHeader, 0, sizeof(m_rawHeader));
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool OtaSender::begin(OtaImageReader* reader, uint32_t nowMs) {
+  m_reader = reader;
+  m_error = OTA_ERR_NONE;
+  if (reader == nullptr || !reader->read(0, m_rawHeader, OTA_HEADER_LEN) ||
+      !otaHeaderParse(m_rawHeader, OTA_HEADER_LEN, m_header)) {
+    m_state = OTA_SEND_FAILED;
+    m_error = OTA_ERR_BAD_HEADER;
+    return false;
+  }
+  m_sent = 0;
+  m_acked = 0;
+  m_resumedFrom = 0;
+  m_retries = 0;
+  m_lastTxMs = nowMs - OTA_BEGIN_RETRY_MS; // 立即发 BEGIN
+  m_lastStatusMs = nowMs;
+  m_state = OTA_SEND_STARTING;
+  return true;
+}
+
+size_t OtaSender::next(uint32_t nowMs, uint8_t* buf, size_t cap) {
+  switch (m_state) {
+    case OTA_SEND_STARTING:
+      if (nowMs - m_lastTxMs < OTA_BEGIN_RETRY_MS || cap < 1 + OTA_HEADER_LEN) return 0;
+      if (++m_retries > OTA_MAX_RETRIES) {
+        m_state = OTA_SEND_FAILED;
+        return 0;
+      }
+      m_lastTxMs = nowMs;
+      buf[0] = OTA_MSG_BEGIN;
+      memcpy(buf + 1, m_rawHeader, OTA_HEADER_LEN);
+      return 1 + OTA_HEADER_LEN;
+
+    case OTA_SEND_SENDING: {
+      uint32_t window = OTA_WINDOW * (uint32_t)(m_header.chunkMax + OTA_CHUNK_HEADER_LEN);
+      if (m_sent < m_header.streamSize && m_sent - m_acked < window) {
+        uint8_t* chunk = buf + 5;
+        if (cap < 5 + OTA_CHUNK_HEADER_LEN || !m_reader->read(OTA_HEADER_LEN + m_sent, chunk, OTA_CHUNK_HEADER_LEN)) {
+          m_state = OTA_SEND_FAILED;
+          m_error = OTA_ERR_CHUNK;
+          return 0;
+        }
+        uint16_t chunkLen = get16(chunk);
+        size_t total = 5 + OTA_CHUNK_HEADER_LEN + chunkLen;
+        if (chunkLen > m_header.chunkMax || total > cap ||
+            !m_reader->read(OTA_HEADER_LEN + m_sent + OTA_CHUNK_HEADER_LEN, chunk + OTA_CHUNK_HEADER_LEN, chunkLen)) {
+          m_state = OTA_SEND_FAILED;
+          m_error = OTA_ERR_CHUNK;
+          return 0;
+        }
+        buf[0] = OTA_MSG_DATA;
+        put32(buf + 1, m_sent);
+        m_sent += OTA_CHUNK_HEADER_LEN + chunkLen;
+        m_stats.packets++;
+        m_stats.bytes += OTA_CHUNK_HEADER_LEN + chunkLen;
+        return total;
+      }
+      if (m_acked >= m_header.streamSize) {
+        m_state = OTA_SEND_FINISHING;
+        m_retries = 0;
+        m_lastTxMs = nowMs - OTA_END_RETRY_MS;
+        return next(nowMs, buf, cap);
+      }
+      // 窗口满或已发完：等确认，超时询问进度（剑端的回答决定从哪里重发）
+      if (nowMs - m_lastStatusMs < OTA_STATUS_TIMEOUT_MS || nowMs - m_lastTxMs < OTA_STATUS_TIMEOUT_MS) return 0;
+      if (++m_retries > OTA_MAX_RETRIES) {
+        m_state = OTA_SEND_FAILED;
+        return 0;
+      }
+      m_lastTxMs = nowMs;
+      m_stats.queries++;
+      buf[0] = OTA_MSG_QUERY;
+      return 1;
+    }
+
+    case OTA_SEND_FINISHING:
+      if (nowMs - m_lastTxMs < OTA_END_RETRY_MS) return 0;
+      if (++m_retries > OTA_MAX_RETRIES) {
+        m_state = OTA_SEND_FAILED;
+        return 0;
+      }
+      m_lastTxMs = nowMs;
+      buf[0] = OTA_MSG_END;
+      return 1;
+
+    default:
+      return 0;
+  }
+}
+
+void OtaSender::onStatus(const uint8_t* msg, size_t len, uint32_t nowMs) {
+  OtaStatus s;
+  if (!busy() || !otaStatusParse(msg, len, s)) return;
+  m_lastStatusMs = nowMs;
+  m_retries = 0;
+  if (s.state == OTA_STATE_IDLE && m_state == OTA_SEND_STARTING) return; // 旧状态，等 BEGIN 的回答
+  if (s.state == OTA_STATE_ERROR || s.state == OTA_STATE_IDLE) {
+    m_state = OTA_SEND_FAILED;
+    m_error = s.error != OTA_ERR_NONE ? s.error : (uint8_t)OTA_ERR_NOT_STARTED;
+    return;
+  }
+  switch (m_state) {
+    case OTA_SEND_STARTING:
+      if (s.reason != OTA_REASON_BEGIN || s.state != OTA_STATE_RECEIVING) return;
+      m_acked = m_sent = m_resumedFrom = s.nextStream;
+      m_state = OTA_SEND_SENDING;
+      break;
+    case OTA_SEND_SENDING:
+      m_acked = s.nextStream;
+      if ((s.reason == OTA_REASON_GAP || s.reason == OTA_REASON_QUERY) && m_sent != s.nextStream) {
+        m_sent = s.nextStream;
+        m_stats.rewinds++;
+      }
+      if (m_sent < m_acked) m_sent = m_acked;
+      break;
+    case OTA_SEND_FINISHING:
+      if (s.state == OTA_STATE_DONE) {
+        m_state = OTA_SEND_DONE;
+      } else if (s.reason == OTA_REASON_GAP) {
+        m_acked = m_sent = s.nextStream;
+        m_stats.rewinds++;
+        m_state = OTA_SEND_SENDING;
+      }
+      break;
+    default:
+      break;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "PeerGatt.h"
+
+PeerGatt::Sub PeerGatt::s_subs[PEER_GATT_MAX_SUBS];
+portMUX_TYPE PeerGatt::s_mux = portMUX_INITIALIZER_UNLOCKED;
+SemaphoreHandle_t PeerGatt::s_lock = NULL;
+SemaphoreHandle_t PeerGatt::s_done = NULL;
+volatile esp_gattc_cb_event_t PeerGatt::s_waitEvent = ESP_GATTC_READ_CHAR_EVT;
+volatile uint16_t PeerGatt::s_waitConn = 0;
+volatile uint16_t PeerGatt::s_waitHandle = 0;
+volatile bool PeerGatt::s_waiting = false;
+esp_gatt_status_t PeerGatt::s_status = ESP_GATT_OK;
+uint8_t PeerGatt::s_value[PEER_GATT_VALUE_MAX];
+size_t PeerGatt::s_valueLen = 0;
+
+void PeerGatt::begin() {
+    if (s_lock != NULL) return;
+    s_lock = xSemaphoreCreateMutex();
+    s_done = xSemaphoreCreateBinary();
+    for (int i = 0; i < PEER_GATT_MAX_SUBS; i++) s_subs[i].cb = nullptr;
+    BLEDevice::setCustomGattcHandler(onEvent);
+}
+
+// 登记要等的完成事件；调用方随后发请求，再调 finish() 等结果
+bool PeerGatt::start(BLEClient* client, esp_gattc_cb_event_t event, uint16_t handle) {
+    if (s_lock == NULL || client == nullptr || handle == 0 || !client->isConnected()) return false;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    xSemaphoreTake(s_done, 0); // 丢掉上一次超时后才到的完成
+    portENTER_CRITICAL(&s_mux);
+    s_waitEvent = event;
+    s_waitConn = client->getConnId();
+    s_waitHandle = handle;
+    s_status = ESP_GATT_ERROR;
+    s_valueLen = 0;
+    s_waiting = true;
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+bool PeerGatt::finish() {
+    bool done = xSemaphoreTake(s_done, pdMS_TO_TICKS(PEER_GATT_TIMEOUT_MS)) == pdTRUE;
+    portENTER_CRITICAL(&s_mux);
+    s_waiting = false;
+    bool ok = done && s_status == ESP_GATT_OK;
+    portEXIT_CRITICAL(&s_mux);
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+bool PeerGatt::subscribe(BLEClient* client, uint16_t handle, uint16_t cccd, PeerNotifyCallback cb) {
+    if (client == nullptr || handle == 0 || cccd == 0 || !client->isConnected()) return false;
+    esp_gatt_if_t gattcIf = client->getGattcIf();
+    uint16_t connId = client->getConnId();
+
+    // 先登记分发表再打开 CCCD：写确认之前剑端就可能发来通知
+    portENTER_CRITICAL(&s_mux);
+    int slot = -1;
+    for (int i = 0; i < PEER_GATT_MAX_SUBS; i++) {
+        Sub& s = s_subs[i];
+        if (s.cb != nullptr && s.gattcIf == gattcIf && s.connId == connId && s.handle == handle) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 && s.cb == nullptr) slot = i;
+    }
+    if (slot >= 0) {
+        s_subs[slot].gattcIf = gattcIf;
+        s_subs[slot].connId = connId;
+        s_subs[slot].handle = handle;
+        s_subs[slot].cb = cb;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (slot < 0) return false;
+
+    if (esp_ble_gattc_register_for_notify(gattcIf, *client->getPeerAddress().getNative(), handle) != ESP_OK) return false;
+    uint8_t enable[2] = {0x01, 0x00};
+    if (!start(client, ESP_GATTC_WRITE_DESCR_EVT, cccd)) return false;
+    if (esp_ble_gattc_write_char_descr(gattcIf, connId, cccd, sizeof(enable), enable, ESP_GATT_WRITE_TYPE_RSP,
+                                       ESP_GATT_AUTH_REQ_NONE) != ESP_OK) {
+        xSemaphoreGive(s_done);
+    }
+    return finish();
+}
+
+bool PeerGatt::write(BLEClient* client, uint16_t handle, const uint8_t* data, size_t length, bool response) {
+    if (!start(client, ESP_GATTC_WRITE_CHAR_EVT, handle)) return false;
+    // 无响应写也有完成事件（数据交给链路层后），等它可以顺带做流控
+    if (esp_ble_gattc_write_char(client->getGattcIf(), client->getConnId(), handle, (uint16_t)length, (uint8_t*)data,
+                                 response ? ESP_GATT_WRITE_TYPE_RSP : ESP_GATT_WRITE_TYPE_NO_RSP,
+                                 ESP_GATT_AUTH_REQ_NONE) != ESP_OK) {
+        xSemaphoreGive(s_done);
+    }
+    return finish();
+}
+
+bool PeerGatt::read(BLEClient* client, uint16_t handle, uint8_t* out, size_t cap, size_t& len) {
+    len = 0;
+    if (!start(client, ESP_GATTC_READ_CHAR_EVT, handle)) return false;
+    if (esp_ble_gattc_read_char(client->getGattcIf(), client->getConnId(), handle, ESP_GATT_AUTH_REQ_NONE) != ESP_OK) {
+        xSemaphoreGive(s_done);
+    }
+    // 持有 s_lock 期间拷出结果，下一次读写不会覆盖
+    bool done = xSemaphoreTake(s_done, pdMS_TO_TICKS(PEER_GATT_TIMEOUT_MS)) == pdTRUE;
+    portENTER_CRITICAL(&s_mux);
+    s_waiting = false;
+    bool ok = done && s_status == ESP_GATT_OK;
+    if (ok) {
+        len = s_valueLen < cap ? s_valueLen : cap;
+        memcpy(out, s_value, len);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    xSemaphoreGive(s_lock);
+    return ok;
+}
+
+void PeerGatt::complete(esp_gattc_cb_event_t event, uint16_t connId, uint16_t handle, esp_gatt_status_t status,
+                        const uint8_t* value, size_t len) {
+    portENTER_CRITICAL(&s_mux);
+    bool match = s_waiting && s_waitEvent == event && s_waitConn == connId && s_waitHandle == handle;
+    if (match) {
+        s_waiting = false;
+        s_status = status;
+        s_valueLen = len < sizeof(s_value) ? len : sizeof(s_value);
+        if (s_valueLen > 0) memcpy(s_value, value, s_valueLen);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (match) xSemaphoreGive(s_done);
+}
+
+// 蓝牙协议栈任务里调用（BLEClient 自己的处理之后）
+void PeerGatt::onEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf, esp_ble_gattc_cb_param_t* param) {
+    switch (event) {
+        case ESP_GATTC_NOTIFY_EVT: {
+            PeerNotifyCallback cb = nullptr;
+            portENTER_CRITICAL(&s_mux);
+            for (int i = 0; i < PEER_GATT_MAX_SUBS; i++) {
+                const Sub& s = s_subs[i];
+                if (s.cb != nullptr && s.gattcIf == gattcIf && s.connId == param->notify.conn_id &&
+                    s.handle == param->notify.handle) {
+                    cb = s.cb;
+                    break;
+                }
+            }
+            portEXIT_CRITICAL(&s_mux);
+            if (cb != nullptr) cb(param->notify.value, param->notify.value_len);
+            break;
+        }
+        case ESP_GATTC_READ_CHAR_EVT:
+            complete(event, param->read.conn_id, param->read.handle, param->read.status, param->read.value,
+                     param->read.value_len);
+            break;
+        case ESP_GATTC_WRITE_CHAR_EVT:
+        case ESP_GATTC_WRITE_DESCR_EVT:
+            complete(event, param->write.conn_id, param->write.handle, param->write.status, nullptr, 0);
+            break;
+        case ESP_GATTC_DISCONNECT_EVT: {
+            // 连接号会被下一条连接复用：清掉这条连接的分发项，在途读写立即失败
+            bool wake = false;
+            portENTER_CRITICAL(&s_mux);
+            for (int i = 0; i < PEER_GATT_MAX_SUBS; i++) {
+                if (s_subs[i].gattcIf == gattcIf && s_subs[i].connId == param->disconnect.conn_id) s_subs[i].cb = nullptr;
+            }
+            if (s_waiting && s_waitConn == param->disconnect.conn_id) {
+                s_waiting = false;
+                s_status = ESP_GATT_ERROR;
+                wake = true;
+            }
+            portEXIT_CRITICAL(&s_mux);
+            if (wake) xSemaphoreGive(s_done);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+String PeerChar::readValue() {
+    uint8_t buf[PEER_GATT_VALUE_MAX];
+    size_t len = 0;
+    if (!PeerGatt::read(m_client, m_handle, buf, sizeof(buf), len)) return String();
+    return String((const char*)buf, len);
+}
\ No newline at end of file
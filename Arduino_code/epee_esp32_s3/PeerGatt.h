@@ -0,0 +1,80 @@
+#ifndef PEER_GATT_H
+#define PEER_GATT_H
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <esp_gattc_api.h>
+
+// 按句柄直接读写剑端属性，不经过 BLERemoteService/BLERemoteCharacteristic：
+// 句柄来自缓存（GattCache.h）时不用先发现服务；来自发现时也走这里，连上之后只有一套读写/通知代码
+// 通知由自定义 GATTC 事件回调按 连接号+句柄 分发；同步读写一次只有一条在途，等完成事件或超时
+
+#define PEER_GATT_TIMEOUT_MS  2000
+#define PEER_GATT_MAX_SUBS    8      // 两方各 击中+升级，留余量
+#define PEER_GATT_VALUE_MAX   128    // 读回的最大长度（遥测/布局文本都远小于此）
+
+typedef void (*PeerNotifyCallback)(uint8_t* data, size_t length);
+
+class PeerGatt {
+public:
+    // setup 里调用一次（BLEDevice::init 之后）：挂上 GATTC 事件回调
+    static void begin();
+
+    // 注册通知并写 CCCD=0x0001（等写确认）；成功后该句柄的通知交给 cb（在蓝牙协议栈任务里调用）
+    static bool subscribe(BLEClient* client, uint16_t handle, uint16_t cccd, PeerNotifyCallback cb);
+    static bool write(BLEClient* client, uint16_t handle, const uint8_t* data, size_t length, bool response);
+    // 读失败返回 false；len 为读回长度
+    static bool read(BLEClient* client, uint16_t handle, uint8_t* out, size_t cap, size_t& len);
+
+private:
+    struct Sub {
+        esp_gatt_if_t gattcIf;
+        uint16_t connId;
+        uint16_t handle;
+        PeerNotifyCallback cb;
+    };
+    static Sub s_subs[PEER_GATT_MAX_SUBS];
+    static portMUX_TYPE s_mux;
+    static SemaphoreHandle_t s_lock;     // 串行化同步读写
+    static SemaphoreHandle_t s_done;     // 完成事件到达
+    static volatile esp_gattc_cb_event_t s_waitEvent;
+    static volatile uint16_t s_waitConn;
+    static volatile uint16_t s_waitHandle;
+    static volatile bool s_waiting;
+    static esp_gatt_status_t s_status;
+    static uint8_t s_value[PEER_GATT_VALUE_MAX];
+    static size_t s_valueLen;
+
+    static bool start(BLEClient* client, esp_gattc_cb_event_t event, uint16_t handle);
+    static bool finish();
+    static void onEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf, esp_ble_gattc_cb_param_t* param);
+    static void complete(esp_gattc_cb_event_t event, uint16_t connId, uint16_t handle, esp_gatt_status_t status,
+                         const uint8_t* value, size_t len);
+};
+
+// 一方剑端的一个特征值：本次连接的客户端 + 句柄；接口与原来用的 BLERemoteCharacteristic 子集一致
+class PeerChar {
+public:
+    PeerChar() : m_client(nullptr), m_handle(0) {}
+
+    void attach(BLEClient* client, uint16_t handle) {
+        m_client = client;
+        m_handle = handle;
+    }
+    uint16_t handle() const { return m_handle; }
+
+    bool writeValue(const uint8_t* data, size_t length, bool response = false) {
+        return PeerGatt::write(m_client, m_handle, data, length, response);
+    }
+    bool writeValue(const char* text, bool response = false) {
+        return writeValue((const uint8_t*)text, strlen(text), response);
+    }
+    // 读失败返回空串
+    String readValue();
+
+private:
+    BLEClient* m_client;
+    uint16_t m_handle;
+};
+
+#endif // PEER_GATT_H
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "PointerHealth.h"
+#include <string.h>
+#include <stdlib.h>
+
+// 取 "key:" 后面的整数，找不到返回 false
+static bool fieldValue(const char* text, size_t len, const char* key, long& out) {
+  size_t keyLen = strlen(key);
+  for (size_t i = 0; i + keyLen < len; i++) {
+    if ((i == 0 || text[i - 1] == '|') && memcmp(text + i, key, keyLen) == 0 && text[i + keyLen] == ':') {
+      char num[12];
+      size_t n = 0;
+      size_t p = i + keyLen + 1;
+      while (p < len && text[p] != '|' && n < sizeof(num) - 1) num[n++] = text[p++];
+      num[n] = '\0';
+      if (n == 0) return false;
+      char* end;
+      out = strtol(num, &end, 10);
+      return *end == '\0';
+    }
+  }
+  return false;
+}
+
+bool healthParse(const char* text, size_t len, PointerTelemetry& out) {
+  long bat, tc, rst, up, n;
+  if (text == nullptr) return false;
+  if (!fieldValue(text, len, "bat", bat) || !fieldValue(text, len, "tc", tc) ||
+      !fieldValue(text, len, "rst", rst) || !fieldValue(text, len, "up", up) ||
+      !fieldValue(text, len, "n", n)) {
+    return false;
+  }
+  if (bat < 0 || bat > 6000 || rst < 0 || rst > 255 || up < 0) return false;
+  out.batteryMv = (uint16_t)bat;
+  out.tempC = (int16_t)tc;
+  out.resetReason = (uint8_t)rst;
+  out.uptimeS = (uint32_t)up;
+  out.sample = (uint16_t)n;
+  return true;
+}
+
+PointerHealth::PointerHealth() {
+  reset();
+}
+
+void PointerHealth::reset() {
+  memset(m_mv, 0, sizeof(m_mv));
+  memset(m_ms, 0, sizeof(m_ms));
+  m_count = m_head = 0;
+  m_level = HEALTH_LEVEL_OK;
+  m_haveLast = false;
+  memset(&m_last, 0, sizeof(m_last));
+}
+
+bool PointerHealth::add(const PointerTelemetry& t, uint32_t nowMs) {
+  if (m_haveLast && t.sample == m_last.sample && t.uptimeS >= m_last.uptimeS) return false;
+  m_last = t;
+  m_haveLast = true;
+  if (t.batteryMv == 0) return false; // 没装电池检测：只记温度和复位原因
+
+  m_mv[m_head] = t.batteryMv;
+  m_ms[m_head] = nowMs;
+  m_head = (m_head + 1) % HEALTH_WINDOW;
+  if (m_count < HEALTH_WINDOW) m_count++;
+
+  // 往下立即降级，往上要高出阈值 HEALTH_HYSTERESIS_MV 才恢复（换电池后重连会 reset）
+  uint16_t mv = recentAvg();
+  uint8_t level = m_level;
+  if (mv < HEALTH_BATTERY_CRITICAL_MV) {
+    level = HEALTH_LEVEL_CRITICAL;
+  } else if (mv < HEALTH_BATTERY_LOW_MV) {
+    if (level == HEALTH_LEVEL_OK || mv >= HEALTH_BATTERY_CRITICAL_MV + HEALTH_HYSTERESIS_MV) level = HEALTH_LEVEL_LOW;
+  } else if (mv >= HEALTH_BATTERY_LOW_MV + HEALTH_HYSTERESIS_MV) {
+    level = HEALTH_LEVEL_OK;
+  } else if (level == HEALTH_LEVEL_CRITICAL) {
+    level = HEALTH_LEVEL_LOW;
+  }
+  bool changed = level != m_level;
+  m_level = level;
+  return changed;
+}
+
+uint16_t PointerHealth::recentAvg() const {
+  if (m_count == 0) return 0;
+  int n = m_count < HEALTH_AVG_SAMPLES ? m_count : HEALTH_AVG_SAMPLES;
+  uint32_t sum = 0;
+  for (int i = 1; i <= n; i++) sum += m_mv[(m_head + HEALTH_WINDOW - i) % HEALTH_WINDOW];
+  return (uint16_t)(sum / n);
+}
+
+// 最小二乘斜率，单位 mV/小时；样本太少或跨度太短返回 0
+int32_t PointerHealth::trendMvPerHour() const {
+  if (m_count < 3) return 0;
+  int oldest = (m_head + HEALTH_WINDOW - m_count) % HEALTH_WINDOW;
+  uint32_t t0 = m_ms[oldest];
+  uint32_t span = m_ms[(m_head + HEALTH_WINDOW - 1) % HEALTH_WINDOW] - t0;
+  if (span < HEALTH_TREND_MIN_SPAN_MS) return 0;
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+  for (int i = 0; i < m_count; i++) {
+    int idx = (oldest + i) % HEALTH_WINDOW;
+    double x = (m_ms[idx] - t0) / 3600000.0;
+    double y = m_mv[idx];
+    sx += x;
+    sy += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+  double den = m_count * sxx - sx * sx;
+  if (den <= 0) return 0;
+  return (int32_t)((m_count * sxy - sx * sy) / den);
+}
+
+void PointerHealth::metrics(HealthMetrics& out) const {
+  memset(&out, 0, sizeof(out));
+  out.minutesToLow = 0xFFFF;
+  out.level = m_level;
+  out.samples = m_count;
+  if (m_haveLast) {
+    out.tempC = m_last.tempC;
+    out.resetReason = m_last.resetReason;
+    out.uptimeS = m_last.uptimeS;
+  }
+  if (m_count == 0) return;
+  out.batteryMv = recentAvg();
+  uint16_t minV = 0xFFFF;
+  for (int i = 0; i < m_count; i++) {
+    if (m_mv[i] < minV) minV = m_mv[i];
+  }
+  out.batteryMinMv = minV;
+  int32_t trend = trendMvPerHour();
+  if (trend < -32768) trend = -32768;
+  if (trend > 32767) trend = 32767;
+  out.trendMvPerHour = (int16_t)trend;
+  if (trend < 0 && out.batteryMv > HEALTH_BATTERY_LOW_MV) {
+    uint32_t minutes = (uint32_t)(out.batteryMv - HEALTH_BATTERY_LOW_MV) * 60 / (uint32_t)(-trend);
+    out.minutesToLow = minutes > 0xFFFE ? 0xFFFE : (uint16_t)minutes;
+  } else if (out.batteryMv <= HEALTH_BATTERY_LOW_MV) {
+    out.minutesToLow = 0;
+  }
+}
+
+bool PointerHealth::abnormalReset() const {
+  if (!m_haveLast) return false;
+  switch (m_last.resetReason) {
+    case HEALTH_RESET_PANIC:
+    case HEALTH_RESET_INT_WDT:
+    case HEALTH_RESET_TASK_WDT:
+    case HEALTH_RESET_WDT:
+    case HEALTH_RESET_BROWNOUT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+const char* PointerHealth::levelName(uint8_t level) {
+  switch (level) {
+    case HEALTH_LEVEL_OK:       return "正常";
+    case HEALTH_LEVEL_LOW:      return "偏低";
+    case HEALTH_LEVEL_CRITICAL: return "告急";
+    default:                    return "未知";
+  }
+}
+
+const char* PointerHealth::resetName(uint8_t reason) {
+  switch (reason) {
+    case HEALTH_RESET_POWERON:   return "上电";
+    case HEALTH_RESET_EXT:       return "外部复位";
+    case HEALTH_RESET_SW:        return "软件重启";
+    case HEALTH_RESET_PANIC:     return "程序崩溃";
+    case HEALTH_RESET_INT_WDT:   return "中断看门狗";
+    case HEALTH_RESET_TASK_WDT:  return "任务看门狗";
+    case HEALTH_RESET_WDT:       return "看门狗";
+    case HEALTH_RESET_DEEPSLEEP: return "深睡唤醒";
+    case HEALTH_RESET_BROWNOUT:  return "欠压";
+    case HEALTH_RESET_SDIO:      return "SDIO";
+    default:                     return "未知";
+  }
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef POINTER_HEALTH_H
+#define POINTER_HEALTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 剑端电量/健康遥测：剑端低频采样电池电压、芯片温度、上次复位原因，写进只读的遥测特征值；
+// 主机不额外发包，每隔 HEALTH_READ_MS 把一次链路探测的读往返改读遥测特征值，顺带取回
+// 按滚动窗口算电压均值和下降趋势，低于阈值分级告警（带回差，避免发射瞬间的压降来回跳）
+// 遥测文本：bat:<mV>|tc:<°C>|rst:<复位原因>|up:<运行秒数>|n:<采样序号>，bat:0 表示没装分压检测
+// 不依赖 Arduino.h，时间由调用方传入，主机端仿真可直接编译
+
+#define HEALTH_READ_MS              30000  // 主机读遥测的周期（借用链路探测）
+#define HEALTH_FIRST_READ_MS        2000   // 连上后多久读第一次
+#define HEALTH_WINDOW               16     // 趋势窗口样本数（约 8 分钟）
+#define HEALTH_AVG_SAMPLES          4      // 等级按最近这么多个样本的均值判断
+#define HEALTH_BATTERY_LOW_MV       3550   // 单节锂电：约剩 15%
+#define HEALTH_BATTERY_CRITICAL_MV  3400   // 随时可能欠压重启
+#define HEALTH_HYSTERESIS_MV        50     // 回到上一级需要高出阈值这么多
+#define HEALTH_TEMP_HIGH_C          70
+#define HEALTH_TREND_MIN_SPAN_MS    120000 // 窗口跨度不到这么久不给趋势
+
+enum HealthLevel {
+  HEALTH_LEVEL_OK = 0,
+  HEALTH_LEVEL_LOW,        // 电量偏低：局间换电池
+  HEALTH_LEVEL_CRITICAL    // 电量告急：马上换
+};
+
+// 与 esp_reset_reason_t 取值一致（剑端原样上报）
+enum HealthReset {
+  HEALTH_RESET_UNKNOWN = 0,
+  HEALTH_RESET_POWERON,
+  HEALTH_RESET_EXT,
+  HEALTH_RESET_SW,
+  HEALTH_RESET_PANIC,
+  HEALTH_RESET_INT_WDT,
+  HEALTH_RESET_TASK_WDT,
+  HEALTH_RESET_WDT,
+  HEALTH_RESET_DEEPSLEEP,
+  HEALTH_RESET_BROWNOUT,
+  HEALTH_RESET_SDIO
+};
+
+struct PointerTelemetry {
+  uint16_t batteryMv;      // 0=没有电池检测
+  int16_t tempC;
+  uint8_t resetReason;     // HealthReset
+  uint32_t uptimeS;
+  uint16_t sample;         // 剑端采样序号，主机据此跳过重复读到的旧值
+};
+
+struct HealthMetrics {
+  uint16_t batteryMv;      // 最近 HEALTH_AVG_SAMPLES 个样本均值（0=未知）
+  uint16_t batteryMinMv;
+  int16_t trendMvPerHour;  // 负数为下降；样本跨度不够时为 0
+  uint16_t minutesToLow;   // 按趋势估算到偏低阈值的分钟数（0xFFFF=无法估算）
+  int16_t tempC;
+  uint8_t resetReason;
+  uint32_t uptimeS;
+  uint16_t samples;        // 窗口内样本数
+  uint8_t level;           // HealthLevel
+};
+
+// 解析遥测文本，缺字段或格式不对返回 false
+bool healthParse(const char* text, size_t len, PointerTelemetry& out);
+
+class PointerHealth {
+public:
+  PointerHealth();
+
+  // 新连接：清空窗口（剑端可能刚换过电池）
+  void reset();
+
+  // 收到一次遥测；同一采样序号重复读到时忽略。等级变化返回 true
+  bool add(const PointerTelemetry& t, uint32_t nowMs);
+
+  void metrics(HealthMetrics& out) const;
+  uint8_t level() const { return m_level; }
+  bool hasData() const { return m_haveLast; }
+  // 上次复位是欠压/看门狗/崩溃等异常原因
+  bool abnormalReset() const;
+
+  static const char* levelName(uint8_t level);
+  static const char* resetName(uint8_t reason);
+
+private:
+  uint16_t m_mv[HEALTH_WINDOW];
+  uint32_t m_ms[HEALTH_WINDOW];
+  uint8_t m_count;
+  uint8_t m_head;            // 下一个写入位置
+  uint8_t m_level;
+  bool m_haveLast;
+  PointerTelemetry m_last;
+
+  uint16_t recentAvg() const;
+  int32_t trendMvPerHour() const;
+};
+
+#endif // POINTER_HEALTH_H
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "ScoreboardServer.h"
+#include <esp_timer.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// 极简计分板页面：连上 /ws 后按推送刷新，断开自动重连
+static const char SCOREBOARD_HTML[] =
+    "<!DOCTYPE html><html><head><meta charset=utf-8>"
+    "<meta name=viewport content='width=device-width,initial-scale=1'><title>epee</title>"
+    "<style>body{margin:0;background:#000;color:#fff;font-family:sans-serif;text-align:center}"
+    "#s{display:flex;height:70vh}.p{flex:1;font-size:30vh;line-height:70vh}"
+    "#r{color:#f33}#g{color:#3f3}.on#r{background:#f33;color:#000}.on#g{background:#3f3;color:#000}"
+    "#t{font-size:18vh}#i{font-size:3vh;color:#888}</style></head><body>"
+    "<div id=s><div class=p id=r>0</div><div class=p id=g>0</div></div>"
+    "<div id=t>--:--</div><div id=i>连接中</div><script>"
+    "function c(){var w=new WebSocket('ws://'+location.host+'/ws');"
+    "w.onmessage=function(e){var d=JSON.parse(e.data),r=document.getElementById('r'),g=document.getElementById('g');"
+    "r.textContent=d.red;g.textContent=d.green;r.className=d.lr?'p on':'p';g.className=d.lg?'p on':'p';"
+    "var s=d.time;document.getElementById('t').textContent=(s/60|0)+':'+('0'+s%60).slice(-2);"
+    "var q=['','信号边缘','信号危险'],k=function(n,v){return v<0?' '+n+'离线':(v>0?' '+n+q[v]:'')};"
+    "document.getElementById('i').textContent=(d.rest?'休息 ':'')+(d.run?'计时中':'暂停')+' #'+d.seq+k('红方',d.qr)+k('绿方',d.qg)};"
+    "w.onclose=function(){document.getElementById('i').textContent='重连中';setTimeout(c,1000)}}c()"
+    "</script></body></html>";
+
+ScoreboardServer* ScoreboardServer::s_instance = nullptr;
+ScoreboardServer* ScoreboardServer::getInstance() {
+    if (s_instance == nullptr) {
+        s_instance = new ScoreboardServer();
+    }
+    return s_instance;
+}
+
+ScoreboardServer::ScoreboardServer()
+    : m_server(nullptr)
+    , m_mux(portMUX_INITIALIZER_UNLOCKED)
+    , m_seq(0) {
+    for (int i = 0; i < SCOREBOARD_MAX_CLIENTS; i++) {
+        m_clients[i].fd = -1;
+        m_clients[i].inFlight = false;
+        m_clients[i].lastSeq = 0;
+    }
+    memset(&m_last, 0, sizeof(m_last));
+    m_linkLevel[0] = m_linkLevel[1] = -1;
+    m_lastLink[0] = m_lastLink[1] = -1;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool ScoreboardServer::begin() {
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.core_id = 0;                                 // 远离核心1的判定任务
+    config.max_open_sockets = SCOREBOARD_MAX_CLIENTS + 2; // 留两个给页面请求
+    config.lru_purge_enable = true;
+    config.close_fn = onClose;
+
+    if (httpd_start(&m_server, &config) != ESP_OK) {
+        Serial.println("[计分板] HTTP 服务启动失败");
+        return false;
+    }
+
+    httpd_uri_t index = {};
+    index.uri = "/";
+    index.method = HTTP_GET;
+    index.handler = indexHandler;
+    httpd_register_uri_handler(m_server, &index);
+
+    httpd_uri_t ws = {};
+    ws.uri = "/ws";
+    ws.method = HTTP_GET;
+    ws.handler = wsHandler;
+    ws.is_websocket = true;
+    httpd_register_uri_handler(m_server, &ws);
+
+    xTaskCreatePinnedToCore(pushTask, "Scoreboard", 4096, this, 1, NULL, 0);
+    Serial.println("[计分板] HTTP/WebSocket 服务已启动 (端口 80, /ws)");
+    return true;
+}
+
+void ScoreboardServer::getStats(ScoreboardStats& out) {
+    portENTER_CRITICAL(&m_mux);
+    out = m_stats;
+    portEXIT_CRITICAL(&m_mux);
+}
+
+void ScoreboardServer::setLinkLevels(int8_t red, int8_t green) {
+    m_linkLevel[0] = red;
+    m_linkLevel[1] = green;
+}
+
+void ScoreboardServer::addClient(int fd) {
+    portENTER_CRITICAL(&m_mux);
+    for (int i = 0; i < SCOREBOARD_MAX_CLIENTS; i++) {
+        if (m_clients[i].fd == -1) {
+            m_clients[i].fd = fd;
+            m_clients[i].inFlight = false;
+            m_clients[i].lastSeq = 0; // 下一帧立即推全量状态
+            m_stats.clients++;
+            portEXIT_CRITICAL(&m_mux);
+            return;
+        }
+    }
+    portEXIT_CRITICAL(&m_mux);
+    // 客户端满：拒绝新的，不影响已有推送
+    Serial.printf("[计分板] 客户端已满 (%d)，关闭新连接\n", SCOREBOARD_MAX_CLIENTS);
+    httpd_sess_trigger_close(m_server, fd);
+}
+
+void ScoreboardServer::removeClient(int fd) {
+    portENTER_CRITICAL(&m_mux);
+    for (int i = 0; i < SCOREBOARD_MAX_CLIENTS; i++) {
+        if (m_clients[i].fd == fd) {
+            m_clients[i].fd = -1;
+            m_clients[i].inFlight = false;
+            if (m_stats.clients > 0) m_stats.clients--;
+        }
+    }
+    portEXIT_CRITICAL(&m_mux);
+}
+
+bool ScoreboardServer::sameState(const BoutState& a, const BoutState& b) {
+    return a.redScore == b.redScore && a.greenScore == b.greenScore &&
+           a.redLamp == b.redLamp && a.greenLamp == b.greenLamp &&
+           a.locked == b.locked && a.timerRunning == b.timerRunning &&
+           a.resting == b.resting && a.remainingSeconds == b.remainingSeconds;
+}
+
+// 每帧一次：状态有变化才生成新序号；每个客户端同时只有一条在途消息，
+// 慢客户端跳过中间状态，下一帧直接拿最新状态，不会拖慢其他客户端
+void ScoreboardServer::pushFrame() {
+    static uint32_t lastKeepalive = 0;
+    BoutState st;
+    FencingCore::getInstance()->getBoutState(st);
+
+    uint32_t now = millis();
+    int8_t qr = m_linkLevel[0];
+    int8_t qg = m_linkLevel[1];
+    bool changed = (m_seq == 0) || !sameState(st, m_last) || qr != m_lastLink[0] || qg != m_lastLink[1];
+    bool keepalive = now - lastKeepalive >= SCOREBOARD_KEEPALIVE_MS;
+    if (changed) {
+        m_last = st;
+        m_lastLink[0] = qr;
+        m_lastLink[1] = qg;
+        m_seq++;
+    }
+    if (keepalive) lastKeepalive = now;
+
+    char json[SCOREBOARD_MSG_LEN];
+    int len = snprintf(json, sizeof(json),
+        "{\"seq\":%lu,\"red\":%d,\"green\":%d,\"lr\":%d,\"lg\":%d,\"lock\":%d,\"run\":%d,\"rest\":%d,\"time\":%d,\"qr\":%d,\"qg\":%d}",
+        (unsigned long)m_seq, st.redScore, st.greenScore, st.redLamp, st.greenLamp,
+        st.locked, st.timerRunning, st.resting, st.remainingSeconds, qr, qg);
+    if (changed) {
+        portENTER_CRITICAL(&m_mux);
+        m_stats.frames++;
+        portEXIT_CRITICAL(&m_mux);
+    }
+
+    for (int i = 0; i < SCOREBOARD_MAX_CLIENTS; i++) {
+        Client& c = m_clients[i];
+        portENTER_CRITICAL(&m_mux);
+        int fd = c.fd;
+        bool due = fd != -1 && (c.lastSeq != m_seq || keepalive);
+        bool busy = c.inFlight;
+        if (due && busy) m_stats.skipped++;
+        if (due && !busy) {
+            c.inFlight = true;
+            c.lastSeq = m_seq;
+        }
+        portEXIT_CRITICAL(&m_mux);
+        if (!due || busy) continue;
+
+        memcpy(c.msg, json, len + 1);
+        httpd_ws_frame_t frame = {};
+        frame.type = HTTPD_WS_TYPE_TEXT;
+        frame.payload = (uint8_t*)c.msg;
+        frame.len = len;
+        frame.final = true;
+        bool sent = httpd_ws_send_data_async(m_server, fd, &frame, sendDone, &c) == ESP_OK;
+        portENTER_CRITICAL(&m_mux);
+        if (sent) {
+            m_stats.sends++;
+        } else {
+            c.inFlight = false;
+            m_stats.failures++;
+        }
+        portEXIT_CRITICAL(&m_mux);
+    }
+}
+
+// 异步发送完成（在 HTTP 服务任务里回调）：释放该客户端的在途标记
+void ScoreboardServer::sendDone(esp_err_t err, int fd, void* arg) {
+    Client* c = (Client*)arg;
+    portENTER_CRITICAL(&s_instance->m_mux);
+    c->inFlight = false;
+    if (err != ESP_OK) s_instance->m_stats.failures++;
+    portEXIT_CRITICAL(&s_instance->m_mux);
+    if (err != ESP_OK) httpd_sess_trigger_close(s_instance->m_server, fd);
+}
+
+void ScoreboardServer::pushTask(void* param) {
+    ScoreboardServer* self = (ScoreboardServer*)param;
+    TickType_t lastWake = xTaskGetTickCount();
+    for (;;) {
+        self->pushFrame();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(SCOREBOARD_FRAME_MS));
+    }
+}
+
+esp_err_t ScoreboardServer::indexHandler(httpd_req_t* req) {
+    httpd_resp_set_type(req, "text/html; charset=utf-8");
+    return httpd_resp_send(req, SCOREBOARD_HTML, HTTPD_RESP_USE_STRLEN);
+}
+
+esp_err_t ScoreboardServer::wsHandler(httpd_req_t* req) {
+    if (req->method == HTTP_GET) {
+        // 握手完成：登记客户端
+        int fd = httpd_req_to_sockfd(req);
+        s_instance->addClient(fd);
+        Serial.printf("[计分板] 浏览器已连接 fd=%d\n", fd);
+        return ESP_OK;
+    }
+    // 客户端发来的数据只读掉丢弃（计分板是单向推送）
+    httpd_ws_frame_t frame = {};
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) return ret;
+    if (frame.len > 0) {
+        uint8_t buf[64];
+        if (frame.len > sizeof(buf)) return ESP_FAIL; // 不该有大消息，断开该客户端
+        frame.payload = buf;
+        ret = httpd_ws_recv_frame(req, &frame, sizeof(buf));
+    }
+    return ret;
+}
+
+void ScoreboardServer::onClose(httpd_handle_t hd, int fd) {
+    s_instance->removeClient(fd);
+    close(fd);
+}
\ No newline at end of file
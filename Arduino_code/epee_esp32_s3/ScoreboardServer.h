@@ -0,0 +1,71 @@
+#ifndef SCOREBOARD_SERVER_H
+#define SCOREBOARD_SERVER_H
+
+#include <Arduino.h>
+#include <esp_http_server.h>
+#include "FencingCore.h"
+
+// Wi-Fi 计分板：HTTP 页面 + WebSocket 推送比赛状态（大屏、裁判平板用浏览器打开即可）
+// 运行在核心0（和蓝牙同核），判定任务在核心1，互不抢占
+
+#define SCOREBOARD_MAX_CLIENTS  8     // 最多同时推送的浏览器数
+#define SCOREBOARD_FRAME_MS     50    // 每帧检查一次状态，同一帧内的多次变化合并推送
+#define SCOREBOARD_KEEPALIVE_MS 1000  // 状态不变时也定期重推，新打开的页面/丢帧客户端尽快同步
+#define SCOREBOARD_MSG_LEN      192
+
+// 推送统计（串口 'w' 打印）
+struct ScoreboardStats {
+    uint32_t clients;     // 当前 WebSocket 客户端数
+    uint32_t frames;      // 状态帧（每帧生成一次 JSON）
+    uint32_t sends;       // 实际发出的消息数
+    uint32_t skipped;     // 客户端上一条还没发完而跳过的次数（背压）
+    uint32_t failures;    // 发送失败（客户端已断开）
+};
+
+class ScoreboardServer {
+public:
+    static ScoreboardServer* getInstance();
+
+    // 启动 HTTP 服务和推送任务（Wi-Fi 需已连接/已开热点）
+    bool begin();
+    void getStats(ScoreboardStats& out);
+
+    // 两方链路等级（-1=未连接，其余为 LinkLevel），变化时随下一帧推送
+    void setLinkLevels(int8_t red, int8_t green);
+
+private:
+    struct Client {
+        int fd;                          // -1 = 空位
+        volatile bool inFlight;          // 上一条消息还在发送队列里
+        uint32_t lastSeq;                // 已发给该客户端的状态序号
+        char msg[SCOREBOARD_MSG_LEN];    // 发送中的消息（异步发送期间必须保持有效）
+    };
+
+    ScoreboardServer();
+    ScoreboardServer(const ScoreboardServer&) = delete;
+    ScoreboardServer& operator=(const ScoreboardServer&) = delete;
+
+    static ScoreboardServer* s_instance;
+
+    httpd_handle_t m_server;
+    Client m_clients[SCOREBOARD_MAX_CLIENTS];
+    portMUX_TYPE m_mux;
+    BoutState m_last;
+    volatile int8_t m_linkLevel[2];
+    int8_t m_lastLink[2];
+    uint32_t m_seq;
+    ScoreboardStats m_stats;
+
+    void addClient(int fd);
+    void removeClient(int fd);
+    void pushFrame();
+    static bool sameState(const BoutState& a, const BoutState& b);
+
+    static void pushTask(void* param);
+    static esp_err_t indexHandler(httpd_req_t* req);
+    static esp_err_t wsHandler(httpd_req_t* req);
+    static void sendDone(esp_err_t err, int fd, void* arg);
+    static void onClose(httpd_handle_t hd, int fd);
+};
+
+#endif // SCOREBOARD_SERVER_H
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "SyncLink.h"
+#include <string.h>
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; i++) v |= (uint32_t)p[i] << (8 * i);
+  return v;
+}
+
+size_t syncFrameBuild(const SyncFrame& f, uint8_t* buf) {
+  buf[0] = SYNC_MAGIC;
+  buf[1] = SYNC_VERSION;
+  buf[2] = f.flags;
+  buf[3] = f.bout;
+  put32(buf + 4, f.term);
+  put16(buf + 8, f.seq);
+  buf[10] = f.redScore;
+  buf[11] = f.greenScore;
+  put16(buf + 12, f.remainingSeconds);
+  put16(buf + 14, f.savedMatchSeconds);
+  put16(buf + 16, f.maxDurationSeconds);
+  put32(buf + 18, f.judged[0]);
+  put32(buf + 22, f.judged[1]);
+  memcpy(buf + 26, f.nonce[0], SYNC_NONCE_LEN);
+  memcpy(buf + 34, f.nonce[1], SYNC_NONCE_LEN);
+  buf[42] = f.piste;
+  memcpy(buf + SYNC_SIGNED_LEN, f.tag, SYNC_TAG_LEN);
+  return SYNC_FRAME_LEN;
+}
+
+bool syncFrameParse(const uint8_t* data, size_t len, SyncFrame& out) {
+  if (data == nullptr || len != SYNC_FRAME_LEN) return false;
+  if (data[0] != SYNC_MAGIC || data[1] != SYNC_VERSION) return false;
+  out.flags = data[2];
+  out.bout = data[3];
+  out.term = get32(data + 4);
+  out.seq = get16(data + 8);
+  out.redScore = data[10];
+  out.greenScore = data[11];
+  out.remainingSeconds = get16(data + 12);
+  out.savedMatchSeconds = get16(data + 14);
+  out.maxDurationSeconds = get16(data + 16);
+  out.judged[0] = get32(data + 18);
+  out.judged[1] = get32(data + 22);
+  memcpy(out.nonce[0], data + 26, SYNC_NONCE_LEN);
+  memcpy(out.nonce[1], data + 34, SYNC_NONCE_LEN);
+  out.piste = data[42];
+  memcpy(out.tag, data + SYNC_SIGNED_LEN, SYNC_TAG_LEN);
+  return true;
+}
+
+void syncAuthNonce(uint8_t piste, uint8_t out[SYNC_NONCE_LEN]) {
+  static const uint8_t prefix[SYNC_NONCE_LEN - 1] = {'e', 'p', 's', 'y', 'n', 'c', SYNC_VERSION};
+  memcpy(out, prefix, sizeof(prefix));
+  out[SYNC_NONCE_LEN - 1] = piste;
+}
+
+bool syncFrameNewer(uint32_t term, uint16_t seq, uint32_t lastTerm, uint16_t lastSeq) {
+  if (term != lastTerm) return term > lastTerm;
+  return (int16_t)(seq - lastSeq) > 0;
+}
+
+SyncRole::SyncRole()
+  : m_primaryRole(true), m_active(false), m_heard(false), m_term(0), m_peerTerm(0),
+    m_bootMs(0), m_lastHeardMs(0) {}
+
+void SyncRole::begin(bool primaryRole, uint32_t nowMs) {
+  m_primaryRole = primaryRole;
+  m_active = false;
+  m_heard = false;
+  m_term = 0;
+  m_peerTerm = 0;
+  m_bootMs = nowMs;
+  m_lastHeardMs = nowMs;
+}
+
+bool SyncRole::heard(uint32_t peerTerm, bool peerPrimary, bool peerIdHigher, uint32_t nowMs) {
+  m_heard = true;
+  m_lastHeardMs = nowMs;
+  if (peerTerm > m_peerTerm || !m_active) m_peerTerm = peerTerm;
+  if (!m_active) return false;
+  // 两台都在主用：任期高的留下；任期相同时主用角色留下，角色也相同时地址大的留下
+  bool yield = peerTerm > m_term;
+  if (peerTerm == m_term) {
+    yield = (peerPrimary != m_primaryRole) ? peerPrimary : peerIdHigher;
+  }
+  if (yield) m_active = false;
+  return yield;
+}
+
+bool SyncRole::due(uint32_t nowMs) const {
+  if (m_active) return false;
+  if (m_heard) return nowMs - m_lastHeardMs > SYNC_TAKEOVER_MS;
+  uint32_t wait = m_primaryRole ? SYNC_BOOT_LISTEN_MS : SYNC_STANDBY_WAIT_MS;
+  return nowMs - m_bootMs > wait;
+}
+
+uint32_t SyncRole::takeOver(uint32_t nowMs) {
+  m_active = true;
+  m_term = (m_peerTerm > m_term ? m_peerTerm : m_term) + 1;
+  return m_heard ? nowMs - m_lastHeardMs : 0;
+}
\ No newline at end of file
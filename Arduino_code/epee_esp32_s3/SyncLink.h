@@ -0,0 +1,104 @@
+#ifndef SYNC_LINK_H
+#define SYNC_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 热备主机同步链路：主用主机每 SYNC_HEARTBEAT_MS 广播一帧心跳（ESP-NOW），带完整比赛状态；
+// 热备主机同时订阅两把剑的通知（不回写），按心跳镜像比分/计时，心跳中断超过 SYNC_TAKEOVER_MS 即接管
+// 任期（term）每接管一次 +1：同时有两台主用时任期高的留下，任期相同时主用角色留下
+// 同一剑道的两台主机才配成一对：帧里带剑道号，整帧用两台共用的剑端密钥（x/k 导入）算 CMAC 标签，
+// 剑道号不同、标签不对、来源地址不是本次上电认定的那台、序号不比上一帧新的帧一律丢弃
+// 不依赖 Arduino.h，主机端工具可直接编译
+//
+// 帧格式（47 字节，小端）：
+//   [0] 标识 0xEC  [1] 版本 2  [2] 角色/随机数标志 SYNC_FLAG_*  [3] 比赛标志 SYNC_BOUT_*
+//   [4..7] 任期  [8..9] 序号  [10] 红分 [11] 绿分
+//   [12..13] 计时剩余秒 [14..15] 比赛断点秒 [16..17] 局时长秒
+//   [18..21] 红方已交判定击中数 [22..25] 绿方已交判定击中数（热备据此找出主用没来得及判定的击中）
+//   [26..33] 红方本次连接随机数 [34..41] 绿方本次连接随机数（热备用它校验剑端标签，密钥不上链路）
+//   [42] 剑道号（配对号）  [43..46] 标签：HitAuth CMAC，随机数取 syncAuthNonce(剑道号)，覆盖 [0..42]
+
+#define SYNC_MAGIC            0xEC
+#define SYNC_VERSION          2
+#define SYNC_SIGNED_LEN       43      // 标签覆盖的字节数
+#define SYNC_TAG_LEN          4       // 与 HIT_AUTH_TAG_LEN 一致
+#define SYNC_FRAME_LEN        (SYNC_SIGNED_LEN + SYNC_TAG_LEN)
+#define SYNC_HEARTBEAT_MS     50      // 主用心跳间隔
+#define SYNC_TAKEOVER_MS      300     // 心跳中断这么久热备接管（约 6 帧）
+#define SYNC_BOOT_LISTEN_MS   400     // 主用角色上电先听这么久，已有主机在跑就当热备
+#define SYNC_STANDBY_WAIT_MS  3000    // 热备角色上电后一直没听到心跳，等这么久再自己接管
+#define SYNC_NONCE_LEN        8       // 与 HIT_AUTH_NONCE_LEN 一致
+
+#define SYNC_FLAG_PRIMARY     0x01    // 发送方配置为主用角色
+#define SYNC_FLAG_NONCE_RED   0x02
+#define SYNC_FLAG_NONCE_GREEN 0x04
+
+#define SYNC_BOUT_RUNNING     0x01
+#define SYNC_BOUT_RESTING     0x02
+#define SYNC_BOUT_LOCKED      0x04
+#define SYNC_BOUT_RED_LAMP    0x08
+#define SYNC_BOUT_GREEN_LAMP  0x10
+
+struct SyncFrame {
+  uint8_t flags;
+  uint8_t bout;
+  uint32_t term;
+  uint16_t seq;
+  uint8_t redScore;
+  uint8_t greenScore;
+  uint16_t remainingSeconds;
+  uint16_t savedMatchSeconds;
+  uint16_t maxDurationSeconds;
+  uint32_t judged[2];                     // 按 HitSide 索引
+  uint8_t nonce[2][SYNC_NONCE_LEN];
+  uint8_t piste;                          // 配对号：同一剑道的两台主机相同
+  uint8_t tag[SYNC_TAG_LEN];
+};
+
+// build 原样写入 f.tag：调用方 build 后对 buf 前 SYNC_SIGNED_LEN 字节算标签，写到 buf + SYNC_SIGNED_LEN
+size_t syncFrameBuild(const SyncFrame& f, uint8_t* buf);
+// 只解析格式，标签由调用方对 data 前 SYNC_SIGNED_LEN 字节校验
+bool syncFrameParse(const uint8_t* data, size_t len, SyncFrame& out);
+
+// 心跳签名用的随机数：固定前缀 + 剑道号（与剑端帧的连接随机数区分开，换剑道号标签即不同）
+void syncAuthNonce(uint8_t piste, uint8_t out[SYNC_NONCE_LEN]);
+
+// 序号比上一帧新：任期更高，或同一任期序号往前走（按 16 位回绕比较）
+bool syncFrameNewer(uint32_t term, uint16_t seq, uint32_t lastTerm, uint16_t lastSeq);
+
+// 主用/热备角色切换（只在一个任务里调用）
+class SyncRole {
+public:
+  SyncRole();
+
+  // primaryRole=配置为主用；上电都先按热备等待，due() 到点再接管
+  void begin(bool primaryRole, uint32_t nowMs);
+
+  // 收到对端心跳；返回 true 表示本机是主用但对端优先，应退为热备
+  // peerIdHigher：对端地址比本机大（任期、角色都相同时的最后裁决）
+  bool heard(uint32_t peerTerm, bool peerPrimary, bool peerIdHigher, uint32_t nowMs);
+
+  // 热备且心跳中断超时（从没听到过心跳时按上电等待时间）
+  bool due(uint32_t nowMs) const;
+
+  // 接管：任期取双方最大值 +1，返回最后一帧心跳到现在的毫秒数（从没听到过返回 0）
+  uint32_t takeOver(uint32_t nowMs);
+
+  bool active() const { return m_active; }
+  bool primaryRole() const { return m_primaryRole; }
+  bool everHeard() const { return m_heard; }
+  uint32_t term() const { return m_term; }
+  uint32_t lastHeardMs() const { return m_lastHeardMs; }
+
+private:
+  bool m_primaryRole;
+  bool m_active;
+  bool m_heard;
+  uint32_t m_term;
+  uint32_t m_peerTerm;
+  uint32_t m_bootMs;
+  uint32_t m_lastHeardMs;
+};
+
+#endif // SYNC_LINK_H
\ No newline at end of file
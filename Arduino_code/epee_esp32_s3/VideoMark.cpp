@@ -0,0 +1,57 @@
+#include "VideoMark.h"
+#include <stdio.h>
+
+bool VideoMarkRing::push(const VideoMark& m) {
+  uint32_t head = m_head;
+  uint32_t tail = __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+  if (head - tail >= VIDEO_MARK_RING) {
+    __atomic_store_n(&m_drops, m_drops + 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  m_items[head % VIDEO_MARK_RING] = m;
+  __atomic_store_n(&m_head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool VideoMarkRing::pop(VideoMark& m) {
+  uint32_t tail = m_tail;
+  uint32_t head = __atomic_load_n(&m_head, __ATOMIC_ACQUIRE);
+  if (head == tail) return false;
+  m = m_items[tail % VIDEO_MARK_RING];
+  __atomic_store_n(&m_tail, tail + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+uint32_t VideoMarkRing::pending() const {
+  return __atomic_load_n(&m_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&m_tail, __ATOMIC_ACQUIRE);
+}
+
+size_t videoMarkFormat(const VideoMark& m, char* out, size_t cap) {
+  int n = snprintf(out, cap, "vm:%u|k:%u|us:%lld|ms:%lu|hit:%lu|f:%u|r:%u|s:%u-%u", m.seq, m.kind,
+                   (long long)m.edgeUs, (unsigned long)m.ms, (unsigned long)m.hitMs, m.flags, m.result,
+                   m.redScore, m.greenScore);
+  if (n < 0 || (size_t)n >= cap) return 0;
+  return (size_t)n;
+}
+
+const char* videoMarkKindName(uint8_t kind) {
+  switch (kind) {
+    case VIDEO_MARK_START:   return "开始";
+    case VIDEO_MARK_VERDICT: return "判定";
+    case VIDEO_MARK_AMEND:   return "补判";
+    case VIDEO_MARK_TOUCH:   return "击中";
+    default:                 return "?";
+  }
+}
+
+uint8_t videoFlashCode(uint8_t kind, uint16_t seq, uint32_t& bits) {
+  uint8_t code = (uint8_t)(((kind & 0x03) << 6) | (seq & 0x3F));
+  bits = (1u << VIDEO_FLASH_LEAD_SLOTS) - 1;     // 引导亮，上升沿即标记时刻
+  uint8_t n = VIDEO_FLASH_LEAD_SLOTS + 1;        // 引导后灭一格
+  for (int i = 7; i >= 0; i--) {
+    // 每位都有一次跳变，逐帧看亮度就能解出来
+    bits |= 1u << (((code >> i) & 1) ? n : n + 1);
+    n += 2;
+  }
+  return n;
+}
\ No newline at end of file
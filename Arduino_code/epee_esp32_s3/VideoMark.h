@@ -0,0 +1,70 @@
+#ifndef VIDEO_MARK_H
+#define VIDEO_MARK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 录像同步标记：计时开始和每次判定/补判时主机输出同步脉冲（接录像机/采集卡的同步输入）和闪码（灯放在镜头里），
+// 同时记下本机时间；击中按主机时间基准记进同一条时间线。回看时用脉冲沿或闪码引导对齐一帧，
+// 其余击中按时间线里的毫秒差换算到帧
+// 判定任务只往环里写，串口导出在 loop 里（单生产者/单消费者，不加锁不阻塞），环满丢新记录并计数，
+// 导出的序号有缺口即说明丢过
+// 导出行：vm:<序号>|k:<类别>|us:<脉冲沿微秒>|ms:<同一时刻 millis>|hit:<首击/击中时间>|f:<标志>|r:<击中结果>|s:<红>-<绿>
+// 闪码：引导亮 2 格、灭 1 格，之后 8 位（类别 2 位 + 序号低 6 位，高位在前），每位 2 格：1=亮灭，0=灭亮
+// 不依赖 Arduino.h，主机端仿真可直接编译
+
+#define VIDEO_MARK_RING        32     // 待导出记录数（一剑最多几条，loop 1ms 取一次）
+#define VIDEO_MARK_TEXT_MAX    112
+#define VIDEO_FLASH_LEAD_SLOTS 2
+#define VIDEO_FLASH_SLOTS      (VIDEO_FLASH_LEAD_SLOTS + 1 + 16)
+
+enum VideoMarkKind {
+  VIDEO_MARK_START = 0,   // 计时开始/恢复
+  VIDEO_MARK_VERDICT,     // 判定亮灯
+  VIDEO_MARK_AMEND,       // 补判改为同时击中
+  VIDEO_MARK_TOUCH,       // 击中进入判定（只记时间线，不出脉冲）
+  VIDEO_MARK_KIND_COUNT
+};
+
+// 标志：判定/补判为亮灯，击中为来源
+#define VIDEO_FLAG_RED     0x01   // 红灯 / 红方击中
+#define VIDEO_FLAG_GREEN   0x02   // 绿灯
+#define VIDEO_FLAG_LATE    0x04   // 击中为补发
+
+struct VideoMark {
+  uint16_t seq;          // 记录序号（含击中）
+  uint8_t kind;          // VideoMarkKind
+  uint8_t flags;
+  uint8_t result;        // 击中：判定引擎的结果（JudgeHitResult）
+  uint8_t redScore;
+  uint8_t greenScore;
+  int64_t edgeUs;        // 脉冲上升沿（esp_timer 微秒）；击中为记录时刻
+  uint32_t ms;           // 与 edgeUs 同一时刻的 millis()
+  uint32_t hitMs;        // 判定：本剑首击；击中：击中时间（主机时间基准）
+};
+
+class VideoMarkRing {
+public:
+  VideoMarkRing() : m_head(0), m_tail(0), m_drops(0) {}
+
+  // 生产者（判定任务）；满了返回 false
+  bool push(const VideoMark& m);
+  // 消费者（loop）
+  bool pop(VideoMark& m);
+  uint32_t drops() const { return __atomic_load_n(&m_drops, __ATOMIC_RELAXED); }
+  uint32_t pending() const;
+
+private:
+  VideoMark m_items[VIDEO_MARK_RING];
+  uint32_t m_head;       // 只由生产者写
+  uint32_t m_tail;       // 只由消费者写
+  uint32_t m_drops;
+};
+
+size_t videoMarkFormat(const VideoMark& m, char* out, size_t cap);
+const char* videoMarkKindName(uint8_t kind);
+
+// 闪码：bits 第 i 位为第 i 格亮，返回格数（VIDEO_FLASH_SLOTS）
+uint8_t videoFlashCode(uint8_t kind, uint16_t seq, uint32_t& bits);
+
+#endif // VIDEO_MARK_H
\ No newline at end of file
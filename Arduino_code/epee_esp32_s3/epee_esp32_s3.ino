@@ -4,6 +4,28 @@
 #include <BLEAdvertisedDevice.h>
 #include "led_controller.h"
 #include "FencingCore.h" // 仅引入封装类，无其他依赖
+#include "HitLink.h"
+#include "HitAuth.h"
+#include "LinkMonitor.h"
+#include "PointerHealth.h"
+#include "BladeMonitor.h"
+#include "ScoreboardServer.h"
+#include "BootTimeline.h"
+#include "InjectPort.h"
+#include "RemoteLink.h"
+#include "HubFrame.h"
+#include "SyncLink.h"
+#include "OtaLink.h"
+#include "GattCache.h"
+#include "PeerGatt.h"
+#include "VideoMark.h"
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <esp_mac.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <LittleFS.h>
 
 // =====================【蓝牙相关常量（完全保留，未改动）】=====================
 const int LED_BOARD = 8;
@@ -28,14 +50,273 @@ static BLEAdvertisedDevice* greenDevice;
 int redRetryCount = 0;
 int greenRetryCount = 0;
 
+// =====================【Wi-Fi 计分板（可选）】=====================
+#define SCOREBOARD_ENABLE   0                  // 1=开启热点+网页计分板（浏览器打开 http://192.168.4.1/）
+#define SCOREBOARD_SSID     "epee_scoreboard"
+#define SCOREBOARD_PASS     "epee1234"         // 至少8位
+
+// 判定任务周期抖动（衡量计分板等核心0负载是否影响判定）
+volatile uint32_t logicMaxLateUs = 0;   // 单次循环超出 10ms 周期的最大值
+volatile uint32_t logicLoops = 0;
+
+// =====================【存储转发 - 击中帧去重+确认】=====================
+HitLink hitLink;
+portMUX_TYPE hitLinkMux = portMUX_INITIALIZER_UNLOCKED; // 通知回调与蓝牙任务共用 hitLink
+PeerChar* redHitChar = nullptr;   // 用于回写 hello/ack
+PeerChar* greenHitChar = nullptr;
+TaskHandle_t bleTaskHandle = NULL;               // 收到击中后唤醒蓝牙任务尽快回确认
+
+// =====================【快速启动 - 已知剑端直连 + 启动时间线】=====================
+// 上次连上的剑端地址存在 NVS，重启后先按地址直连（剑端断线后一直在广播），连不上再扫描
+#define KNOWN_PEER_NS          "epee_peers"
+#define KNOWN_PEER_TIMEOUT_MS  1000
+BootTimeline bootTimeline;
+volatile bool coreReady = false;   // FencingCore 在逻辑任务里初始化，完成前收到的击中不参与判定
+
+// =====================【属性句柄缓存 - 重连跳过服务发现】=====================
+// 剑端布局特征值里有各特征值/CCCD 的句柄（见 GattCache.h），按剑端地址存在 NVS；
+// 重连时读一次布局核对，一致就按缓存句柄直接打开通知，否则发现服务并更新缓存。
+// 连上后的读写/通知都按句柄走 PeerGatt，不再依赖 BLERemoteCharacteristic
+// 串口 g 打印两条路径的耗时对比，G 清除缓存（下次重连走发现，用来对比）
+#define GATT_NS  "epee_gatt"
+static BLEUUID gattLayoutCharUUID("beb5483e-36e1-4688-b7f5-ea07361b26ab");
+struct PeerChars {
+  PeerChar hit;
+  PeerChar telemetry;
+  PeerChar ota;
+};
+PeerChars peerChars[2];                    // 本次连接的特征值，按 HitSide 索引
+GattConnectStats gattStats;                // 受 gattMux 保护（通知回调里记首条通知）
+portMUX_TYPE gattMux = portMUX_INITIALIZER_UNLOCKED;
+int64_t gattConnectUs[2] = {0, 0};         // 本次连接开始时间
+uint8_t gattPath[2] = {GATT_PATH_DISCOVERED, GATT_PATH_DISCOVERED};
+volatile bool gattFirstPending[2] = {false, false}; // 还没收到本次连接的第一条通知
+
+// =====================【击中帧认证 - 配对密钥+连接随机数】=====================
+// 已配对的一方每帧必须带正确的 CMAC 标签；未配对的一方按旧格式接收（兼容旧剑端）
+#define AUTH_NS          "epee_auth"
+#define PAIR_WINDOW_MS   30000           // 串口 'p' 后的配对窗口
+HitAuth hitAuth[2];                      // 按 HitSide 索引，校验在通知回调里做
+HitAuth ctrlAuth[2];                     // 写给剑端的随机数/hello/确认签名，只在蓝牙任务里用（与通知回调分开）
+volatile unsigned long pairUntil = 0;    // 配对窗口截止时间（0=未开启）
+bool pairTried[2] = {false, false};      // 本次窗口内已尝试过配对（掉线后清除，重连再试）
+volatile uint32_t authVerifyCount = 0;   // 校验次数/耗时，串口 's' 打印
+volatile uint32_t authVerifyTotalUs = 0;
+volatile uint32_t authVerifyMaxUs = 0;
+uint8_t authNonce[2][HIT_AUTH_NONCE_LEN];   // 本次连接随机数（心跳带给热备主机）
+volatile bool authNonceSet[2] = {false, false};
+
+// =====================【链路质量监测】=====================
+// 每 LINK_PING_MS 读一次 RSSI、做一次读往返，结合通知到达时间和连接参数评估每方链路，
+// 断线前在状态灯和计分板上提前告警；串口 'q' 打印指标
+LinkMonitor linkMon[2];                       // 按 HitSide 索引
+portMUX_TYPE linkMonMux = portMUX_INITIALIZER_UNLOCKED; // 通知回调/GAP 事件/蓝牙任务共用
+esp_bd_addr_t peerBda[2];                     // 对端地址，用来匹配连接参数更新事件
+uint8_t linkLevel[2] = {LINK_LEVEL_OK, LINK_LEVEL_OK};
+unsigned long lastLinkProbe = 0;
+
+// =====================【剑端电量/健康】=====================
+// 剑端空闲时采样电池电压/芯片温度/复位原因写进遥测特征值；每 HEALTH_READ_MS 把一次链路探测改读它，
+// 不多发包。电量跌破阈值、温度过高、上次异常复位时串口告警；串口 't' 打印
+static BLEUUID telemetryCharUUID("beb5483e-36e1-4688-b7f5-ea07361b26aa");
+PointerHealth pointerHealth[2];               // 按 HitSide 索引，受 linkMonMux 保护
+PeerChar* telemetryChar[2] = {nullptr, nullptr}; // 旧剑端没有
+unsigned long healthNextRead[2] = {0, 0};
+bool healthHot[2] = {false, false};
+
+// 剑端 ADC 连续采样发现剑路故障（接触不良/电阻偏高/短路）时经击中特征值发 fault: 帧（见 BladeMonitor.h），
+// 通知回调按前缀分流，不进击中判定；串口 't' 一并打印
+volatile uint32_t bladeFaults[2][BLADE_CLASS_COUNT];  // 按 HitSide、BladeClass 索引
+BladeEvent bladeLast[2];                               // 最近一条故障（受 linkMonMux 保护）
+
+// =====================【串口注入口（压测/硬件在环）】=====================
+// Linux 脚本经串口二进制帧注入合成击中/按键/链路事件（见 InjectPort.h、host_tools/inject_load），
+// 击中按剑端帧格式走认证→去重→补发→判定全路径，主机回传处理结果和判定耗时
+// 注意：已配对的一方注入时该方剑端应关机（签名与通知回调共用该方 HitAuth）
+#define INJECT_SID            0xfeed      // 注入击中的会话号，与真实剑端区分（真实帧到达时自动切回）
+#define INJECT_VERDICT_QUEUE  16
+#define SERIAL_RX_BUFFER      1024        // 高速注入时的串口接收缓冲
+struct InjectedHit {
+  uint16_t seq;
+  uint32_t hitTimeMs;   // 换算后的击中时间，用来判断是否计入本次判定
+  int64_t rxUs;         // 注入帧到达时间
+};
+InjectParser injectParser;
+QueueHandle_t verdictQueue = NULL;
+portMUX_TYPE injectMux = portMUX_INITIALIZER_UNLOCKED;
+InjectedHit injectLast[2];                 // 按 HitSide 索引
+volatile bool injectEnabled = false;       // 收到过注入帧才回传判定，平时串口只有文字日志
+volatile bool injectActive[2] = {false, false}; // 该方当前是注入会话：确认不回写给真实剑端
+volatile bool serialQuiet = false;         // 注入设置 quiet=1 时关闭 lockedPrintf 日志
+volatile bool linkDropRequest[2] = {false, false};
+volatile bool linkRescanRequest = false;
+volatile uint32_t injectTouches = 0;
+volatile uint32_t injectVerdicts = 0;
+volatile uint32_t injectVerdictDrops = 0;
+
+// =====================【无线裁判遥控器（ESP-NOW）】=====================
+// 遥控器命令在 Wi-Fi 任务的接收回调里校验、去重，按按键编号交给 FencingCore 并立即唤醒判定任务；
+// 不经过击中链路的通知回调/hitLink，也不占用蓝牙任务。配对与剑端共用串口 'p' 的配对窗口
+// 默认关闭：打开后 Wi-Fi STA 常开，ESP32-S3 的 Wi-Fi 与击中链路分时共用射频；用遥控器的剑道再打开
+#define REMOTE_ENABLE    0
+#define REMOTE_KEY       "remote"        // 与剑端密钥同在 AUTH_NS
+#define REMOTE_MAC_KEY   "remote_mac"
+HitAuth remoteAuth;                      // 只在 Wi-Fi 任务的接收回调里签名校验
+RemoteLink remoteLink;
+uint8_t remoteMac[6];
+uint8_t remoteNonce[HIT_AUTH_NONCE_LEN];
+volatile bool remoteKnown = false;       // 已配对遥控器（只认这个地址）
+uint8_t remotePairMac[6];                // 配对中：已下发密钥、等遥控器回 "paired"
+uint8_t remotePairKey[HIT_AUTH_KEY_LEN];
+volatile bool remotePairPending = false;
+volatile bool remotePairDone = false;    // 回调里收到 "paired"，loop 里写 NVS
+volatile uint32_t remoteHandleMaxUs = 0; // 收到命令→回确认的最大耗时
+TaskHandle_t logicTaskHandle = NULL;     // 遥控器/注入按键到达时唤醒判定任务
+bool espNowReady = false;                // 遥控器和赛场汇总共用一次 ESP-NOW 初始化
+
+// =====================【赛场汇总（ESP-NOW 广播比分和判定结果）】=====================
+// 状态变化时和每秒发一帧状态，每次判定亮灯发一帧结果；汇总中心见 tournament_hub
+// 剑道号存在 NVS，串口 h<号><回车> 设置（如 h12）
+// 默认关闭：打开后 Wi-Fi STA 常开、每秒至少一帧，与击中链路分时共用射频；接了汇总中心的赛场再打开
+#define HUB_ENABLE          0
+#define HUB_NS              "epee_hub"
+#define HUB_DEFAULT_PISTE   1
+#define HUB_POLL_MS         50
+static const uint8_t HUB_BROADCAST[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+uint8_t hubPiste = HUB_DEFAULT_PISTE;
+bool hubReady = false;
+uint16_t hubSeq = 0;
+AppState hubLast;
+bool hubLastLocked = false;
+unsigned long hubLastSend = 0;
+unsigned long hubLastPoll = 0;
+int pisteEntry = -1;                     // 串口输入剑道号中（-1=未在输入）
+int pisteDigits = 0;
+
+// =====================【热备主机（心跳中断后接管）】=====================
+// 两台主机同时连两把剑：主用主机判定，每 SYNC_HEARTBEAT_MS 广播心跳（比分/计时/随机数/已判定击中数）；
+// 热备主机只订阅通知、不回写，按心跳镜像比分和计时。心跳中断 SYNC_TAKEOVER_MS 后热备接管：
+// 给在线剑端写随机数+hello（剑端补发未确认击中），主用没来得及判定的击中补交判定，串口报告中断时长和空档击中
+// 角色存在 NVS，串口 Y 切换（重启生效）、y 打印状态；已配对的剑端两台主机要用同一密钥（x 导出，k<64位十六进制><回车> 导入）
+// 配对：两台主机设同一剑道号（h），心跳用共用的剑端密钥签名（red 已配对用 red 的，否则用 green 的），
+// 剑道号/标签不对的帧丢弃，本次上电第一台验证通过的主机之后只认它的地址；没有密钥时不启用同步、单机判定
+// 默认关闭：一般剑道只有一台主机；打开后每 50ms 广播一帧，Wi-Fi 与击中链路分时共用射频
+#define SYNC_ENABLE          0
+#define SYNC_NS              "epee_sync"
+#define SYNC_GAP_RING        8        // 每方记住最近这么多条击中，接管时找主用没判定的
+#define SYNC_GAP_LOOKBACK_MS 200      // 最后一帧心跳前这么久以内的空档击中才补交判定，更早的只报告
+struct SyncGapHit {
+  uint16_t seq;
+  uint32_t hitTimeMs;
+};
+SyncRole syncRole;                        // 只在判定任务里操作
+volatile bool syncReady = false;
+volatile bool syncActive = !SYNC_ENABLE;  // 本机在判定（false=热备，只镜像）
+volatile uint32_t syncTerm = 0;
+portMUX_TYPE syncMux = portMUX_INITIALIZER_UNLOCKED; // Wi-Fi 回调/通知回调/判定任务共用
+SyncFrame syncRx;                         // 最新一帧心跳，判定任务取走
+uint32_t syncRxMs = 0;
+bool syncRxIdHigher = false;
+volatile bool syncRxReady = false;
+uint8_t syncSelfMac[6];
+uint32_t syncHits[2] = {0, 0};            // 交给判定（热备时记入空档环）的击中数，按 HitSide 索引
+SyncGapHit syncGap[2][SYNC_GAP_RING];     // 最近的击中，按 syncHits 取模
+uint32_t syncReflected[2] = {0, 0};       // 热备：主用已判定到本机计数的哪个位置
+uint32_t syncPeerJudged[2] = {0, 0};
+bool syncMirrored = false;                // 热备：已按心跳对齐过计数
+uint8_t syncPeerNonce[2][HIT_AUTH_NONCE_LEN];
+volatile uint8_t syncNonceDirty = 0;      // bit n：HitSide n 的随机数有更新，蓝牙任务套用
+volatile bool syncHelloPending = false;   // 接管后蓝牙任务给在线剑端写随机数+hello
+uint16_t syncSeq = 0;
+unsigned long syncLastSend = 0;
+uint32_t syncTxCount = 0;
+volatile uint32_t syncRxCount = 0;
+uint32_t syncFailovers = 0;
+uint32_t syncLastFailoverMs = 0;
+uint32_t syncLastGap[2] = {0, 0};
+HitAuth syncTxAuth;                       // loop 里给心跳签名
+HitAuth syncRxAuth;                       // Wi-Fi 任务的接收回调里校验（两个任务不共用 CMAC 上下文）
+uint8_t syncPiste = HUB_DEFAULT_PISTE;    // 配对号：本次上电时的剑道号
+uint8_t syncPeerMac[6];                   // 以下只在 Wi-Fi 任务里读写
+bool syncPeerBound = false;               // 已认定对端主机地址（本次上电）
+bool syncLastValid = false;
+uint32_t syncLastTerm = 0;
+uint16_t syncLastSeq = 0;
+volatile uint32_t syncRxDropped = 0;      // 剑道号/标签/地址/序号不对丢弃的帧
+int keyEntry = -1;                        // 串口导入密钥中（-1=未在输入）
+char keyHex[HIT_AUTH_KEY_LEN * 4 + 1];
+
+// =====================【剑端蓝牙升级】=====================
+// 镜像用 host_tools/ota_sim 打包（有剑端当前固件时自动做差分），放进 LittleFS：/ota/red.img、/ota/green.img
+// 串口 u：给在线剑端开始升级，中途掉线重连后自动从剑端已写到的位置续传；U：放弃
+// 升级期间蓝牙任务 1ms 轮询、暂停扫描，每块一条无响应写；旧剑端没有升级特征值，提示后跳过
+#define OTA_ENABLE           1
+#define OTA_RED_PATH         "/ota/red.img"
+#define OTA_GREEN_PATH       "/ota/green.img"
+#define OTA_BURST            8        // 每轮最多写这么多条（其余受窗口限制）
+#define OTA_STATUS_RING      4
+#define OTA_MTU_WAIT_MS      1000     // 请求大 MTU 后最多等这么久
+static BLEUUID otaCharUUID("beb5483e-36e1-4688-b7f5-ea07361b26a9");
+
+// 从 LittleFS 读镜像：按偏移顺序读，seek 基本不动
+class FileImageReader : public OtaImageReader {
+public:
+  File file;
+  bool read(uint32_t off, uint8_t* buf, size_t n) override {
+    if (!file) return false;
+    if (file.position() != off && !file.seek(off)) return false;
+    return file.read(buf, n) == n;
+  }
+};
+
+struct OtaPeer {
+  OtaSender sender;
+  FileImageReader reader;
+  PeerChar* chr;                  // 本次连接的升级特征值（旧剑端为 nullptr）
+  bool wanted;                    // 串口 u 之后直到完成/失败/放弃
+  bool running;                   // 本次连接已 begin
+  uint32_t mtuAskedMs;            // 0=还没请求大 MTU
+  uint32_t startMs;
+  uint8_t lastTenth;              // 上次打印的进度（10% 一档）
+  uint8_t status[OTA_STATUS_RING][OTA_STATUS_LEN]; // 通知回调写，蓝牙任务取
+  uint8_t statusHead;
+  uint8_t statusCount;
+};
+OtaPeer otaPeer[2];
+portMUX_TYPE otaMux = portMUX_INITIALIZER_UNLOCKED;
+uint8_t otaTxBuf[OTA_MTU];
+
+// =====================【录像同步标记】=====================
+// 计时开始、每次判定/补判时输出同步脉冲（接录像机/采集卡同步输入）和闪码（灯放进镜头画面），
+// 标记和击中按主机时间基准记进时间线，loop 从串口导出 "[录像] vm:..." 行（格式见 VideoMark.h）
+// 判定任务里只写 GPIO、启动 esp_timer、写环，不等串口；串口 v 打印计数，V 开/关脉冲和闪码（时间线照常导出，注入 quiet 也不停）
+#define VIDEO_MARK_ENABLE    1
+#define VIDEO_PULSE_PIN      21       // 同步脉冲输出，-1=不用
+#define VIDEO_PULSE_MS       20       // 脉冲宽度（高电平）
+#define VIDEO_LED_PIN        38       // 闪码灯，-1=不用
+#define VIDEO_FLASH_SLOT_MS  40       // 闪码每格时长，不短于一帧（25fps=40ms；50fps 录像可改 20）
+VideoMarkRing videoMarks;
+volatile bool videoOutputOn = true;
+uint16_t videoSeq = 0;                    // 只在判定任务里改
+esp_timer_handle_t videoPulseTimer = NULL;
+esp_timer_handle_t videoFlashTimer = NULL;
+portMUX_TYPE videoMux = portMUX_INITIALIZER_UNLOCKED; // 判定任务与 esp_timer 任务共用闪码进度
+uint32_t videoFlashBits = 0;
+uint8_t videoFlashLen = 0;
+uint8_t videoFlashPos = 0;
+uint32_t videoExported[VIDEO_MARK_KIND_COUNT];
+
 // =====================【前置函数声明（蓝牙相关，保留）】=====================
 void updateBLEStatusLed();
 void checkBLEConnectionStatus();
-bool connectToDevice(BLEAdvertisedDevice* target, void (*cb)(BLERemoteCharacteristic*, uint8_t*, size_t, bool), String side);
+bool connectToDevice(BLEAdvertisedDevice* target, PeerNotifyCallback cb, String side);
+bool connectToAddress(BLEAddress addr, esp_ble_addr_type_t type, uint32_t timeoutMs, PeerNotifyCallback cb, String side);
+void sendAuthNonce(PeerChar* pChar, HitSide side);
+void writeControl(PeerChar* pChar, HitSide side, const char* text, bool response);
 
 // =====================【串口锁定打印（完全保留，未改动）】=====================
 void lockedPrintf(const char* format, ...) {
-  if (serialMutex == NULL) return;
+  if (serialMutex == NULL || serialQuiet) return;
   if (xSemaphoreTake(serialMutex, portMAX_DELAY) == pdTRUE) {
     char buffer[128];
     va_list args;
@@ -48,24 +329,1216 @@ void lockedPrintf(const char* format, ...) {
 }
 
 void lockedPrintln(String msg) {
-  if (serialMutex == NULL) return;
+  if (serialMutex == NULL || serialQuiet) return;
   if (xSemaphoreTake(serialMutex, portMAX_DELAY) == pdTRUE) {
     Serial.println(msg);
     xSemaphoreGive(serialMutex);
   }
 }
 
-// =====================【蓝牙回调（仅调用FencingCore的setHit，无其他改动）】=====================
-static void redNotifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
-  lockedPrintln("[信号] red原始击中信号!");
-  led_hit_red();
-  FencingCore::getInstance()->setRedHit(); // 仅这一行，调用封装类
+// =====================【蓝牙回调（解析击中帧→去重→按击中时间交给FencingCore）】=====================
+// 真实通知和串口注入共用：返回处理结果，hitTime 为换算后的击中时间
+static InjectTouchResult processHitFrame(HitSide side, uint8_t* pData, size_t length, uint32_t arrival, uint32_t& hitTime) {
+  const char* name = (side == HIT_SIDE_RED) ? "red" : "green";
+  HitFrame frame;
+  HitFrameResult result;
+  hitTime = arrival;
+
+  // 已配对：先验标签（硬件AES，几十微秒，不影响40ms判定窗口）
+  if (hitAuth[side].hasKey()) {
+    int64_t t0 = esp_timer_get_time();
+    size_t bodyLen = 0;
+    bool ok = hitAuth[side].verify(pData, length, bodyLen);
+    uint32_t costUs = (uint32_t)(esp_timer_get_time() - t0);
+    authVerifyCount++;
+    authVerifyTotalUs += costUs;
+    if (costUs > authVerifyMaxUs) authVerifyMaxUs = costUs;
+    if (!ok) {
+      portENTER_CRITICAL(&hitLinkMux);
+      hitLink.countAuthFailed(side);
+      portEXIT_CRITICAL(&hitLinkMux);
+      lockedPrintf("[认证] %s击中帧标签校验失败，已丢弃\n", name);
+      return INJECT_RESULT_AUTH_FAILED;
+    }
+    length = bodyLen;
+  }
+
+  bool parsed = HitLink::parseFrame(pData, length, frame);
+  // 核心未就绪：击中不交给 HitLink，不推进确认，剑端留在发件箱里重发到就绪后（时钟样本照常收）
+  if (parsed && !frame.isClock && !coreReady) {
+    lockedPrintf("[信号] %s击中 seq=%u 在核心就绪前到达，不确认，等剑端重发\n", name, frame.seq);
+    return INJECT_RESULT_NOT_READY;
+  }
+
+  portENTER_CRITICAL(&hitLinkMux);
+  if (parsed) {
+    result = hitLink.accept(side, frame, arrival, hitTime);
+  } else {
+    hitLink.countMalformed(side);
+    result = HIT_FRAME_MALFORMED;
+  }
+  portEXIT_CRITICAL(&hitLinkMux);
+  if (bleTaskHandle != NULL) xTaskNotifyGive(bleTaskHandle);
+
+  switch (result) {
+    case HIT_FRAME_DUPLICATE:
+      lockedPrintf("[去重] %s重复帧 seq=%u 已丢弃\n", name, frame.seq);
+      return INJECT_RESULT_DUPLICATE;
+    case HIT_FRAME_STALE:
+      lockedPrintf("[补发] %s过期击中 seq=%u 击中于 %lu 毫秒前，仅记录不计分\n", name, frame.seq, frame.ageMs);
+      return INJECT_RESULT_STALE;
+    case HIT_FRAME_MALFORMED:
+      lockedPrintf("[信号] %s击中帧格式错误，已丢弃\n", name);
+      return INJECT_RESULT_MALFORMED;
+    case HIT_FRAME_CLOCK:
+      return INJECT_RESULT_CLOCK; // 时钟样本：HitLink 已更新时钟差估计
+    default:
+      break;
+  }
+
+  bool late = (result == HIT_FRAME_LATE);
+  bool judging = syncActive;
+  portENTER_CRITICAL(&syncMux);
+  SyncGapHit& gap = syncGap[side][syncHits[side] % SYNC_GAP_RING];
+  gap.seq = frame.seq;
+  gap.hitTimeMs = hitTime;
+  syncHits[side]++;
+  portEXIT_CRITICAL(&syncMux);
+  if (!judging) {
+    lockedPrintf("[热备] %s击中 seq=%u 已记录，由主用判定\n", name, frame.seq);
+    return late ? INJECT_RESULT_LATE : INJECT_RESULT_FRESH;
+  }
+  if (late) {
+    lockedPrintf("[补发] %s迟到击中 seq=%u 击中于 %lu 毫秒前，按击中时间判定\n", name, frame.seq, frame.ageMs);
+  } else {
+    lockedPrintf("[信号] %s原始击中信号!\n", name);
+  }
+  if (side == HIT_SIDE_RED) {
+    led_hit_red();
+    FencingCore::getInstance()->setRedHit(hitTime, late);
+  } else {
+    led_hit_green();
+    FencingCore::getInstance()->setGreenHit(hitTime, late);
+  }
+  return late ? INJECT_RESULT_LATE : INJECT_RESULT_FRESH;
+}
+
+// 剑路故障帧：已配对时同样先验标签；只计数告警，不碰判定
+static void handleBladeFault(HitSide side, uint8_t* pData, size_t length) {
+  const char* name = (side == HIT_SIDE_RED) ? "red" : "green";
+  size_t bodyLen = length;
+  if (hitAuth[side].hasKey() && !hitAuth[side].verify(pData, length, bodyLen)) {
+    lockedPrintf("[剑路] %s故障帧标签校验失败，已丢弃\n", name);
+    return;
+  }
+  BladeEvent ev;
+  uint32_t total;
+  if (!bladeFaultParse((const char*)pData, bodyLen, ev, total)) return;
+  bladeFaults[side][ev.kind]++;
+  portENTER_CRITICAL(&linkMonMux);
+  bladeLast[side] = ev;
+  portEXIT_CRITICAL(&linkMonMux);
+  lockedPrintf("[剑路] %s %s：接通%lums 电平%u‰ 抖动%u次 累计%lu，检查剑尖/身线\n", name,
+               BladeMonitor::className(ev.kind), (unsigned long)ev.durationMs, ev.level, ev.edges, (unsigned long)total);
+}
+
+static void handleHitFrame(HitSide side, uint8_t* pData, size_t length) {
+  uint32_t arrival = millis();
+  uint32_t hitTime;
+  if (gattFirstPending[side]) {
+    gattFirstPending[side] = false;
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - gattConnectUs[side]) / 1000);
+    portENTER_CRITICAL(&gattMux);
+    gattStats.addFirstNotify(gattPath[side], ms);
+    portEXIT_CRITICAL(&gattMux);
+  }
+  portENTER_CRITICAL(&linkMonMux);
+  linkMon[side].heard(arrival);
+  portEXIT_CRITICAL(&linkMonMux);
+  if (bladeFaultFrame(pData, length)) {
+    handleBladeFault(side, pData, length);
+    return;
+  }
+  injectActive[side] = false;  // 真实剑端的帧：HitLink 切回剑端会话，恢复回写确认
+  processHitFrame(side, pData, length, arrival, hitTime);
+}
+
+static void redNotifyCallback(uint8_t* pData, size_t length) {
+  handleHitFrame(HIT_SIDE_RED, pData, length);
+}
+
+static void greenNotifyCallback(uint8_t* pData, size_t length) {
+  handleHitFrame(HIT_SIDE_GREEN, pData, length);
+}
+
+// 回写累积确认（无响应写，不阻塞等待往返）
+void sendHitAcks() {
+  char buf[16];
+  bool has;
+  if (!syncActive) return; // 热备不回写，确认留到接管后一起发
+  if (redConnected && redHitChar != nullptr) {
+    portENTER_CRITICAL(&hitLinkMux);
+    has = hitLink.takeAck(HIT_SIDE_RED, buf, sizeof(buf));
+    portEXIT_CRITICAL(&hitLinkMux);
+    if (has && !injectActive[HIT_SIDE_RED]) writeControl(redHitChar, HIT_SIDE_RED, buf, false);
+  }
+  if (greenConnected && greenHitChar != nullptr) {
+    portENTER_CRITICAL(&hitLinkMux);
+    has = hitLink.takeAck(HIT_SIDE_GREEN, buf, sizeof(buf));
+    portEXIT_CRITICAL(&hitLinkMux);
+    if (has && !injectActive[HIT_SIDE_GREEN]) writeControl(greenHitChar, HIT_SIDE_GREEN, buf, false);
+  }
+}
+
+// 串口 'w'：打印计分板推送计数和判定任务抖动（打印后清零最大值）
+void printScoreboardStats() {
+#if SCOREBOARD_ENABLE
+  ScoreboardStats st;
+  ScoreboardServer::getInstance()->getStats(st);
+  lockedPrintf("[计分板] 客户端%lu 状态帧%lu 发送%lu 背压跳过%lu 失败%lu\n",
+               st.clients, st.frames, st.sends, st.skipped, st.failures);
+#endif
+  lockedPrintf("[核心1] 判定循环%lu次 最大延迟%lu微秒\n", logicLoops, logicMaxLateUs);
+  logicMaxLateUs = 0;
+}
+
+// 串口 's'：打印存储转发计数
+void printHitLinkStats() {
+  const char* names[2] = {"red", "green"};
+  for (int i = 0; i < 2; i++) {
+    const HitLinkStats& st = hitLink.stats((HitSide)i);
+    lockedPrintf("[链路] %s 收到%lu 重复%lu 迟到%lu 过期%lu 错误%lu 认证失败%lu 确认%lu %s\n", names[i],
+                 st.received, st.duplicates, st.late, st.stale, st.malformed, st.authFailed, st.acks,
+                 hitAuth[i].hasKey() ? "已配对" : "未配对");
+  }
+  uint32_t n = authVerifyCount;
+  lockedPrintf("[认证] 校验%lu次 平均%lu微秒 最大%lu微秒\n", n, n ? authVerifyTotalUs / n : 0, authVerifyMaxUs);
+}
+
+// =====================【串口注入口处理】=====================
+// 回传帧整帧一次写出，和 FencingCore 直接打印的文字日志不会交错在帧中间
+void writeInjectFrame(uint8_t type, const void* payload, uint8_t len) {
+  uint8_t buf[INJECT_FRAME_MAX];
+  size_t n = InjectParser::encode(type, payload, len, buf, sizeof(buf));
+  if (n == 0 || serialMutex == NULL) return;
+  if (xSemaphoreTake(serialMutex, portMAX_DELAY) == pdTRUE) {
+    Serial.write(buf, n);
+    xSemaphoreGive(serialMutex);
+  }
+}
+
+// =====================【录像同步标记处理】=====================
+static void videoPulseEnd(void* arg) {
+  digitalWrite(VIDEO_PULSE_PIN, LOW);
+}
+
+// 闪码下一格（esp_timer 任务里）
+static void videoFlashStep(void* arg) {
+  bool on = false;
+  bool done = false;
+  portENTER_CRITICAL(&videoMux);
+  videoFlashPos++;
+  if (videoFlashPos >= videoFlashLen) done = true;
+  else on = (videoFlashBits >> videoFlashPos) & 1;
+  portEXIT_CRITICAL(&videoMux);
+  digitalWrite(VIDEO_LED_PIN, on ? HIGH : LOW);
+  if (done) esp_timer_stop(videoFlashTimer);
+}
+
+void videoInit() {
+  if (VIDEO_PULSE_PIN >= 0) {
+    pinMode(VIDEO_PULSE_PIN, OUTPUT);
+    digitalWrite(VIDEO_PULSE_PIN, LOW);
+    esp_timer_create_args_t args = {};
+    args.callback = videoPulseEnd;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "vpulse";
+    if (esp_timer_create(&args, &videoPulseTimer) != ESP_OK) videoPulseTimer = NULL;
+  }
+  if (VIDEO_LED_PIN >= 0) {
+    pinMode(VIDEO_LED_PIN, OUTPUT);
+    digitalWrite(VIDEO_LED_PIN, LOW);
+    esp_timer_create_args_t args = {};
+    args.callback = videoFlashStep;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "vflash";
+    if (esp_timer_create(&args, &videoFlashTimer) != ESP_OK) videoFlashTimer = NULL;
+  }
+}
+
+// 出脉冲/闪码并记下上升沿时间（判定任务里调用）：先拉高再读时间，沿和记录差几微秒
+static void videoEmit(uint8_t kind, uint8_t flags, uint32_t hitMs, int redScore, int greenScore) {
+  VideoMark m;
+  m.seq = videoSeq++;
+  m.kind = kind;
+  m.flags = flags;
+  m.result = 0;
+  m.redScore = (uint8_t)redScore;
+  m.greenScore = (uint8_t)greenScore;
+  m.hitMs = hitMs;
+  bool out = videoOutputOn;
+  if (out && videoPulseTimer != NULL) digitalWrite(VIDEO_PULSE_PIN, HIGH);
+  if (out && videoFlashTimer != NULL) digitalWrite(VIDEO_LED_PIN, HIGH);
+  m.edgeUs = esp_timer_get_time();
+  m.ms = millis();
+  if (out && videoPulseTimer != NULL) {
+    esp_timer_stop(videoPulseTimer); // 上一个脉冲还没结束就从这里重新计宽度
+    esp_timer_start_once(videoPulseTimer, VIDEO_PULSE_MS * 1000);
+  }
+  if (out && videoFlashTimer != NULL) {
+    // 新标记打断还没闪完的上一个闪码，引导沿就是本次标记
+    uint32_t bits;
+    uint8_t len = videoFlashCode(kind, m.seq, bits);
+    esp_timer_stop(videoFlashTimer);
+    portENTER_CRITICAL(&videoMux);
+    videoFlashBits = bits;
+    videoFlashLen = len;
+    videoFlashPos = 0;
+    portEXIT_CRITICAL(&videoMux);
+    esp_timer_start_periodic(videoFlashTimer, VIDEO_FLASH_SLOT_MS * 1000);
+  }
+  videoMarks.push(m);
+}
+
+// FencingCore 回调（判定任务里）：计时开始/恢复
+static void onTimerStart(uint32_t nowMs) {
+  BoutState bout;
+  FencingCore::getInstance()->getBoutState(bout);
+  videoEmit(VIDEO_MARK_START, 0, nowMs, bout.redScore, bout.greenScore);
+}
+
+// FencingCore 回调（判定任务里）：击中交给判定引擎，只记时间线
+static void onTouch(const CoreTouch& t) {
+  VideoMark m;
+  m.seq = videoSeq++;
+  m.kind = VIDEO_MARK_TOUCH;
+  m.flags = (t.red ? VIDEO_FLAG_RED : VIDEO_FLAG_GREEN) | (t.late ? VIDEO_FLAG_LATE : 0);
+  m.result = t.result;
+  m.redScore = 0;
+  m.greenScore = 0;
+  m.edgeUs = esp_timer_get_time();
+  m.ms = millis();
+  m.hitMs = t.hitTimeMs;
+  videoMarks.push(m);
+}
+
+// loop 里导出时间线：时间线是数据不是日志，不走 lockedPrintf，注入 quiet=1 时照常输出
+void serviceVideoMarks() {
+  if (serialMutex == NULL) return;
+  VideoMark m;
+  char text[VIDEO_MARK_TEXT_MAX];
+  while (videoMarks.pop(m)) {
+    if (m.kind < VIDEO_MARK_KIND_COUNT) videoExported[m.kind]++;
+    if (videoMarkFormat(m, text, sizeof(text)) == 0) continue;
+    if (xSemaphoreTake(serialMutex, portMAX_DELAY) == pdTRUE) {
+      Serial.print("[录像] ");
+      Serial.print(text);
+      Serial.print('\n');
+      xSemaphoreGive(serialMutex);
+    }
+  }
+}
+
+// 串口 'v'
+void printVideoStats() {
+  lockedPrintf("[录像] 输出%s 脉冲GPIO%d(%dms) 闪码GPIO%d(每格%dms)\n", videoOutputOn ? "开" : "关", VIDEO_PULSE_PIN,
+               VIDEO_PULSE_MS, VIDEO_LED_PIN, VIDEO_FLASH_SLOT_MS);
+  lockedPrintf("[录像] 导出 开始%lu 判定%lu 补判%lu 击中%lu | 环满丢弃%lu\n", (unsigned long)videoExported[VIDEO_MARK_START],
+               (unsigned long)videoExported[VIDEO_MARK_VERDICT], (unsigned long)videoExported[VIDEO_MARK_AMEND],
+               (unsigned long)videoExported[VIDEO_MARK_TOUCH], (unsigned long)videoMarks.drops());
+}
+
+// 判定回调（核心1判定任务里调用）：只填结构体入队，串口由 loop 发送
+static void onVerdict(const CoreVerdict& v) {
+#if VIDEO_MARK_ENABLE
+  videoEmit(v.amended ? VIDEO_MARK_AMEND : VIDEO_MARK_VERDICT,
+            (v.redLamp ? VIDEO_FLAG_RED : 0) | (v.greenLamp ? VIDEO_FLAG_GREEN : 0), v.firstHitMs, v.redScore, v.greenScore);
+#endif
+  if (!injectEnabled || verdictQueue == NULL) return;
+  InjectVerdictMsg m;
+  int64_t nowUs = esp_timer_get_time();
+  int64_t firstRxUs = 0;
+  bool lit[2] = {v.redLamp, v.greenLamp};
+  uint16_t seq[2] = {INJECT_NO_SEQ, INJECT_NO_SEQ};
+  portENTER_CRITICAL(&injectMux);
+  for (int i = 0; i < 2; i++) {
+    const InjectedHit& h = injectLast[i];
+    // 该方亮灯且最近一次注入击中落在本剑窗口内，才算注入击中触发的判定
+    if (!lit[i] || h.rxUs == 0 || abs((int32_t)(h.hitTimeMs - v.firstHitMs)) > FencingCore::HIT_TIME_WINDOW) continue;
+    seq[i] = h.seq;
+    if (firstRxUs == 0 || h.rxUs < firstRxUs) firstRxUs = h.rxUs;
+  }
+  portEXIT_CRITICAL(&injectMux);
+  m.deviceMs = millis();
+  m.redSeq = seq[HIT_SIDE_RED];
+  m.greenSeq = seq[HIT_SIDE_GREEN];
+  m.latencyUs = firstRxUs ? (uint32_t)(nowUs - firstRxUs) : 0;
+  m.lamps = (v.redLamp ? 1 : 0) | (v.greenLamp ? 2 : 0);
+  m.amended = v.amended ? 1 : 0;
+  m.redScore = (uint8_t)v.redScore;
+  m.greenScore = (uint8_t)v.greenScore;
+  if (xQueueSend(verdictQueue, &m, 0) != pdTRUE) injectVerdictDrops++;
+}
+
+// 合成击中：按剑端格式拼一帧（已配对的一方用本连接随机数签名），走真实接收路径
+static void injectTouch(const InjectTouchMsg& t, int64_t rxUs) {
+  if (t.side > HIT_SIDE_GREEN) return;
+  HitSide side = (HitSide)t.side;
+  uint32_t arrival = millis();
+  char buf[96];
+  snprintf(buf, sizeof(buf), "time:%lu|%s:0|seq:%u|sid:%04x|age:%u|old:%u",
+           (unsigned long)(arrival - t.ageMs), side == HIT_SIDE_RED ? "RED" : "GREEN", t.seq, INJECT_SID, t.ageMs, t.seq);
+  if (hitAuth[side].hasKey()) hitAuth[side].sign(buf, sizeof(buf));
+  injectTouches++;
+  injectActive[side] = true;
+
+  uint32_t hitTime;
+  InjectTouchResult result = processHitFrame(side, (uint8_t*)buf, strlen(buf), arrival, hitTime);
+  if (result == INJECT_RESULT_FRESH || result == INJECT_RESULT_LATE) {
+    portENTER_CRITICAL(&injectMux);
+    injectLast[side].seq = t.seq;
+    injectLast[side].hitTimeMs = hitTime;
+    injectLast[side].rxUs = rxUs;
+    portEXIT_CRITICAL(&injectMux);
+  }
+
+  InjectTouchAckMsg ack;
+  ack.seq = t.seq;
+  ack.side = t.side;
+  ack.result = (uint8_t)result;
+  ack.handleUs = (uint32_t)(esp_timer_get_time() - rxUs);
+  writeInjectFrame(INJECT_TOUCH_ACK, &ack, sizeof(ack));
+}
+
+void sendInjectStats() {
+  InjectStatsMsg st;
+  BoutState bout;
+  FencingCore::getInstance()->getBoutState(bout);
+  memset(&st, 0, sizeof(st));
+  st.touches = injectTouches;
+  st.verdicts = injectVerdicts;
+  st.verdictDrops = injectVerdictDrops;
+  st.crcErrors = injectParser.crcErrors();
+  st.logicLoops = logicLoops;
+  st.logicMaxLateUs = logicMaxLateUs;
+#if SCOREBOARD_ENABLE
+  ScoreboardStats board;
+  ScoreboardServer::getInstance()->getStats(board);
+  st.boardSkipped = board.skipped;
+#endif
+  st.locked = bout.locked;
+  st.timerRunning = bout.timerRunning;
+  writeInjectFrame(INJECT_STATS_REPLY, &st, sizeof(st));
+}
+
+void handleInjectMsg(const InjectMsg& msg, int64_t rxUs) {
+  injectEnabled = true;
+  switch (msg.type) {
+    case INJECT_TOUCH: {
+      if (msg.len != sizeof(InjectTouchMsg)) break;
+      InjectTouchMsg t;
+      memcpy(&t, msg.payload, sizeof(t));
+      injectTouch(t, rxUs);
+      break;
+    }
+    case INJECT_BUTTON: {
+      if (msg.len != sizeof(InjectButtonMsg) || msg.payload[0] >= INJECT_BTN_COUNT) break;
+      FencingCore::getInstance()->injectButton((CoreButton)msg.payload[0]);
+      if (logicTaskHandle != NULL) xTaskNotifyGive(logicTaskHandle);
+      break;
+    }
+    case INJECT_LINK: {
+      if (msg.len != sizeof(InjectLinkMsg)) break;
+      InjectLinkMsg l;
+      memcpy(&l, msg.payload, sizeof(l));
+      if (l.event == INJECT_LINK_DROP && l.side <= HIT_SIDE_GREEN) linkDropRequest[l.side] = true;
+      if (l.event == INJECT_LINK_RESCAN) linkRescanRequest = true;
+      if (bleTaskHandle != NULL) xTaskNotifyGive(bleTaskHandle);
+      break;
+    }
+    case INJECT_CONFIG:
+      if (msg.len == sizeof(InjectConfigMsg)) serialQuiet = msg.payload[0] != 0;
+      break;
+    case INJECT_ECHO:
+      writeInjectFrame(INJECT_ECHO_REPLY, msg.payload, msg.len);
+      break;
+    case INJECT_STATS:
+      sendInjectStats();
+      break;
+    default:
+      break;
+  }
+}
+
+// 把判定任务入队的结果发回主机
+void sendInjectVerdicts() {
+  InjectVerdictMsg m;
+  while (verdictQueue != NULL && xQueueReceive(verdictQueue, &m, 0) == pdTRUE) {
+    writeInjectFrame(INJECT_VERDICT, &m, sizeof(m));
+    injectVerdicts++;
+  }
+}
+
+// 注入的链路事件在蓝牙任务里执行：断开走真实的掉线→清理→重连流程
+void serviceInjectedLinkEvents() {
+  BLEClient* clients[2] = {redClient, greenClient};
+  for (int i = 0; i < 2; i++) {
+    if (!linkDropRequest[i]) continue;
+    linkDropRequest[i] = false;
+    if (clients[i] != nullptr && clients[i]->isConnected()) {
+      lockedPrintf("[注入] 断开%s链路\n", i == HIT_SIDE_RED ? "red" : "green");
+      clients[i]->disconnect();
+    }
+  }
+  if (linkRescanRequest) {
+    linkRescanRequest = false;
+    redRetryCount = 0;
+    greenRetryCount = 0;
+    lockedPrintln("[注入] 重试次数清零，重新扫描");
+  }
+}
+
+// =====================【无线裁判遥控器处理】=====================
+void remoteSend(const uint8_t* mac, const char* msg) {
+  esp_now_send(mac, (const uint8_t*)msg, strlen(msg));
+}
+
+void remoteAddPeer(const uint8_t* mac) {
+  if (esp_now_is_peer_exist(mac)) return;
+  esp_now_peer_info_t p = {};
+  memcpy(p.peer_addr, mac, 6);
+  p.channel = REMOTE_CHANNEL;
+  p.ifidx = WIFI_IF_STA;
+  p.encrypt = false;
+  esp_now_add_peer(&p);
+}
+
+// 下发本次随机数；renew=false 时重发当前的（遥控器丢了随机数或主机刚重启）
+static void remoteSendNonce(const uint8_t* mac, bool renew) {
+  if (renew || !remoteAuth.hasNonce()) {
+    esp_fill_random(remoteNonce, sizeof(remoteNonce));
+    remoteAuth.setNonce(remoteNonce);
+  }
+  char msg[8 + HIT_AUTH_NONCE_LEN * 2];
+  strcpy(msg, "nonce:");
+  HitAuth::toHex(remoteNonce, sizeof(remoteNonce), msg + 6);
+  remoteSend(mac, msg);
+}
+
+// ESP-NOW 接收回调（Wi-Fi 任务）：命令路径只做校验/去重/置按键位/回确认，几十微秒
+static void onRemoteRecv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+  int64_t t0 = esp_timer_get_time();
+  const uint8_t* mac = info->src_addr;
+  char text[REMOTE_FRAME_LEN];
+  if (len <= 0 || len >= (int)sizeof(text)) return;
+  memcpy(text, data, len);
+  text[len] = '\0';
+
+  if (strcmp(text, "pair?") == 0) {
+    if (!pairWindowOpen()) return;
+    esp_fill_random(remotePairKey, sizeof(remotePairKey));
+    memcpy(remotePairMac, mac, 6);
+    remotePairPending = true;
+    remoteAddPeer(mac);
+    char msg[8 + HIT_AUTH_KEY_LEN * 2];
+    strcpy(msg, "pair:");
+    HitAuth::toHex(remotePairKey, sizeof(remotePairKey), msg + 5);
+    remoteSend(mac, msg);
+    return;
+  }
+  if (strcmp(text, "paired") == 0) {
+    if (remotePairPending && memcmp(mac, remotePairMac, 6) == 0) {
+      remotePairPending = false;
+      remotePairDone = true;
+    }
+    return;
+  }
+  if (!remoteKnown || memcmp(mac, remoteMac, 6) != 0) return; // 只认已配对的遥控器
+  if (strncmp(text, "hello", 5) == 0) {
+    remoteSendNonce(mac, true);
+    return;
+  }
+
+  size_t bodyLen = 0;
+  RemoteCommand c;
+  if (!remoteAuth.verify(data, len, bodyLen) || !RemoteLink::parseCommand(data, bodyLen, c)) {
+    remoteLink.countAuthFailed();
+    remoteSendNonce(mac, false); // 遥控器拿到随机数后按原序号重签重发
+    return;
+  }
+  RemoteAckResult r = remoteLink.accept(c);
+  if (r == REMOTE_ACK_APPLIED) {
+    FencingCore::getInstance()->injectButton((CoreButton)c.cmd);
+    if (logicTaskHandle != NULL) xTaskNotifyGive(logicTaskHandle);
+  }
+  char ack[24];
+  snprintf(ack, sizeof(ack), "ack:%u|r:%u", c.seq, (unsigned)r);
+  remoteSend(mac, ack);
+  uint32_t costUs = (uint32_t)(esp_timer_get_time() - t0);
+  if (costUs > remoteHandleMaxUs) remoteHandleMaxUs = costUs;
+}
+
+// =====================【热备同步链路】=====================
+// ESP-NOW 接收回调（Wi-Fi 任务）：只存下最新心跳，判定任务里再处理
+// 只收同一剑道、用共用密钥签名、来自已认定主机的帧，序号不新的（重放）也丢弃
+static void onSyncRecv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+  if (!syncReady) return;
+  SyncFrame f;
+  if (!syncFrameParse(data, len, f) || f.piste != syncPiste || !syncRxAuth.check(data, SYNC_SIGNED_LEN, f.tag) ||
+      (syncPeerBound && memcmp(info->src_addr, syncPeerMac, 6) != 0) ||
+      (syncLastValid && !syncFrameNewer(f.term, f.seq, syncLastTerm, syncLastSeq))) {
+    syncRxDropped++;
+    return;
+  }
+  if (!syncPeerBound) {
+    memcpy(syncPeerMac, info->src_addr, 6);
+    syncPeerBound = true;
+  }
+  syncLastValid = true;
+  syncLastTerm = f.term;
+  syncLastSeq = f.seq;
+  portENTER_CRITICAL(&syncMux);
+  syncRx = f;
+  syncRxMs = millis();
+  syncRxIdHigher = memcmp(info->src_addr, syncSelfMac, 6) > 0;
+  syncRxReady = true;
+  syncRxCount++;
+  portEXIT_CRITICAL(&syncMux);
+  if (logicTaskHandle != NULL) xTaskNotifyGive(logicTaskHandle);
+}
+
+// 遥控器、心跳共用一个接收回调，按帧头分发
+static void onEspNowRecv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+  if (len == SYNC_FRAME_LEN && data[0] == SYNC_MAGIC) {
+    onSyncRecv(info, data, len);
+    return;
+  }
+#if REMOTE_ENABLE
+  onRemoteRecv(info, data, len);
+#endif
+}
+
+bool espNowInit() {
+  if (espNowReady) return true;
+  // 计分板热点开着时用 AP+STA，热点和 ESP-NOW 都在 REMOTE_CHANNEL
+  WiFi.mode(SCOREBOARD_ENABLE ? WIFI_AP_STA : WIFI_STA);
+  esp_wifi_set_promiscuous(true);
+  esp_wifi_set_channel(REMOTE_CHANNEL, WIFI_SECOND_CHAN_NONE);
+  esp_wifi_set_promiscuous(false);
+  if (esp_now_init() != ESP_OK) {
+    lockedPrintln("[ESP-NOW] 初始化失败");
+    return false;
+  }
+  esp_now_register_recv_cb(onEspNowRecv);
+  espNowReady = true;
+  return true;
+}
+
+void remoteInit() {
+  if (!espNowInit()) return;
+  Preferences prefs;
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  if (prefs.begin(AUTH_NS, true)) {
+    if (prefs.getBytes(REMOTE_KEY, key, sizeof(key)) == sizeof(key) &&
+        prefs.getBytes(REMOTE_MAC_KEY, remoteMac, sizeof(remoteMac)) == sizeof(remoteMac)) {
+      remoteAuth.setKey(key);
+      remoteAddPeer(remoteMac);
+      remoteKnown = true;
+    }
+    prefs.end();
+  }
+  if (remoteKnown) {
+    lockedPrintf("[遥控] 已配对遥控器 %02x:%02x:%02x:%02x:%02x:%02x\n",
+                 remoteMac[0], remoteMac[1], remoteMac[2], remoteMac[3], remoteMac[4], remoteMac[5]);
+  } else {
+    lockedPrintln("[遥控] 未配对遥控器（串口 p 开配对窗口）");
+  }
+}
+
+// 遥控器确认收到密钥后保存（NVS 写入不放在 Wi-Fi 回调里）
+void serviceRemotePairing() {
+  if (!remotePairDone) return;
+  remotePairDone = false;
+  Preferences prefs;
+  if (prefs.begin(AUTH_NS, false)) {
+    prefs.putBytes(REMOTE_KEY, remotePairKey, sizeof(remotePairKey));
+    prefs.putBytes(REMOTE_MAC_KEY, remotePairMac, sizeof(remotePairMac));
+    prefs.end();
+  }
+  remoteKnown = false;          // 换密钥期间回调不处理命令
+  remoteAuth.clearNonce();
+  remoteAuth.setKey(remotePairKey);
+  memcpy(remoteMac, remotePairMac, sizeof(remoteMac));
+  remoteKnown = true;
+  lockedPrintln("[遥控] 配对完成");
+}
+
+// 串口 'e'：遥控器命令计数
+void printRemoteStats() {
+  const RemoteLinkStats& st = remoteLink.stats();
+  lockedPrintf("[遥控] %s 执行%lu 重复%lu 无效%lu 认证失败%lu 最大处理%lu微秒\n", remoteKnown ? "已配对" : "未配对",
+               st.applied, st.duplicates, st.rejected, st.authFailed, remoteHandleMaxUs);
+}
+
+// =====================【赛场汇总发送】=====================
+void hubInit() {
+  if (!espNowInit()) return;
+  remoteAddPeer(HUB_BROADCAST);
+  Preferences prefs;
+  if (prefs.begin(HUB_NS, true)) {
+    hubPiste = prefs.getUChar("piste", HUB_DEFAULT_PISTE);
+    prefs.end();
+  }
+  memset(&hubLast, 0, sizeof(hubLast));
+  hubReady = true;
+  lockedPrintf("[汇总] 剑道号 %u（串口 h<号><回车> 修改）\n", hubPiste);
+}
+
+void saveHubPiste(int piste) {
+  if (piste < 0 || piste >= HUB_MAX_PISTES) {
+    lockedPrintf("[汇总] 剑道号需在 0~%d\n", HUB_MAX_PISTES - 1);
+    return;
+  }
+  Preferences prefs;
+  if (prefs.begin(HUB_NS, false)) {
+    prefs.putUChar("piste", (uint8_t)piste);
+    prefs.end();
+  }
+  hubPiste = (uint8_t)piste;
+  lockedPrintf("[汇总] 剑道号已设为 %d\n", piste);
+}
+
+// 比赛状态 → 小程序/汇总共用的 AppState 取值
+AppState boutAppState(const BoutState& bout) {
+  AppState st;
+  st.redScore = (uint8_t)constrain(bout.redScore, 0, 255);
+  st.grnScore = (uint8_t)constrain(bout.greenScore, 0, 255);
+  st.lamps = 0;
+  if (bout.redLamp) st.lamps |= APP_LAMP_RED;
+  if (bout.greenLamp) st.lamps |= APP_LAMP_GRN;
+  if (redConnected) st.lamps |= APP_LAMP_RED_LINK;
+  if (greenConnected) st.lamps |= APP_LAMP_GRN_LINK;
+  st.timerSec = (uint16_t)constrain(bout.remainingSeconds, 0, 0xFFFE);
+  if (bout.redLamp && bout.greenLamp) st.phase = APP_PHASE_DOUBLE;
+  else if (bout.redLamp) st.phase = APP_PHASE_RED_HIT;
+  else if (bout.greenLamp) st.phase = APP_PHASE_GRN_HIT;
+  else if (!redConnected || !greenConnected) st.phase = APP_PHASE_SCANNING;
+  else st.phase = APP_PHASE_IDLE;
+  return st;
+}
+
+void sendHubFrame(uint8_t type, const AppState& st) {
+  HubFrame f;
+  f.type = type;
+  f.piste = hubPiste;
+  f.seq = ++hubSeq;
+  f.state = st;
+  f.uptimeMs = millis();
+  uint8_t buf[HUB_FRAME_LEN];
+  size_t n = hubFrameBuild(f, buf);
+  esp_now_send(HUB_BROADCAST, buf, n);
+  hubLastSend = millis();
+}
+
+// loop 里轮询比赛状态：刚判定亮灯（或锁定期间补判多亮一盏）发结果，其余变化/每秒发状态
+void serviceHub() {
+  if (!hubReady || !coreReady || !syncActive || millis() - hubLastPoll < HUB_POLL_MS) return;
+  hubLastPoll = millis();
+  BoutState bout;
+  FencingCore::getInstance()->getBoutState(bout);
+  AppState st = boutAppState(bout);
+  const uint8_t hitMask = APP_LAMP_RED | APP_LAMP_GRN;
+  uint8_t hits = st.lamps & hitMask;
+  bool result = bout.locked && hits != 0 && (!hubLastLocked || hits != (hubLast.lamps & hitMask));
+  bool changed = st.redScore != hubLast.redScore || st.grnScore != hubLast.grnScore ||
+                 st.lamps != hubLast.lamps || st.timerSec != hubLast.timerSec || st.phase != hubLast.phase;
+  if (result) {
+    sendHubFrame(HUB_FRAME_RESULT, st);
+  } else if (changed || millis() - hubLastSend >= HUB_KEEPALIVE_MS) {
+    sendHubFrame(HUB_FRAME_STATE, st);
+  }
+  hubLast = st;
+  hubLastLocked = bout.locked;
+}
+
+// =====================【热备主机处理】=====================
+void syncInit() {
+  if (!espNowInit()) {
+    syncActive = true; // 没有同步链路：单机判定
+    return;
+  }
+  // 心跳密钥：两台主机经 x/k 共用的剑端密钥，red 优先（两台的选择一致）
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  bool hasKey = false;
+  Preferences prefs;
+  if (prefs.begin(AUTH_NS, true)) {
+    hasKey = prefs.getBytes("red", key, sizeof(key)) == sizeof(key) || prefs.getBytes("green", key, sizeof(key)) == sizeof(key);
+    prefs.end();
+  }
+  if (!hasKey) {
+    syncActive = true;
+    lockedPrintln("[热备] 未配对剑端，没有心跳密钥，同步链路不启用（配对后 x/k 把密钥导入另一台，重启生效）");
+    return;
+  }
+  if (prefs.begin(HUB_NS, true)) {
+    syncPiste = prefs.getUChar("piste", HUB_DEFAULT_PISTE);
+    prefs.end();
+  }
+  uint8_t nonce[HIT_AUTH_NONCE_LEN];
+  syncAuthNonce(syncPiste, nonce);
+  syncTxAuth.setKey(key);
+  syncTxAuth.setNonce(nonce);
+  syncRxAuth.setKey(key);
+  syncRxAuth.setNonce(nonce);
+  memset(key, 0, sizeof(key));
+
+  remoteAddPeer(HUB_BROADCAST);
+  esp_read_mac(syncSelfMac, ESP_MAC_WIFI_STA);
+  bool primary = true;
+  if (prefs.begin(SYNC_NS, true)) {
+    primary = !prefs.getBool("standby", false);
+    prefs.end();
+  }
+  syncRole.begin(primary, millis());
+  syncReady = true;
+  lockedPrintf("[热备] 本机角色%s，剑道 %u，先监听同步链路 %d ms（串口 Y 切换角色）\n", primary ? "主用" : "热备",
+               syncPiste, primary ? SYNC_BOOT_LISTEN_MS : SYNC_STANDBY_WAIT_MS);
+}
+
+// 主用：定期广播心跳（loop 里调用）
+void serviceSync() {
+  if (!syncReady || !syncActive || !coreReady || millis() - syncLastSend < SYNC_HEARTBEAT_MS) return;
+  syncLastSend = millis();
+  MirrorState st;
+  FencingCore::getInstance()->getMirrorState(st);
+  SyncFrame f;
+  memset(&f, 0, sizeof(f));
+  f.flags = syncRole.primaryRole() ? SYNC_FLAG_PRIMARY : 0;
+  if (st.bout.timerRunning) f.bout |= SYNC_BOUT_RUNNING;
+  if (st.bout.resting) f.bout |= SYNC_BOUT_RESTING;
+  if (st.bout.locked) f.bout |= SYNC_BOUT_LOCKED;
+  if (st.bout.redLamp) f.bout |= SYNC_BOUT_RED_LAMP;
+  if (st.bout.greenLamp) f.bout |= SYNC_BOUT_GREEN_LAMP;
+  f.term = syncTerm;
+  f.seq = ++syncSeq;
+  f.redScore = (uint8_t)constrain(st.bout.redScore, 0, 255);
+  f.greenScore = (uint8_t)constrain(st.bout.greenScore, 0, 255);
+  f.remainingSeconds = (uint16_t)constrain(st.bout.remainingSeconds, 0, 0xFFFF);
+  f.savedMatchSeconds = (uint16_t)constrain(st.savedMatchSeconds, 0, 0xFFFF);
+  f.maxDurationSeconds = (uint16_t)constrain(st.maxDurationSeconds, 0, 0xFFFF);
+  portENTER_CRITICAL(&syncMux);
+  f.judged[0] = syncHits[0];
+  f.judged[1] = syncHits[1];
+  portEXIT_CRITICAL(&syncMux);
+  for (int i = 0; i < 2; i++) {
+    if (!authNonceSet[i]) continue;
+    f.flags |= (i == HIT_SIDE_RED) ? SYNC_FLAG_NONCE_RED : SYNC_FLAG_NONCE_GREEN;
+    memcpy(f.nonce[i], authNonce[i], SYNC_NONCE_LEN);
+  }
+  f.piste = syncPiste;
+  uint8_t buf[SYNC_FRAME_LEN];
+  size_t n = syncFrameBuild(f, buf);
+  if (!syncTxAuth.tag(buf, SYNC_SIGNED_LEN, buf + SYNC_SIGNED_LEN)) return;
+  esp_now_send(HUB_BROADCAST, buf, n);
+  syncTxCount++;
+}
+
+// 热备：按心跳套用主用的比分/计时，对齐已判定击中数，记下新的随机数
+static void syncMirror(FencingCore* core, const SyncFrame& f) {
+  MirrorState st;
+  st.bout.redScore = f.redScore;
+  st.bout.greenScore = f.greenScore;
+  st.bout.redLamp = (f.bout & SYNC_BOUT_RED_LAMP) != 0;
+  st.bout.greenLamp = (f.bout & SYNC_BOUT_GREEN_LAMP) != 0;
+  st.bout.locked = (f.bout & SYNC_BOUT_LOCKED) != 0;
+  st.bout.timerRunning = (f.bout & SYNC_BOUT_RUNNING) != 0;
+  st.bout.resting = (f.bout & SYNC_BOUT_RESTING) != 0;
+  st.bout.remainingSeconds = f.remainingSeconds;
+  st.savedMatchSeconds = f.savedMatchSeconds;
+  st.maxDurationSeconds = f.maxDurationSeconds;
+  core->applyMirrorState(st);
+
+  // 主用每多判定一条，本机最早的一条未判定击中就算已判定（两台收到的是同样的通知）
+  portENTER_CRITICAL(&syncMux);
+  for (int i = 0; i < 2; i++) {
+    if (!syncMirrored || f.judged[i] < syncPeerJudged[i]) {
+      syncReflected[i] = syncHits[i]; // 第一次对齐或主用重启
+    } else {
+      syncReflected[i] += f.judged[i] - syncPeerJudged[i];
+      if (syncReflected[i] > syncHits[i]) syncReflected[i] = syncHits[i];
+    }
+    syncPeerJudged[i] = f.judged[i];
+  }
+  portEXIT_CRITICAL(&syncMux);
+  syncMirrored = true;
+
+  const uint8_t nonceFlags[2] = {SYNC_FLAG_NONCE_RED, SYNC_FLAG_NONCE_GREEN};
+  for (int i = 0; i < 2; i++) {
+    if (!(f.flags & nonceFlags[i]) || memcmp(syncPeerNonce[i], f.nonce[i], SYNC_NONCE_LEN) == 0) continue;
+    memcpy(syncPeerNonce[i], f.nonce[i], SYNC_NONCE_LEN);
+    syncNonceDirty |= (1 << i);
+    if (bleTaskHandle != NULL) xTaskNotifyGive(bleTaskHandle);
+  }
+}
+
+// 接管：主用最后一帧心跳之后（及之前不久）收到、主用还没判定的击中补交判定，其余只报告
+static void syncTakeOver(FencingCore* core) {
+  bool heardBefore = syncRole.everHeard();
+  uint32_t lastHeard = syncRole.lastHeardMs();
+  uint32_t gapMs = syncRole.takeOver(millis());
+  syncTerm = syncRole.term();
+  syncActive = true;
+  syncHelloPending = true;
+  if (bleTaskHandle != NULL) xTaskNotifyGive(bleTaskHandle);
+  if (!heardBefore) {
+    lockedPrintf("[热备] 未听到其他主机，本机开始判定（任期 %lu）\n", (unsigned long)syncTerm);
+    return;
+  }
+  syncFailovers++;
+  syncLastFailoverMs = gapMs;
+  lockedPrintf("[热备] 主用心跳中断 %lu ms，本机接管判定和显示（任期 %lu）\n", (unsigned long)gapMs, (unsigned long)syncTerm);
+
+  const char* names[2] = {"red", "green"};
+  for (int i = 0; i < 2; i++) {
+    SyncGapHit hits[SYNC_GAP_RING];
+    uint32_t lost = 0;
+    int n = 0;
+    portENTER_CRITICAL(&syncMux);
+    uint32_t pending = syncHits[i] - syncReflected[i];
+    if (pending > SYNC_GAP_RING) {
+      lost = pending - SYNC_GAP_RING;
+      pending = SYNC_GAP_RING;
+    }
+    for (uint32_t k = syncHits[i] - pending; k != syncHits[i]; k++) hits[n++] = syncGap[i][k % SYNC_GAP_RING];
+    syncReflected[i] = syncHits[i];
+    portEXIT_CRITICAL(&syncMux);
+    syncLastGap[i] = n + lost;
+    if (lost > 0) lockedPrintf("[热备] %s另有 %lu 条未判定击中超出记录\n", names[i], (unsigned long)lost);
+
+    // 同一方只补交最早的一条（判定只看每方是否击中）
+    bool fed = false;
+    for (int k = 0; k < n; k++) {
+      int32_t sinceHeartbeat = (int32_t)(hits[k].hitTimeMs - lastHeard);
+      bool inGap = sinceHeartbeat >= -SYNC_GAP_LOOKBACK_MS;
+      lockedPrintf("[热备] 空档击中 %s seq=%u 距最后心跳 %+ld ms，%s\n", names[i], hits[k].seq, (long)sinceHeartbeat,
+                   !inGap ? "主用未判定且已过期，仅记录" : (fed ? "同一方已补交，仅记录" : "补交判定"));
+      if (!inGap || fed) continue;
+      fed = true;
+      if (i == HIT_SIDE_RED) core->setRedHit(hits[k].hitTimeMs, true);
+      else core->setGreenHit(hits[k].hitTimeMs, true);
+    }
+  }
+}
+
+// 判定任务里调用：处理最新心跳、检查是否该接管
+void serviceSyncLogic(FencingCore* core) {
+  if (!syncReady) return;
+  SyncFrame f;
+  uint32_t rxMs = 0;
+  bool idHigher = false;
+  portENTER_CRITICAL(&syncMux);
+  bool has = syncRxReady;
+  if (has) {
+    f = syncRx;
+    rxMs = syncRxMs;
+    idHigher = syncRxIdHigher;
+    syncRxReady = false;
+  }
+  portEXIT_CRITICAL(&syncMux);
+  if (has) {
+    if (syncRole.heard(f.term, (f.flags & SYNC_FLAG_PRIMARY) != 0, idHigher, rxMs)) {
+      syncActive = false;
+      syncMirrored = false;
+      lockedPrintf("[热备] 另一台主机任期 %lu 优先，本机退为热备\n", (unsigned long)f.term);
+    }
+    if (!syncActive) syncMirror(core, f);
+  }
+  if (syncRole.due(millis())) syncTakeOver(core);
+}
+
+// 蓝牙任务里调用：热备套用主用的随机数；接管后给在线剑端写随机数+hello
+void serviceSyncBle() {
+  uint8_t dirty = syncNonceDirty;
+  if (dirty != 0 && !syncActive) {
+    syncNonceDirty = 0;
+    for (int i = 0; i < 2; i++) {
+      if (!(dirty & (1 << i))) continue;
+      hitAuth[i].setNonce(syncPeerNonce[i]);
+      ctrlAuth[i].setNonce(syncPeerNonce[i]);
+      memcpy(authNonce[i], syncPeerNonce[i], HIT_AUTH_NONCE_LEN);
+      authNonceSet[i] = true;
+    }
+  }
+  if (!syncHelloPending) return;
+  syncHelloPending = false;
+  if (redConnected && redHitChar != nullptr) {
+    sendAuthNonce(redHitChar, HIT_SIDE_RED);
+    writeControl(redHitChar, HIT_SIDE_RED, "hello", true);
+  }
+  if (greenConnected && greenHitChar != nullptr) {
+    sendAuthNonce(greenHitChar, HIT_SIDE_GREEN);
+    writeControl(greenHitChar, HIT_SIDE_GREEN, "hello", true);
+  }
+  if (redConnected || greenConnected) lockedPrintln("[热备] 已通知在线剑端向本机确认并补发未确认击中");
 }
 
-static void greenNotifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
-  lockedPrintln("[信号] green原始击中信号!");
-  led_hit_green();
-  FencingCore::getInstance()->setGreenHit(); // 仅这一行，调用封装类
+// 串口 'Y'：切换主用/热备角色（重启生效）
+void toggleSyncRole() {
+  Preferences prefs;
+  if (!prefs.begin(SYNC_NS, false)) return;
+  bool standby = !prefs.getBool("standby", false);
+  prefs.putBool("standby", standby);
+  prefs.end();
+  lockedPrintf("[热备] 角色改为%s，重启后生效\n", standby ? "热备" : "主用");
+}
+
+// 串口 'y'：同步链路状态
+void printSyncStats() {
+  if (!syncReady) {
+    lockedPrintln("[热备] 同步链路未启用");
+    return;
+  }
+  lockedPrintf("[热备] 角色%s 当前%s 任期%lu 剑道%u 对端%s\n", syncRole.primaryRole() ? "主用" : "热备",
+               syncActive ? "判定中" : "镜像中", (unsigned long)syncTerm, syncPiste, syncPeerBound ? "已认定" : "未听到");
+  lockedPrintf("[热备] 心跳 发%lu 收%lu 丢弃%lu | 接管%lu次 最近一次中断%lu ms 空档击中 red%lu green%lu\n",
+               (unsigned long)syncTxCount, (unsigned long)syncRxCount, (unsigned long)syncRxDropped,
+               (unsigned long)syncFailovers, (unsigned long)syncLastFailoverMs, (unsigned long)syncLastGap[0],
+               (unsigned long)syncLastGap[1]);
+}
+
+// 串口 'x'：导出两方剑端密钥（在另一台主机串口粘贴这一行，两台主机才能校验同一剑端）
+void exportAuthKeys() {
+  const char* keys[2] = {"red", "green"};
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  char hex[HIT_AUTH_KEY_LEN * 4 + 1];
+  Preferences prefs;
+  bool open = prefs.begin(AUTH_NS, true);
+  for (int i = 0; i < 2; i++) {
+    if (!open || prefs.getBytes(keys[i], key, sizeof(key)) != sizeof(key)) memset(key, 0, sizeof(key)); // 全 0=未配对
+    HitAuth::toHex(key, sizeof(key), hex + i * HIT_AUTH_KEY_LEN * 2);
+  }
+  if (open) prefs.end();
+  lockedPrintf("[热备] 在另一台主机串口粘贴：k%s\n", hex);
+}
+
+// 串口 k<64位十六进制><回车>：导入两方密钥（全 0 的一方清除配对）
+void importAuthKeys(const char* hex) {
+  const char* keys[2] = {"red", "green"};
+  uint8_t key[2][HIT_AUTH_KEY_LEN];
+  if (!HitAuth::parseHex(hex, strlen(hex), key[0], sizeof(key))) {
+    lockedPrintf("[热备] 密钥需为 %d 位十六进制\n", HIT_AUTH_KEY_LEN * 4);
+    return;
+  }
+  const uint8_t zero[HIT_AUTH_KEY_LEN] = {0};
+  Preferences prefs;
+  if (!prefs.begin(AUTH_NS, false)) return;
+  for (int i = 0; i < 2; i++) {
+    if (memcmp(key[i], zero, sizeof(zero)) == 0) {
+      prefs.remove(keys[i]);
+      hitAuth[i].clearKey();
+      ctrlAuth[i].clearKey();
+    } else {
+      prefs.putBytes(keys[i], key[i], HIT_AUTH_KEY_LEN);
+      hitAuth[i].setKey(key[i]);
+      ctrlAuth[i].setKey(key[i]);
+    }
+  }
+  prefs.end();
+  lockedPrintf("[认证] 已导入密钥 red%s green%s（热备心跳密钥重启后生效）\n", hitAuth[0].hasKey() ? "已配对" : "未配对",
+               hitAuth[1].hasKey() ? "已配对" : "未配对");
+}
+
+// =====================【剑端蓝牙升级处理】=====================
+static void otaOnNotify(HitSide side, const uint8_t* data, size_t length) {
+  if (length != OTA_STATUS_LEN) return;
+  OtaPeer& o = otaPeer[side];
+  portENTER_CRITICAL(&otaMux);
+  uint8_t slot = (o.statusHead + o.statusCount) % OTA_STATUS_RING;
+  memcpy(o.status[slot], data, OTA_STATUS_LEN);
+  if (o.statusCount < OTA_STATUS_RING) o.statusCount++;
+  else o.statusHead = (o.statusHead + 1) % OTA_STATUS_RING; // 满了丢最旧的，进度是累计的
+  portEXIT_CRITICAL(&otaMux);
+  if (bleTaskHandle != NULL) xTaskNotifyGive(bleTaskHandle);
+}
+
+static void otaRedNotifyCallback(uint8_t* pData, size_t length) {
+  otaOnNotify(HIT_SIDE_RED, pData, length);
+}
+
+static void otaGreenNotifyCallback(uint8_t* pData, size_t length) {
+  otaOnNotify(HIT_SIDE_GREEN, pData, length);
+}
+
+bool otaBusy() {
+  return otaPeer[HIT_SIDE_RED].running || otaPeer[HIT_SIDE_GREEN].running;
+}
+
+void startOta() {
+#if OTA_ENABLE
+  for (int i = 0; i < 2; i++) {
+    const char* name = i == HIT_SIDE_RED ? "red" : "green";
+    const char* path = i == HIT_SIDE_RED ? OTA_RED_PATH : OTA_GREEN_PATH;
+    OtaPeer& o = otaPeer[i];
+    if (o.wanted) continue;
+    if (!LittleFS.exists(path)) {
+      lockedPrintf("[升级] %s：没有镜像 %s\n", name, path);
+      continue;
+    }
+    o.wanted = true;
+    o.running = false;
+    o.mtuAskedMs = 0;
+    lockedPrintf("[升级] %s：镜像 %s，剑端在线时开始（掉线重连后续传）\n", name, path);
+  }
+#else
+  lockedPrintln("[升级] 未启用（OTA_ENABLE=0）");
+#endif
+}
+
+void abortOta() {
+  for (int i = 0; i < 2; i++) {
+    OtaPeer& o = otaPeer[i];
+    if (!o.wanted) continue;
+    PeerChar* chr = o.chr;
+    if (o.running && chr != nullptr) {
+      uint8_t msg = OTA_MSG_ABORT;
+      chr->writeValue(&msg, 1, false);
+    }
+    o.sender.abort();
+    o.wanted = false;
+    o.running = false;
+    if (o.reader.file) o.reader.file.close();
+    lockedPrintf("[升级] %s：已放弃\n", i == HIT_SIDE_RED ? "red" : "green");
+  }
+}
+
+// 连上后先请求大 MTU 和 7.5ms 连接间隔，MTU 到位再打开镜像发 BEGIN
+static bool otaBegin(HitSide side, uint32_t now) {
+  const char* name = side == HIT_SIDE_RED ? "red" : "green";
+  OtaPeer& o = otaPeer[side];
+  BLEClient* client = side == HIT_SIDE_RED ? redClient : greenClient;
+  if (client == nullptr) return false;
+  if (o.chr == nullptr) {
+    lockedPrintf("[升级] %s：剑端固件不支持蓝牙升级（需先用 USB 刷一次）\n", name);
+    o.wanted = false;
+    return false;
+  }
+  if (!ctrlAuth[side].hasKey()) {
+    lockedPrintf("[升级] %s：剑端未配对，不接受蓝牙升级（串口 p 配对）\n", name);
+    o.wanted = false;
+    return false;
+  }
+  if (o.mtuAskedMs == 0) {
+    o.mtuAskedMs = now | 1;
+    client->setMTU(OTA_MTU);
+    esp_ble_conn_update_params_t params = {};
+    memcpy(params.bda, peerBda[side], sizeof(esp_bd_addr_t));
+    params.min_int = 0x06;
+    params.max_int = 0x06;
+    params.latency = 0;
+    params.timeout = 400;
+    esp_ble_gap_update_conn_params(&params);
+    return false;
+  }
+  uint16_t need = 1 + 4 + OTA_CHUNK_HEADER_LEN + OTA_CHUNK_MAX + 3;
+  if (client->getMTU() < need) {
+    if (now - o.mtuAskedMs < OTA_MTU_WAIT_MS) return false;
+    lockedPrintf("[升级] %s：MTU 只有 %u（需要 %u），放弃\n", name, client->getMTU(), need);
+    o.wanted = false;
+    return false;
+  }
+  if (o.reader.file) o.reader.file.close();
+  o.reader.file = LittleFS.open(side == HIT_SIDE_RED ? OTA_RED_PATH : OTA_GREEN_PATH, "r");
+  if (!o.sender.begin(&o.reader, now)) {
+    lockedPrintf("[升级] %s：镜像无效\n", name);
+    o.wanted = false;
+    return false;
+  }
+  portENTER_CRITICAL(&otaMux);
+  o.statusCount = 0;
+  portEXIT_CRITICAL(&otaMux);
+  o.running = true;
+  o.startMs = now;
+  o.lastTenth = 0;
+  const OtaHeader& h = o.sender.header();
+  lockedPrintf("[升级] %s：%s镜像 %lu 字节 → 固件 %lu 字节，MTU %u\n", name,
+               h.codec == OTA_CODEC_XOR_RLE ? "差分" : "整包", (unsigned long)h.streamSize,
+               (unsigned long)h.outSize, client->getMTU());
+  return true;
+}
+
+// 蓝牙任务：喂剑端状态、按窗口发块、打印进度；完成/失败后停止
+void serviceOta() {
+#if OTA_ENABLE
+  if (!syncActive) return; // 热备不写剑端
+  uint32_t now = millis();
+  for (int i = 0; i < 2; i++) {
+    HitSide side = (HitSide)i;
+    const char* name = side == HIT_SIDE_RED ? "red" : "green";
+    OtaPeer& o = otaPeer[i];
+    if (!o.wanted) continue;
+    bool connected = side == HIT_SIDE_RED ? redConnected : greenConnected;
+    PeerChar* chr = o.chr;
+    if (!connected || chr == nullptr) {
+      if (o.running) lockedPrintf("[升级] %s：掉线，重连后续传\n", name);
+      o.running = false;
+      o.mtuAskedMs = 0;
+      if (!connected) continue;
+    }
+    if (!o.running && !otaBegin(side, now)) continue;
+
+    uint8_t prev = o.sender.state();
+    uint8_t st[OTA_STATUS_LEN];
+    for (;;) {
+      bool have = false;
+      portENTER_CRITICAL(&otaMux);
+      if (o.statusCount > 0) {
+        memcpy(st, o.status[o.statusHead], OTA_STATUS_LEN);
+        o.statusHead = (o.statusHead + 1) % OTA_STATUS_RING;
+        o.statusCount--;
+        have = true;
+      }
+      portEXIT_CRITICAL(&otaMux);
+      if (!have) break;
+      o.sender.onStatus(st, OTA_STATUS_LEN, now);
+    }
+    if (prev == OTA_SEND_STARTING && o.sender.state() == OTA_SEND_SENDING && o.sender.resumedFrom() > 0) {
+      lockedPrintf("[升级] %s：从 %lu 字节续传\n", name, (unsigned long)o.sender.resumedFrom());
+    }
+
+    for (int k = 0; k < OTA_BURST; k++) {
+      size_t n = o.sender.next(now, otaTxBuf, sizeof(otaTxBuf));
+      if (n == 0) break;
+      if (otaTxBuf[0] == OTA_MSG_BEGIN) {
+        // BEGIN 附标签（本次连接随机数签）：剑端只认持有配对密钥、写过 hello 的主机
+        if (n + OTA_TAG_LEN > sizeof(otaTxBuf) || !ctrlAuth[side].tag(otaTxBuf, n, otaTxBuf + n)) break;
+        n += OTA_TAG_LEN;
+      }
+      chr->writeValue(otaTxBuf, n, false);
+    }
+
+    const OtaHeader& h = o.sender.header();
+    uint8_t tenth = h.streamSize > 0 ? (uint8_t)((uint64_t)o.sender.acked() * 10 / h.streamSize) : 0;
+    if (tenth > o.lastTenth) {
+      o.lastTenth = tenth;
+      uint32_t elapsed = now - o.startMs;
+      uint32_t sent = o.sender.acked() - o.sender.resumedFrom();
+      lockedPrintf("[升级] %s：%u%%  %.1f KB/s  回退 %lu\n", name, tenth * 10,
+                   elapsed > 0 ? sent / 1.024f / elapsed : 0.0f, (unsigned long)o.sender.stats().rewinds);
+    }
+
+    if (o.sender.state() == OTA_SEND_DONE) {
+      lockedPrintf("[升级] %s：完成，用时 %.1f 秒，剑端校验通过正在重启\n", name, (now - o.startMs) / 1000.0f);
+    } else if (o.sender.state() == OTA_SEND_FAILED) {
+      lockedPrintf("[升级] %s：失败（%s）\n", name,
+                   o.sender.error() != OTA_ERR_NONE ? otaErrorName(o.sender.error()) : "剑端无应答");
+    } else {
+      continue;
+    }
+    o.wanted = false;
+    o.running = false;
+    o.reader.file.close();
+  }
+#endif
 }
 
 // =====================【蓝牙扫描回调（完全保留，未改动）】=====================
@@ -76,17 +1549,203 @@ class MyAdvertisedDeviceCallbacks : public BLEAdvertisedDeviceCallbacks {
       lockedPrintln("[扫描] 发现red重剑设备!");
       redDevice = new BLEAdvertisedDevice(advertisedDevice);
       doConnectRed = true;
+      BLEDevice::getScan()->stop(); // 找到就停，立即去连，不等本轮扫描结束
     } else if (name == "epee_green" && !greenConnected && !doConnectGreen) {
       lockedPrintln("[扫描] 发现green重剑设备!");
       greenDevice = new BLEAdvertisedDevice(advertisedDevice);
       doConnectGreen = true;
+      BLEDevice::getScan()->stop();
     }
   }
 };
 
+// 断开事件：立即触发一次连接检查，不再等 2 秒轮询
+class MasterClientCallbacks : public BLEClientCallbacks {
+  void onConnect(BLEClient* pClient) {}
+  void onDisconnect(BLEClient* pClient) {
+    lastConnectionCheck = 0;
+    if (bleTaskHandle != NULL) xTaskNotifyGive(bleTaskHandle);
+  }
+};
+static MasterClientCallbacks masterClientCallbacks;
+
+// 连接参数更新事件（GAP）：记下每方实际的连接间隔/从机延迟/监督超时
+static void linkGapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT || param->update_conn_params.status != ESP_BT_STATUS_SUCCESS) return;
+  for (int i = 0; i < 2; i++) {
+    if (memcmp(param->update_conn_params.bda, peerBda[i], sizeof(esp_bd_addr_t)) != 0) continue;
+    portENTER_CRITICAL(&linkMonMux);
+    linkMon[i].setConnParams(param->update_conn_params.conn_int, param->update_conn_params.latency,
+                             param->update_conn_params.timeout);
+    portEXIT_CRITICAL(&linkMonMux);
+  }
+}
+
+// 收到一次遥测：更新趋势，等级变化/温度过高/连上后首次发现异常复位时告警
+static void onTelemetry(HitSide side, const String& value, uint32_t now) {
+  const char* name = side == HIT_SIDE_RED ? "red" : "green";
+  PointerTelemetry t;
+  if (!healthParse(value.c_str(), value.length(), t)) return;
+  portENTER_CRITICAL(&linkMonMux);
+  bool first = !pointerHealth[side].hasData();
+  bool changed = pointerHealth[side].add(t, now);
+  PointerHealth snapshot = pointerHealth[side];
+  portEXIT_CRITICAL(&linkMonMux);
+
+  HealthMetrics m;
+  snapshot.metrics(m);
+  if (first && snapshot.abnormalReset()) {
+    lockedPrintf("[电量] %s 上次复位原因：%s（已运行 %lu 秒）\n", name, PointerHealth::resetName(m.resetReason),
+                 (unsigned long)m.uptimeS);
+  }
+  if (changed || (first && m.level != HEALTH_LEVEL_OK)) {
+    lockedPrintf("[电量] %s 电池%s %.2fV（%+d mV/h）%s\n", name, PointerHealth::levelName(m.level),
+                 m.batteryMv / 1000.0f, m.trendMvPerHour, m.level == HEALTH_LEVEL_CRITICAL ? "，请立即更换" : "");
+  }
+  bool hot = m.tempC >= HEALTH_TEMP_HIGH_C;
+  if (hot != healthHot[side]) {
+    healthHot[side] = hot;
+    lockedPrintf("[电量] %s 芯片温度 %d°C%s\n", name, m.tempC, hot ? " 过高" : " 已恢复");
+  }
+}
+
+// 探测一方链路：RSSI + 读往返（剑端每个连接事件都能应答，往返时间反映丢包重传）
+// 到点时这次往返改读遥测特征值：不多发一个包就把电量带回来
+static void probeLink(HitSide side, BLEClient* client, PeerChar* pChar) {
+  if (client == nullptr || pChar == nullptr) return;
+  int rssi = client->getRssi();
+  PeerChar* telem = telemetryChar[side];
+  bool health = telem != nullptr && (long)(millis() - healthNextRead[side]) >= 0;
+  uint32_t t0 = millis();
+  String value = (health ? telem : pChar)->readValue();
+  bool ok = value.length() > 0;
+  uint32_t now = millis();
+  portENTER_CRITICAL(&linkMonMux);
+  if (rssi != 0) linkMon[side].addRssi(rssi);
+  linkMon[side].addPing(ok, now - t0, now);
+  portEXIT_CRITICAL(&linkMonMux);
+  if (health) {
+    healthNextRead[side] = now + HEALTH_READ_MS;
+    if (ok) onTelemetry(side, value, now);
+  }
+}
+
+// 串口 't'：两方电量、趋势、温度、复位原因
+void printPointerHealth() {
+  const char* names[2] = {"red", "green"};
+  bool connected[2] = {redConnected, greenConnected};
+  for (int i = 0; i < 2; i++) {
+    if (!connected[i]) {
+      lockedPrintf("[电量] %s 未连接\n", names[i]);
+      continue;
+    }
+    uint32_t faults = bladeFaults[i][BLADE_BOUNCE] + bladeFaults[i][BLADE_RESISTIVE] + bladeFaults[i][BLADE_SHORT];
+    if (faults > 0) {
+      portENTER_CRITICAL(&linkMonMux);
+      BladeEvent last = bladeLast[i];
+      portEXIT_CRITICAL(&linkMonMux);
+      lockedPrintf("[剑路] %s 接触不良%lu 电阻偏高%lu 短路%lu | 最近：%s 电平%u‰\n", names[i],
+                   (unsigned long)bladeFaults[i][BLADE_BOUNCE], (unsigned long)bladeFaults[i][BLADE_RESISTIVE],
+                   (unsigned long)bladeFaults[i][BLADE_SHORT], BladeMonitor::className(last.kind), last.level);
+    }
+    if (telemetryChar[i] == nullptr) {
+      lockedPrintf("[电量] %s 剑端固件不带遥测\n", names[i]);
+      continue;
+    }
+    portENTER_CRITICAL(&linkMonMux);
+    PointerHealth snapshot = pointerHealth[i];
+    portEXIT_CRITICAL(&linkMonMux);
+    if (!snapshot.hasData()) {
+      lockedPrintf("[电量] %s 等待第一次读取\n", names[i]);
+      continue;
+    }
+    HealthMetrics m;
+    snapshot.metrics(m);
+    char eta[24] = "-";
+    if (m.minutesToLow != 0xFFFF) snprintf(eta, sizeof(eta), "%u 分钟", m.minutesToLow);
+    if (m.batteryMv == 0) {
+      lockedPrintf("[电量] %s 未装电池检测 | 温度 %d°C | 复位 %s | 运行 %lu 秒\n", names[i], m.tempC,
+                   PointerHealth::resetName(m.resetReason), (unsigned long)m.uptimeS);
+    } else {
+      lockedPrintf("[电量] %s %s %.2fV (最低 %.2fV, %+d mV/h, 距偏低约 %s, %u 样本) | 温度 %d°C | 复位 %s | 运行 %lu 秒\n",
+                   names[i], PointerHealth::levelName(m.level), m.batteryMv / 1000.0f, m.batteryMinMv / 1000.0f,
+                   m.trendMvPerHour, eta, m.samples, m.tempC, PointerHealth::resetName(m.resetReason),
+                   (unsigned long)m.uptimeS);
+    }
+  }
+}
+
+// 周期探测并评估，等级变化时打印原因并推给计分板
+void monitorLinks() {
+  unsigned long now = millis();
+  if (now - lastLinkProbe < LINK_PING_MS) return;
+  lastLinkProbe = now;
+
+  const char* names[2] = {"red", "green"};
+  bool connected[2] = {redConnected, greenConnected};
+  if (connected[HIT_SIDE_RED]) probeLink(HIT_SIDE_RED, redClient, redHitChar);
+  if (connected[HIT_SIDE_GREEN]) probeLink(HIT_SIDE_GREEN, greenClient, greenHitChar);
+
+  int8_t levels[2];
+  for (int i = 0; i < 2; i++) {
+    if (!connected[i]) {
+      linkLevel[i] = LINK_LEVEL_OK;
+      levels[i] = -1;
+      continue;
+    }
+    LinkMetrics m;
+    portENTER_CRITICAL(&linkMonMux);
+    LinkLevel level = linkMon[i].evaluate(millis(), m);
+    portEXIT_CRITICAL(&linkMonMux);
+    if (level != linkLevel[i]) {
+      char why[64];
+      LinkMonitor::reasonText(m.reasons, why, sizeof(why));
+      lockedPrintf("[链路质量] %s %s→%s %s (RSSI %d 往返%ums 静默%u%%)\n", names[i],
+                   LinkMonitor::levelName(linkLevel[i]), LinkMonitor::levelName(level), why,
+                   m.rssiAvg, m.rttMaxMs, m.silencePct);
+      linkLevel[i] = level;
+    }
+    levels[i] = (int8_t)level;
+  }
+#if SCOREBOARD_ENABLE
+  ScoreboardServer::getInstance()->setLinkLevels(levels[HIT_SIDE_RED], levels[HIT_SIDE_GREEN]);
+#endif
+}
+
+// 串口 'q'：打印两方链路指标
+void printLinkQuality() {
+  const char* names[2] = {"red", "green"};
+  bool connected[2] = {redConnected, greenConnected};
+  for (int i = 0; i < 2; i++) {
+    if (!connected[i]) {
+      lockedPrintf("[链路质量] %s 未连接\n", names[i]);
+      continue;
+    }
+    LinkMetrics m;
+    portENTER_CRITICAL(&linkMonMux);
+    linkMon[i].evaluate(millis(), m);
+    uint32_t intervalUs = linkMon[i].intervalUs();
+    uint32_t timeoutMs = linkMon[i].timeoutMs();
+    portEXIT_CRITICAL(&linkMonMux);
+    char why[64];
+    LinkMonitor::reasonText(m.reasons, why, sizeof(why));
+    lockedPrintf("[链路质量] %s %s RSSI 均%d 最低%d 趋势%+d | 往返 均%u 最大%ums 错过事件%u | 静默%u%% 探测失败%lu | 间隔%luus 超时%lums %s\n",
+                 names[i], LinkMonitor::levelName(m.level), m.rssiAvg, m.rssiMin, m.rssiTrend,
+                 m.rttAvgMs, m.rttMaxMs, m.missedMax, m.silencePct, m.pingFails, intervalUs, timeoutMs, why);
+  }
+}
+
 // =====================【蓝牙相关函数（完全保留，未改动）】=====================
 void updateBLEStatusLed() {
-  if (redConnected && greenConnected) {
+  // 任一在线方链路变差时优先显示告警闪烁，裁判在断线前就能看到
+  uint8_t worst = LINK_LEVEL_OK;
+  if (redConnected && linkLevel[HIT_SIDE_RED] > worst) worst = linkLevel[HIT_SIDE_RED];
+  if (greenConnected && linkLevel[HIT_SIDE_GREEN] > worst) worst = linkLevel[HIT_SIDE_GREEN];
+  if (worst == LINK_LEVEL_CRITICAL) {
+    led_link_critical();
+  } else if (worst == LINK_LEVEL_MARGINAL) {
+    led_link_marginal();
+  } else if (redConnected && greenConnected) {
     led_connected_both();
   } else if(redConnected){
     led_connected_red();
@@ -105,6 +1764,10 @@ void checkBLEConnectionStatus() {
     if (!redClient->isConnected()) {
       lockedPrintln("[蓝牙] red设备已掉线!");
       redConnected = false;
+      redHitChar = nullptr;
+      otaPeer[HIT_SIDE_RED].chr = nullptr;
+      telemetryChar[HIT_SIDE_RED] = nullptr;
+      pairTried[HIT_SIDE_RED] = false;
       redClient->disconnect();
       delete redClient;
       redClient = nullptr;
@@ -115,6 +1778,10 @@ void checkBLEConnectionStatus() {
     if (!greenClient->isConnected()) {
       lockedPrintln("[蓝牙] green设备已掉线!");
       greenConnected = false;
+      greenHitChar = nullptr;
+      otaPeer[HIT_SIDE_GREEN].chr = nullptr;
+      telemetryChar[HIT_SIDE_GREEN] = nullptr;
+      pairTried[HIT_SIDE_GREEN] = false;
       greenClient->disconnect();
       delete greenClient;
       greenClient = nullptr;
@@ -122,68 +1789,408 @@ void checkBLEConnectionStatus() {
   }
 }
 
-bool connectToDevice(BLEAdvertisedDevice* target, void (*cb)(BLERemoteCharacteristic*, uint8_t*, size_t, bool), String side) {
+bool connectToDevice(BLEAdvertisedDevice* target, PeerNotifyCallback cb, String side) {
   if (target == nullptr) return false;
-  lockedPrintf("[蓝牙] 开始连接%s设备...\n", side.c_str());
+  return connectToAddress(target->getAddress(), target->getAddressType(), portMAX_DELAY, cb, side);
+}
 
-  BLEClient* pClient = BLEDevice::createClient();
-  if (!pClient->connect(target)) {
-    lockedPrintf("[蓝牙] %s设备连接失败\n", side.c_str());
-    delete pClient;
+// 记住连上的剑端地址，下次启动直连
+void saveKnownPeer(const String& side, BLEAddress addr, esp_ble_addr_type_t type) {
+  Preferences prefs;
+  if (!prefs.begin(KNOWN_PEER_NS, false)) return;
+  String text = addr.toString().c_str();
+  if (prefs.getString(side.c_str(), "") != text || prefs.getUChar((side + "T").c_str(), 0xFF) != (uint8_t)type) {
+    prefs.putString(side.c_str(), text);
+    prefs.putUChar((side + "T").c_str(), (uint8_t)type);
+  }
+  prefs.end();
+}
+
+bool loadKnownPeer(const String& side, String& addr, esp_ble_addr_type_t& type) {
+  Preferences prefs;
+  if (!prefs.begin(KNOWN_PEER_NS, true)) return false;
+  addr = prefs.getString(side.c_str(), "");
+  type = (esp_ble_addr_type_t)prefs.getUChar((side + "T").c_str(), BLE_ADDR_TYPE_PUBLIC);
+  prefs.end();
+  return addr.length() > 0;
+}
+
+// 读取已配对的密钥
+void loadAuthKeys() {
+  Preferences prefs;
+  if (!prefs.begin(AUTH_NS, true)) return;
+  const char* keys[2] = {"red", "green"};
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  for (int i = 0; i < 2; i++) {
+    if (prefs.getBytes(keys[i], key, sizeof(key)) != sizeof(key)) continue;
+    hitAuth[i].setKey(key);
+    ctrlAuth[i].setKey(key);
+  }
+  prefs.end();
+  lockedPrintf("[认证] red%s green%s\n", hitAuth[0].hasKey() ? "已配对" : "未配对", hitAuth[1].hasKey() ? "已配对" : "未配对");
+}
+
+bool pairWindowOpen() {
+  return pairUntil != 0 && (long)(millis() - pairUntil) <= 0;
+}
+
+// 配对：生成新密钥写给剑端（剑端需在配对模式），读回 "paired" 后才保存，避免两边密钥不一致
+bool pairPointer(PeerChar* pChar, HitSide side) {
+  const char* keys[2] = {"red", "green"};
+  pairTried[side] = true;
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  esp_fill_random(key, sizeof(key));
+  char msg[8 + HIT_AUTH_KEY_LEN * 2];
+  strcpy(msg, "pair:");
+  HitAuth::toHex(key, sizeof(key), msg + 5);
+  pChar->writeValue(msg, true);
+  if (pChar->readValue() != "paired") {
+    lockedPrintf("[认证] %s剑端未进入配对模式（剑尖按住再上电）\n", keys[side]);
     return false;
   }
+  Preferences prefs;
+  if (prefs.begin(AUTH_NS, false)) {
+    prefs.putBytes(keys[side], key, sizeof(key));
+    prefs.end();
+  }
+  hitAuth[side].setKey(key);
+  ctrlAuth[side].setKey(key);
+  lockedPrintf("[认证] %s配对完成\n", keys[side]);
+  return true;
+}
+
+// 每次连接下发新随机数，上次连接录下的帧在本次连接校验不过
+void sendAuthNonce(PeerChar* pChar, HitSide side) {
+  if (!hitAuth[side].hasKey()) {
+    lockedPrintf("[认证] %s未配对，按旧格式接收（串口 p 配对）\n", side == HIT_SIDE_RED ? "red" : "green");
+    return;
+  }
+  uint8_t nonce[HIT_AUTH_NONCE_LEN];
+  esp_fill_random(nonce, sizeof(nonce));
+  hitAuth[side].setNonce(nonce);
+  ctrlAuth[side].setNonce(nonce);
+  memcpy(authNonce[side], nonce, sizeof(nonce));
+  authNonceSet[side] = true;
+  char msg[8 + HIT_AUTH_NONCE_LEN * 2];
+  strcpy(msg, "nonce:");
+  HitAuth::toHex(nonce, sizeof(nonce), msg + 6);
+  writeControl(pChar, side, msg, true); // 用新随机数签：剑端据此确认随机数来自持有密钥的主机
+}
+
+// 写剑端控制命令（随机数/hello/确认）：已配对的一方附 "|mac:" 标签，剑端只认带正确标签的写入
+void writeControl(PeerChar* pChar, HitSide side, const char* text, bool response) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%s", text);
+  if (ctrlAuth[side].hasKey() && !ctrlAuth[side].sign(buf, sizeof(buf))) return;
+  pChar->writeValue((uint8_t*)buf, strlen(buf), response);
+}
+
+// 配对窗口内，对已在线的剑端补做配对并换新随机数
+void servicePairing() {
+  if (!pairWindowOpen() || !syncActive) return;
+  if (redConnected && redHitChar != nullptr && !pairTried[HIT_SIDE_RED] && pairPointer(redHitChar, HIT_SIDE_RED)) {
+    sendAuthNonce(redHitChar, HIT_SIDE_RED);
+  }
+  if (greenConnected && greenHitChar != nullptr && !pairTried[HIT_SIDE_GREEN] && pairPointer(greenHitChar, HIT_SIDE_GREEN)) {
+    sendAuthNonce(greenHitChar, HIT_SIDE_GREEN);
+  }
+}
+
+// 启动时先直连上次的剑端，省掉扫描；失败不影响后面的扫描流程
+void connectKnownPeers() {
+  String addr;
+  esp_ble_addr_type_t type;
+  if (!redConnected && loadKnownPeer("red", addr, type)) {
+    bootTimeline.mark(BOOT_PEER_TRY);
+    lockedPrintf("[蓝牙] 直连上次的red设备 %s\n", addr.c_str());
+    if (connectToAddress(BLEAddress(addr.c_str()), type, KNOWN_PEER_TIMEOUT_MS, redNotifyCallback, "red")) {
+      redConnected = true;
+    }
+  }
+  if (!greenConnected && loadKnownPeer("green", addr, type)) {
+    bootTimeline.mark(BOOT_PEER_TRY);
+    lockedPrintf("[蓝牙] 直连上次的green设备 %s\n", addr.c_str());
+    if (connectToAddress(BLEAddress(addr.c_str()), type, KNOWN_PEER_TIMEOUT_MS, greenNotifyCallback, "green")) {
+      greenConnected = true;
+    }
+  }
+}
+
+// 缓存的布局（按剑端地址）：地址对得上、文本能解析才算有缓存
+bool loadGattLayout(HitSide side, BLEAddress addr, String& text, GattLayout& layout) {
+  const char* keys[2] = {"red", "green"};
+  Preferences prefs;
+  if (!prefs.begin(GATT_NS, true)) return false;
+  String cachedAddr = prefs.getString((String(keys[side]) + "A").c_str(), "");
+  text = prefs.getString(keys[side], "");
+  prefs.end();
+  return cachedAddr == addr.toString().c_str() && gattLayoutParse(text.c_str(), text.length(), layout);
+}
+
+void saveGattLayout(HitSide side, BLEAddress addr, const String& text) {
+  const char* keys[2] = {"red", "green"};
+  String addrText = addr.toString().c_str();
+  Preferences prefs;
+  if (!prefs.begin(GATT_NS, false)) return;
+  if (prefs.getString(keys[side], "") != text || prefs.getString((String(keys[side]) + "A").c_str(), "") != addrText) {
+    prefs.putString(keys[side], text);
+    prefs.putString((String(keys[side]) + "A").c_str(), addrText);
+  }
+  prefs.end();
+}
+
+// 串口 'G'：清除两方缓存，下次重连走服务发现
+void clearGattCache() {
+  Preferences prefs;
+  if (!prefs.begin(GATT_NS, false)) return;
+  prefs.clear();
+  prefs.end();
+  lockedPrintln("[缓存] 已清除属性句柄缓存，下次重连走服务发现");
+}
+
+static uint16_t cccdHandle(BLERemoteCharacteristic* pChar) {
+  if (pChar == nullptr || !pChar->canNotify()) return 0;
+  BLERemoteDescriptor* desc = pChar->getDescriptor(BLEUUID((uint16_t)0x2902));
+  return desc != nullptr ? desc->getHandle() : 0;
+}
 
+// 服务发现拿句柄；剑端自报的布局和发现结果一致时写进缓存（旧剑端没有布局特征值，只能每次发现）
+bool discoverGattLayout(BLEClient* pClient, HitSide side, BLEAddress addr, GattLayout& layout) {
+  const char* name = side == HIT_SIDE_RED ? "red" : "green";
   BLERemoteService* pSvc = pClient->getService(serviceUUID);
   if (pSvc == nullptr) {
-    lockedPrintf("[蓝牙] %s设备未找到指定服务\n", side.c_str());
-    pClient->disconnect();
-    delete pClient;
+    lockedPrintf("[蓝牙] %s设备未找到指定服务\n", name);
     return false;
   }
-
   BLERemoteCharacteristic* pChar = pSvc->getCharacteristic(charUUID);
   if (pChar == nullptr) {
-    lockedPrintf("[蓝牙] %s设备未找到指定特征值\n", side.c_str());
+    lockedPrintf("[蓝牙] %s设备未找到指定特征值\n", name);
+    return false;
+  }
+  memset(&layout, 0, sizeof(layout));
+  layout.hit = pChar->getHandle();
+  layout.hitCccd = cccdHandle(pChar);
+  BLERemoteCharacteristic* chr = pSvc->getCharacteristic(telemetryCharUUID);
+  if (chr != nullptr) layout.telemetry = chr->getHandle();
+  chr = pSvc->getCharacteristic(otaCharUUID);
+  if (chr != nullptr) {
+    layout.ota = chr->getHandle();
+    layout.otaCccd = cccdHandle(chr);
+  }
+  chr = pSvc->getCharacteristic(gattLayoutCharUUID);
+  if (chr == nullptr) {
+    lockedPrintf("[缓存] %s剑端固件不带布局特征值，每次重连都要发现服务\n", name);
+    return true;
+  }
+  layout.layout = chr->getHandle();
+
+  PeerChar layoutChar;
+  layoutChar.attach(pClient, layout.layout);
+  String text = layoutChar.readValue();
+  GattLayout reported;
+  if (gattLayoutParse(text.c_str(), text.length(), reported) && gattLayoutEqual(reported, layout)) {
+    saveGattLayout(side, addr, text);
+  } else {
+    lockedPrintf("[缓存] %s剑端自报布局 \"%s\" 与发现结果不符，不缓存\n", name, text.c_str());
+  }
+  return true;
+}
+
+bool connectToAddress(BLEAddress addr, esp_ble_addr_type_t type, uint32_t timeoutMs, PeerNotifyCallback cb, String side) {
+  lockedPrintf("[蓝牙] 开始连接%s设备...\n", side.c_str());
+  HitSide hitSide = (side == "red") ? HIT_SIDE_RED : HIT_SIDE_GREEN;
+  int64_t startUs = esp_timer_get_time();
+
+  BLEClient* pClient = BLEDevice::createClient();
+  pClient->setClientCallbacks(&masterClientCallbacks);
+  if (!pClient->connect(addr, type, timeoutMs)) {
+    lockedPrintf("[蓝牙] %s设备连接失败\n", side.c_str());
+    delete pClient;
+    return false;
+  }
+  int64_t linkUs = esp_timer_get_time();
+
+  // 有缓存先按缓存句柄读一次布局核对（一次读往返），对不上再整轮发现
+  GattLayout layout;
+  String cachedText;
+  uint8_t path = GATT_PATH_DISCOVERED;
+  if (loadGattLayout(hitSide, addr, cachedText, layout)) {
+    PeerChar layoutChar;
+    layoutChar.attach(pClient, layout.layout);
+    if (layoutChar.readValue() == cachedText) {
+      path = GATT_PATH_CACHED;
+    } else {
+      portENTER_CRITICAL(&gattMux);
+      gattStats.addMismatch();
+      portEXIT_CRITICAL(&gattMux);
+      lockedPrintf("[缓存] %s剑端布局已变（换了固件？），重新发现服务\n", side.c_str());
+    }
+  }
+  if (path == GATT_PATH_DISCOVERED && !discoverGattLayout(pClient, hitSide, addr, layout)) {
     pClient->disconnect();
     delete pClient;
     return false;
   }
 
-  if (pChar->canNotify()) {
-    pChar->registerForNotify(cb);
+  PeerChars& chars = peerChars[hitSide];
+  chars.hit.attach(pClient, layout.hit);
+  chars.telemetry.attach(pClient, layout.telemetry);
+  chars.ota.attach(pClient, layout.ota);
+
+  // 计时从本次连接开始；通知一打开就可能到达
+  gattConnectUs[hitSide] = startUs;
+  gattPath[hitSide] = path;
+  gattFirstPending[hitSide] = true;
+  if (layout.hitCccd != 0) {
+    if (!PeerGatt::subscribe(pClient, layout.hit, layout.hitCccd, cb)) {
+      gattFirstPending[hitSide] = false;
+      lockedPrintf("[蓝牙] %s设备通知注册失败\n", side.c_str());
+      // 缓存句柄写 CCCD 失败：清掉缓存，下次走发现
+      if (path == GATT_PATH_CACHED) {
+        Preferences prefs;
+        if (prefs.begin(GATT_NS, false)) {
+          prefs.remove(side.c_str());
+          prefs.end();
+        }
+      }
+      pClient->disconnect();
+      delete pClient;
+      return false;
+    }
     lockedPrintf("[蓝牙] %s设备通知已注册成功\n", side.c_str());
   }
 
   if (side == "red") {
     redClient = pClient;
+    redHitChar = &chars.hit;
   } else if (side == "green") {
     greenClient = pClient;
+    greenHitChar = &chars.hit;
+  }
+
+  portENTER_CRITICAL(&linkMonMux);
+  memcpy(peerBda[hitSide], *addr.getNative(), sizeof(esp_bd_addr_t));
+  linkMon[hitSide].reset(millis());
+  pointerHealth[hitSide].reset();
+  portEXIT_CRITICAL(&linkMonMux);
+  linkLevel[hitSide] = LINK_LEVEL_OK;
+  telemetryChar[hitSide] = layout.telemetry != 0 ? &chars.telemetry : nullptr;
+  healthNextRead[hitSide] = millis() + HEALTH_FIRST_READ_MS;
+  healthHot[hitSide] = false;
+
+#if OTA_ENABLE
+  // 升级特征值：旧剑端没有，不影响计分
+  PeerChar* otaChar = nullptr;
+  if (layout.otaCccd != 0 &&
+      PeerGatt::subscribe(pClient, layout.ota, layout.otaCccd, hitSide == HIT_SIDE_RED ? otaRedNotifyCallback : otaGreenNotifyCallback)) {
+    otaChar = &chars.ota;
+  }
+  otaPeer[hitSide].chr = otaChar;
+  otaPeer[hitSide].running = false;
+  otaPeer[hitSide].mtuAskedMs = 0;
+#endif
+
+  // 热备只订阅通知：随机数/hello 由主用主机写，接管时再写
+  if (!syncActive) {
+    lockedPrintf("[热备] %s设备只订阅通知，等主用心跳中断再接管\n", side.c_str());
+  } else {
+    // 随机数要在 hello 之前下发：剑端收到 hello 就开始补发，补发帧需要带标签
+    if (pairWindowOpen() && !pairTried[hitSide]) pairPointer(&chars.hit, hitSide);
+    sendAuthNonce(&chars.hit, hitSide);
+
+    // 告知剑端本机支持确认：剑端开始重发未确认击中（旧剑端忽略该写入）
+    writeControl(&chars.hit, hitSide, "hello", true);
   }
 
+  int64_t readyUs = esp_timer_get_time();
+  uint32_t readyMs = (uint32_t)((readyUs - startUs) / 1000);
+  portENTER_CRITICAL(&gattMux);
+  gattStats.addReady(path, readyMs);
+  portEXIT_CRITICAL(&gattMux);
+  lockedPrintf("[缓存] %s %s：建链 %ld ms + 属性 %ld ms，共 %lu ms 可计分\n", side.c_str(), GattConnectStats::pathName(path),
+               (long)((linkUs - startUs) / 1000), (long)((readyUs - linkUs) / 1000), (unsigned long)readyMs);
+
+  saveKnownPeer(side, addr, type);
   return true;
 }
 
-// =====================【多核任务函数（仅简化TaskLogic，蓝牙Task完全不动）】=====================
+// 串口 'g'：缓存/发现两条路径的连接耗时对比
+void printGattStats() {
+  portENTER_CRITICAL(&gattMux);
+  GattConnectStats st = gattStats;
+  portEXIT_CRITICAL(&gattMux);
+  for (int p = 0; p < GATT_PATH_COUNT; p++) {
+    const GattTiming& r = st.ready(p);
+    const GattTiming& f = st.firstNotify(p);
+    lockedPrintf("[缓存] %s 连接%lu次 可计分 均%lu 最短%lu 最长%lums\n", GattConnectStats::pathName(p),
+                 (unsigned long)r.count, (unsigned long)GattConnectStats::average(r), (unsigned long)r.minMs,
+                 (unsigned long)r.maxMs);
+    lockedPrintf("[缓存] %s 首条通知%lu次 均%lu 最短%lu 最长%lums\n", GattConnectStats::pathName(p),
+                 (unsigned long)f.count, (unsigned long)GattConnectStats::average(f), (unsigned long)f.minMs,
+                 (unsigned long)f.maxMs);
+  }
+  lockedPrintf("[缓存] 布局不符改走发现 %lu 次\n", (unsigned long)st.mismatches());
+}
+
+// =====================【多核任务函数（核心1判定任务，核心0蓝牙任务）】=====================
 void TaskLogic(void* pvParameters) {
   lockedPrintln("[核心1] 逻辑任务已启动");
+  logicTaskHandle = xTaskGetCurrentTaskHandle();
   FencingCore* core = FencingCore::getInstance(); // 获取封装类实例
+  // 显示、计时、按键在核心1初始化，和核心0的蓝牙连接并行
+  core->init();
+  coreReady = true;
+  bootTimeline.mark(BOOT_CORE_READY);
+  int64_t lastLoopUs = esp_timer_get_time();
 
   for (;;) {
-    // 仅调用4个封装方法，无任何业务逻辑！
-    core->updateTimer();          // 更新计时器显示
-    core->processHitDetection();  // 处理击中判定（核心，全部封装）
-    core->handleHitEffects();     // 处理声光效果
-    core->checkButtons();         // 检测比分/时间按键
+    int64_t nowUs = esp_timer_get_time();
+    int64_t lateUs = (nowUs - lastLoopUs) - 10000;
+    lastLoopUs = nowUs;
+    if (lateUs > (int64_t)logicMaxLateUs) logicMaxLateUs = (uint32_t)lateUs;
+    logicLoops++;
+
+    serviceSyncLogic(core);       // 热备：镜像主用状态，心跳中断时接管
+    if (syncActive) {
+      // 仅调用4个封装方法，无任何业务逻辑！
+      core->updateTimer();          // 更新计时器显示
+      core->processHitDetection();  // 处理击中判定（核心，全部封装）
+      core->handleHitEffects();     // 处理声光效果
+      core->checkButtons();         // 检测比分/时间按键
+    }
 
-    vTaskDelay(pdMS_TO_TICKS(10));
+    // 10ms 周期；遥控器/注入按键到达时提前唤醒，按键不必等到下一周期
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
   }
 }
 
-// 蓝牙任务（完全保留，一行未改）
+// 连接进度计入启动时间线，首次达到可判定时打印一次
+void updateBootPhases() {
+  if (bootTimeline.reached(BOOT_READY)) return;
+  if (redConnected || greenConnected) bootTimeline.mark(BOOT_FIRST_POINTER);
+  if (redConnected && greenConnected) {
+    bootTimeline.mark(BOOT_BOTH_POINTERS);
+    if (coreReady) {
+      bootTimeline.mark(BOOT_READY);
+      lockedPrintf("[系统] 上电到可判定 %ld ms\n", (long)(bootTimeline.at(BOOT_READY) / 1000));
+      bootTimeline.report(lockedPrintf);
+    }
+  }
+}
+
+// 蓝牙任务（核心0）：开机回连已知剑端，循环里处理热备同步、回写确认、蓝牙升级、注入链路事件、配对、连接状态和链路监测，再按扫描结果连接
 void TaskBLE(void* pvParameters) {
   lockedPrintln("[核心0] 蓝牙任务已启动");
+  bleTaskHandle = xTaskGetCurrentTaskHandle();
+  connectKnownPeers();
   for (;;) {
+    serviceSyncBle();
+    sendHitAcks();
+    serviceOta();
+    serviceInjectedLinkEvents();
+    servicePairing();
     checkBLEConnectionStatus();
+    monitorLinks();
     updateBLEStatusLed();
     
     if (doConnectRed && !redConnected && redRetryCount < MAX_CONNECT_RETRY) {
@@ -205,46 +2212,154 @@ void TaskBLE(void* pvParameters) {
       doConnectGreen = false;
     }
 
-    if (((!redConnected && redRetryCount < MAX_CONNECT_RETRY) || (!greenConnected && greenRetryCount < MAX_CONNECT_RETRY)) && (!doConnectRed && !doConnectGreen)) {
+    updateBootPhases();
+
+    // 升级中不扫描：一轮扫描阻塞 1 秒，另一方的重连等升级结束
+    if (((!redConnected && redRetryCount < MAX_CONNECT_RETRY) || (!greenConnected && greenRetryCount < MAX_CONNECT_RETRY)) && (!doConnectRed && !doConnectGreen) && !otaBusy()) {
+      bootTimeline.mark(BOOT_SCAN_START);
       BLEDevice::getScan()->start(1, false);
     }
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // 收到击中帧时被立即唤醒回确认，否则 100ms 轮询一次（升级中 1ms）
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(otaBusy() ? 1 : 100));
   }
 }
 
-// =====================【Arduino 标准入口（仅初始化FencingCore）】=====================
+// =====================【Arduino 标准入口（先起蓝牙，显示/日志并行就绪）】=====================
 void setup() {
+  bootTimeline.mark(BOOT_SETUP);
+  Serial.setRxBufferSize(SERIAL_RX_BUFFER);
   Serial.begin(115200);
   serialMutex = xSemaphoreCreateMutex();
+  verdictQueue = xQueueCreate(INJECT_VERDICT_QUEUE, sizeof(InjectVerdictMsg));
+  FencingCore::getInstance()->setVerdictCallback(onVerdict);
+  FencingCore::getInstance()->setStatsPrinter(lockedPrintf); // 全局重置时打印本局统计
+#if VIDEO_MARK_ENABLE
+  videoInit();
+  FencingCore::getInstance()->setTimerStartCallback(onTimerStart);
+  FencingCore::getInstance()->setTouchCallback(onTouch);
+#endif
   
   // 初始化LED和蓝牙相关引脚
   led_init();
   led_on_boot();
   pinMode(LED_BOARD, OUTPUT);
 
-  delay(1000);
-  lockedPrintln("\n==============================");
-  lockedPrintln("    重剑计分系统 S3 (带计时) 启动...");
-  lockedPrintln("==============================");
-
-  // 初始化封装的比分+计时+击中判定核心（仅这一行）
-  FencingCore::getInstance()->init();
-
-  // 蓝牙初始化（完全保留，未改动）
+  // 蓝牙最先起来：剑端还在广播，越早连上越早能判定（不再等待串口）
   BLEDevice::init("epee_master_s3");
   BLEScan* pBLEScan = BLEDevice::getScan();
   pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks());
+  BLEDevice::setCustomGapHandler(linkGapHandler);
+  PeerGatt::begin();
   pBLEScan->setActiveScan(true);
   pBLEScan->setInterval(100);
   pBLEScan->setWindow(99);
+  bootTimeline.mark(BOOT_RADIO_UP);
+  loadAuthKeys();
 
-  // 创建FreeRTOS任务（完全保留，未改动）
-  xTaskCreatePinnedToCore(TaskLogic, "Logic", 8192, NULL, 2, NULL, 1);
+  // 创建FreeRTOS任务：蓝牙任务立即直连/扫描，逻辑任务在核心1初始化FencingCore
   xTaskCreatePinnedToCore(TaskBLE, "BLE", 8192, NULL, 1, NULL, 0);
+  xTaskCreatePinnedToCore(TaskLogic, "Logic", 8192, NULL, 2, NULL, 1);
+
+  lockedPrintln("\n==============================");
+  lockedPrintln("    重剑计分系统 S3 (带计时) 启动...");
+  lockedPrintln("==============================");
+
+#if SCOREBOARD_ENABLE
+  WiFi.softAP(SCOREBOARD_SSID, SCOREBOARD_PASS, REMOTE_CHANNEL);
+  lockedPrintf("[计分板] 热点 %s 已开启，地址 %s\n", SCOREBOARD_SSID, WiFi.softAPIP().toString().c_str());
+  ScoreboardServer::getInstance()->begin();
+#endif
+#if REMOTE_ENABLE
+  remoteInit();
+#endif
+#if HUB_ENABLE
+  hubInit();
+#endif
+#if SYNC_ENABLE
+  syncInit();
+#endif
+#if OTA_ENABLE
+  if (!LittleFS.begin(false)) lockedPrintln("[升级] LittleFS 未挂载（没有镜像分区），蓝牙升级不可用");
+#endif
 
   lockedPrintln("[系统] 所有任务已就绪");
 }
 
+// 单字符串口命令
+void handleSerialCommand(char cmd) {
+  if (keyEntry >= 0) {
+    if (cmd == '\r' || cmd == '\n') {
+      keyHex[keyEntry] = '\0';
+      importAuthKeys(keyHex);
+      keyEntry = -1;
+    } else if (keyEntry < (int)sizeof(keyHex) - 1) {
+      keyHex[keyEntry++] = cmd;
+    }
+    return;
+  }
+  if (pisteEntry >= 0) {
+    if (cmd >= '0' && cmd <= '9') {
+      pisteEntry = pisteEntry * 10 + (cmd - '0');
+      pisteDigits++;
+      if (pisteEntry > 999) pisteEntry = 999;
+      return;
+    }
+    if (cmd == '\r' || cmd == '\n') {
+      if (pisteDigits > 0) saveHubPiste(pisteEntry);
+      else lockedPrintf("[汇总] 剑道号 %u\n", hubPiste);
+    }
+    pisteEntry = -1;
+    return;
+  }
+  if (cmd == 'h') {
+    pisteEntry = 0;
+    pisteDigits = 0;
+  }
+  if (cmd == 's') printHitLinkStats();
+  if (cmd == 'w') printScoreboardStats();
+  if (cmd == 'b') bootTimeline.report(lockedPrintf);
+  if (cmd == 'q') printLinkQuality();
+  if (cmd == 't') printPointerHealth();
+  if (cmd == 'e') printRemoteStats();
+  if (cmd == 'a') FencingCore::getInstance()->reportStats(lockedPrintf);
+  if (cmd == 'y') printSyncStats();
+  if (cmd == 'Y') toggleSyncRole();
+  if (cmd == 'x') exportAuthKeys();
+  if (cmd == 'k') keyEntry = 0;
+  if (cmd == 'u') startOta();
+  if (cmd == 'U') abortOta();
+  if (cmd == 'g') printGattStats();
+  if (cmd == 'G') clearGattCache();
+  if (cmd == 'v') printVideoStats();
+  if (cmd == 'V') {
+    videoOutputOn = !videoOutputOn;
+    lockedPrintf("[录像] 脉冲/闪码输出%s\n", videoOutputOn ? "开" : "关");
+  }
+  if (cmd == 'p') {
+    pairTried[HIT_SIDE_RED] = false;
+    pairTried[HIT_SIDE_GREEN] = false;
+    pairUntil = millis() + PAIR_WINDOW_MS;
+    lockedPrintf("[认证] 配对窗口开启 %d 秒：剑尖按住给剑端上电，遥控器按住“下一分”上电\n", PAIR_WINDOW_MS / 1000);
+  }
+}
+
+// 串口：注入帧交给解析器，帧外的字节按单字符命令处理；1ms 轮询，满足每秒数千帧注入
 void loop() {
-  vTaskDelay(pdMS_TO_TICKS(1000));
+  while (Serial.available()) {
+    int64_t rxUs = esp_timer_get_time();
+    uint8_t b = Serial.read();
+    bool wasIdle = injectParser.idle();
+    InjectMsg msg;
+    if (injectParser.feed(b, msg)) {
+      handleInjectMsg(msg, rxUs);
+    } else if (wasIdle && injectParser.idle()) {
+      handleSerialCommand((char)b);
+    }
+  }
+  sendInjectVerdicts();
+  serviceVideoMarks();
+  serviceRemotePairing();
+  serviceHub();
+  serviceSync();
+  vTaskDelay(pdMS_TO_TICKS(1));
 }
\ No newline at end of file
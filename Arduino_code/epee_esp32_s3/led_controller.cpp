@@ -1,48 +1,26 @@
 #include "led_controller.h"
 
 // 全局对象实例化
-Adafruit_NeoPixel pixels(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
-SemaphoreHandle_t led_mutex = NULL;
+LedEngine ledEngine;
 
 /**
- * @brief 初始化LED和互斥锁
+ * @brief 初始化LED引擎：RMT 直接驱动 WS2812，刷新任务放在核心0（不占判定核心）
  */
 void led_init() {
-  // 1. 创建互斥锁（FreeRTOS原生API）
-  led_mutex = xSemaphoreCreateMutex();
-  if (led_mutex == NULL) {
-    Serial.println("LED互斥锁创建失败！");
-    while(1); // 锁创建失败时卡死，避免后续错误
+  if (!ledEngine.begin(LED_BACKEND_RMT_WS2812, LED_PIN, false, LED_BRIGHTNESS, 0)) {
+    Serial.println("LED引擎初始化失败！");
   }
-
-  // 2. 初始化LED
-  pixels.begin();
-  pixels.setBrightness(LED_BRIGHTNESS);
-  pixels.clear();
-  pixels.show();
 }
 
 /**
- * @brief 核心：带锁保护的LED颜色设置
+ * @brief 设置连接状态层颜色（入队即返回；颜色没变引擎不会重写）
  * @param r/g/b 颜色值
  */
 void led_set_color(uint8_t r, uint8_t g, uint8_t b) {
-  // 申请锁（最多等待10ms，避免死锁）
-  if (xSemaphoreTake(led_mutex, pdMS_TO_TICKS(10)) == pdTRUE) {
-    // 临界区：只有拿到锁的核心能执行LED操作
-    pixels.clear();
-    pixels.setPixelColor(0, r, g, b);
-    pixels.show();
-    
-    // 释放锁，让其他核心可以获取
-    xSemaphoreGive(led_mutex);
-  } else {
-    // 锁获取失败（超时），打印错误日志
-    Serial.println("LED锁获取超时，操作被跳过！");
-  }
+  ledEngine.set(LED_LAYER_STATUS, LedEngine::solid(r, g, b));
 }
 
-// 以下函数逻辑不变，因为核心的加锁逻辑已封装在led_set_color中
+// 以下函数颜色不变，连接状态写状态层，击中写提示层（到时自动恢复连接状态颜色）
 void led_on_boot() {
   led_set_color(LED_BRIGHTNESS, LED_BRIGHTNESS, LED_BRIGHTNESS);
 }
@@ -60,9 +38,18 @@ void led_connected_both() {
 }
 
 void led_hit_red() {
-  led_set_color(LED_BRIGHTNESS, 0, 0);
+  ledEngine.set(LED_LAYER_ALERT, LedEngine::flash(LED_BRIGHTNESS, 0, 0, LED_HIT_FLASH_MS));
 }
 
 void led_hit_green() {
-  led_set_color(0, LED_BRIGHTNESS, 0);
+  ledEngine.set(LED_LAYER_ALERT, LedEngine::flash(0, LED_BRIGHTNESS, 0, LED_HIT_FLASH_MS));
+}
+
+// 链路告警写状态层：覆盖连接颜色，链路恢复后由 updateBLEStatusLed 改回
+void led_link_marginal() {
+  ledEngine.set(LED_LAYER_STATUS, LedEngine::blink(LED_BRIGHTNESS, LED_BRIGHTNESS/3, 0, 1, 300, 700, 1000));
+}
+
+void led_link_critical() {
+  ledEngine.set(LED_LAYER_STATUS, LedEngine::blink(LED_BRIGHTNESS, LED_BRIGHTNESS/3, 0, 3, 80, 80, 600));
 }
\ No newline at end of file
@@ -2,32 +2,31 @@
 #define LED_CONTROLLER_H
 
 #include <Arduino.h>
-#include <Adafruit_NeoPixel.h>
-// 引入FreeRTOS头文件，用于互斥锁
-#include "freertos/semphr.h"
+#include "LedEngine.h"
 
 // ESP32-S3板载RGB LED引脚（根据实际硬件调整，常见为GPIO48）
 #define LED_PIN        48
 #define LED_COUNT      1
 #define LED_BRIGHTNESS 70
+#define LED_HIT_FLASH_MS 500   // 击中闪烁盖在连接状态上的时长
 
-// NeoPixel对象
-extern Adafruit_NeoPixel pixels;
-// 互斥锁句柄，保护LED操作
-extern SemaphoreHandle_t led_mutex;
+// LED引擎（独占RMT通道，自带刷新任务）
+extern LedEngine ledEngine;
 
-// 初始化LED控制器（含锁初始化）
+// 初始化LED控制器（创建引擎任务）
 void led_init();
 
-// 各状态控制函数（与之前一致）
+// 各状态控制函数（与之前一致，全部只入队不阻塞）
 void led_on_boot();
 void led_connected_red();
 void led_connected_green();
 void led_connected_both();
 void led_hit_red();
 void led_hit_green();
+void led_link_marginal();   // 有一方链路边缘：慢闪琥珀色
+void led_link_critical();   // 有一方链路随时可能断：快闪琥珀色
 
-// 辅助函数
+// 辅助函数：设置连接状态层颜色
 void led_set_color(uint8_t r, uint8_t g, uint8_t b);
 
 #endif // LED_CONTROLLER_H
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include "ToneEngine.h"
 
 // 引脚定义（新增连接状态LED引脚GPIO5）
 #define HIT_SENSOR_PIN 4    // 击中信号输入引脚
@@ -20,6 +21,9 @@ bool deviceConnected = false;  // 蓝牙连接状态
 bool hitDetected = false;      // 击中检测状态
 unsigned long lastHitTime = 0; // 防重复触发计时
 const unsigned long hitDebounceTime = 500; // 防抖时间500ms
+ToneEngine toneEngine;         // 无源蜂鸣器：LEDC出方波+定时器控时，不阻塞loop
+unsigned long hitLedOnTime = 0;
+bool hitLedIsOn = false;
 
 // 蓝牙连接回调类（修改：连接/断开时控制连接状态LED）
 class MyServerCallbacks: public BLEServerCallbacks {
@@ -38,14 +42,9 @@ class MyServerCallbacks: public BLEServerCallbacks {
   }
 };
 
-// 蜂鸣器发声函数（保持不变）
-void buzzerBeep(int duration) {
-  for (int i = 0; i < duration * 1000 / 2; i++) {
-    digitalWrite(BUZZER_PIN, HIGH);
-    delayMicroseconds(500);
-    digitalWrite(BUZZER_PIN, LOW);
-    delayMicroseconds(500);
-  }
+// 蜂鸣器发声函数：原来 delayMicroseconds 翻转引脚会阻塞整个剑端，改为入队由硬件播放
+void buzzerBeep() {
+  toneEngine.play(TONE_POINTER_HIT, true);
 }
 
 void setup() {
@@ -53,12 +52,11 @@ void setup() {
   pinMode(HIT_SENSOR_PIN, INPUT_PULLUP);
   pinMode(HIT_LED_PIN, OUTPUT);
   pinMode(CONN_LED_PIN, OUTPUT); // 初始化新增LED引脚
-  pinMode(BUZZER_PIN, OUTPUT);
   
   // 默认状态：击中LED灭、连接LED灭、蜂鸣器静音
   digitalWrite(HIT_LED_PIN, HIGH);
   digitalWrite(CONN_LED_PIN, HIGH);
-  digitalWrite(BUZZER_PIN, LOW);
+  toneEngine.begin(BUZZER_PIN, true);
 
   // 串口初始化
   Serial.begin(115200);
@@ -97,10 +95,11 @@ void loop() {
     hitDetected = true;
     lastHitTime = currentTime;
 
-    // 击中提示：原有LED亮+蜂鸣器响
+    // 击中提示：原有LED亮+蜂鸣器响（都不阻塞，LED 500ms 后在下面熄灭）
     digitalWrite(HIT_LED_PIN, LOW);
-    buzzerBeep(500);
-    digitalWrite(HIT_LED_PIN, HIGH);
+    buzzerBeep();
+    hitLedOnTime = currentTime;
+    hitLedIsOn = true;
 
     // 蓝牙发送击中信号（保持不变）
     if (deviceConnected) {
@@ -112,6 +111,11 @@ void loop() {
     }
   }
 
+  if (hitLedIsOn && currentTime - hitLedOnTime >= 500) {
+    digitalWrite(HIT_LED_PIN, HIGH);
+    hitLedIsOn = false;
+  }
+
   // 重置击中状态（保持不变）
   if (hitState == HIGH && hitDetected) {
     hitDetected = false;
@@ -0,0 +1,198 @@
+#include "LedEngine.h"
+
+// WS2812 时序（RMT 分辨率 10MHz，即 0.1us 一格）
+#define WS2812_RMT_HZ   10000000
+#define WS2812_T0H      4   // 0.4us
+#define WS2812_T0L      8
+#define WS2812_T1H      8   // 0.8us
+#define WS2812_T1L      4
+
+LedEngine::LedEngine()
+  : m_backend(LED_BACKEND_GPIO)
+  , m_pin(-1)
+  , m_activeLow(false)
+  , m_brightness(255)
+  , m_queue(NULL)
+  , m_lastColor(0)
+  , m_written(false)
+  , m_frames(0)
+  , m_dropped(0) {
+  memset(m_layers, 0, sizeof(m_layers));
+}
+
+bool LedEngine::begin(LedBackend backend, int pin, bool activeLow, uint8_t brightness, BaseType_t core) {
+  m_backend = backend;
+  m_pin = pin;
+  m_activeLow = activeLow;
+  m_brightness = brightness;
+
+  if (backend == LED_BACKEND_RMT_WS2812) {
+    if (!rmtInit(pin, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_1, WS2812_RMT_HZ)) {
+      Serial.println("[LED] RMT 初始化失败");
+      return false;
+    }
+  } else {
+    pinMode(pin, OUTPUT);
+  }
+  write(0);
+
+  m_queue = xQueueCreate(LED_QUEUE_LEN, sizeof(Command));
+  if (m_queue == NULL) return false;
+  xTaskCreatePinnedToCore(task, "LedEngine", 3072, this, 1, NULL, core);
+  return true;
+}
+
+void LedEngine::post(const Command& cmd) {
+  if (m_queue == NULL) return;
+  // 不等待：灯是次要输出，队列满宁可丢一条也不拖慢调用方
+  BaseType_t ok = xPortInIsrContext() ? xQueueSendFromISR(m_queue, &cmd, NULL)
+                                      : xQueueSend(m_queue, &cmd, 0);
+  if (ok != pdTRUE) m_dropped++;
+}
+
+void LedEngine::set(LedLayer layer, const LedPattern& pattern) {
+  Command cmd;
+  cmd.layer = layer;
+  cmd.active = true;
+  cmd.pattern = pattern;
+  post(cmd);
+}
+
+void LedEngine::clear(LedLayer layer) {
+  Command cmd;
+  memset(&cmd, 0, sizeof(cmd));
+  cmd.layer = layer;
+  cmd.active = false;
+  post(cmd);
+}
+
+LedPattern LedEngine::solid(uint8_t r, uint8_t g, uint8_t b) {
+  LedPattern p = {LED_MODE_SOLID, r, g, b, 0, 0, 0, 0, 0};
+  return p;
+}
+
+LedPattern LedEngine::blink(uint8_t r, uint8_t g, uint8_t b, uint8_t count, uint16_t onMs, uint16_t offMs, uint16_t periodMs) {
+  LedPattern p = {LED_MODE_BLINK, r, g, b, periodMs, onMs, offMs, count, 0};
+  return p;
+}
+
+LedPattern LedEngine::fade(uint8_t r, uint8_t g, uint8_t b, uint16_t periodMs) {
+  LedPattern p = {LED_MODE_FADE, r, g, b, periodMs, 0, 0, 0, 0};
+  return p;
+}
+
+LedPattern LedEngine::flash(uint8_t r, uint8_t g, uint8_t b, uint16_t durationMs) {
+  LedPattern p = {LED_MODE_SOLID, r, g, b, 0, 0, 0, 0, durationMs};
+  return p;
+}
+
+bool LedEngine::samePattern(const LedPattern& a, const LedPattern& b) {
+  return a.mode == b.mode && a.r == b.r && a.g == b.g && a.b == b.b &&
+         a.periodMs == b.periodMs && a.onMs == b.onMs && a.offMs == b.offMs &&
+         a.count == b.count && a.durationMs == b.durationMs;
+}
+
+void LedEngine::apply(const Command& cmd, uint32_t now) {
+  if (cmd.layer >= LED_LAYER_COUNT) return;
+  LayerState& ls = m_layers[cmd.layer];
+  if (!cmd.active) {
+    ls.active = false;
+    return;
+  }
+  // 同一图案重复设置（例如每 100ms 刷一次连接状态）：保持原相位，不重新开始
+  if (ls.active && ls.pattern.durationMs == 0 && samePattern(ls.pattern, cmd.pattern)) return;
+  ls.active = true;
+  ls.pattern = cmd.pattern;
+  ls.startMs = now;
+}
+
+// 计算当前颜色（0x00RRGGBB）和下次需要刷新的时间（相对毫秒，UINT32_MAX=静止不用刷新）
+uint32_t LedEngine::render(uint32_t now, uint32_t& nextWakeMs) {
+  nextWakeMs = UINT32_MAX;
+  for (int i = LED_LAYER_COUNT - 1; i >= 0; i--) {
+    LayerState& ls = m_layers[i];
+    if (!ls.active) continue;
+    const LedPattern& p = ls.pattern;
+    uint32_t elapsed = now - ls.startMs;
+    if (p.durationMs > 0) {
+      if (elapsed >= p.durationMs) {
+        ls.active = false;     // 提示层到时撤销，露出下一层
+        continue;
+      }
+      nextWakeMs = p.durationMs - elapsed;
+    }
+
+    uint16_t level = 0;        // 0~255
+    switch (p.mode) {
+      case LED_MODE_SOLID:
+        level = 255;
+        break;
+      case LED_MODE_BLINK: {
+        uint32_t t = p.periodMs > 0 ? elapsed % p.periodMs : elapsed;
+        uint32_t slot = p.onMs + p.offMs;
+        if (slot > 0 && t < slot * p.count && (t % slot) < p.onMs) level = 255;
+        if (nextWakeMs > LED_TICK_MS) nextWakeMs = LED_TICK_MS;
+        break;
+      }
+      case LED_MODE_FADE: {
+        uint32_t period = p.periodMs > 0 ? p.periodMs : 1000;
+        uint32_t t = elapsed % period;
+        uint32_t half = period / 2;
+        level = (t < half) ? (t * 255 / half) : ((period - t) * 255 / (period - half));
+        if (nextWakeMs > LED_TICK_MS) nextWakeMs = LED_TICK_MS;
+        break;
+      }
+      default:
+        break;
+    }
+    uint32_t r = p.r * level / 255;
+    uint32_t g = p.g * level / 255;
+    uint32_t b = p.b * level / 255;
+    return (r << 16) | (g << 8) | b;
+  }
+  return 0;
+}
+
+void LedEngine::write(uint32_t color) {
+  if (m_written && color == m_lastColor) return; // 没变化不重写
+  m_lastColor = color;
+  m_written = true;
+  m_frames++;
+
+  if (m_backend == LED_BACKEND_GPIO) {
+    bool on = color != 0;
+    digitalWrite(m_pin, (on != m_activeLow) ? HIGH : LOW);
+    return;
+  }
+
+  uint8_t r = ((color >> 16) & 0xFF) * m_brightness / 255;
+  uint8_t g = ((color >> 8) & 0xFF) * m_brightness / 255;
+  uint8_t b = (color & 0xFF) * m_brightness / 255;
+  uint32_t grb = ((uint32_t)g << 16) | ((uint32_t)r << 8) | b;
+  for (int i = 0; i < 24; i++) {
+    bool bit = grb & (1UL << (23 - i));
+    m_rmtData[i].level0 = 1;
+    m_rmtData[i].duration0 = bit ? WS2812_T1H : WS2812_T0H;
+    m_rmtData[i].level1 = 0;
+    m_rmtData[i].duration1 = bit ? WS2812_T1L : WS2812_T0L;
+  }
+  // 异步发送：RMT 硬件出波形，不关中断、不等待（两帧间隔远大于 30us 发送时间）
+  rmtWriteAsync(m_pin, m_rmtData, 24);
+}
+
+void LedEngine::task(void* param) {
+  LedEngine* self = (LedEngine*)param;
+  uint32_t nextWakeMs = UINT32_MAX;
+  for (;;) {
+    TickType_t wait = (nextWakeMs == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(nextWakeMs);
+    if (wait == 0 && nextWakeMs != UINT32_MAX) wait = 1;
+    Command cmd;
+    if (xQueueReceive(self->m_queue, &cmd, wait) == pdTRUE) {
+      uint32_t now = millis();
+      self->apply(cmd, now);
+      // 一次取完积压的命令，只渲染最后的结果
+      while (xQueueReceive(self->m_queue, &cmd, 0) == pdTRUE) self->apply(cmd, now);
+    }
+    self->write(self->render(millis(), nextWakeMs));
+  }
+}
\ No newline at end of file
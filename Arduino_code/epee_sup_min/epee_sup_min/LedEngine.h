@@ -0,0 +1,96 @@
+#ifndef LED_ENGINE_H
+#define LED_ENGINE_H
+
+#include <Arduino.h>
+#include "freertos/queue.h"
+
+// 状态灯动画引擎：独占输出（RMT 驱动的 WS2812，或普通 GPIO 灯），由自己的任务刷新
+// 调用方只往命令队列里放一条命令（不等待），不会被灯的刷新阻塞
+// 两个图层：状态层（连接状态，常驻）+ 提示层（击中闪烁，带时长，盖在状态层上）
+
+enum LedBackend {
+  LED_BACKEND_RMT_WS2812,   // 单颗 WS2812（S3 板载 RGB）
+  LED_BACKEND_GPIO          // 单色灯，任意颜色非 0 即亮
+};
+
+enum LedLayer {
+  LED_LAYER_STATUS = 0,     // 低优先级
+  LED_LAYER_ALERT,          // 高优先级，到时自动撤销
+  LED_LAYER_COUNT
+};
+
+enum LedMode {
+  LED_MODE_OFF = 0,
+  LED_MODE_SOLID,
+  LED_MODE_BLINK,           // 每周期闪 count 下：亮 onMs、灭 offMs，其余时间灭
+  LED_MODE_FADE             // 每周期亮→暗呼吸一次
+};
+
+struct LedPattern {
+  uint8_t mode;             // LedMode
+  uint8_t r, g, b;
+  uint16_t periodMs;
+  uint16_t onMs;
+  uint16_t offMs;
+  uint8_t count;
+  uint16_t durationMs;      // 提示层持续时间，0=一直显示
+};
+
+#define LED_QUEUE_LEN    8
+#define LED_TICK_MS      20    // 动画刷新周期（静态图案不刷新）
+
+class LedEngine {
+public:
+  LedEngine();
+
+  // 建立输出和刷新任务；activeLow 只对 GPIO 灯有效；brightness 按 0~255 缩放颜色
+  bool begin(LedBackend backend, int pin, bool activeLow, uint8_t brightness, BaseType_t core);
+
+  // 设置某一层的图案（入队，不等待；队列满时丢弃并计数）
+  void set(LedLayer layer, const LedPattern& pattern);
+  void clear(LedLayer layer);
+
+  uint32_t frames() const { return m_frames; }     // 实际写到灯上的帧数
+  uint32_t dropped() const { return m_dropped; }   // 队列满丢弃的命令
+
+  // 便捷构造
+  static LedPattern solid(uint8_t r, uint8_t g, uint8_t b);
+  static LedPattern blink(uint8_t r, uint8_t g, uint8_t b, uint8_t count, uint16_t onMs, uint16_t offMs, uint16_t periodMs);
+  static LedPattern fade(uint8_t r, uint8_t g, uint8_t b, uint16_t periodMs);
+  static LedPattern flash(uint8_t r, uint8_t g, uint8_t b, uint16_t durationMs);
+
+private:
+  struct Command {
+    uint8_t layer;
+    bool active;
+    LedPattern pattern;
+  };
+
+  struct LayerState {
+    bool active;
+    LedPattern pattern;
+    uint32_t startMs;
+  };
+
+  LedBackend m_backend;
+  int m_pin;
+  bool m_activeLow;
+  uint8_t m_brightness;
+  QueueHandle_t m_queue;
+  LayerState m_layers[LED_LAYER_COUNT];
+  uint32_t m_lastColor;     // 上次写出的颜色，相同则跳过
+  bool m_written;
+  volatile uint32_t m_frames;
+  volatile uint32_t m_dropped;
+  rmt_data_t m_rmtData[24];
+
+  void post(const Command& cmd);
+  void apply(const Command& cmd, uint32_t now);
+  uint32_t render(uint32_t now, uint32_t& nextWakeMs);
+  void write(uint32_t color);
+
+  static bool samePattern(const LedPattern& a, const LedPattern& b);
+  static void task(void* param);
+};
+
+#endif // LED_ENGINE_H
\ No newline at end of file
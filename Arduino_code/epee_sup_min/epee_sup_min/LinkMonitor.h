@@ -0,0 +1,94 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 单方链路质量监测：RSSI 趋势、读往返（折算错过的连接事件）、距监督超时的静默占比
+// 滚动窗口统计，超过阈值分级告警，在真正断线之前提醒裁判
+// 不依赖 Arduino.h，时间由调用方传入，主机端仿真可直接编译
+
+#define LINK_WINDOW                16     // 滚动窗口样本数（RSSI、往返各一份）
+#define LINK_PING_MS               500    // 探测周期：读一次 RSSI + 读一次特征值
+#define LINK_DEFAULT_TIMEOUT_MS    4000   // 未拿到连接参数前假定的监督超时
+#define LINK_DEFAULT_INTERVAL_US   15000  // 未拿到连接参数前假定的连接间隔
+
+#define LINK_RSSI_MARGINAL         -80    // 窗口均值低于此值告警
+#define LINK_RSSI_CRITICAL         -88
+#define LINK_RSSI_DROP_DB          8      // 窗口后半段比前半段下降这么多视为快速恶化
+#define LINK_MISSED_MARGINAL       4      // 窗口内一次往返错过的连接事件最大值
+#define LINK_MISSED_CRITICAL       10
+#define LINK_SILENCE_MARGINAL_PCT  40     // 距上次收到对端的时间占监督超时的百分比
+#define LINK_SILENCE_CRITICAL_PCT  70
+#define LINK_PING_FAIL_CRITICAL    2      // 连续探测失败次数
+
+enum LinkLevel {
+  LINK_LEVEL_OK = 0,
+  LINK_LEVEL_MARGINAL,    // 边缘：提醒检查距离/遮挡/电量
+  LINK_LEVEL_CRITICAL     // 随时可能断线
+};
+
+// 告警原因（位掩码）
+enum LinkReason {
+  LINK_REASON_RSSI     = 1 << 0,   // 信号弱
+  LINK_REASON_TREND    = 1 << 1,   // 信号快速下降
+  LINK_REASON_MISSED   = 1 << 2,   // 往返错过连接事件
+  LINK_REASON_SILENCE  = 1 << 3,   // 接近监督超时
+  LINK_REASON_PINGFAIL = 1 << 4    // 探测读失败
+};
+
+struct LinkMetrics {
+  int16_t rssiAvg;          // 窗口均值 dBm（无样本为 0）
+  int16_t rssiMin;
+  int16_t rssiTrend;        // 后半段均值 - 前半段均值，负数为变差
+  uint16_t rttAvgMs;
+  uint16_t rttMaxMs;
+  uint16_t missedMax;       // 窗口内单次往返错过的连接事件最大值（估算）
+  uint16_t silencePct;      // 当前静默时间 / 监督超时
+  uint32_t pingFails;       // 累计探测失败
+  uint8_t level;            // LinkLevel
+  uint8_t reasons;          // LinkReason 位掩码
+};
+
+class LinkMonitor {
+public:
+  LinkMonitor();
+
+  // 新连接：清空窗口，连接参数恢复默认
+  void reset(uint32_t nowMs);
+
+  // 连接参数更新（协议栈事件）：间隔单位 1.25ms，超时单位 10ms
+  void setConnParams(uint16_t interval, uint16_t latency, uint16_t timeout);
+
+  // 收到对端数据（通知、探测响应）
+  void heard(uint32_t nowMs);
+
+  void addRssi(int rssi);
+  void addPing(bool ok, uint32_t rttMs, uint32_t nowMs);
+
+  // 计算当前指标和告警等级
+  LinkLevel evaluate(uint32_t nowMs, LinkMetrics& out) const;
+
+  uint32_t intervalUs() const { return m_intervalUs; }
+  uint32_t timeoutMs() const { return m_timeoutMs; }
+
+  static const char* levelName(uint8_t level);
+  // 把原因位掩码写成 "信号弱,接近超时" 这样的文字
+  static void reasonText(uint8_t reasons, char* buf, size_t len);
+
+private:
+  int8_t m_rssi[LINK_WINDOW];
+  uint8_t m_rssiCount;
+  uint8_t m_rssiHead;        // 下一个写入位置
+  uint16_t m_rtt[LINK_WINDOW];
+  uint8_t m_rttCount;
+  uint8_t m_rttHead;
+  uint32_t m_lastHeardMs;
+  uint32_t m_pingFails;
+  uint8_t m_pingFailStreak;
+  uint32_t m_intervalUs;
+  uint16_t m_latency;
+  uint32_t m_timeoutMs;
+};
+
+#endif // LINK_MONITOR_H
\ No newline at end of file
@@ -2,6 +2,9 @@
 #include <BLEUtils.h>
 #include <BLEScan.h>
 #include <BLEAdvertisedDevice.h>
+#include "LedEngine.h"
+#include "LinkMonitor.h"
+#include "EpeeJudge.h"
 
 // --- 新增引脚配置 ---
 const int PIN_RED_LED = 4;   // 红方击中灯
@@ -20,6 +23,7 @@ bool effectActive = false;           // 效果是否正在运行
 const int BTN_NEXT = 7;   // 下一剑按钮：GPIO 7
 const int BTN_RESET = 6;  // 完全重置按钮：GPIO 6
 const int LED_BOARD = 8;  // 板载蓝色LED：GPIO 8
+LedEngine ledEngine;      // 板载灯由引擎任务按图案刷新，loop 只在状态变化时下发
 
 // --- 配置区 ---
 static BLEUUID serviceUUID("4fafc201-1fb5-459e-8fcc-c5c9c331914b");
@@ -28,60 +32,101 @@ static BLEUUID charUUID("beb5483e-36e1-4688-b7f5-ea07361b26a8");
 // --- 计分变量 ---
 int redScore = 0;
 int greenScore = 0;
-unsigned long firstHitTime = 0; // 记录回合第一次击中的时间
-bool isLocked = false;          // 回合锁定状态
-bool redHitReceived = false;    // 本回合红色是否有效击中
-bool greenHitReceived = false;  // 本回合绿色是否有效击中
 
 // --- BLE 状态变量 ---
-static boolean doConnectRed = false;
-static boolean doConnectGreen = false;
-static BLEAdvertisedDevice* redDevice;
-static BLEAdvertisedDevice* greenDevice;
-static boolean redConnected = false;
-static boolean greenConnected = false;
-
-// ===================== 新增：连接重试次数限制核心配置 =====================
-const int MAX_CONNECT_RETRY = 5;  // 单个设备最大重试连接次数
-const int MAX_SCAN_RETRY = 5;  // 最大扫描次数
-int redRetryCount = 0;             // 红方连接失败重试计数
-int greenRetryCount = 0;           // 绿方连接失败重试计数
-int scan_count = MAX_SCAN_RETRY;  //扫描计数 
+// 每一方一个连接状态机，由链路任务按协议栈事件逐步推进，判定任务只读 connected
+enum LinkState {
+    LINK_IDLE,        // 等扫描发现
+    LINK_FOUND,       // 扫描回调已发现设备，等链路任务处理
+    LINK_SETTLING,    // 已停扫描，等协议栈退出扫描再发起连接
+    LINK_ONLINE,      // 已连接并订阅
+    LINK_BACKOFF      // 连接失败，退避后重新扫描
+};
+
+struct SideLink {
+    const char* name;
+    volatile LinkState state;
+    BLEAdvertisedDevice* device;
+    BLEClient* client;
+    unsigned long stateSince;
+    unsigned long backoffMs;
+    int retryCount;
+    void (*callback)(BLERemoteCharacteristic*, uint8_t*, size_t, bool);
+    BLERemoteCharacteristic* hitChar;  // 链路探测用（读往返）
+    esp_bd_addr_t bda;                 // 对端地址，匹配连接参数更新事件
+    LinkMonitor monitor;               // 链路质量滚动窗口
+    uint8_t level;                     // 当前告警等级 LinkLevel
+    unsigned long lastProbe;
+};
+
+static void redNotifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify);
+static void greenNotifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify);
+
+SideLink redLink = {"epee_red", LINK_IDLE, nullptr, nullptr, 0, 0, 0, redNotifyCallback};
+SideLink greenLink = {"epee_green", LINK_IDLE, nullptr, nullptr, 0, 0, 0, greenNotifyCallback};
+#define redConnected   (redLink.state == LINK_ONLINE)
+#define greenConnected (greenLink.state == LINK_ONLINE)
+
+// ===================== 连接/扫描节奏配置 =====================
+const int MAX_CONNECT_RETRY = 5;                // 连续失败这么多次后进入长退避（不再放弃）
+const unsigned long SCAN_SECONDS = 5;           // 每轮扫描时长
+const unsigned long SCAN_PAUSE_MS = 2000;       // 两轮扫描之间的间隔
+const unsigned long LINK_SETTLE_MS = 500;       // 停扫描后等协议栈退出扫描再连接（原 delay(500)）
+const unsigned long RETRY_BACKOFF_MS = 1000;    // 首次失败退避，之后翻倍
+const unsigned long RETRY_BACKOFF_MAX_MS = 30000;
+volatile bool scanning = false;
+unsigned long lastScanEnd = 0;
+TaskHandle_t linkTaskHandle = NULL;
+
+// ===================== 判定任务节奏 =====================
+const unsigned long JUDGE_PERIOD_MS = 5;        // 判定任务固定周期，不受连接过程影响
+const unsigned long HIT_WINDOW_MS = 40;
+const unsigned long HIT_EVAL_DELAY_MS = 45;
+const unsigned long BTN_DEBOUNCE_MS = 50;
+portMUX_TYPE judgeMux = portMUX_INITIALIZER_UNLOCKED; // 通知回调（蓝牙任务）与判定任务共用待判击中
+volatile bool hitPending[2] = {false, false};       // 回调只登记到达时间，判定任务取走后喂给引擎
+uint32_t hitPendingMs[2] = {0, 0};
+volatile uint8_t resetRequest = 0;                  // 串口命令请求重置（1=下一剑，2=全部），判定任务里执行
+volatile uint32_t judgeMaxLateUs = 0;
+volatile uint32_t judgeLoops = 0;
+uint8_t ledAlertLevel = LINK_LEVEL_OK;              // 板载灯当前显示的链路告警等级
+
+// 判定引擎（EpeeJudge.h，各主机目标共用）：只在判定任务里调用，判定结果回调 applyVerdict
+void applyVerdict(const JudgeVerdict& v);
+struct MillisClock {
+    uint32_t now() const { return millis(); }
+};
+struct VerdictSink {
+    void onVerdict(const JudgeVerdict& v) { applyVerdict(v); }
+};
+EpeeJudge<MillisClock, VerdictSink> judge(MillisClock(), VerdictSink(), HIT_WINDOW_MS, HIT_EVAL_DELAY_MS);
 // =========================================================================
 
 // --- [核心逻辑] 仅通过灯光频率区分红绿在线状态 ---
+// 图案交给 LedEngine 播放，这里只在连接状态变化时下发一次
 void updateStatusLed() {
-    unsigned long now = millis();
-    
-    // 1. 双方都上线：常亮 (最高优先级)
-    if (redConnected && greenConnected) {
-        digitalWrite(LED_BOARD, LOW); // 低电平点亮
-        return;
-    }
-
-    // 2. 只有红方在线：每2秒闪烁 1 下
-    if (redConnected && !greenConnected) {
-        int cycle = now % 2000;
-        if (cycle < 200) digitalWrite(LED_BOARD, LOW); 
-        else digitalWrite(LED_BOARD, HIGH);           
-        return;
-    }
-
-    // 3. 只有绿方在线：每2秒闪烁 2 下
-    if (!redConnected && greenConnected) {
-        int cycle = now % 2000;
-        if (cycle < 200) digitalWrite(LED_BOARD, LOW);           // 第一闪
-        else if (cycle < 400) digitalWrite(LED_BOARD, HIGH);     // 间隔
-        else if (cycle < 600) digitalWrite(LED_BOARD, LOW);      // 第二闪
-        else digitalWrite(LED_BOARD, HIGH);                      // 停顿
-        return;
+    static int lastState = -1;
+    int state = (redConnected ? 1 : 0) | (greenConnected ? 2 : 0);
+    if (state == lastState) return;
+    lastState = state;
+
+    switch (state) {
+        case 3: // 1. 双方都上线：常亮 (最高优先级)
+            ledEngine.set(LED_LAYER_STATUS, LedEngine::solid(255, 255, 255));
+            break;
+        case 1: // 2. 只有红方在线：每2秒闪烁 1 下
+            ledEngine.set(LED_LAYER_STATUS, LedEngine::blink(255, 255, 255, 1, 200, 200, 2000));
+            break;
+        case 2: // 3. 只有绿方在线：每2秒闪烁 2 下
+            ledEngine.set(LED_LAYER_STATUS, LedEngine::blink(255, 255, 255, 2, 200, 200, 2000));
+            break;
+        default: // 4. 其他状态（连接中、无人在线）：保持灯灭，避免干扰
+            ledEngine.clear(LED_LAYER_STATUS);
+            break;
     }
-
-    // 4. 其他状态（连接中、无人在线）：保持灯灭，避免干扰
-    digitalWrite(LED_BOARD, HIGH);
 }
 
-// --- 重置比赛逻辑 (保持不变) ---
+// --- 重置比赛逻辑（判定任务里调用）---
 void resetMatch(bool resetTotalScore) {
     if (resetTotalScore) {
         redScore = 0;
@@ -90,10 +135,10 @@ void resetMatch(bool resetTotalScore) {
     } else {
         Serial.println("\n[系统] >>> 回合就绪，准备下一剑 <<<");
     }
-    isLocked = false;
-    redHitReceived = false;
-    greenHitReceived = false;
-    firstHitTime = 0;
+    judge.reset();
+    portENTER_CRITICAL(&judgeMux);
+    hitPending[JUDGE_RED] = hitPending[JUDGE_GREEN] = false;
+    portEXIT_CRITICAL(&judgeMux);
 
     effectActive = false;
     digitalWrite(PIN_RED_LED, LOW);
@@ -101,23 +146,25 @@ void resetMatch(bool resetTotalScore) {
     digitalWrite(PIN_BUZZER, LOW);
 }
 
-// --- 修改后的核心判定函数 ---
-void evaluateHit() {
+// --- 判定结果（引擎到期出判定后回调，之后本剑锁定，新到的击中一律丢弃）---
+void applyVerdict(const JudgeVerdict& v) {
+    bool redHit = v.red;
+    bool greenHit = v.green;
+
     Serial.println("[判定] 判定窗口关闭，正在触发效果...");
-    isLocked = true; 
     hitEffectStartTime = millis();
     effectActive = true;
 
-    if (redHitReceived && greenHitReceived) {
+    if (redHit && greenHit) {
         redScore++; greenScore++;
         digitalWrite(PIN_RED_LED, HIGH);
         digitalWrite(PIN_GRN_LED, HIGH);
         Serial.println(">>> 【互中】！");
-    } else if (redHitReceived) {
+    } else if (redHit) {
         redScore++;
         digitalWrite(PIN_RED_LED, HIGH);
         Serial.println(">>> 【红方单中】！");
-    } else if (greenHitReceived) {
+    } else if (greenHit) {
         greenScore++;
         digitalWrite(PIN_GRN_LED, HIGH);
         Serial.println(">>> 【绿方单中】！");
@@ -145,71 +192,109 @@ void handleHitEffects() {
         digitalWrite(PIN_RED_LED, LOW);
         digitalWrite(PIN_GRN_LED, LOW);
         effectActive = false; 
+        judge.lampOff();
         Serial.println("[系统] 效果显示结束，等待下一剑复位...");
     }
 }
 
-// --- 红色设备回调 ---
-static void redNotifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
-    Serial.println("[日志] epee_red 回调！");
-    if (isLocked) return; 
+// --- 击中记录（两方回调共用） ---
+// 在蓝牙协议栈任务里执行，只登记到达时间，判定交给判定任务按固定节拍完成；
+// 另一方正在重连时，链路任务阻塞在连接上也不影响这里和判定任务
+static void recordHit(bool isRed) {
+    const char* tag = isRed ? "epee_red" : "epee_green";
+    Serial.printf("[日志] %s 回调\n", tag);
     unsigned long currentTime = millis();
-    if (firstHitTime == 0) {
-        firstHitTime = currentTime;
-        Serial.println("\n[信号] 红色首击！开启 40ms 窗口...");
+    (isRed ? redLink : greenLink).monitor.heard(currentTime);
+    int side = isRed ? JUDGE_RED : JUDGE_GREEN;
+
+    portENTER_CRITICAL(&judgeMux);
+    if (!hitPending[side]) { // 一拍内同一方的多次通知只留最早的
+        hitPendingMs[side] = currentTime;
+        hitPending[side] = true;
     }
-    if (currentTime - firstHitTime <= 40) {
-        if (!redHitReceived) {
-            redHitReceived = true;
-            Serial.println("[日志] epee_red 信号确认有效");
-        }
+    portEXIT_CRITICAL(&judgeMux);
+}
+
+// 取走回调登记的击中，按到达时间喂给判定引擎（判定任务里调用）
+static void feedHits() {
+    for (int side = JUDGE_RED; side <= JUDGE_GREEN; side++) {
+        portENTER_CRITICAL(&judgeMux);
+        bool pending = hitPending[side];
+        uint32_t at = hitPendingMs[side];
+        hitPending[side] = false;
+        portEXIT_CRITICAL(&judgeMux);
+        if (!pending) continue;
+
+        bool isRed = side == JUDGE_RED;
+        JudgeHitResult r = judge.hit(side, at);
+        if (r == JUDGE_HIT_FIRST) Serial.printf("\n[信号] %s首击！开启 %lums 窗口...\n", isRed ? "红色" : "绿色", HIT_WINDOW_MS);
+        if (r == JUDGE_HIT_FIRST || r == JUDGE_HIT_ACCEPTED) Serial.printf("[日志] %s 信号确认有效\n", isRed ? "epee_red" : "epee_green");
     }
 }
 
+// --- 红色设备回调 ---
+static void redNotifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
+    recordHit(true);
+}
+
 // --- 绿色设备回调 ---
 static void greenNotifyCallback(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t length, bool isNotify) {
-    Serial.println("[日志] epee_green 回调");
-    if (isLocked) return;
-    unsigned long currentTime = millis();
-    if (firstHitTime == 0) {
-        firstHitTime = currentTime;
-        Serial.println("\n[信号] 绿色首击！开启 40ms 窗口...");
-    }
-    if (currentTime - firstHitTime <= 40) {
-        if (!greenHitReceived) {
-            greenHitReceived = true;
-            Serial.println("[日志] epee_green 信号确认有效");
-        }
-    }
+    recordHit(false);
 }
 
 // --- 扫描与连接逻辑 ---
+// 扫描回调只登记发现的设备并唤醒链路任务，连接动作全部在链路任务里推进
 class MyAdvertisedDeviceCallbacks: public BLEAdvertisedDeviceCallbacks {
     void onResult(BLEAdvertisedDevice advertisedDevice) {
         String name = advertisedDevice.getName().c_str();
-        if (name == "epee_red" && !redConnected && !doConnectRed && redRetryCount < MAX_CONNECT_RETRY) {
-            Serial.println(">>> 锁定 epee_red");
-            redDevice = new BLEAdvertisedDevice(advertisedDevice);
-            doConnectRed = true;
-        } 
-        else if (name == "epee_green" && !greenConnected && !doConnectGreen && greenRetryCount < MAX_CONNECT_RETRY) {
-            Serial.println(">>> 锁定 epee_green");
-            greenDevice = new BLEAdvertisedDevice(advertisedDevice);
-            doConnectGreen = true;
+        SideLink* link = nullptr;
+        if (name == redLink.name) link = &redLink;
+        else if (name == greenLink.name) link = &greenLink;
+        if (link == nullptr || link->state != LINK_IDLE) return;
+
+        Serial.printf(">>> 锁定 %s\n", link->name);
+        if (link->device != nullptr) delete link->device;
+        link->device = new BLEAdvertisedDevice(advertisedDevice);
+        link->state = LINK_FOUND;
+        if (linkTaskHandle != NULL) xTaskNotifyGive(linkTaskHandle);
+    }
+};
+
+// 扫描结束事件：记录时间，由链路任务决定何时开下一轮
+static void onScanComplete(BLEScanResults results) {
+    scanning = false;
+    lastScanEnd = millis();
+    BLEDevice::getScan()->clearResults();
+    if (linkTaskHandle != NULL) xTaskNotifyGive(linkTaskHandle);
+}
+
+// 断开事件：标记回到扫描，客户端对象由链路任务回收
+class LinkClientCallbacks : public BLEClientCallbacks {
+public:
+    explicit LinkClientCallbacks(SideLink* link) : m_link(link) {}
+    void onConnect(BLEClient* pClient) {}
+    void onDisconnect(BLEClient* pClient) {
+        if (m_link->state == LINK_ONLINE) {
+            m_link->state = LINK_IDLE;
+            m_link->stateSince = millis();
         }
+        if (linkTaskHandle != NULL) xTaskNotifyGive(linkTaskHandle);
     }
+private:
+    SideLink* m_link;
 };
 
-bool connectToDevice(BLEAdvertisedDevice* targetDevice, void (*callback)(BLERemoteCharacteristic*, uint8_t*, size_t, bool)) {
+// 连接 + 服务发现 + 订阅。只在链路任务里调用：协议栈等待期间链路任务阻塞，判定任务照常运行
+bool connectToDevice(SideLink* link) {
     Serial.print("正在连接: ");
-    Serial.println(targetDevice->getName().c_str());
+    Serial.println(link->device->getName().c_str());
     
+    static LinkClientCallbacks redClientCb(&redLink);
+    static LinkClientCallbacks greenClientCb(&greenLink);
     BLEClient* pClient = BLEDevice::createClient();
-    
-    // 给射频模块 100ms 喘息时间
-    delay(100); 
+    pClient->setClientCallbacks(link == &redLink ? &redClientCb : &greenClientCb);
 
-    if (!pClient->connect(targetDevice)) {
+    if (!pClient->connect(link->device)) {
         Serial.println("连接失败，等待下次扫描");
         pClient->disconnect();  // 新增：释放客户端，防止内存泄漏
         delete pClient;         // 新增：销毁对象，优化内存
@@ -233,19 +318,210 @@ bool connectToDevice(BLEAdvertisedDevice* targetDevice, void (*callback)(BLERemo
     }
     
     if (pRemoteChar->canNotify()) {
-        pRemoteChar->registerForNotify(callback);
+        pRemoteChar->registerForNotify(link->callback);
     }
+    link->client = pClient;
+    link->hitChar = pRemoteChar;
+    memcpy(link->bda, *link->device->getAddress().getNative(), sizeof(esp_bd_addr_t));
+    link->monitor.reset(millis());
+    link->level = LINK_LEVEL_OK;
+    link->lastProbe = millis();
     Serial.println("✅ 特征值订阅成功");
     return true;
 }
 
+// 推进一方的连接状态机，返回 true 表示这一步用掉了射频（本轮不再开扫描）
+static bool stepLink(SideLink* link) {
+    unsigned long now = millis();
+    switch (link->state) {
+        case LINK_FOUND:
+            // 停扫描后进入冷静期，不再用 delay 卡住整个 loop
+            Serial.printf(">>> 准备连接 %s [连续失败: %d]\n", link->name, link->retryCount);
+            if (scanning) {
+                BLEDevice::getScan()->stop();
+                scanning = false;
+                lastScanEnd = now;
+            }
+            link->state = LINK_SETTLING;
+            link->stateSince = now;
+            return true;
+
+        case LINK_SETTLING:
+            if (now - link->stateSince < LINK_SETTLE_MS) return true;
+            if (connectToDevice(link)) {
+                Serial.printf("[状态] ✅ %s 已上线\n", link->name);
+                link->retryCount = 0;
+                link->backoffMs = 0;
+                link->state = LINK_ONLINE;
+            } else {
+                // 不再设上限放弃：失败次数越多退避越长，一直找回来为止
+                link->retryCount++;
+                if (link->backoffMs == 0) link->backoffMs = RETRY_BACKOFF_MS;
+                else if (link->backoffMs < RETRY_BACKOFF_MAX_MS) link->backoffMs *= 2;
+                if (link->backoffMs > RETRY_BACKOFF_MAX_MS) link->backoffMs = RETRY_BACKOFF_MAX_MS;
+                Serial.printf("[错误] ❌ %s 连接失败 %d 次，%lums 后重新扫描\n", link->name, link->retryCount, link->backoffMs);
+                if (link->retryCount == MAX_CONNECT_RETRY) {
+                    Serial.println("==================================================");
+                    Serial.printf("⚠️ [警告] %s 连续 %d 次连接失败，请检查剑端电源/距离\n", link->name, MAX_CONNECT_RETRY);
+                    Serial.println("==================================================");
+                }
+                link->state = LINK_BACKOFF;
+            }
+            link->stateSince = millis();
+            return true;
+
+        case LINK_BACKOFF:
+            if (now - link->stateSince >= link->backoffMs) {
+                link->state = LINK_IDLE;
+                link->stateSince = now;
+            }
+            return false;
+
+        case LINK_IDLE:
+            // 断线后回收旧客户端，重新扫描
+            if (link->client != nullptr) {
+                Serial.printf("[状态] ⚠️ %s 已断开，重新扫描\n", link->name);
+                delete link->client;
+                link->client = nullptr;
+                link->hitChar = nullptr;
+            }
+            return false;
+
+        case LINK_ONLINE:
+        default:
+            return false;
+    }
+}
+
+// 连接参数更新事件（GAP）：记下实际的连接间隔/从机延迟/监督超时，用于链路评估
+static void linkGapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+    if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT || param->update_conn_params.status != ESP_BT_STATUS_SUCCESS) return;
+    SideLink* links[2] = {&redLink, &greenLink};
+    for (int i = 0; i < 2; i++) {
+        if (memcmp(param->update_conn_params.bda, links[i]->bda, sizeof(esp_bd_addr_t)) != 0) continue;
+        links[i]->monitor.setConnParams(param->update_conn_params.conn_int, param->update_conn_params.latency,
+                                        param->update_conn_params.timeout);
+    }
+}
+
+// 在线一方每 LINK_PING_MS 探测一次（RSSI + 读往返），等级变化时打印原因
+static void monitorLink(SideLink* link) {
+    if (link->state != LINK_ONLINE || link->client == nullptr || link->hitChar == nullptr) return;
+    unsigned long now = millis();
+    if (now - link->lastProbe < LINK_PING_MS) return;
+    link->lastProbe = now;
+
+    int rssi = link->client->getRssi();
+    if (rssi != 0) link->monitor.addRssi(rssi);
+    uint32_t t0 = millis();
+    bool ok = link->hitChar->readValue().length() > 0;
+    link->monitor.addPing(ok, millis() - t0, millis());
+
+    LinkMetrics m;
+    LinkLevel level = link->monitor.evaluate(millis(), m);
+    if (level != link->level) {
+        char why[64];
+        LinkMonitor::reasonText(m.reasons, why, sizeof(why));
+        Serial.printf("[链路质量] %s %s→%s %s (RSSI %d 往返%ums 静默%u%%)\n", link->name,
+                      LinkMonitor::levelName(link->level), LinkMonitor::levelName(level), why,
+                      m.rssiAvg, m.rttMaxMs, m.silencePct);
+        link->level = level;
+    }
+}
+
+// 任一在线方链路变差：提示层盖在连接状态上（边缘=呼吸，危险=快闪），恢复后撤销
+static void updateLinkAlertLed() {
+    uint8_t worst = LINK_LEVEL_OK;
+    if (redConnected && redLink.level > worst) worst = redLink.level;
+    if (greenConnected && greenLink.level > worst) worst = greenLink.level;
+    if (worst == ledAlertLevel) return;
+    ledAlertLevel = worst;
+    if (worst == LINK_LEVEL_CRITICAL) {
+        ledEngine.set(LED_LAYER_ALERT, LedEngine::blink(255, 255, 255, 3, 80, 80, 600));
+    } else if (worst == LINK_LEVEL_MARGINAL) {
+        ledEngine.set(LED_LAYER_ALERT, LedEngine::fade(255, 255, 255, 1000));
+    } else {
+        ledEngine.clear(LED_LAYER_ALERT);
+    }
+}
+
+// ===================== 链路任务（低优先级） =====================
+// 扫描、连接、服务发现都在这里按事件一步步推进；扫描回调 / 扫描结束 / 断开都会唤醒本任务
+void TaskLink(void* pvParameters) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+
+        bool busy = stepLink(&redLink);
+        busy = stepLink(&greenLink) || busy;
+        monitorLink(&redLink);
+        monitorLink(&greenLink);
+        updateLinkAlertLed();
+
+        // 有人不在线且射频空闲：每轮扫描结束后隔一段时间再开下一轮，不设次数上限
+        bool needScan = redLink.state == LINK_IDLE || greenLink.state == LINK_IDLE;
+        if (needScan && !busy && !scanning && millis() - lastScanEnd > SCAN_PAUSE_MS) {
+            Serial.println("[系统] 启动一轮新扫描");
+            scanning = true;
+            BLEDevice::getScan()->start(SCAN_SECONDS, onScanComplete, false); // 异步扫描，结束时回调
+        }
+    }
+}
+
+// ===================== 判定任务（高优先级，固定节拍） =====================
+// 判定窗口、按键、声光效果都在这里，链路任务阻塞在连接上时也按节拍运行
+void TaskJudge(void* pvParameters) {
+    bool lastNextState = HIGH;
+    bool lastResetState = HIGH;
+    unsigned long nextPressAt = 0;
+    unsigned long resetPressAt = 0;
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t expectUs = micros();
+
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(JUDGE_PERIOD_MS));
+
+        // 记录节拍抖动，串口 'j' 查看
+        expectUs += JUDGE_PERIOD_MS * 1000;
+        int32_t lateUs = (int32_t)(micros() - expectUs);
+        if (lateUs > (int32_t)judgeMaxLateUs) judgeMaxLateUs = lateUs;
+        if (lateUs < 0 || lateUs > 100000) expectUs = micros(); // 节拍被补齐或长时间挂起后重新对齐
+        judgeLoops++;
+
+        updateStatusLed();   // 维护连接状态灯
+        handleHitEffects();  // 维护击中后的声光效果
+
+        if (resetRequest != 0) {
+            resetMatch(resetRequest == 2);
+            resetRequest = 0;
+        }
+        feedHits();
+        judge.poll(); // 首击后 HIT_EVAL_DELAY_MS 出判定
+
+        unsigned long now = millis();
+
+        // 按键：按下后计时消抖，不再 delay
+        bool currNext = digitalRead(BTN_NEXT);
+        bool currReset = digitalRead(BTN_RESET);
+        if (lastNextState == HIGH && currNext == LOW) nextPressAt = now;
+        if (lastResetState == HIGH && currReset == LOW) resetPressAt = now;
+        if (nextPressAt != 0 && now - nextPressAt >= BTN_DEBOUNCE_MS) {
+            if (currNext == LOW) resetMatch(false);
+            nextPressAt = 0;
+        }
+        if (resetPressAt != 0 && now - resetPressAt >= BTN_DEBOUNCE_MS) {
+            if (currReset == LOW) resetMatch(true);
+            resetPressAt = 0;
+        }
+        lastNextState = currNext;
+        lastResetState = currReset;
+    }
+}
+
 void setup() {
     Serial.begin(115200);
-    scan_count = 0;
     pinMode(BTN_NEXT, INPUT_PULLUP); 
     pinMode(BTN_RESET, INPUT_PULLUP);
-    pinMode(LED_BOARD, OUTPUT);
-    digitalWrite(LED_BOARD, HIGH); // 初始灭灯
+    ledEngine.begin(LED_BACKEND_GPIO, LED_BOARD, true, 255, 0); // 低电平点亮，初始灭灯
 
     //击中的灯
     pinMode(PIN_RED_LED, OUTPUT);
@@ -259,107 +535,45 @@ void setup() {
     BLEDevice::init("epee_supmin");
     BLEScan* pBLEScan = BLEDevice::getScan();
     pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks());
+    BLEDevice::setCustomGapHandler(linkGapHandler);
     pBLEScan->setActiveScan(true); // 主动扫描
     pBLEScan->setInterval(100);    // 扫描间隔
     pBLEScan->setWindow(99);       // 扫描窗口接近间隔
 
+    // C3 单核：判定任务优先级高于链路任务和 loop，保证节拍
+    xTaskCreate(TaskJudge, "TaskJudge", 4096, NULL, 3, NULL);
+    xTaskCreate(TaskLink, "TaskLink", 8192, NULL, 1, &linkTaskHandle);
+
     Serial.println("[系统] 正在开启初始扫描...");
-    pBLEScan->start(5, false);     // 每次只扫5秒，扫完会停，这样最稳
+    scanning = true;
+    pBLEScan->start(SCAN_SECONDS, onScanComplete, false); // 每次只扫5秒，扫完回调，这样最稳
 }
 
+// loop 只处理串口命令，判定和连接都在各自任务里
 void loop() {
-    updateStatusLed();   // 维护连接状态灯
-    handleHitEffects();  // 维护击中后的声光效果
-
-    // --- 优化后的红方连接处理 + 重试计数+超次数提示 ---
-    if (doConnectRed && !redConnected && redRetryCount < MAX_CONNECT_RETRY) {
-        Serial.printf(">>> 准备连接红方 [当前重试次数: %d/%d] \n", redRetryCount+1, MAX_CONNECT_RETRY);
-        BLEDevice::getScan()->stop(); 
-        delay(500); // 关键：给底层协议栈 500ms 彻底退出的时间
-
-        if (connectToDevice(redDevice, redNotifyCallback)) {
-            Serial.println("[状态] ✅ epee_red 已上线");
-            redConnected = true;
-            redRetryCount = 0; // 连接成功，重置重试计数
-        } else {
-            redRetryCount++;   // 连接失败，重试计数+1
-            Serial.printf("[错误] ❌ 红方连接失败，剩余重试次数: %d\n", MAX_CONNECT_RETRY - redRetryCount);
-            
-            // 新增：红方超过10次连接失败
-            if(redRetryCount >= MAX_CONNECT_RETRY){
-                Serial.println("==================================================");
-                Serial.println("⚠️ [严重错误] epee_red 连接重试超过10次！建议重启设备恢复！");
-                Serial.println("==================================================");
-                doConnectRed = false;
-            }
-        }
-        doConnectRed = false; 
-    }
-
-    // --- 优化后的绿方连接处理 + 重试计数+超次数提示 ---
-    if (doConnectGreen && !greenConnected && greenRetryCount < MAX_CONNECT_RETRY) {
-        Serial.printf(">>> 准备连接绿方 [当前重试次数: %d/%d] \n", greenRetryCount+1, MAX_CONNECT_RETRY);
-        BLEDevice::getScan()->stop();
-        delay(500); // 关键：冷静期
-
-        if (connectToDevice(greenDevice, greenNotifyCallback)) {
-            Serial.println("[状态] ✅ epee_green 已上线");
-            greenConnected = true;
-            greenRetryCount = 0; // 连接成功，重置重试计数
-        } else {
-            greenRetryCount++;   // 连接失败，重试计数+1
-            Serial.printf("[错误] ❌ 绿方连接失败，剩余重试次数: %d\n", MAX_CONNECT_RETRY - greenRetryCount);
-            
-            // 新增：绿方超过10次连接失败
-            if(greenRetryCount >= MAX_CONNECT_RETRY){
-                Serial.println("==================================================");
-                Serial.println("⚠️ [严重错误] epee_green 连接重试超过10次！建议重启设备恢复！");
-                Serial.println("==================================================");
-                doConnectGreen = false;
-            }
+    if (Serial.available()) {
+        char cmd = Serial.read();
+        if (cmd == 'r') resetRequest = 2; // 判定引擎只在判定任务里动
+        if (cmd == 'n') resetRequest = 1;
+        if (cmd == 'j') {
+            Serial.printf("[判定] 节拍 %lums，已运行 %u 次，最大延迟 %uus\n",
+                          JUDGE_PERIOD_MS, (unsigned)judgeLoops, (unsigned)judgeMaxLateUs);
+            judgeMaxLateUs = 0;
         }
-        doConnectGreen = false;
-    }
-
-    // --- 核心逻辑：如果有人没连上+重试次数没超，就开启扫描 ---
-    static unsigned long scanTimer = 0;
-    if ((( !redConnected && redRetryCount < MAX_CONNECT_RETRY ) || ( !greenConnected && greenRetryCount < MAX_CONNECT_RETRY ) ) 
-    && scan_count <= MAX_SCAN_RETRY) {
-        if (!doConnectRed && !doConnectGreen) {
-            if (millis() - scanTimer > 2000) { // 每2秒检查一次是否需要重启扫描
-                Serial.printf("[系统] 启动一轮新扫描,扫描次数%d \n", scan_count);
-                scan_count ++;
-                BLEDevice::getScan()->start(5, false); // 扫5秒
-                scanTimer = millis();
+        if (cmd == 'q') {
+            SideLink* links[2] = {&redLink, &greenLink};
+            for (int i = 0; i < 2; i++) {
+                if (links[i]->state != LINK_ONLINE) {
+                    Serial.printf("[链路质量] %s 未连接\n", links[i]->name);
+                    continue;
+                }
+                LinkMetrics m;
+                links[i]->monitor.evaluate(millis(), m);
+                Serial.printf("[链路质量] %s %s RSSI 均%d 趋势%+d | 往返最大%ums 错过事件%u | 静默%u%% 探测失败%lu\n",
+                              links[i]->name, LinkMonitor::levelName(m.level), m.rssiAvg, m.rssiTrend,
+                              m.rttMaxMs, m.missedMax, m.silencePct, (unsigned long)m.pingFails);
             }
         }
     }
-
-    if (firstHitTime > 0 && !isLocked) {
-        if (millis() - firstHitTime > 45) evaluateHit();
-    }
-
-    if (Serial.available()) {
-        char cmd = Serial.read();
-        if (cmd == 'r') resetMatch(true);
-        if (cmd == 'n') resetMatch(false);
-    }
-
-    static bool lastNextState = HIGH;
-    static bool lastResetState = HIGH;
-    bool currNext = digitalRead(BTN_NEXT);
-    bool currReset = digitalRead(BTN_RESET);
-
-    if (lastNextState == HIGH && currNext == LOW) {
-        delay(50);
-        if (digitalRead(BTN_NEXT) == LOW) resetMatch(false);
-    }
-    if (lastResetState == HIGH && currReset == LOW) {
-        delay(50);
-        if (digitalRead(BTN_RESET) == LOW) resetMatch(true);
-    }
-    lastNextState = currNext;
-    lastResetState = currReset;
-
-    delay(1); 
+    vTaskDelay(pdMS_TO_TICKS(20));
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "AppStateChannel.h"
+#include <string.h>
+
+AppStateChannel::AppStateChannel()
+  : m_dirty(APP_FIELD_ALL)
+  , m_seq(0)
+  , m_updates(0)
+  , m_frames(0) {
+  memset(&m_state, 0, sizeof(m_state));
+  memset(&m_sent, 0, sizeof(m_sent));
+  m_state.timerSec = APP_TIMER_NONE;
+  m_sent.timerSec = APP_TIMER_NONE;
+}
+
+void AppStateChannel::update(const AppState& st) {
+  uint8_t changed = 0;
+  if (st.redScore != m_sent.redScore) changed |= APP_FIELD_RED_SCORE;
+  if (st.grnScore != m_sent.grnScore) changed |= APP_FIELD_GRN_SCORE;
+  if (st.lamps != m_sent.lamps) changed |= APP_FIELD_LAMPS;
+  if (st.timerSec != m_sent.timerSec) changed |= APP_FIELD_TIMER;
+  if (st.phase != m_sent.phase) changed |= APP_FIELD_PHASE;
+
+  if (changed != 0) m_updates++;
+  m_state = st;
+  // 已标记的字段保留（包括 resync），变回原值的字段也照发一次，帧里总是最新值
+  m_dirty |= changed;
+}
+
+size_t AppStateChannel::pack(uint8_t* buf, uint8_t type, uint8_t seq, uint8_t fields, const AppState& st) {
+  size_t n = 0;
+  buf[n++] = type;
+  buf[n++] = seq;
+  buf[n++] = fields;
+  if (fields & APP_FIELD_RED_SCORE) buf[n++] = st.redScore;
+  if (fields & APP_FIELD_GRN_SCORE) buf[n++] = st.grnScore;
+  if (fields & APP_FIELD_LAMPS) buf[n++] = st.lamps;
+  if (fields & APP_FIELD_TIMER) {
+    buf[n++] = (uint8_t)(st.timerSec & 0xFF);
+    buf[n++] = (uint8_t)(st.timerSec >> 8);
+  }
+  if (fields & APP_FIELD_PHASE) buf[n++] = st.phase;
+  return n;
+}
+
+size_t AppStateChannel::buildDelta(uint8_t* buf) {
+  if (m_dirty == 0) return 0;
+  m_seq++;
+  size_t n = pack(buf, APP_FRAME_DELTA, m_seq, m_dirty, m_state);
+  m_sent = m_state;
+  m_dirty = 0;
+  m_frames++;
+  return n;
+}
+
+size_t AppStateChannel::buildFull(uint8_t* buf) const {
+  // 全量帧反映最新状态，序号取已发出的最后一帧：之后的增量序号都比它新
+  return pack(buf, APP_FRAME_FULL, m_seq, APP_FIELD_ALL, m_state);
+}
\ No newline at end of file
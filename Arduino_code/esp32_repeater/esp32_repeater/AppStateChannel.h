@@ -0,0 +1,85 @@
+#ifndef APP_STATE_CHANNEL_H
+#define APP_STATE_CHANNEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 小程序二进制状态帧：只发变化的字段，同一连接间隔内的多次变化合并成一帧
+// 不依赖 Arduino.h，主机端可直接编译验证
+//
+// 帧格式（小端）：
+//   [0] 类型   APP_FRAME_FULL / APP_FRAME_DELTA
+//   [1] 序号   每发一帧增量 +1（8位回绕），全量帧带当前序号不递增
+//   [2] 字段位 APP_FIELD_*，按位从低到高依次跟随字段值
+//   红分 u8 | 绿分 u8 | 灯 u8 | 计时剩余秒 u16 | 阶段 u8
+// 小程序断线重连后先读全量帧，之后只应用序号比它新的增量帧
+
+#define APP_FRAME_FULL     0x01
+#define APP_FRAME_DELTA    0x02
+#define APP_FRAME_MAX_LEN  9       // 3字节头 + 6字节字段，默认 MTU(23) 一包装得下
+#define APP_TIMER_NONE     0xFFFF  // 本机没有计时器
+
+enum AppField {
+  APP_FIELD_RED_SCORE = 0x01,
+  APP_FIELD_GRN_SCORE = 0x02,
+  APP_FIELD_LAMPS     = 0x04,
+  APP_FIELD_TIMER     = 0x08,
+  APP_FIELD_PHASE     = 0x10,
+  APP_FIELD_ALL       = 0x1F
+};
+
+// 灯状态位
+#define APP_LAMP_RED       0x01  // 红方击中灯亮（未确认）
+#define APP_LAMP_GRN       0x02  // 绿方击中灯亮（未确认）
+#define APP_LAMP_RED_LINK  0x04  // 红方剑已连接
+#define APP_LAMP_GRN_LINK  0x08  // 绿方剑已连接
+
+enum AppPhase {
+  APP_PHASE_IDLE = 0,
+  APP_PHASE_RED_HIT,
+  APP_PHASE_GRN_HIT,
+  APP_PHASE_DOUBLE,
+  APP_PHASE_SCANNING
+};
+
+struct AppState {
+  uint8_t redScore;
+  uint8_t grnScore;
+  uint8_t lamps;
+  uint16_t timerSec;
+  uint8_t phase;
+};
+
+class AppStateChannel {
+public:
+  AppStateChannel();
+
+  // 记录最新状态，和上次发出的比较，标记变化字段（不发送）
+  void update(const AppState& st);
+
+  // 下一帧增量带全部字段（小程序重连后调用）
+  void resync() { m_dirty = APP_FIELD_ALL; }
+
+  bool pending() const { return m_dirty != 0; }
+
+  // 打包变化字段为一帧增量，返回长度；没有变化返回 0
+  size_t buildDelta(uint8_t* buf);
+
+  // 打包全量帧（供读特征值重新同步），不影响待发的增量
+  size_t buildFull(uint8_t* buf) const;
+
+  uint32_t updates() const { return m_updates; }  // 调用 update 且有变化的次数
+  uint32_t frames() const { return m_frames; }    // 实际发出的增量帧数
+
+private:
+  AppState m_state;    // 最新状态
+  AppState m_sent;     // 小程序已收到的状态
+  uint8_t m_dirty;     // 待发字段位
+  uint8_t m_seq;       // 最近一帧增量的序号
+  uint32_t m_updates;
+  uint32_t m_frames;
+
+  static size_t pack(uint8_t* buf, uint8_t type, uint8_t seq, uint8_t fields, const AppState& st);
+};
+
+#endif // APP_STATE_CHANNEL_H
\ No newline at end of file
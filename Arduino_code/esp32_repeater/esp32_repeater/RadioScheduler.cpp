@@ -0,0 +1,120 @@
+#include "RadioScheduler.h"
+#include <string.h>
+
+RadioScheduler::RadioScheduler()
+  : m_scanning(false)
+  , m_scanSince(0)
+  , m_pointerSeen(false)
+  , m_lastPointerMs(0)
+  , m_statsSince(0) {
+  memset(m_up, 0, sizeof(m_up));
+  memset(m_intervalMs, 0, sizeof(m_intervalMs));
+  memset(m_latency, 0, sizeof(m_latency));
+  memset(&m_scanPlan, 0, sizeof(m_scanPlan));
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void RadioScheduler::setLink(uint8_t id, bool up) {
+  if (id >= RADIO_LINK_COUNT) return;
+  m_up[id] = up;
+  if (!up) {
+    m_intervalMs[id] = 0; // 下次连接重新上报
+    m_latency[id] = 0;
+  }
+}
+
+void RadioScheduler::setConnParams(uint8_t id, uint16_t interval, uint16_t latency) {
+  if (id >= RADIO_LINK_COUNT) return;
+  uint32_t ms = ((uint32_t)interval * 5 + 3) / 4;
+  m_intervalMs[id] = ms > 0 ? (uint16_t)ms : 1;
+  m_latency[id] = latency;
+}
+
+bool RadioScheduler::shouldScan(bool targetPending) const {
+  if (m_up[RADIO_LINK_RED] && m_up[RADIO_LINK_GRN]) return false;
+  return targetPending;
+}
+
+RadioScanPlan RadioScheduler::plan() const {
+  RadioScanPlan p;
+  int links = 0;
+  uint16_t shortest = 0xFFFF;
+  for (int i = 0; i < RADIO_LINK_COUNT; i++) {
+    if (!m_up[i]) continue;
+    links++;
+    uint16_t t = m_intervalMs[i] > 0 ? m_intervalMs[i] : RADIO_DEFAULT_INTERVAL_MS;
+    if (t < shortest) shortest = t;
+  }
+  if (links == 0) {
+    p.intervalMs = RADIO_IDLE_INTERVAL_MS;
+    p.windowMs = RADIO_IDLE_WINDOW_MS;
+    return p;
+  }
+  // 窗口短于最短连接间隔，任何一个间隔里都有连接事件能排进去
+  uint16_t window = shortest > RADIO_GUARD_MS + RADIO_MIN_WINDOW_MS ? shortest - RADIO_GUARD_MS : RADIO_MIN_WINDOW_MS;
+  uint32_t duty = links == 1 ? RADIO_DUTY_ONE_LINK_PCT : RADIO_DUTY_MULTI_LINK_PCT;
+  uint32_t interval = ((uint32_t)window * 100 + duty - 1) / duty;
+  if (interval > RADIO_MAX_INTERVAL_MS) interval = RADIO_MAX_INTERVAL_MS;
+  if (interval < window) interval = window;
+  p.intervalMs = (uint16_t)interval;
+  p.windowMs = window;
+  return p;
+}
+
+void RadioScheduler::closeScan(uint32_t nowMs) {
+  if (!m_scanning) return;
+  uint32_t on = nowMs - m_scanSince;
+  m_stats.scanMs += on;
+  if (m_scanPlan.intervalMs > 0) m_stats.scanAirMs += on * m_scanPlan.windowMs / m_scanPlan.intervalMs;
+  m_scanning = false;
+}
+
+void RadioScheduler::scanStarted(const RadioScanPlan& p, uint32_t nowMs) {
+  closeScan(nowMs);
+  m_scanning = true;
+  m_scanPlan = p;
+  m_scanSince = nowMs;
+  m_stats.scanSlices++;
+}
+
+void RadioScheduler::scanStopped(uint32_t nowMs) {
+  closeScan(nowMs);
+}
+
+void RadioScheduler::pointerNotified(uint32_t nowMs) {
+  m_pointerSeen = true;
+  m_lastPointerMs = nowMs;
+  m_stats.pointerNotifies++;
+}
+
+bool RadioScheduler::pointerBusy(uint32_t nowMs) const {
+  return m_pointerSeen && nowMs - m_lastPointerMs < RADIO_POINTER_QUIET_MS;
+}
+
+// 读往返正常一到两个连接间隔完成，多出来的按错过的连接事件计
+void RadioScheduler::addProbe(uint8_t id, uint32_t rttMs) {
+  if (id >= RADIO_LINK_COUNT) return;
+  uint32_t interval = m_intervalMs[id] > 0 ? m_intervalMs[id] : RADIO_DEFAULT_INTERVAL_MS;
+  uint32_t events = (rttMs + interval - 1) / interval;
+  uint32_t allowed = 2 + m_latency[id];
+  uint32_t missed = events > allowed ? events - allowed : 0;
+  m_stats.probes++;
+  m_stats.missedEvents += missed;
+  if (missed > m_stats.missedMax) m_stats.missedMax = missed > 0xFFFF ? 0xFFFF : (uint16_t)missed;
+}
+
+void RadioScheduler::stats(RadioStats& out, uint32_t nowMs) const {
+  out = m_stats;
+  out.elapsedMs = nowMs - m_statsSince;
+  if (m_scanning) {
+    uint32_t on = nowMs - (m_scanSince > m_statsSince ? m_scanSince : m_statsSince);
+    out.scanMs += on;
+    if (m_scanPlan.intervalMs > 0) out.scanAirMs += on * m_scanPlan.windowMs / m_scanPlan.intervalMs;
+  }
+}
+
+void RadioScheduler::resetStats(uint32_t nowMs) {
+  memset(&m_stats, 0, sizeof(m_stats));
+  m_statsSince = nowMs;
+  if (m_scanning) m_scanSince = nowMs; // 正在扫的片从这里重新计
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef RADIO_SCHEDULER_H
+#define RADIO_SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 计分端射频时间调度：本机同时是中心（连红/绿剑端）和外设（服务小程序），三条连接和扫描共用一个射频
+//   扫描按 RADIO_SLICE_S 秒一片启动，片间按当前连接重新规划窗口：
+//     没有连接时沿用 100ms/90ms；有连接时窗口比最短连接间隔少 RADIO_GUARD_MS，
+//     占空比按连接数压到 RADIO_DUTY_*，保证每条连接在一个间隔内至少有空档；两把剑都在线时不扫描
+//   剑端通知优先：收到后 RADIO_POINTER_QUIET_MS 内小程序/广播/汇总更新推迟，互中窗口内只收不发
+//   统计扫描实际占用的射频时间比例，和用读往返估算的错过连接事件
+// 不依赖 Arduino.h，时间由调用方传入，主机端可直接编译验证
+
+#define RADIO_SLICE_S               1      // 扫描片长度（秒）
+#define RADIO_IDLE_INTERVAL_MS      100    // 没有任何连接时的扫描参数
+#define RADIO_IDLE_WINDOW_MS        90
+#define RADIO_GUARD_MS              3      // 扫描窗口给连接事件留的余量
+#define RADIO_MIN_WINDOW_MS         3
+#define RADIO_MAX_INTERVAL_MS       1000
+#define RADIO_DUTY_ONE_LINK_PCT     40     // 有一条连接时扫描占空比上限
+#define RADIO_DUTY_MULTI_LINK_PCT   20     // 两条及以上
+#define RADIO_DEFAULT_INTERVAL_MS   15     // 还没拿到连接参数时假定的连接间隔
+#define RADIO_POINTER_QUIET_MS      50     // 剑端通知后推迟小程序更新（大于互中窗口 40ms）
+#define RADIO_PROBE_MS              1000   // 剑端读往返探测周期（计分端在低优先级任务里读）
+#define RADIO_STATS_MS              30000  // 统计打印周期
+
+enum RadioLinkId {
+  RADIO_LINK_RED = 0,
+  RADIO_LINK_GRN,
+  RADIO_LINK_APP,
+  RADIO_LINK_COUNT
+};
+
+struct RadioScanPlan {
+  uint16_t intervalMs;
+  uint16_t windowMs;
+};
+
+struct RadioStats {
+  uint32_t elapsedMs;        // 统计区间长度
+  uint32_t scanMs;           // 扫描开着的时间
+  uint32_t scanAirMs;        // 其中窗口实际占用射频的时间（按窗口/间隔折算）
+  uint32_t scanSlices;
+  uint32_t probes;
+  uint32_t missedEvents;     // 估算错过的连接事件累计
+  uint16_t missedMax;        // 单次往返错过的最大值
+  uint32_t pointerNotifies;
+  uint32_t appDeferred;      // 因剑端通知推迟小程序更新的轮次
+};
+
+class RadioScheduler {
+public:
+  RadioScheduler();
+
+  void setLink(uint8_t id, bool up);
+  // 连接参数（协议栈事件）：间隔单位 1.25ms
+  void setConnParams(uint8_t id, uint16_t interval, uint16_t latency);
+  bool linkUp(uint8_t id) const { return id < RADIO_LINK_COUNT && m_up[id]; }
+
+  // 还有剑端要连才扫；两把剑都在线时一律不扫
+  bool shouldScan(bool targetPending) const;
+  RadioScanPlan plan() const;
+
+  // 扫描片开始/扫描停止时记账
+  void scanStarted(const RadioScanPlan& p, uint32_t nowMs);
+  void scanStopped(uint32_t nowMs);
+
+  // 剑端通知到达；之后 RADIO_POINTER_QUIET_MS 内 pointerBusy 为真
+  void pointerNotified(uint32_t nowMs);
+  bool pointerBusy(uint32_t nowMs) const;
+  void appDeferred() { m_stats.appDeferred++; }
+
+  // 读往返（毫秒）折算错过的连接事件（从机延迟允许跳过的不算）
+  void addProbe(uint8_t id, uint32_t rttMs);
+
+  void stats(RadioStats& out, uint32_t nowMs) const;
+  void resetStats(uint32_t nowMs);
+
+private:
+  bool m_up[RADIO_LINK_COUNT];
+  uint16_t m_intervalMs[RADIO_LINK_COUNT];   // 0=未知
+  uint16_t m_latency[RADIO_LINK_COUNT];
+  bool m_scanning;
+  RadioScanPlan m_scanPlan;
+  uint32_t m_scanSince;
+  bool m_pointerSeen;
+  uint32_t m_lastPointerMs;
+  uint32_t m_statsSince;
+  RadioStats m_stats;
+
+  void closeScan(uint32_t nowMs);
+};
+
+#endif // RADIO_SCHEDULER_H
\ No newline at end of file
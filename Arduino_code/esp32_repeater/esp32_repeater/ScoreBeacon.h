@@ -0,0 +1,44 @@
+#ifndef SCORE_BEACON_H
+#define SCORE_BEACON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AppStateChannel.h"
+
+// 无连接比分广播：比分/灯/计时/阶段放进广播包的厂商数据，观众手机、副屏只需被动扫描
+// 不依赖 Arduino.h，主机端解码工具直接包含本文件
+//
+// 厂商数据（AD 类型 0xFF）内容，小端：
+//   [0..1] 厂商ID 0xFFFF（测试用，未分配）
+//   [2]    标识 0xE9   [3] 版本 1
+//   [4]    序号（状态变化 +1，8位回绕；扫描端据此去重/判断丢包）
+//   [5] 红分  [6] 绿分  [7] 灯（APP_LAMP_*）  [8..9] 计时剩余秒  [10] 阶段（AppPhase）
+
+#define BEACON_COMPANY_ID   0xFFFF
+#define BEACON_MAGIC        0xE9
+#define BEACON_VERSION      1
+#define BEACON_DATA_LEN     11     // 厂商数据长度（不含 AD 长度/类型两字节）
+#define BEACON_MIN_UPDATE_MS 100   // 广播内容最快 100ms 换一次，和广播间隔同量级
+
+class ScoreBeacon {
+public:
+  ScoreBeacon();
+
+  // 状态有变化时序号 +1 并返回 true（调用方据此刷新广播数据）
+  bool update(const AppState& st);
+
+  // 打包厂商数据，返回长度 BEACON_DATA_LEN
+  size_t build(uint8_t* buf) const;
+
+  // 解析厂商数据，不是本格式返回 false
+  static bool parse(const uint8_t* data, size_t len, uint8_t& seq, AppState& out);
+
+  uint8_t seq() const { return m_seq; }
+
+private:
+  AppState m_state;
+  uint8_t m_seq;
+  bool m_valid;   // 已有一次状态
+};
+
+#endif // SCORE_BEACON_H
\ No newline at end of file
@@ -6,6 +6,14 @@
 #include <BLEServer.h>
 #include <BLECharacteristic.h>
 #include <BLE2902.h>
+#include "AppStateChannel.h"
+#include "ScoreBeacon.h"
+#include "HubFrame.h"
+#include "RadioScheduler.h"
+#include "EpeeJudge.h"
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
 
 // ✅【修复】ESP32-C3 专属合法引脚定义 (全部可用，无GPIO20/21/12)
 #define LED_APP_CONN  2   // 小程序连接指示灯
@@ -27,15 +35,51 @@
 #define BLE_SLAVE_NAME "epee"
 #define UUID_SLAVE_SRV "12345678-1234-5678-1234-56789abcdef0"
 #define UUID_SLAVE_CHAR "87654321-4321-8765-4321-0fedcba987654"
+#define UUID_STATE_CHAR "87654321-4321-8765-4321-0fedcba98701" // 二进制状态增量（Notify）
+#define UUID_SNAP_CHAR  "87654321-4321-8765-4321-0fedcba98702" // 二进制全量状态（Read，重连后同步）
 
 // 核心全局变量
 BLEServer* pServer = nullptr;
 BLECharacteristic* pChar = nullptr;
 bool appConn = false;
 
+// 二进制状态通道：旧文本特征值保留给旧版小程序（未订阅则不发）
+BLECharacteristic* pStateChar = nullptr;
+BLECharacteristic* pSnapChar = nullptr;
+AppStateChannel appChannel;
+portMUX_TYPE appChannelMux = portMUX_INITIALIZER_UNLOCKED; // 读回调在蓝牙任务里
+uint32_t appConnIntervalMs = 30;  // 小程序连接间隔，每个间隔最多推一帧
+unsigned long lastAppFlush = 0;
+
+// 无连接比分广播：小程序连上后改为不可连接广播继续发，观众端被动扫描即可
+BLEAdvertising* pAdv = nullptr;
+ScoreBeacon scoreBeacon;
+unsigned long lastBeaconUpdate = 0;
+
+// 赛场汇总：ESP-NOW 广播比分状态和判定结果（汇总中心见 tournament_hub）
+// 默认关闭：ESP32-C3 只有一个射频，Wi-Fi 常开会挤占三条蓝牙连接和扫描的时间；接了汇总中心再打开
+#define HUB_ENABLE    0
+#define HUB_PISTE     2     // 本机剑道号，每台计分端改成不同的号
+static const uint8_t HUB_BROADCAST[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+bool hubReady = false;
+uint16_t hubSeq = 0;
+AppState hubLast;
+unsigned long hubLastSend = 0;
+
+// 射频时间调度：扫描分片按连接规划窗口，剑端通知优先于小程序更新（见 RadioScheduler.h）
+RadioScheduler radio;
+portMUX_TYPE radioMux = portMUX_INITIALIZER_UNLOCKED; // 通知回调/GAP 事件在蓝牙任务里
+volatile bool scanSliceActive = false;                // 当前扫描片未结束
+volatile bool appTextPending = false;                 // 文本特征值待推送（等剑端通知空档）
+esp_bd_addr_t linkBda[RADIO_LINK_COUNT];              // 匹配连接参数更新事件
+SemaphoreHandle_t probeLock = nullptr;                // 探测任务读特征值期间主循环不能删除客户端
+BLEClient* probeClient[2] = {nullptr, nullptr};       // 读往返探测目标（红/绿），由 radioProbeSet 登记
+BLERemoteCharacteristic* probeChar[2] = {nullptr, nullptr};
+unsigned long lastRadioStats = 0;
+
 // 核心参数
-const int DOUBLE_HIT = 40;
-const int BUZZ_HIT = 500;
+const int DOUBLE_HIT = 40;      // 互中窗口（判定引擎 EpeeJudge.h）
+const int BUZZ_HIT = 500;       // 判定后同时作为自动解锁时间：本机没有下一剑按键
 const int BUZZ_CONF = 100;
 const uint32_t CONN_TIMEOUT = 10000;
 const unsigned long KEY_DEB = 200;
@@ -66,8 +110,20 @@ bool grnHit = false;
 bool doubleHit = false;
 int redScore = 0;
 int grnScore = 0;
-unsigned long lastHit = 0;
-String lastSide = "";
+
+// 判定引擎（EpeeJudge.h，各主机目标共用）：击中回调只登记到达时间，主循环喂给引擎并出判定
+// 两把剑的时钟互不相关，按本机到达时间判定（帧里的 time: 只做格式校验）
+portMUX_TYPE hitMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool hitPending[2] = {false, false};
+uint32_t hitPendingMs[2] = {0, 0};
+void applyVerdict(const JudgeVerdict& v);
+struct MillisClock {
+  uint32_t now() const { return millis(); }
+};
+struct VerdictSink {
+  void onVerdict(const JudgeVerdict& v) { applyVerdict(v); }
+};
+EpeeJudge<MillisClock, VerdictSink> judge(MillisClock(), VerdictSink(), DOUBLE_HIT, JUDGE_EVAL_DELAY_MS, BUZZ_HIT);
 
 // 击中来源标识-解决currSide冲突问题
 struct HitSource {
@@ -80,10 +136,17 @@ ConnectTarget currTgt = NONE;
 
 // 函数前置声明
 void setupBleNotify(BLEClient* pClient, bool isRedSide);
+void radioProbeSet(int side, BLEClient* client, BLERemoteCharacteristic* ch);
 void scanStart();
 void scanStop();
 void sendToApp();
+void serviceAppText();
+void radioSetLink(uint8_t id, bool up, const uint8_t* bda);
+void flushAppState();
+void updateBeacon();
+void startAppAdvertising(bool connectable);
 void sysReset();
+void serviceJudge();
 static void hitCb(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify, bool isRed);
 
 // BLE从机回调-小程序连接/断开
@@ -92,12 +155,37 @@ class MyServerCb : public BLEServerCallbacks {
     appConn = true;
     digitalWrite(LED_APP_CONN, HIGH);
     Serial.println("✅ 小程序已连接");
+    startAppAdvertising(false); // 连接期间继续广播比分，但不再接受连接
+  }
+  void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    // 连接间隔单位 1.25ms
+    appConnIntervalMs = (param->connect.conn_params.interval * 5) / 4;
+    if (appConnIntervalMs == 0) appConnIntervalMs = 30;
+    radioSetLink(RADIO_LINK_APP, true, param->connect.remote_bda);
+    portENTER_CRITICAL(&radioMux);
+    radio.setConnParams(RADIO_LINK_APP, param->connect.conn_params.interval, param->connect.conn_params.latency);
+    portEXIT_CRITICAL(&radioMux);
+    portENTER_CRITICAL(&appChannelMux);
+    appChannel.resync();
+    portEXIT_CRITICAL(&appChannelMux);
   }
   void onDisconnect(BLEServer* pServer) {
     appConn = false;
+    radioSetLink(RADIO_LINK_APP, false, nullptr);
     digitalWrite(LED_APP_CONN, LOW);
     Serial.println("❌ 小程序断开，重启广播");
-    BLEDevice::startAdvertising();
+    startAppAdvertising(true);
+  }
+};
+
+// 全量状态读回调-小程序重连后先读这里，再按序号应用增量
+class SnapReadCb : public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* pCharacteristic) {
+    uint8_t buf[APP_FRAME_MAX_LEN];
+    portENTER_CRITICAL(&appChannelMux);
+    size_t n = appChannel.buildFull(buf);
+    portEXIT_CRITICAL(&appChannelMux);
+    pCharacteristic->setValue(buf, n);
   }
 };
 
@@ -111,6 +199,7 @@ class MyScanCb : public BLEAdvertisedDeviceCallbacks {
       Serial.println("🔴 正在连接红方设备...");
       pRed = BLEDevice::createClient();
       if (pRed->connect(&dev)) {
+        radioSetLink(RADIO_LINK_RED, true, *dev.getAddress().getNative());
         setupBleNotify(pRed, true);
         scanStop();
         digitalWrite(LED_BLUE1, HIGH);
@@ -128,6 +217,7 @@ class MyScanCb : public BLEAdvertisedDeviceCallbacks {
       Serial.println("🟢 正在连接绿方设备...");
       pGreen = BLEDevice::createClient();
       if (pGreen->connect(&dev)) {
+        radioSetLink(RADIO_LINK_GRN, true, *dev.getAddress().getNative());
         setupBleNotify(pGreen, false);
         scanStop();
         digitalWrite(LED_BLUE2, HIGH);
@@ -143,56 +233,63 @@ class MyScanCb : public BLEAdvertisedDeviceCallbacks {
   }
 };
 
-// ✅【修复】击中回调函数 - 新增isRed参数，彻底解决击中来源冲突
-static void hitCb(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify, bool isRed) {
-  String data = String((char*)pData).substring(0, len);
-  String side = isRed ? "RED" : "GRN";
-  Serial.printf("⚡ %s击中：%s\n", side.c_str(), data.c_str());
+// 击中帧须带 time: 字段
+static bool hitFrameValid(const uint8_t* data, size_t len) {
+  for (size_t i = 0; data != nullptr && i + 5 <= len; i++) {
+    if (memcmp(data + i, "time:", 5) == 0) return true;
+  }
+  return false;
+}
 
-  int tStart = data.indexOf("time:") + 5;
-  int tEnd = data.indexOf("|");
-  if (tStart == 4 || tEnd == -1) {
+// 击中回调（蓝牙任务）：只登记到达时间，判定在主循环里
+static void hitCb(BLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify, bool isRed) {
+  unsigned long now = millis();
+  portENTER_CRITICAL(&radioMux);
+  radio.pointerNotified(now);
+  portEXIT_CRITICAL(&radioMux);
+  Serial.printf("⚡ %s击中：%.*s\n", isRed ? "RED" : "GRN", (int)len, (const char*)pData);
+  if (!hitFrameValid(pData, len)) {
     Serial.println("❌ 击中数据格式错误");
     return;
   }
-  unsigned long hitTime = data.substring(tStart, tEnd).toInt();
-
-  buzzHit = true;
-  lastBuzzHit = millis();
-  redHit = false;
-  grnHit = false;
-  doubleHit = false;
+  int side = isRed ? JUDGE_RED : JUDGE_GREEN;
+  portENTER_CRITICAL(&hitMux);
+  if (!hitPending[side]) {
+    hitPendingMs[side] = now;
+    hitPending[side] = true;
+  }
+  portEXIT_CRITICAL(&hitMux);
+}
 
-  // 互中判定逻辑
-  if (lastHit != 0 && lastSide != "" && lastSide != side) {
-    unsigned long diff = hitTime - lastHit;
-    if (diff <= DOUBLE_HIT) {
-      doubleHit = true;
-      redHit = true;
-      grnHit = true;
-      redScore++;
-      grnScore++;
-      Serial.printf("💥 互中判定！红方:%d 绿方:%d\n", redScore, grnScore);
-      sendToApp();
-      lastHit = 0;
-      lastSide = "";
-      return;
-    }
+// 取走回调登记的击中喂给判定引擎，到期出判定
+void serviceJudge() {
+  for (int side = JUDGE_RED; side <= JUDGE_GREEN; side++) {
+    portENTER_CRITICAL(&hitMux);
+    bool pending = hitPending[side];
+    uint32_t at = hitPendingMs[side];
+    hitPending[side] = false;
+    portEXIT_CRITICAL(&hitMux);
+    if (pending) judge.hit(side, at);
   }
+  judge.poll();
+}
 
-  // 单方击中计分
-  if (isRed) {
-    redHit = true;
-    redScore++;
+// 判定结果（引擎回调）：计分、蜂鸣、推送小程序
+void applyVerdict(const JudgeVerdict& v) {
+  buzzHit = true;
+  lastBuzzHit = millis();
+  redHit = v.red;
+  grnHit = v.green;
+  doubleHit = v.red && v.green;
+  if (v.red) redScore++;
+  if (v.green) grnScore++;
+  if (doubleHit) {
+    Serial.printf("💥 互中判定！红方:%d 绿方:%d (差%dms)\n", redScore, grnScore, (int)v.redMinusGreenMs);
+  } else if (v.red) {
     Serial.printf("🔴 红方有效击中！红:%d 绿:%d\n", redScore, grnScore);
   } else {
-    grnHit = true;
-    grnScore++;
     Serial.printf("🟢 绿方有效击中！红:%d 绿:%d\n", redScore, grnScore);
   }
-
-  lastHit = hitTime;
-  lastSide = side;
   sendToApp();
 }
 
@@ -321,6 +418,7 @@ void setupBleNotify(BLEClient* pClient, bool isRedSide) {
   BLERemoteService* pSrv = pClient->getService(UUID_MASTER_SRV);
   if (pSrv == nullptr) {Serial.println("❌ 找不到主服务UUID"); return;}
   BLERemoteCharacteristic* pChar = pSrv->getCharacteristic(UUID_MASTER_CHAR);
+  radioProbeSet(isRedSide ? 0 : 1, pClient, pChar);
   if (pChar != nullptr) {
     if(isRedSide){
       pChar->registerForNotify([](BLERemoteCharacteristic* pChar, uint8_t* pData, size_t len, bool isNotify) {
@@ -334,17 +432,34 @@ void setupBleNotify(BLEClient* pClient, bool isRedSide) {
   }
 }
 
+// 扫描片结束（蓝牙任务回调）：主循环按最新连接情况规划下一片
+static void scanSliceDone(BLEScanResults results) {
+  scanSliceActive = false;
+}
+
+// 启动一片扫描：窗口/间隔按当前连接规划，非阻塞
+static void scanSlice() {
+  portENTER_CRITICAL(&radioMux);
+  RadioScanPlan p = radio.plan();
+  portEXIT_CRITICAL(&radioMux);
+  pScan->setInterval(p.intervalMs);
+  pScan->setWindow(p.windowMs);
+  scanSliceActive = true;
+  if (!pScan->start(RADIO_SLICE_S, scanSliceDone, false)) {
+    scanSliceActive = false;
+    return;
+  }
+  portENTER_CRITICAL(&radioMux);
+  radio.scanStarted(p, millis());
+  portEXIT_CRITICAL(&radioMux);
+}
+
 // BLE扫描启动
 void scanStart() {
   if (scanning) return;
-  pScan = BLEDevice::getScan();
-  pScan->setAdvertisedDeviceCallbacks(new MyScanCb());
-  pScan->setActiveScan(true);
-  pScan->setInterval(100);
-  pScan->setWindow(90);
-  pScan->start(0);
   scanning = true;
   scanStartTime = millis();
+  scanSlice();
   Serial.println("🔍 BLE扫描已启动！");
 }
 
@@ -353,28 +468,118 @@ void scanStop() {
   if (!scanning) return;
   pScan->stop();
   scanning = false;
+  scanSliceActive = false;
+  portENTER_CRITICAL(&radioMux);
+  radio.scanStopped(millis());
+  portEXIT_CRITICAL(&radioMux);
   Serial.println("🛑 BLE扫描已停止！");
 }
 
+// 扫描片之间：目标已连上或两把剑都在线就停，否则按新规划接着扫
+void serviceScan() {
+  if (!scanning) return;
+  bool pending = (currTgt == RED && pRed == nullptr) || (currTgt == GRN && pGreen == nullptr);
+  portENTER_CRITICAL(&radioMux);
+  bool want = radio.shouldScan(pending);
+  portEXIT_CRITICAL(&radioMux);
+  if (!want) {
+    scanStop();
+    return;
+  }
+  if (!scanSliceActive) scanSlice();
+}
+
+// 连接上下线：记地址用于匹配连接参数事件
+void radioSetLink(uint8_t id, bool up, const uint8_t* bda) {
+  portENTER_CRITICAL(&radioMux);
+  radio.setLink(id, up);
+  if (bda != nullptr) memcpy(linkBda[id], bda, sizeof(esp_bd_addr_t));
+  portEXIT_CRITICAL(&radioMux);
+}
+
+// 连接参数更新事件（GAP）：剑端请求的间隔/从机延迟、小程序协商后的间隔
+static void radioGapHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (event != ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT || param->update_conn_params.status != ESP_BT_STATUS_SUCCESS) return;
+  portENTER_CRITICAL(&radioMux);
+  for (int i = 0; i < RADIO_LINK_COUNT; i++) {
+    if (!radio.linkUp(i) || memcmp(param->update_conn_params.bda, linkBda[i], sizeof(esp_bd_addr_t)) != 0) continue;
+    radio.setConnParams(i, param->update_conn_params.conn_int, param->update_conn_params.latency);
+  }
+  portEXIT_CRITICAL(&radioMux);
+}
+
+// 登记/撤下读往返探测目标；撤下时等探测任务手上的读完成，返回后主循环才能删除客户端
+void radioProbeSet(int side, BLEClient* client, BLERemoteCharacteristic* ch) {
+  xSemaphoreTake(probeLock, portMAX_DELAY);
+  probeClient[side] = client;
+  probeChar[side] = ch;
+  xSemaphoreGive(probeLock);
+}
+
+// 读往返探测任务（低优先级）：每秒读一次在线剑端的特征值，往返折算错过的连接事件
+// readValue 要等一个连接往返，放在主循环里会拖住 serviceJudge 的判定
+void TaskRadioProbe(void* pv) {
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(RADIO_PROBE_MS));
+    for (int i = 0; i < 2; i++) {
+      xSemaphoreTake(probeLock, portMAX_DELAY);
+      if (probeClient[i] != nullptr && probeChar[i] != nullptr && probeClient[i]->isConnected()) {
+        uint32_t t0 = millis();
+        bool ok = probeChar[i]->readValue().length() > 0;
+        uint32_t rtt = millis() - t0;
+        if (ok) {
+          portENTER_CRITICAL(&radioMux);
+          radio.addProbe(i == 0 ? RADIO_LINK_RED : RADIO_LINK_GRN, rtt);
+          portEXIT_CRITICAL(&radioMux);
+        }
+      }
+      xSemaphoreGive(probeLock);
+    }
+  }
+}
+
+// 每 30 秒打印一次调度统计（探测在 TaskRadioProbe 里）
+void serviceRadioStats() {
+  unsigned long now = millis();
+  if (now - lastRadioStats < RADIO_STATS_MS) return;
+  lastRadioStats = now;
+  RadioStats st;
+  portENTER_CRITICAL(&radioMux);
+  radio.stats(st, now);
+  radio.resetStats(now);
+  portEXIT_CRITICAL(&radioMux);
+  uint32_t elapsed = st.elapsedMs > 0 ? st.elapsedMs : 1;
+  Serial.printf("📶 射频调度：扫描开 %.1f%% 占空 %.1f%% (%lu 片) | 错过连接事件 %lu (单次最多 %u, 探测 %lu) | 剑端通知 %lu | 小程序推迟 %lu 轮\n",
+                st.scanMs * 100.0f / elapsed, st.scanAirMs * 100.0f / elapsed, (unsigned long)st.scanSlices,
+                (unsigned long)st.missedEvents, st.missedMax, (unsigned long)st.probes,
+                (unsigned long)st.pointerNotifies, (unsigned long)st.appDeferred);
+}
+
 // ✅【优化】系统重置 - 释放内存+重置所有状态
 void sysReset() {
   if (pRed != nullptr) {
+    radioProbeSet(0, nullptr, nullptr);
     if (pRed->isConnected()) pRed->disconnect();
     delete pRed;
     pRed = nullptr;
+    radioSetLink(RADIO_LINK_RED, false, nullptr);
     hitSrc.isRed = false;
   }
   if (pGreen != nullptr) {
+    radioProbeSet(1, nullptr, nullptr);
     if (pGreen->isConnected()) pGreen->disconnect();
     delete pGreen;
     pGreen = nullptr;
+    radioSetLink(RADIO_LINK_GRN, false, nullptr);
     hitSrc.isGreen = false;
   }
 
   redScore = 0;
   grnScore = 0;
-  lastHit = 0;
-  lastSide = "";
+  judge.reset();
+  portENTER_CRITICAL(&hitMux);
+  hitPending[JUDGE_RED] = hitPending[JUDGE_GREEN] = false;
+  portEXIT_CRITICAL(&hitMux);
   redHit = false;
   grnHit = false;
   doubleHit = false;
@@ -387,7 +592,7 @@ void sysReset() {
   digitalWrite(BUZZER, HIGH);
 
   currTgt = NONE;
-  scanning = false;
+  scanStop();
   timeoutFlag = false;
 
   sendToApp();
@@ -410,21 +615,40 @@ void checkTimeout() {
 void checkReconnect() {
   if (pRed != nullptr && !pRed->isConnected() && currTgt == RED) {
     Serial.println("🔴 红方设备断线，正在重连...");
+    radioProbeSet(0, nullptr, nullptr);
     delete pRed;
     pRed = nullptr;
+    radioSetLink(RADIO_LINK_RED, false, nullptr);
     scanStart();
   }
   if (pGreen != nullptr && !pGreen->isConnected() && currTgt == GRN) {
     Serial.println("🟢 绿方设备断线，正在重连...");
+    radioProbeSet(1, nullptr, nullptr);
     delete pGreen;
     pGreen = nullptr;
+    radioSetLink(RADIO_LINK_GRN, false, nullptr);
     scanStart();
   }
 }
 
-// ✅【修复】发送数据到小程序 + 互中状态清零
+// 标记文本状态待推送：击中回调里不直接发，等剑端通知的空档由主循环发
 void sendToApp() {
-  if (!appConn) return;
+  if (appConn) appTextPending = true;
+}
+
+// ✅【修复】发送数据到小程序 + 互中状态清零
+void serviceAppText() {
+  if (!appTextPending) return;
+  if (!appConn) {
+    appTextPending = false;
+    return;
+  }
+  portENTER_CRITICAL(&radioMux);
+  bool busy = radio.pointerBusy(millis());
+  if (busy) radio.appDeferred();
+  portEXIT_CRITICAL(&radioMux);
+  if (busy) return;
+  appTextPending = false;
   char dataBuf[128];
   if (doubleHit) {
     sprintf(dataBuf, "red:%d,grn:%d,state:double,red_confirm:%d,grn_confirm:%d", redScore, grnScore, redHit ? 0 : 1, grnHit ? 0 : 1);
@@ -441,6 +665,123 @@ void sendToApp() {
   doubleHit = false; // ✅ 修复：互中状态清零，解决计分卡死
 }
 
+// 当前计分状态 -> 二进制状态帧字段
+AppState currentAppState() {
+  AppState st;
+  st.redScore = (uint8_t)constrain(redScore, 0, 255);
+  st.grnScore = (uint8_t)constrain(grnScore, 0, 255);
+  st.lamps = 0;
+  if (redHit) st.lamps |= APP_LAMP_RED;
+  if (grnHit) st.lamps |= APP_LAMP_GRN;
+  if (pRed != nullptr && pRed->isConnected()) st.lamps |= APP_LAMP_RED_LINK;
+  if (pGreen != nullptr && pGreen->isConnected()) st.lamps |= APP_LAMP_GRN_LINK;
+  st.timerSec = APP_TIMER_NONE;
+  if (redHit && grnHit) st.phase = APP_PHASE_DOUBLE;
+  else if (redHit) st.phase = APP_PHASE_RED_HIT;
+  else if (grnHit) st.phase = APP_PHASE_GRN_HIT;
+  else if (scanning) st.phase = APP_PHASE_SCANNING;
+  else st.phase = APP_PHASE_IDLE;
+  return st;
+}
+
+// 推送二进制状态增量：同一连接间隔内的多次变化合并成一帧
+void flushAppState() {
+  AppState st = currentAppState();
+  uint8_t buf[APP_FRAME_MAX_LEN];
+  size_t n = 0;
+  portENTER_CRITICAL(&appChannelMux);
+  appChannel.update(st);
+  bool due = appConn && appChannel.pending() && millis() - lastAppFlush >= appConnIntervalMs;
+  portEXIT_CRITICAL(&appChannelMux);
+  if (!due) return;
+  // 剑端通知优先：互中窗口内先不推，变化留在通道里合并到下一帧
+  portENTER_CRITICAL(&radioMux);
+  bool busy = radio.pointerBusy(millis());
+  if (busy) radio.appDeferred();
+  portEXIT_CRITICAL(&radioMux);
+  if (busy) return;
+  portENTER_CRITICAL(&appChannelMux);
+  n = appChannel.buildDelta(buf);
+  portEXIT_CRITICAL(&appChannelMux);
+  if (n == 0) return;
+  lastAppFlush = millis();
+  pStateChar->setValue(buf, n);
+  pStateChar->notify();
+  Serial.printf("📤 推送状态帧：seq=%u 字段=0x%02X 长度=%u\n", buf[1], buf[2], (unsigned)n);
+}
+
+// 广播：主包放比分厂商数据，名称和服务UUID放扫描响应
+void startAppAdvertising(bool connectable) {
+  pAdv->stop();
+  pAdv->setAdvertisementType(connectable ? ADV_TYPE_IND : ADV_TYPE_SCAN_IND);
+  pAdv->start();
+}
+
+// 比分变化时刷新广播数据（限速，广播本身按间隔周期发送）
+void updateBeacon() {
+  if (millis() - lastBeaconUpdate < BEACON_MIN_UPDATE_MS) return;
+  portENTER_CRITICAL(&radioMux);
+  bool busy = radio.pointerBusy(millis());
+  portEXIT_CRITICAL(&radioMux);
+  if (busy) return; // 剑端通知优先，广播数据稍后刷新
+  if (!scoreBeacon.update(currentAppState())) return;
+  lastBeaconUpdate = millis();
+
+  uint8_t buf[BEACON_DATA_LEN];
+  size_t n = scoreBeacon.build(buf);
+  BLEAdvertisementData adv;
+  adv.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+  adv.setManufacturerData(String((const char*)buf, n));
+  pAdv->setAdvertisementData(adv);
+  Serial.printf("📡 比分广播更新：seq=%u 红:%d 绿:%d\n", scoreBeacon.seq(), redScore, grnScore);
+}
+
+// 汇总：固定信道，添加广播对端
+void hubInit() {
+  WiFi.mode(WIFI_STA);
+  esp_wifi_set_promiscuous(true);
+  esp_wifi_set_channel(HUB_CHANNEL, WIFI_SECOND_CHAN_NONE);
+  esp_wifi_set_promiscuous(false);
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("❌ 汇总广播初始化失败");
+    return;
+  }
+  esp_now_peer_info_t p = {};
+  memcpy(p.peer_addr, HUB_BROADCAST, 6);
+  p.channel = HUB_CHANNEL;
+  p.ifidx = WIFI_IF_STA;
+  esp_now_add_peer(&p);
+  memset(&hubLast, 0, sizeof(hubLast));
+  hubReady = true;
+  Serial.printf("📡 汇总广播已启动：剑道 %d 信道 %d\n", HUB_PISTE, HUB_CHANNEL);
+}
+
+// 刚亮起击中灯发判定结果，其余变化和每秒发状态
+void updateHub() {
+  if (!hubReady) return;
+  portENTER_CRITICAL(&radioMux);
+  bool busy = radio.pointerBusy(millis());
+  portEXIT_CRITICAL(&radioMux);
+  if (busy) return; // 剑端通知优先，汇总帧稍后发
+  AppState st = currentAppState();
+  const uint8_t hitMask = APP_LAMP_RED | APP_LAMP_GRN;
+  bool result = (st.lamps & hitMask) != 0 && (st.lamps & hitMask) != (hubLast.lamps & hitMask);
+  bool changed = st.redScore != hubLast.redScore || st.grnScore != hubLast.grnScore ||
+                 st.lamps != hubLast.lamps || st.phase != hubLast.phase;
+  hubLast = st;
+  if (!result && !changed && millis() - hubLastSend < HUB_KEEPALIVE_MS) return;
+
+  HubFrame f;
+  f.type = result ? HUB_FRAME_RESULT : HUB_FRAME_STATE;
+  f.piste = HUB_PISTE;
+  f.seq = ++hubSeq;
+  f.state = st;
+  f.uptimeMs = millis();
+  uint8_t buf[HUB_FRAME_LEN];
+  esp_now_send(HUB_BROADCAST, buf, hubFrameBuild(f, buf));
+  hubLastSend = millis();
+}
+
 // 初始化函数
 void setup() {
   Serial.begin(115200);
@@ -448,6 +789,7 @@ void setup() {
   Serial.println("✅ ESP32-C3 重剑计分端 - 启动成功");
   Serial.println("=================================");
   hwInit();
+  probeLock = xSemaphoreCreateMutex();
 
   Serial.println("🔧 初始化BLE从机模式...");
   BLEDevice::init(BLE_SLAVE_NAME);
@@ -457,18 +799,33 @@ void setup() {
   BLEService* pSrv = pServer->createService(UUID_SLAVE_SRV);
   pChar = pSrv->createCharacteristic(UUID_SLAVE_CHAR, BLECharacteristic::PROPERTY_NOTIFY | BLECharacteristic::PROPERTY_READ);
   pChar->addDescriptor(new BLE2902());
+  pStateChar = pSrv->createCharacteristic(UUID_STATE_CHAR, BLECharacteristic::PROPERTY_NOTIFY);
+  pStateChar->addDescriptor(new BLE2902());
+  pSnapChar = pSrv->createCharacteristic(UUID_SNAP_CHAR, BLECharacteristic::PROPERTY_READ);
+  pSnapChar->setCallbacks(new SnapReadCb());
   pSrv->start();
 
-  BLEAdvertising* pAdv = BLEDevice::getAdvertising();
-  pAdv->addServiceUUID(UUID_SLAVE_SRV);
+  pAdv = BLEDevice::getAdvertising();
+  BLEAdvertisementData scanResp;
+  scanResp.setName(BLE_SLAVE_NAME);
+  scanResp.setCompleteServices(BLEUUID(UUID_SLAVE_SRV));
+  pAdv->setScanResponseData(scanResp);
+  updateBeacon();
   pAdv->start();
   Serial.println("✅ BLE广播已启动，等待小程序连接！");
 
   pScan = BLEDevice::getScan();
+  pScan->setAdvertisedDeviceCallbacks(new MyScanCb());
+  BLEDevice::setCustomGapHandler(radioGapHandler);
   pScan->setActiveScan(true);
   pScan->setInterval(100);
   pScan->setWindow(90);
   scanStartTime = 0; // ✅ 修复：初始化扫描时间，解决首次假超时
+  xTaskCreate(TaskRadioProbe, "RadioProbe", 4096, NULL, 1, NULL);
+
+#if HUB_ENABLE
+  hubInit();
+#endif
 }
 
 // 主循环
@@ -477,9 +834,16 @@ void loop() {
   handleKeyConfirm();
   handleLedFlash();
   checkTimeout();
+  serviceJudge();
   handleHitLed();
   handleBuzzer();
   checkReconnect();
+  serviceScan();
+  serviceAppText();
+  flushAppState();
+  updateBeacon();
+  updateHub();
+  serviceRadioStats();
   digitalWrite(LED_APP_CONN, appConn ? HIGH : LOW);
   delay(20);
 }
\ No newline at end of file
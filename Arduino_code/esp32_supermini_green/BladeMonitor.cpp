@@ -0,0 +1,141 @@
+#include "BladeMonitor.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BLADE_FAULT_PREFIX "fault:"
+
+BladeMonitor::BladeMonitor(uint32_t sampleHz)
+  : m_sampleHz(sampleHz > 0 ? sampleHz : BLADE_SAMPLE_HZ) {
+  memset(m_counts, 0, sizeof(m_counts));
+  reset();
+}
+
+void BladeMonitor::reset() {
+  m_active = false;
+  m_closed = false;
+  m_shortReported = false;
+  m_samples = m_openRun = m_closedRun = 0;
+  m_closedSamples = m_midSamples = m_levelSum = 0;
+  m_edges = 0;
+}
+
+// 中间电平占多数算电阻偏高（优先于抖动：电阻偏高时电平贴着阈值，也会来回跨）
+uint8_t BladeMonitor::contactClass() const {
+  if ((uint64_t)m_midSamples * 100 > (uint64_t)m_closedSamples * BLADE_RESISTIVE_PCT) return BLADE_RESISTIVE;
+  if (m_edges > BLADE_BOUNCE_EDGES) return BLADE_BOUNCE;
+  return BLADE_CLEAN;
+}
+
+bool BladeMonitor::finish(BladeEvent& ev) {
+  bool reported = m_shortReported;
+  bool glitch = m_closedSamples < msToSamples(BLADE_MIN_CONTACT_MS);
+  uint8_t kind = contactClass();
+  uint32_t durationMs = samplesToMs(m_samples - m_openRun);
+  uint16_t level = m_closedSamples > 0 ? (uint16_t)(m_levelSum / m_closedSamples) : 0;
+  uint16_t edges = m_edges;
+  reset();
+  // 已按短路报过的一次接通，松开时不再重复分类
+  if (reported || glitch) return false;
+  ev.kind = kind;
+  ev.durationMs = durationMs;
+  ev.level = level;
+  ev.edges = edges;
+  m_counts[kind]++;
+  return true;
+}
+
+bool BladeMonitor::feed(uint16_t level, BladeEvent& ev) {
+  bool closed = level < BLADE_OPEN_MIN;
+  if (!m_active) {
+    if (!closed) return false;
+    reset();
+    m_active = true;
+  }
+  m_samples++;
+  if (closed) {
+    if (!m_closed && m_samples > 1 && m_samples > msToSamples(BLADE_SETTLE_MS)) m_edges++;
+    m_closed = true;
+    m_closedSamples++;
+    m_levelSum += level;
+    if (level >= BLADE_CLOSED_MAX) m_midSamples++;
+    m_openRun = 0;
+    m_closedRun++;
+    if (!m_shortReported && m_closedRun >= msToSamples(BLADE_SHORT_MS)) {
+      // 持续接通不等松开就报；一直是中间电平的是漏电，按电阻偏高报
+      m_shortReported = true;
+      ev.kind = contactClass() == BLADE_RESISTIVE ? BLADE_RESISTIVE : BLADE_SHORT;
+      ev.durationMs = samplesToMs(m_samples);
+      ev.level = (uint16_t)(m_levelSum / m_closedSamples);
+      ev.edges = m_edges;
+      m_counts[ev.kind]++;
+      return true;
+    }
+    return false;
+  }
+  m_closed = false;
+  m_closedRun = 0;
+  m_openRun++;
+  if (m_openRun < msToSamples(BLADE_RELEASE_MS)) return false;
+  return finish(ev);
+}
+
+bool BladeMonitor::flush(BladeEvent& ev) {
+  if (!m_active) return false;
+  return finish(ev);
+}
+
+const char* BladeMonitor::className(uint8_t kind) {
+  switch (kind) {
+    case BLADE_CLEAN:     return "接通正常";
+    case BLADE_BOUNCE:    return "接触不良";
+    case BLADE_RESISTIVE: return "电阻偏高";
+    case BLADE_SHORT:     return "短路";
+    default:              return "?";
+  }
+}
+
+size_t bladeFaultFormat(const BladeEvent& ev, uint32_t total, char* out, size_t cap) {
+  int n = snprintf(out, cap, BLADE_FAULT_PREFIX "%u|ms:%lu|lv:%u|e:%u|n:%lu", ev.kind, (unsigned long)ev.durationMs,
+                   ev.level, ev.edges, (unsigned long)total);
+  if (n < 0 || (size_t)n >= cap) return 0;
+  return (size_t)n;
+}
+
+bool bladeFaultFrame(const uint8_t* data, size_t len) {
+  size_t prefixLen = strlen(BLADE_FAULT_PREFIX);
+  return data != nullptr && len > prefixLen && memcmp(data, BLADE_FAULT_PREFIX, prefixLen) == 0;
+}
+
+bool bladeFaultParse(const char* text, size_t len, BladeEvent& ev, uint32_t& total) {
+  if (!bladeFaultFrame((const uint8_t*)text, len)) return false;
+  char buf[BLADE_FAULT_TEXT_MAX];
+  if (len >= sizeof(buf)) return false;
+  memcpy(buf, text, len);
+  buf[len] = '\0';
+
+  long kind = -1, ms = -1, lv = -1, e = -1, n = -1;
+  char* save = nullptr;
+  for (char* tok = strtok_r(buf, "|", &save); tok != nullptr; tok = strtok_r(nullptr, "|", &save)) {
+    char* colon = strchr(tok, ':');
+    if (colon == nullptr) return false;
+    *colon = '\0';
+    char* end;
+    long v = strtol(colon + 1, &end, 10);
+    if (*end != '\0' || end == colon + 1 || v < 0) return false;
+    if (strcmp(tok, "fault") == 0) kind = v;
+    else if (strcmp(tok, "ms") == 0) ms = v;
+    else if (strcmp(tok, "lv") == 0) lv = v;
+    else if (strcmp(tok, "e") == 0) e = v;
+    else if (strcmp(tok, "n") == 0) n = v;
+  }
+  if (kind <= BLADE_CLEAN || kind >= BLADE_CLASS_COUNT || ms < 0 || lv < 0 || lv > 1000 || e < 0 || e > 0xFFFF || n < 0) {
+    return false;
+  }
+  ev.kind = (uint8_t)kind;
+  ev.durationMs = (uint32_t)ms;
+  ev.level = (uint16_t)lv;
+  ev.edges = (uint16_t)e;
+  total = (uint32_t)n;
+  return true;
+}
\ No newline at end of file
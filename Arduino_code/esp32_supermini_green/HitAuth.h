@@ -0,0 +1,64 @@
+#ifndef HIT_AUTH_H
+#define HIT_AUTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef HIT_AUTH_HOST_OPENSSL
+#include "mbedtls/cipher.h"
+#endif
+
+// 击中帧认证：每对剑端/主机一把 128 位密钥，AES-CMAC 截断为 32 位标签附在帧尾
+//   "time:..|RED:..|seq:..|sid:..|age:..|mac:<8位十六进制>"
+// 标签覆盖 主机本次连接下发的随机数(8字节) + 帧正文，换一次连接旧帧即失效；
+// 同一连接内的重放由 HitLink 的序号去重挡住
+// 设备端用 mbedtls（走 ESP32 AES 硬件加速），主机端工具定义 HIT_AUTH_HOST_OPENSSL 改用 OpenSSL
+
+#define HIT_AUTH_KEY_LEN    16
+#define HIT_AUTH_NONCE_LEN  8
+#define HIT_AUTH_TAG_LEN    4     // 截断后的标签字节数
+#define HIT_AUTH_TAG_FIELD  "|mac:"
+
+class HitAuth {
+public:
+  HitAuth();
+  ~HitAuth();
+
+  // 设置/清除密钥（未设置时 sign/verify 都返回 false）
+  bool setKey(const uint8_t key[HIT_AUTH_KEY_LEN]);
+  void clearKey();
+  bool hasKey() const { return m_hasKey; }
+
+  // 本次连接的随机数（主机生成并写给剑端）
+  void setNonce(const uint8_t nonce[HIT_AUTH_NONCE_LEN]);
+  void clearNonce() { m_hasNonce = false; }
+  bool hasNonce() const { return m_hasNonce; }
+
+  // 剑端：在 frame（以 '\0' 结尾，缓冲区长 cap）末尾追加 "|mac:xxxxxxxx"
+  bool sign(char* frame, size_t cap);
+
+  // 主机：校验帧尾标签，成功时 bodyLen 为去掉标签后的正文长度
+  bool verify(const uint8_t* frame, size_t len, size_t& bodyLen);
+
+  // 二进制消息（热备心跳、剑端控制命令、升级镜像头）：标签同样覆盖随机数 + data，不拼文本字段
+  bool tag(const uint8_t* data, size_t len, uint8_t out[HIT_AUTH_TAG_LEN]);
+  bool check(const uint8_t* data, size_t len, const uint8_t tag[HIT_AUTH_TAG_LEN]);
+
+  // 十六进制工具：toHex 写入 2*len 个字符加 '\0'；parseHex 要求正好 2*len 个十六进制字符
+  static void toHex(const uint8_t* data, size_t len, char* out);
+  static bool parseHex(const char* text, size_t textLen, uint8_t* out, size_t len);
+
+private:
+  bool m_hasKey;
+  bool m_hasNonce;
+  uint8_t m_nonce[HIT_AUTH_NONCE_LEN];
+#ifdef HIT_AUTH_HOST_OPENSSL
+  uint8_t m_key[HIT_AUTH_KEY_LEN];
+#else
+  mbedtls_cipher_context_t m_ctx;   // 密钥只在 setKey 时展开一次，每帧只做 reset+update
+#endif
+
+  bool computeTag(const uint8_t* body, size_t len, uint8_t tag[HIT_AUTH_TAG_LEN]);
+};
+
+#endif // HIT_AUTH_H
\ No newline at end of file
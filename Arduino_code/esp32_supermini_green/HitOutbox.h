@@ -0,0 +1,65 @@
+#ifndef HIT_OUTBOX_H
+#define HIT_OUTBOX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 未确认击中的暂存环（存储转发）
+// 不依赖 Arduino.h，时间由调用方传入，主机端仿真可直接编译
+#define HIT_OUTBOX_SIZE     8     // 最多暂存 8 条未确认击中，满了覆盖最旧的一条
+#define HIT_ACK_TIMEOUT_MS  250   // 发出后这么久没收到确认就重发
+
+// 单条击中记录
+struct HitRecord {
+  uint16_t seq;         // 序号（本次上电从1开始递增）
+  uint32_t timeMs;      // 击中时本机 millis()
+  uint16_t score;       // 击中后本方得分
+  uint32_t lastSendMs;  // 上次发送时间
+  uint8_t  sendCount;   // 已发送次数，0=还没发过
+};
+
+class HitOutbox {
+public:
+  HitOutbox();
+
+  // 新击中入队，返回分配的序号；队列满时丢弃最旧一条
+  uint16_t push(uint32_t timeMs, uint16_t score);
+
+  // 累积确认：序号 <= seq 的记录全部删除
+  void ack(uint16_t seq);
+
+  // 取下一条该发的记录：没发过的，或 allowRetransmit 时已超时未确认的；没有返回 nullptr
+  HitRecord* nextDue(uint32_t nowMs, bool allowRetransmit);
+
+  // 最旧的一条未确认记录（队列空返回 nullptr）
+  HitRecord* oldest() { return m_count > 0 ? &at(0) : nullptr; }
+
+  // 最新入队的一条（队列空返回 nullptr）
+  HitRecord* newest() { return m_count > 0 ? &at(m_count - 1) : nullptr; }
+
+  // 记录一次发送（第二次及以后计入重发次数）
+  void markSent(HitRecord* rec, uint32_t nowMs);
+
+  // 重连后所有记录视为未发送，按顺序全部补发
+  void resetSendState();
+
+  // 距下一条记录到期还有多少毫秒（没有待确认记录返回 UINT32_MAX）
+  uint32_t msUntilDue(uint32_t nowMs) const;
+
+  size_t count() const { return m_count; }
+  uint32_t retransmits() const { return m_retransmits; }
+  uint32_t dropped() const { return m_dropped; }
+
+private:
+  HitRecord m_ring[HIT_OUTBOX_SIZE];
+  uint8_t m_head;        // 最旧一条的位置
+  uint8_t m_count;
+  uint16_t m_nextSeq;
+  uint32_t m_retransmits;
+  uint32_t m_dropped;
+
+  HitRecord& at(uint8_t i) { return m_ring[(m_head + i) % HIT_OUTBOX_SIZE]; }
+  const HitRecord& at(uint8_t i) const { return m_ring[(m_head + i) % HIT_OUTBOX_SIZE]; }
+};
+
+#endif // HIT_OUTBOX_H
\ No newline at end of file
@@ -0,0 +1,247 @@
+#ifndef OTA_LINK_H
+#define OTA_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 剑端蓝牙升级：主机经剑端的升级特征值（与击中特征值同一服务）分块写入新固件
+//   镜像文件 = 32 字节头 + 数据流；数据流由若干块组成，每块自带输出偏移和 CRC32，块之间互不依赖
+//   块编码：RAW 原样；XOR_RLE 与剑端当前运行的固件逐字节异或后做游程编码（差分升级；
+//           不带基准时按全 0 基准，相当于只压缩空白区）
+//   剑端直接写另一个 OTA 分区（A/B），每写过 OTA_PERSIST_BYTES 把进度存 NVS：
+//   掉线/重启后主机用同一镜像头重新 BEGIN，剑端回报已写到哪里，从那里续传
+//   全部写完后剑端回读整个分区校验 CRC32 再设为启动分区；新固件连上主机收到 hello 才确认，
+//   确认前重启由引导程序回滚到旧固件
+// 不依赖 Arduino.h，主机、剑端和主机端仿真（host_tools/ota_sim）共用
+//
+// 主机 → 剑端（无响应写）：
+//   BEGIN  [0x01][镜像头 32][标签 4]    标签 = 配对密钥+本次连接随机数对前 33 字节的 CMAC（同 HitAuth），
+//                                      镜像头含整包 CRC32；剑端只认写过已认证 hello 的主机，之后的消息只认这台主机
+//   DATA   [0x02][数据流偏移 u32][块：长度 u16 | 输出偏移 u32 | CRC32 u32 | 数据]
+//   END    [0x03]                       全部写完，校验并切换启动分区
+//   ABORT  [0x04]                       放弃（进度清除）
+//   QUERY  [0x05]                       询问进度（超时没收到状态时）
+// 剑端 → 主机（通知）：
+//   STATUS [0x80][状态][原因][已收数据流偏移 u32][已写输出偏移 u32][错误码]
+// 主机每次最多领先确认 OTA_WINDOW 块；剑端每收 OTA_ACK_EVERY 块回一次状态，
+// 发现缺块回 GAP（主机从该偏移重发），多字节整数小端
+
+#define OTA_MAGIC            0x41544F45u   // "EOTA"
+#define OTA_VERSION          1
+#define OTA_HEADER_LEN       32
+#define OTA_TAG_LEN          4             // 与 HIT_AUTH_TAG_LEN 相同
+#define OTA_BEGIN_LEN        (1 + OTA_HEADER_LEN + OTA_TAG_LEN)
+#define OTA_CHUNK_HEADER_LEN 10
+#define OTA_CHUNK_MAX        480           // MTU 517 时一条无响应写放得下：1+4+10+480 <= 514
+#define OTA_MTU              517
+#define OTA_STATUS_LEN       12
+#define OTA_WINDOW           16            // 未确认块数上限
+#define OTA_ACK_EVERY        8
+#define OTA_PERSIST_BYTES    16384         // 每写这么多输出字节存一次进度
+#define OTA_SECTOR           4096
+#define OTA_STATUS_TIMEOUT_MS 300          // 主机这么久没收到状态就发 QUERY
+#define OTA_BEGIN_RETRY_MS   500
+#define OTA_END_RETRY_MS     3000          // 剑端回读校验整个分区需要时间
+#define OTA_MAX_RETRIES      10
+
+enum OtaMsgType {
+  OTA_MSG_BEGIN = 0x01,
+  OTA_MSG_DATA = 0x02,
+  OTA_MSG_END = 0x03,
+  OTA_MSG_ABORT = 0x04,
+  OTA_MSG_QUERY = 0x05,
+  OTA_MSG_STATUS = 0x80
+};
+
+enum OtaCodec {
+  OTA_CODEC_RAW = 0,
+  OTA_CODEC_XOR_RLE = 1
+};
+
+enum OtaState {
+  OTA_STATE_IDLE = 0,
+  OTA_STATE_RECEIVING,
+  OTA_STATE_DONE,
+  OTA_STATE_ERROR
+};
+
+enum OtaReason {
+  OTA_REASON_PROGRESS = 0,   // 定期确认
+  OTA_REASON_GAP,            // 缺块，从已收偏移重发
+  OTA_REASON_QUERY,          // 回答 QUERY
+  OTA_REASON_BEGIN,          // 回答 BEGIN（续传时偏移不为 0）
+  OTA_REASON_END             // 回答 END
+};
+
+enum OtaError {
+  OTA_ERR_NONE = 0,
+  OTA_ERR_BAD_HEADER,        // 镜像头格式/版本不对
+  OTA_ERR_TOO_BIG,           // 超过分区大小
+  OTA_ERR_BASE_MISMATCH,     // 差分镜像的基准与剑端当前固件不一致（需要整包镜像）
+  OTA_ERR_CHUNK,             // 块格式或 CRC 错
+  OTA_ERR_FLASH,             // 擦写失败
+  OTA_ERR_IMAGE_CRC,         // 回读整个镜像校验失败
+  OTA_ERR_ACTIVATE,          // 设置启动分区失败（镜像不是有效固件）
+  OTA_ERR_NOT_STARTED        // 没有进行中的升级
+};
+
+struct OtaHeader {
+  uint8_t codec;
+  uint16_t chunkMax;
+  uint32_t outSize;          // 新固件字节数
+  uint32_t outCrc;           // 新固件 CRC32
+  uint32_t streamSize;       // 数据流字节数（不含头）
+  uint32_t baseSize;         // 差分基准字节数（0=无基准）
+  uint32_t baseCrc;          // 基准前 baseSize 字节的 CRC32
+};
+
+struct OtaStatus {
+  uint8_t state;
+  uint8_t reason;
+  uint32_t nextStream;
+  uint32_t nextOut;
+  uint8_t error;
+};
+
+// 剑端续传进度（存 NVS）
+struct OtaProgress {
+  uint8_t header[OTA_HEADER_LEN];
+  uint32_t nextStream;
+  uint32_t nextOut;
+};
+
+uint32_t otaCrc32(uint32_t crc, const uint8_t* data, size_t len);   // 首次传 0，可分段累计
+size_t otaHeaderBuild(const OtaHeader& h, uint8_t* buf);
+bool otaHeaderParse(const uint8_t* data, size_t len, OtaHeader& out);
+size_t otaStatusBuild(const OtaStatus& s, uint8_t* buf);
+bool otaStatusParse(const uint8_t* data, size_t len, OtaStatus& out);
+
+// 剑端的存储接口（剑端用 esp_partition/NVS 实现，仿真用内存模拟 NOR 闪存）
+class OtaFlash {
+public:
+  virtual ~OtaFlash() {}
+  virtual uint32_t capacity() = 0;                                     // 目标分区大小
+  virtual bool readBase(uint32_t off, uint8_t* buf, size_t n) = 0;     // 当前运行的固件
+  virtual uint32_t baseCapacity() = 0;
+  virtual bool erase(uint32_t off, size_t n) = 0;                      // 目标分区，按扇区
+  virtual bool write(uint32_t off, const uint8_t* data, size_t n) = 0;
+  virtual bool readBack(uint32_t off, uint8_t* buf, size_t n) = 0;
+  virtual bool loadProgress(OtaProgress& p) = 0;
+  virtual void saveProgress(const OtaProgress& p) = 0;
+  virtual void clearProgress() = 0;
+  virtual bool activate() = 0;                                         // 设为下次启动分区
+};
+
+struct OtaReceiverStats {
+  uint32_t chunks;
+  uint32_t duplicates;       // 已收过的块（重发/回退后重叠）
+  uint32_t gaps;
+  uint32_t crcErrors;
+  uint32_t resumes;
+};
+
+// 剑端：处理主机写入，需要回状态时返回 true
+class OtaReceiver {
+public:
+  explicit OtaReceiver(OtaFlash& flash);
+
+  bool handle(const uint8_t* msg, size_t len, uint8_t* reply, size_t& replyLen);
+  bool active() const { return m_state == OTA_STATE_RECEIVING; }
+  bool done() const { return m_state == OTA_STATE_DONE; }
+  uint8_t state() const { return m_state; }
+  uint8_t error() const { return m_error; }
+  uint32_t nextOut() const { return m_nextOut; }
+  uint32_t outSize() const { return m_header.outSize; }
+  const OtaReceiverStats& stats() const { return m_stats; }
+
+private:
+  OtaFlash& m_flash;
+  OtaHeader m_header;
+  uint8_t m_rawHeader[OTA_HEADER_LEN];
+  uint8_t m_state;
+  uint8_t m_error;
+  uint32_t m_nextStream;
+  uint32_t m_nextOut;
+  uint32_t m_persistedOut;
+  uint32_t m_sinceAck;
+  uint32_t m_lastGapAt;      // 同一缺口只回一次 GAP，主机回退后重发的块陆续到齐
+  OtaReceiverStats m_stats;
+  uint8_t m_outBuf[256];     // 解码输出攒够再写闪存
+  size_t m_outLen;
+  uint32_t m_outBufOff;
+  uint8_t m_baseBuf[256];    // 差分基准读缓存
+  uint32_t m_baseBufOff;
+  size_t m_baseBufLen;
+
+  size_t status(uint8_t reason, uint8_t* reply);
+  size_t fail(uint8_t error, uint8_t reason, uint8_t* reply);
+  bool begin(const uint8_t* hdr, size_t len);
+  bool decodeChunk(const uint8_t* payload, uint16_t len, uint32_t outOff, uint32_t& produced);
+  bool emit(uint8_t b);
+  bool flushOut();
+  bool writeOut(uint32_t off, const uint8_t* data, size_t n);
+  bool baseByte(uint32_t off, uint8_t& b);
+  void persist();
+  bool verifyImage();
+};
+
+// 主机读镜像文件的接口（主机用 LittleFS，仿真用内存）
+class OtaImageReader {
+public:
+  virtual ~OtaImageReader() {}
+  virtual bool read(uint32_t off, uint8_t* buf, size_t n) = 0;
+};
+
+enum OtaSendState {
+  OTA_SEND_IDLE = 0,
+  OTA_SEND_STARTING,         // 发 BEGIN 等剑端回状态
+  OTA_SEND_SENDING,
+  OTA_SEND_FINISHING,        // 发 END 等剑端校验
+  OTA_SEND_DONE,
+  OTA_SEND_FAILED
+};
+
+struct OtaSenderStats {
+  uint32_t packets;
+  uint32_t bytes;            // 写出的数据流字节（含重发）
+  uint32_t rewinds;          // 因缺块/询问回退
+  uint32_t queries;
+};
+
+// 主机：每次 next() 给出下一条要写的消息，onStatus() 喂剑端的通知
+class OtaSender {
+public:
+  OtaSender();
+
+  // 读镜像头开始一次传输（剑端有同一镜像的进度时自动续传）
+  bool begin(OtaImageReader* reader, uint32_t nowMs);
+  size_t next(uint32_t nowMs, uint8_t* buf, size_t cap);
+  void onStatus(const uint8_t* msg, size_t len, uint32_t nowMs);
+  void abort() { m_state = OTA_SEND_FAILED; m_error = OTA_ERR_NOT_STARTED; }
+
+  uint8_t state() const { return m_state; }
+  uint8_t error() const { return m_error; }
+  bool busy() const { return m_state == OTA_SEND_STARTING || m_state == OTA_SEND_SENDING || m_state == OTA_SEND_FINISHING; }
+  const OtaHeader& header() const { return m_header; }
+  uint32_t acked() const { return m_acked; }
+  uint32_t resumedFrom() const { return m_resumedFrom; }
+  const OtaSenderStats& stats() const { return m_stats; }
+
+private:
+  OtaImageReader* m_reader;
+  OtaHeader m_header;
+  uint8_t m_rawHeader[OTA_HEADER_LEN];
+  uint8_t m_state;
+  uint8_t m_error;
+  uint32_t m_sent;
+  uint32_t m_acked;
+  uint32_t m_resumedFrom;
+  uint32_t m_lastTxMs;       // 上次发控制消息（BEGIN/END/QUERY）
+  uint32_t m_lastStatusMs;
+  uint32_t m_retries;
+  OtaSenderStats m_stats;
+};
+
+const char* otaErrorName(uint8_t error);
+
+#endif // OTA_LINK_H
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "ToneEngine.h"
+
+#define TONE_STEPS(a) a, (uint8_t)(sizeof(a) / sizeof(a[0]))
+
+static const ToneStep TONE_TOUCH_STEPS[] = {{2700, 800}};
+static const ToneStep TONE_DOUBLE_STEPS[] = {{2700, 250}, {0, 80}, {2700, 250}, {0, 80}, {2700, 250}};
+static const ToneStep TONE_PERIOD_END_STEPS[] = {{2000, 600}, {0, 200}, {2000, 600}, {0, 200}, {2000, 1200}};
+static const ToneStep TONE_CONFIRM_STEPS[] = {{3500, 40}, {0, 30}, {3500, 40}};
+static const ToneStep TONE_POINTER_HIT_STEPS[] = {{2700, 200}};
+
+static const struct {
+  const ToneStep* steps;
+  uint8_t count;
+} TONE_TABLE[TONE_COUNT] = {
+  {TONE_STEPS(TONE_TOUCH_STEPS)},
+  {TONE_STEPS(TONE_DOUBLE_STEPS)},
+  {TONE_STEPS(TONE_PERIOD_END_STEPS)},
+  {TONE_STEPS(TONE_CONFIRM_STEPS)},
+  {TONE_STEPS(TONE_POINTER_HIT_STEPS)},
+};
+
+ToneEngine::ToneEngine()
+  : m_pin(-1)
+  , m_passive(false)
+  , m_timer(NULL)
+  , m_pmLock(NULL)
+  , m_mux(portMUX_INITIALIZER_UNLOCKED)
+  , m_head(0)
+  , m_count(0)
+  , m_playing(false)
+  , m_preempt(false)
+  , m_steps(nullptr)
+  , m_stepCount(0)
+  , m_stepIndex(0) {
+}
+
+bool ToneEngine::begin(int pin, bool passive) {
+  m_pin = pin;
+  m_passive = passive;
+  if (!ledcAttach(pin, 2700, TONE_LEDC_BITS)) {
+    Serial.println("[蜂鸣器] LEDC 初始化失败");
+    return false;
+  }
+  ledcWrite(pin, 0);
+
+  esp_timer_create_args_t args = {};
+  args.callback = onTimer;
+  args.arg = this;
+  args.dispatch_method = ESP_TIMER_TASK;
+  args.name = "tone";
+  if (esp_timer_create(&args, &m_timer) != ESP_OK) return false;
+
+  // 没开电源管理时返回不支持，不影响使用
+  if (esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "tone", &m_pmLock) != ESP_OK) m_pmLock = NULL;
+  return true;
+}
+
+void ToneEngine::play(ToneId id, bool preempt) {
+  if (m_timer == NULL || id >= TONE_COUNT) return;
+  bool start = false;
+  portENTER_CRITICAL_SAFE(&m_mux);
+  if (preempt) {
+    m_head = 0;
+    m_count = 0;
+    if (m_playing) m_preempt = true;
+  }
+  if (m_count < TONE_QUEUE_LEN) {
+    m_queue[(m_head + m_count) % TONE_QUEUE_LEN] = (uint8_t)id;
+    m_count++;
+  }
+  if (!m_playing) {
+    m_playing = true;
+    start = true;
+  }
+  portEXIT_CRITICAL_SAFE(&m_mux);
+
+  if (start) {
+    if (m_pmLock != NULL) esp_pm_lock_acquire(m_pmLock);
+    kick();
+  } else if (preempt) {
+    kick();
+  }
+}
+
+void ToneEngine::stop() {
+  if (m_timer == NULL) return;
+  portENTER_CRITICAL_SAFE(&m_mux);
+  m_head = 0;
+  m_count = 0;
+  bool playing = m_playing;
+  if (playing) m_preempt = true;
+  portEXIT_CRITICAL_SAFE(&m_mux);
+  // 回调发现打断标记且队列为空，会静音并释放电源锁
+  if (playing) kick();
+}
+
+// 让回调尽快执行一次（已在计时中则重新计时）
+void ToneEngine::kick() {
+  esp_timer_stop(m_timer);
+  esp_timer_start_once(m_timer, 1);
+}
+
+void ToneEngine::onTimer(void* arg) {
+  ((ToneEngine*)arg)->advance();
+}
+
+// 定时器回调：进入下一音段；当前音效播完取队列下一个；队列空则静音结束
+void ToneEngine::advance() {
+  portENTER_CRITICAL(&m_mux);
+  if (m_preempt) {
+    m_preempt = false;
+    m_steps = nullptr;
+  }
+  if (m_steps != nullptr && m_stepIndex + 1 < m_stepCount) {
+    m_stepIndex++;
+  } else if (m_count > 0) {
+    uint8_t id = m_queue[m_head];
+    m_head = (m_head + 1) % TONE_QUEUE_LEN;
+    m_count--;
+    m_steps = TONE_TABLE[id].steps;
+    m_stepCount = TONE_TABLE[id].count;
+    m_stepIndex = 0;
+  } else {
+    m_steps = nullptr;
+    m_playing = false;
+  }
+  const ToneStep* step = (m_steps != nullptr) ? &m_steps[m_stepIndex] : nullptr;
+  portEXIT_CRITICAL(&m_mux);
+
+  if (step == nullptr) {
+    output(0);
+    if (m_pmLock != NULL) esp_pm_lock_release(m_pmLock);
+    return;
+  }
+  output(step->freqHz);
+  esp_timer_start_once(m_timer, (uint64_t)step->durationMs * 1000);
+}
+
+void ToneEngine::output(uint16_t freqHz) {
+  if (m_passive) {
+    ledcWriteTone(m_pin, freqHz);
+  } else {
+    ledcWrite(m_pin, freqHz > 0 ? (1 << TONE_LEDC_BITS) - 1 : 0); // 满占空比 = 常高
+  }
+}
\ No newline at end of file
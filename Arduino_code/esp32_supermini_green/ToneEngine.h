@@ -0,0 +1,69 @@
+#ifndef TONE_ENGINE_H
+#define TONE_ENGINE_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "esp_pm.h"
+
+// 蜂鸣器音效引擎：LEDC 硬件出波形，esp_timer 回调切换音段，调用方只做一次入队
+// 有源蜂鸣器只响/停（LEDC 满占空比），无源蜂鸣器按每段频率发声
+
+#define TONE_QUEUE_LEN  4     // 排队等待的音效数，满了丢弃最新的
+#define TONE_LEDC_BITS  8
+
+// 一个音段：频率 0 = 静音
+struct ToneStep {
+  uint16_t freqHz;
+  uint16_t durationMs;
+};
+
+// 预置音效
+enum ToneId {
+  TONE_TOUCH = 0,       // 单方击中（主机，长鸣）
+  TONE_DOUBLE_TOUCH,    // 双方同时击中（三连音）
+  TONE_PERIOD_END,      // 局时结束
+  TONE_CONFIRM,         // 按键确认短音
+  TONE_POINTER_HIT,     // 剑端本地击中提示（短鸣）
+  TONE_COUNT
+};
+
+class ToneEngine {
+public:
+  ToneEngine();
+
+  // passive=true 无源蜂鸣器（按频率发声），false 有源蜂鸣器（只控制通断）
+  bool begin(int pin, bool passive);
+
+  // 入队播放；preempt=true 打断当前音效并清空队列（新的判定结果优先）
+  // 只做入队和必要时启动定时器，不阻塞，可在任意任务中调用
+  void play(ToneId id, bool preempt = false);
+
+  // 立即静音并清空队列
+  void stop();
+
+  bool isPlaying() const { return m_playing; }
+
+private:
+  int m_pin;
+  bool m_passive;
+  esp_timer_handle_t m_timer;
+  esp_pm_lock_handle_t m_pmLock;   // 播放期间保持 APB 频率、禁止轻睡眠，否则 LEDC 停振/变调
+  portMUX_TYPE m_mux;
+
+  uint8_t m_queue[TONE_QUEUE_LEN];
+  uint8_t m_head;
+  uint8_t m_count;
+  volatile bool m_playing;
+  volatile bool m_preempt;
+
+  const ToneStep* m_steps;   // 当前音效（定时器回调独占）
+  uint8_t m_stepCount;
+  uint8_t m_stepIndex;
+
+  void kick();
+  void advance();
+  void output(uint16_t freqHz);
+  static void onTimer(void* arg);
+};
+
+#endif // TONE_ENGINE_H
\ No newline at end of file
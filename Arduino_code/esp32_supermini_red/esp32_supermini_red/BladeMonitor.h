@@ -0,0 +1,86 @@
+#ifndef BLADE_MONITOR_H
+#define BLADE_MONITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 剑路电平分类：剑端用 ADC 连续采样（DMA）看剑尖回路的模拟电平，每个样本喂进来，
+// 每次接通结束时分类：干净接通 / 接触不良（稳定后仍反复断开）/ 电阻偏高（接通电平落在中间）/
+// 短路（持续接通不松开）。判定击中仍走原来的数字输入+消抖，这里只负责发现器材问题
+// 样本单位为 ‰ 满量程（0=接地，1000=满量程），与衰减/校准无关；阈值按剑端内部上拉（约 45kΩ）给出，
+// 中间电平约对应 2kΩ 以上的回路电阻，外接 1kΩ 上拉可以查到 100Ω 级别的脏剑尖
+// 故障上报帧：fault:<类别>|ms:<接通时长>|lv:<平均电平‰>|e:<稳定后断开次数>|n:<本次上电累计故障数>
+// 剑端经击中特征值通知（已配对时同样带标签），主机按 fault: 前缀分流，不进击中判定
+// 不依赖 Arduino.h，主机端仿真可直接编译
+
+#define BLADE_SAMPLE_HZ        5000   // DMA 采样率
+#define BLADE_CLOSED_MAX       60     // 低于此为可靠接通（‰）
+#define BLADE_OPEN_MIN         600    // 高于此为断开（‰）；两者之间为中间电平
+#define BLADE_RELEASE_MS       20     // 连续断开这么久才算一次接通结束（与剑端消抖时间一致）
+#define BLADE_SETTLE_MS        5      // 接通后这么久内的抖动是正常机械抖动，不计数
+#define BLADE_BOUNCE_EDGES     3      // 稳定后又断开→接通超过这么多次，判接触不良
+#define BLADE_RESISTIVE_PCT    50     // 接通期间中间电平样本占比超过此值，判电阻偏高
+#define BLADE_SHORT_MS         3000   // 持续接通超过此值判短路/剑尖卡住（接通期间只报一次）
+#define BLADE_MIN_CONTACT_MS   1      // 闭合样本累计不到这么久的毛刺不分类
+#define BLADE_FAULT_TEXT_MAX   64
+
+enum BladeClass {
+  BLADE_CLEAN = 0,
+  BLADE_BOUNCE,          // 接触不良：剑尖脏/身线松动
+  BLADE_RESISTIVE,       // 电阻偏高或漏电：回路电平落在接通和断开之间
+  BLADE_SHORT,           // 短路：剑尖卡住或剑身线对地
+  BLADE_CLASS_COUNT
+};
+
+struct BladeEvent {
+  uint8_t kind;          // BladeClass
+  uint32_t durationMs;   // 这次接通的时长（短路为报出时已持续的时长）
+  uint16_t level;        // 接通期间平均电平（‰）
+  uint16_t edges;        // 稳定后断开→接通次数
+};
+
+class BladeMonitor {
+public:
+  explicit BladeMonitor(uint32_t sampleHz = BLADE_SAMPLE_HZ);
+
+  // 采样中断/重新开始：丢掉进行中的接通，不清累计计数
+  void reset();
+
+  // 喂一个样本（‰）；一次接通分类完成（或持续接通达到短路时长）时返回 true
+  bool feed(uint16_t level, BladeEvent& ev);
+  // 采样窗口结束：进行中的接通按已采到的部分分类（空闲抽查发现漏电用）
+  bool flush(BladeEvent& ev);
+
+  bool inContact() const { return m_active; }
+  uint32_t count(uint8_t kind) const { return kind < BLADE_CLASS_COUNT ? m_counts[kind] : 0; }
+  uint32_t faults() const { return m_counts[BLADE_BOUNCE] + m_counts[BLADE_RESISTIVE] + m_counts[BLADE_SHORT]; }
+
+  static const char* className(uint8_t kind);
+
+private:
+  uint32_t m_sampleHz;
+  bool m_active;           // 在一次接通内
+  bool m_closed;           // 上一个样本为闭合
+  bool m_shortReported;
+  uint32_t m_samples;      // 本次接通开始以来的样本数
+  uint32_t m_openRun;      // 连续断开样本数
+  uint32_t m_closedRun;    // 连续闭合样本数
+  uint32_t m_closedSamples;
+  uint32_t m_midSamples;
+  uint32_t m_levelSum;
+  uint16_t m_edges;
+  uint32_t m_counts[BLADE_CLASS_COUNT];
+
+  uint32_t msToSamples(uint32_t ms) const { return ms * m_sampleHz / 1000; }
+  uint32_t samplesToMs(uint32_t n) const { return (uint32_t)((uint64_t)n * 1000 / m_sampleHz); }
+  uint8_t contactClass() const;
+  bool finish(BladeEvent& ev);
+};
+
+// 生成/解析故障上报帧；解析只看正文（标签由调用方先校验去掉）
+size_t bladeFaultFormat(const BladeEvent& ev, uint32_t total, char* out, size_t cap);
+bool bladeFaultParse(const char* text, size_t len, BladeEvent& ev, uint32_t& total);
+// 以 fault: 开头（主机据此和击中帧分流）
+bool bladeFaultFrame(const uint8_t* data, size_t len);
+
+#endif // BLADE_MONITOR_H
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "GattCache.h"
+#include <string.h>
+#include <stdio.h>
+
+#define GATT_LAYOUT_PREFIX "gatt1:"
+#define GATT_LAYOUT_FIELDS 6
+
+size_t gattLayoutFormat(const GattLayout& layout, char* out, size_t cap) {
+  int n = snprintf(out, cap, GATT_LAYOUT_PREFIX "%u,%u,%u,%u,%u,%u", layout.hit, layout.hitCccd, layout.ota,
+                   layout.otaCccd, layout.telemetry, layout.layout);
+  if (n < 0 || (size_t)n >= cap) return 0;
+  return (size_t)n;
+}
+
+bool gattLayoutParse(const char* text, size_t len, GattLayout& out) {
+  size_t prefixLen = strlen(GATT_LAYOUT_PREFIX);
+  if (text == nullptr || len <= prefixLen || memcmp(text, GATT_LAYOUT_PREFIX, prefixLen) != 0) return false;
+  uint32_t field[GATT_LAYOUT_FIELDS];
+  size_t p = prefixLen;
+  for (int i = 0; i < GATT_LAYOUT_FIELDS; i++) {
+    uint32_t v = 0;
+    size_t digits = 0;
+    while (p < len && text[p] >= '0' && text[p] <= '9' && digits < 5) {
+      v = v * 10 + (uint32_t)(text[p] - '0');
+      p++;
+      digits++;
+    }
+    if (digits == 0 || v > 0xFFFF) return false;
+    field[i] = v;
+    if (i < GATT_LAYOUT_FIELDS - 1) {
+      if (p >= len || text[p] != ',') return false;
+      p++;
+    }
+  }
+  if (p != len) return false;
+
+  GattLayout l;
+  l.hit = (uint16_t)field[0];
+  l.hitCccd = (uint16_t)field[1];
+  l.ota = (uint16_t)field[2];
+  l.otaCccd = (uint16_t)field[3];
+  l.telemetry = (uint16_t)field[4];
+  l.layout = (uint16_t)field[5];
+  // 击中特征值和布局特征值必须有；CCCD 是所属特征值后面的描述符
+  if (l.hit == 0 || l.layout == 0) return false;
+  if (l.hitCccd != 0 && l.hitCccd <= l.hit) return false;
+  if (l.otaCccd != 0 && (l.ota == 0 || l.otaCccd <= l.ota)) return false;
+  out = l;
+  return true;
+}
+
+bool gattLayoutEqual(const GattLayout& a, const GattLayout& b) {
+  return a.hit == b.hit && a.hitCccd == b.hitCccd && a.ota == b.ota && a.otaCccd == b.otaCccd &&
+         a.telemetry == b.telemetry && a.layout == b.layout;
+}
+
+GattConnectStats::GattConnectStats() {
+  reset();
+}
+
+void GattConnectStats::reset() {
+  memset(m_ready, 0, sizeof(m_ready));
+  memset(m_firstNotify, 0, sizeof(m_firstNotify));
+  m_mismatches = 0;
+}
+
+void GattConnectStats::add(GattTiming& t, uint32_t ms) {
+  if (t.count == 0 || ms < t.minMs) t.minMs = ms;
+  if (ms > t.maxMs) t.maxMs = ms;
+  t.count++;
+  t.totalMs += ms;
+}
+
+void GattConnectStats::addReady(uint8_t path, uint32_t ms) {
+  if (path < GATT_PATH_COUNT) add(m_ready[path], ms);
+}
+
+void GattConnectStats::addFirstNotify(uint8_t path, uint32_t ms) {
+  if (path < GATT_PATH_COUNT) add(m_firstNotify[path], ms);
+}
+
+const char* GattConnectStats::pathName(uint8_t path) {
+  switch (path) {
+    case GATT_PATH_CACHED:     return "缓存句柄";
+    case GATT_PATH_DISCOVERED: return "服务发现";
+    default:                   return "?";
+  }
+}
\ No newline at end of file
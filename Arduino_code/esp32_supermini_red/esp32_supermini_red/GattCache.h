@@ -0,0 +1,73 @@
+#ifndef GATT_CACHE_H
+#define GATT_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 剑端属性句柄缓存：剑端把自己服务里各特征值/CCCD 的句柄写进只读的布局特征值；
+// 主机首次连上时照常发现服务，读出布局、和发现结果核对一致后按剑端地址存进 NVS。
+// 之后重连先按缓存句柄读一次布局特征值，文本一致就直接写 CCCD 打开通知，省掉整轮服务发现；
+// 不一致（剑端换了固件、换了板子）或读不到再发现服务并更新缓存
+// 布局文本：gatt1:<击中>,<击中CCCD>,<升级>,<升级CCCD>,<遥测>,<布局>，剑端没有的特征值写 0
+// 文本就是剑端属性表的摘要：固件增删特征值后句柄跟着变，文本对不上，缓存自动作废
+// 不依赖 Arduino.h，主机端仿真可直接编译
+
+#define GATT_LAYOUT_TEXT_MAX  48
+
+struct GattLayout {
+  uint16_t hit;
+  uint16_t hitCccd;      // 0=不支持通知
+  uint16_t ota;          // 0=旧剑端没有升级特征值
+  uint16_t otaCccd;
+  uint16_t telemetry;    // 0=旧剑端没有遥测
+  uint16_t layout;       // 布局特征值自己的句柄（0=旧剑端，不能缓存）
+};
+
+// 生成布局文本，返回长度（不含结尾 0）；缓冲区不够返回 0
+size_t gattLayoutFormat(const GattLayout& layout, char* out, size_t cap);
+// 解析布局文本；缺字段、句柄越界或 CCCD 不在所属特征值之后返回 false
+bool gattLayoutParse(const char* text, size_t len, GattLayout& out);
+bool gattLayoutEqual(const GattLayout& a, const GattLayout& b);
+
+// 连接耗时：按走缓存/走发现分开统计（串口 'g' 打印），对比两条路径
+enum GattPath {
+  GATT_PATH_CACHED = 0,
+  GATT_PATH_DISCOVERED,
+  GATT_PATH_COUNT
+};
+
+struct GattTiming {
+  uint32_t count;
+  uint32_t totalMs;
+  uint32_t minMs;
+  uint32_t maxMs;
+};
+
+class GattConnectStats {
+public:
+  GattConnectStats();
+  void reset();
+
+  // 开始连接 → 通知已打开、随机数/hello 已写（剑端可以计分）
+  void addReady(uint8_t path, uint32_t ms);
+  // 开始连接 → 收到这次连接的第一条通知
+  void addFirstNotify(uint8_t path, uint32_t ms);
+  // 缓存的布局和剑端当前不一致，改走发现
+  void addMismatch() { m_mismatches++; }
+
+  const GattTiming& ready(uint8_t path) const { return m_ready[path]; }
+  const GattTiming& firstNotify(uint8_t path) const { return m_firstNotify[path]; }
+  uint32_t mismatches() const { return m_mismatches; }
+
+  static uint32_t average(const GattTiming& t) { return t.count ? t.totalMs / t.count : 0; }
+  static const char* pathName(uint8_t path);
+
+private:
+  GattTiming m_ready[GATT_PATH_COUNT];
+  GattTiming m_firstNotify[GATT_PATH_COUNT];
+  uint32_t m_mismatches;
+
+  static void add(GattTiming& t, uint32_t ms);
+};
+
+#endif // GATT_CACHE_H
\ No newline at end of file
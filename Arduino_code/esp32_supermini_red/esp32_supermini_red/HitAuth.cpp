@@ -0,0 +1,148 @@
+#include "HitAuth.h"
+#include <string.h>
+
+#ifdef HIT_AUTH_HOST_OPENSSL
+#include <openssl/evp.h>
+#else
+#include "mbedtls/cmac.h"
+#endif
+
+HitAuth::HitAuth() : m_hasKey(false), m_hasNonce(false) {
+  memset(m_nonce, 0, sizeof(m_nonce));
+#ifdef HIT_AUTH_HOST_OPENSSL
+  memset(m_key, 0, sizeof(m_key));
+#else
+  mbedtls_cipher_init(&m_ctx);
+#endif
+}
+
+HitAuth::~HitAuth() {
+  clearKey();
+#ifndef HIT_AUTH_HOST_OPENSSL
+  mbedtls_cipher_free(&m_ctx);
+#endif
+}
+
+bool HitAuth::setKey(const uint8_t key[HIT_AUTH_KEY_LEN]) {
+  clearKey();
+#ifdef HIT_AUTH_HOST_OPENSSL
+  memcpy(m_key, key, HIT_AUTH_KEY_LEN);
+#else
+  const mbedtls_cipher_info_t* info = mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB);
+  if (info == nullptr || mbedtls_cipher_setup(&m_ctx, info) != 0) return false;
+  if (mbedtls_cipher_cmac_starts(&m_ctx, key, HIT_AUTH_KEY_LEN * 8) != 0) {
+    mbedtls_cipher_free(&m_ctx);
+    mbedtls_cipher_init(&m_ctx);
+    return false;
+  }
+#endif
+  m_hasKey = true;
+  return true;
+}
+
+void HitAuth::clearKey() {
+  if (!m_hasKey) return;
+  m_hasKey = false;
+#ifdef HIT_AUTH_HOST_OPENSSL
+  memset(m_key, 0, sizeof(m_key));
+#else
+  mbedtls_cipher_free(&m_ctx);
+  mbedtls_cipher_init(&m_ctx);
+#endif
+}
+
+void HitAuth::setNonce(const uint8_t nonce[HIT_AUTH_NONCE_LEN]) {
+  memcpy(m_nonce, nonce, HIT_AUTH_NONCE_LEN);
+  m_hasNonce = true;
+}
+
+bool HitAuth::computeTag(const uint8_t* body, size_t len, uint8_t tag[HIT_AUTH_TAG_LEN]) {
+  uint8_t full[16];
+#ifdef HIT_AUTH_HOST_OPENSSL
+  uint8_t msg[HIT_AUTH_NONCE_LEN + 128];
+  if (len > sizeof(msg) - HIT_AUTH_NONCE_LEN) return false;
+  memcpy(msg, m_nonce, HIT_AUTH_NONCE_LEN);
+  memcpy(msg + HIT_AUTH_NONCE_LEN, body, len);
+  size_t outLen = 0;
+  if (EVP_Q_mac(nullptr, "CMAC", nullptr, "AES-128-CBC", nullptr, m_key, HIT_AUTH_KEY_LEN,
+                msg, HIT_AUTH_NONCE_LEN + len, full, sizeof(full), &outLen) == nullptr) {
+    return false;
+  }
+#else
+  if (mbedtls_cipher_cmac_reset(&m_ctx) != 0) return false;
+  if (mbedtls_cipher_cmac_update(&m_ctx, m_nonce, HIT_AUTH_NONCE_LEN) != 0) return false;
+  if (mbedtls_cipher_cmac_update(&m_ctx, body, len) != 0) return false;
+  if (mbedtls_cipher_cmac_finish(&m_ctx, full) != 0) return false;
+#endif
+  memcpy(tag, full, HIT_AUTH_TAG_LEN);
+  return true;
+}
+
+bool HitAuth::sign(char* frame, size_t cap) {
+  if (!m_hasKey || !m_hasNonce) return false;
+  size_t len = strlen(frame);
+  size_t fieldLen = strlen(HIT_AUTH_TAG_FIELD);
+  if (len + fieldLen + HIT_AUTH_TAG_LEN * 2 + 1 > cap) return false;
+
+  uint8_t tag[HIT_AUTH_TAG_LEN];
+  if (!computeTag((const uint8_t*)frame, len, tag)) return false;
+  memcpy(frame + len, HIT_AUTH_TAG_FIELD, fieldLen);
+  toHex(tag, HIT_AUTH_TAG_LEN, frame + len + fieldLen);
+  return true;
+}
+
+bool HitAuth::verify(const uint8_t* frame, size_t len, size_t& bodyLen) {
+  if (!m_hasKey || !m_hasNonce) return false;
+  size_t fieldLen = strlen(HIT_AUTH_TAG_FIELD);
+  size_t suffixLen = fieldLen + HIT_AUTH_TAG_LEN * 2;
+  if (len <= suffixLen) return false;
+  bodyLen = len - suffixLen;
+  if (memcmp(frame + bodyLen, HIT_AUTH_TAG_FIELD, fieldLen) != 0) return false;
+
+  uint8_t got[HIT_AUTH_TAG_LEN];
+  if (!parseHex((const char*)frame + bodyLen + fieldLen, HIT_AUTH_TAG_LEN * 2, got, HIT_AUTH_TAG_LEN)) return false;
+  return check(frame, bodyLen, got);
+}
+
+bool HitAuth::tag(const uint8_t* data, size_t len, uint8_t out[HIT_AUTH_TAG_LEN]) {
+  if (!m_hasKey || !m_hasNonce) return false;
+  return computeTag(data, len, out);
+}
+
+bool HitAuth::check(const uint8_t* data, size_t len, const uint8_t tag[HIT_AUTH_TAG_LEN]) {
+  if (!m_hasKey || !m_hasNonce) return false;
+  uint8_t want[HIT_AUTH_TAG_LEN];
+  if (!computeTag(data, len, want)) return false;
+
+  // 定长比较，不因提前退出泄露匹配位数
+  uint8_t diff = 0;
+  for (size_t i = 0; i < HIT_AUTH_TAG_LEN; i++) diff |= tag[i] ^ want[i];
+  return diff == 0;
+}
+
+void HitAuth::toHex(const uint8_t* data, size_t len, char* out) {
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; i++) {
+    out[i * 2] = digits[data[i] >> 4];
+    out[i * 2 + 1] = digits[data[i] & 0x0F];
+  }
+  out[len * 2] = '\0';
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool HitAuth::parseHex(const char* text, size_t textLen, uint8_t* out, size_t len) {
+  if (textLen != len * 2) return false;
+  for (size_t i = 0; i < len; i++) {
+    int hi = hexValue(text[i * 2]);
+    int lo = hexValue(text[i * 2 + 1]);
+    if (hi < 0 || lo < 0) return false;
+    out[i] = (uint8_t)((hi << 4) | lo);
+  }
+  return true;
+}
\ No newline at end of file
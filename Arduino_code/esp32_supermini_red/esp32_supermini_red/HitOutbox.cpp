@@ -0,0 +1,73 @@
+#include "HitOutbox.h"
+
+// 16位序号回绕比较：a 在 b 之前（含相等）
+static inline bool seqAtOrBefore(uint16_t a, uint16_t b) {
+  return (int16_t)(a - b) <= 0;
+}
+
+HitOutbox::HitOutbox()
+  : m_head(0)
+  , m_count(0)
+  , m_nextSeq(1)
+  , m_retransmits(0)
+  , m_dropped(0) {
+}
+
+uint16_t HitOutbox::push(uint32_t timeMs, uint16_t score) {
+  if (m_count == HIT_OUTBOX_SIZE) {
+    // 满了：丢最旧一条，保证最新的击中一定能发出去
+    m_head = (m_head + 1) % HIT_OUTBOX_SIZE;
+    m_count--;
+    m_dropped++;
+  }
+  HitRecord& rec = at(m_count);
+  rec.seq = m_nextSeq++;
+  if (m_nextSeq == 0) m_nextSeq = 1; // 0 保留给“未确认任何记录”
+  rec.timeMs = timeMs;
+  rec.score = score;
+  rec.lastSendMs = 0;
+  rec.sendCount = 0;
+  m_count++;
+  return rec.seq;
+}
+
+void HitOutbox::ack(uint16_t seq) {
+  while (m_count > 0 && seqAtOrBefore(at(0).seq, seq)) {
+    m_head = (m_head + 1) % HIT_OUTBOX_SIZE;
+    m_count--;
+  }
+}
+
+HitRecord* HitOutbox::nextDue(uint32_t nowMs, bool allowRetransmit) {
+  for (uint8_t i = 0; i < m_count; i++) {
+    HitRecord& rec = at(i);
+    if (rec.sendCount == 0) return &rec;
+    if (allowRetransmit && nowMs - rec.lastSendMs >= HIT_ACK_TIMEOUT_MS) return &rec;
+  }
+  return nullptr;
+}
+
+void HitOutbox::markSent(HitRecord* rec, uint32_t nowMs) {
+  if (rec == nullptr) return;
+  if (rec->sendCount > 0) m_retransmits++;
+  if (rec->sendCount < 255) rec->sendCount++;
+  rec->lastSendMs = nowMs;
+}
+
+void HitOutbox::resetSendState() {
+  for (uint8_t i = 0; i < m_count; i++) {
+    at(i).sendCount = 0;
+  }
+}
+
+uint32_t HitOutbox::msUntilDue(uint32_t nowMs) const {
+  uint32_t best = UINT32_MAX;
+  for (uint8_t i = 0; i < m_count; i++) {
+    const HitRecord& rec = at(i);
+    if (rec.sendCount == 0) return 0;
+    uint32_t elapsed = nowMs - rec.lastSendMs;
+    uint32_t left = elapsed >= HIT_ACK_TIMEOUT_MS ? 0 : HIT_ACK_TIMEOUT_MS - elapsed;
+    if (left < best) best = left;
+  }
+  return best;
+}
\ No newline at end of file
@@ -3,6 +3,20 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "HitOutbox.h"
+#include "ToneEngine.h"
+#include "HitAuth.h"
+#include "OtaLink.h"
+#include "GattCache.h"
+#include "BladeMonitor.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include <Preferences.h>
 
 // =====================【引脚定义 - 完美适配ESP32C3 Supermini 无冲突】=====================
 #define FENCING_PIN     8    // 重剑信号采集GPIO
@@ -14,58 +28,515 @@
 // =====================【BLE蓝牙配置 - 与主机严格一致 不可修改】=====================
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+#define OTA_CHAR_UUID       "beb5483e-36e1-4688-b7f5-ea07361b26a9"  // 升级特征值（旧主机不认识，不影响计分）
+#define TELEMETRY_CHAR_UUID "beb5483e-36e1-4688-b7f5-ea07361b26aa"  // 遥测特征值（只读，主机借链路探测读取）
+#define GATT_LAYOUT_CHAR_UUID "beb5483e-36e1-4688-b7f5-ea07361b26ab" // 句柄布局（只读，主机缓存句柄、重连跳过服务发现）
 #define DEVICE_NAME         "epee_red"
 
+// =====================【低功耗配置 - 轻睡眠+动态调频+GPIO唤醒】=====================
+#define POWER_SAVE_ENABLE   1     // 1=轻睡眠+动态调频 0=旧固件行为(全速空转)
+#define POWER_MEASURE_MODE  0     // 1=每10秒打印醒着时间/估算电流/续航 用于和旧固件对比
+#define CPU_FREQ_MAX_MHZ    80    // BLE 运行需要的最低主频
+#define CPU_FREQ_MIN_MHZ    40    // 空闲时降到晶振频率
+#define IDLE_WAIT_MS        1000  // 空闲阻塞上限：没有击中就一直睡，靠GPIO唤醒
+#define ACTIVE_POLL_MS      1     // 消抖期间的采样周期（1个tick）
+// 唤醒→notify 上限：消抖时间 + 2个采样周期的量化误差 + 1ms 唤醒/调频余量
+#define WAKE_NOTIFY_BOUND_US ((DEBOUNCE_DELAY + 2 * ACTIVE_POLL_MS + 1) * 1000UL)
+
+// 连接参数（单位1.25ms）：7.5~15ms 间隔 + 从机延迟4，空闲时可跳过连接事件省电，有数据时下一个事件就发
+#define CONN_MIN_INTERVAL   0x06
+#define CONN_MAX_INTERVAL   0x0C
+#define CONN_SLAVE_LATENCY  4
+#define CONN_TIMEOUT_10MS   400
+#define OTA_CONN_INTERVAL   0x06  // 升级期间 7.5ms 固定间隔、无从机延迟，每个连接事件都收数据
+
+// =====================【功耗测量 - 估算参数（ESP32C3 数据手册典型值）】=====================
+#define MEASURE_INTERVAL_MS 10000
+#define BATTERY_MAH         220     // 601530 锂电池 220mAh（见 电池.jpg）
+#define CURRENT_ACTIVE_MA   17.0f   // 80MHz CPU 运行（射频另算）
+#define CURRENT_SLEEP_MA    0.13f   // 轻睡眠
+#define CURRENT_BLE_MA      1.5f    // 连接态射频平均电流（上面的连接参数下）
+#define CURRENT_LEGACY_MA   25.0f   // 旧固件：160MHz loop()空转 + 射频常开
+
 // =====================【状态变量】=====================
 bool hitState = false;
 bool lastHitState = false;
 unsigned long lastDebounceTime = 0;
 unsigned long hitLedOnTime = 0;
 bool hitLedIsOn = false;
-bool buzzerIsOn = false;
 int redScore = 0;
 bool deviceConnected = false;
+ToneEngine toneEngine;       // 蜂鸣器：LEDC+定时器播放，击中时只入队
 static BLE2902 ble2902Desc; // 解决内存泄漏 静态创建描述符
 
+// =====================【低功耗相关变量】=====================
+static SemaphoreHandle_t fencingWakeSem = NULL; // GPIO中断 → loop 唤醒信号
+static volatile int64_t fencingEdgeUs = 0;      // 最近一次剑尖接通的中断时间（微秒）
+static volatile bool fencingIntrArmed = false;  // 电平中断是否使能（ISR里关闭，loop里重新使能）
+static int64_t maxWakeToNotifyUs = 0;           // 实测 唤醒→notify 最大值
+static uint32_t boundViolations = 0;            // 超过上限的次数
+static int64_t awakeUs = 0;                     // loop 处于运行（非阻塞等待）的累计时间
+static int64_t measureStartUs = 0;
+
+// =====================【存储转发 - 未确认击中暂存+序号+重发】=====================
+HitOutbox hitOutbox;                          // 未确认击中暂存环
+static uint16_t sessionId = 0;                // 本次上电会话号，主机据此区分重启前后的序号
+static volatile bool masterAckCapable = false; // 主机发过 hello，支持确认（旧主机不补发，避免重复计分）
+static volatile bool replayRequested = false;  // 收到 hello：待确认记录全部补发
+static volatile int32_t pendingAckSeq = -1;    // 主机确认的序号，loop 里处理
+#define CLOCK_SAMPLES       4       // 收到 hello 后发几帧时钟样本，主机取空口最快的一帧估两边时钟差
+#define CLOCK_SAMPLE_GAP_MS 40      // 样本间隔：跨过几个连接事件，碰上链路层重传的只是其中几帧
+static uint8_t clockSamplesLeft = 0;           // 以下只在 loop 里读写
+static uint32_t clockSampleAt = 0;
+
+// =====================【热备主机 - 允许两台主机同时连接】=====================
+// 主用主机写 hello/确认/随机数；热备主机只订阅通知，主用心跳中断后由它写 hello 接管
+// 只有已配对时才为第二台主机继续广播：控制命令要验标签，未配对时只接一台主机
+#define MAX_CENTRALS        2
+static volatile uint8_t centralCount = 0;      // 当前连接的主机数
+static esp_bd_addr_t ackMasterBda;             // 写 hello 的主机地址（只有它断开才清确认/随机数）
+
+// =====================【击中帧认证 - 配对密钥+连接随机数】=====================
+#define AUTH_NS             "epee_auth"
+#define PAIR_MODE_MS        60000   // 上电时按住剑尖进入配对模式，持续这么久
+HitAuth hitAuth;                               // 已配对时每帧附 CMAC 标签，主机校验
+static unsigned long pairModeUntil = 0;        // 配对模式截止时间（0=未进入）
+static uint8_t pendingKey[HIT_AUTH_KEY_LEN];   // 主机下发的新密钥，loop 里写入 NVS
+static volatile bool pendingKeyReady = false;
+static uint8_t pendingNonce[HIT_AUTH_NONCE_LEN]; // 主机本次连接的随机数，loop 里生效
+static volatile bool pendingNonceReady = false;
+
+// 主机控制命令（随机数/hello/确认）校验：以下只在BLE任务里读写，与 loop 里签名用的 hitAuth 分开
+#define NONCE_HISTORY       8       // 本次上电用过的随机数，录下的旧随机数重放时拒绝
+static HitAuth ctrlAuth;
+static bool ctrlNonceSet = false;
+static uint8_t ctrlNonce[HIT_AUTH_NONCE_LEN];
+static esp_bd_addr_t nonceMasterBda;           // 写入当前随机数的主机，只有它的 hello 算数
+static uint8_t usedNonces[NONCE_HISTORY][HIT_AUTH_NONCE_LEN];
+static uint8_t usedNonceCount = 0;
+static volatile uint32_t ctrlRejected = 0;     // 标签不对/来源不对被丢弃的控制命令
+
+// =====================【蓝牙升级 - 写另一个OTA分区，断点续传】=====================
+#define OTA_NS              "epee_ota"
+#define OTA_RESTART_DELAY_MS 500    // 回完 DONE 再重启，主机收得到通知
+static bool otaMasterSet = false;              // 以下只在BLE任务里读写
+static esp_bd_addr_t otaMasterBda;             // 发出已认证 BEGIN 的主机，DATA/END/ABORT/QUERY 只认它
+
+/**
+ * @brief 剑端升级存储：目标为下一个OTA分区，差分基准为当前运行分区，续传进度存 NVS
+ */
+class PointerOtaFlash : public OtaFlash {
+public:
+  uint32_t capacity() override {
+    const esp_partition_t* p = target();
+    return p != NULL ? p->size : 0;
+  }
+  uint32_t baseCapacity() override { return esp_ota_get_running_partition()->size; }
+  bool readBase(uint32_t off, uint8_t* buf, size_t n) override {
+    return esp_partition_read(esp_ota_get_running_partition(), off, buf, n) == ESP_OK;
+  }
+  bool erase(uint32_t off, size_t n) override {
+    const esp_partition_t* p = target();
+    return p != NULL && esp_partition_erase_range(p, off, n) == ESP_OK;
+  }
+  bool write(uint32_t off, const uint8_t* data, size_t n) override {
+    const esp_partition_t* p = target();
+    return p != NULL && esp_partition_write(p, off, data, n) == ESP_OK;
+  }
+  bool readBack(uint32_t off, uint8_t* buf, size_t n) override {
+    const esp_partition_t* p = target();
+    return p != NULL && esp_partition_read(p, off, buf, n) == ESP_OK;
+  }
+  bool loadProgress(OtaProgress& out) override {
+    Preferences prefs;
+    if (!prefs.begin(OTA_NS, true)) return false;
+    bool ok = prefs.getBytes("prog", &out, sizeof(out)) == sizeof(out);
+    prefs.end();
+    return ok;
+  }
+  void saveProgress(const OtaProgress& p) override {
+    Preferences prefs;
+    if (!prefs.begin(OTA_NS, false)) return;
+    prefs.putBytes("prog", &p, sizeof(p));
+    prefs.end();
+  }
+  void clearProgress() override {
+    Preferences prefs;
+    if (!prefs.begin(OTA_NS, false)) return;
+    prefs.remove("prog");
+    prefs.end();
+  }
+  // esp_ota_set_boot_partition 会先校验镜像格式，不是有效固件就拒绝
+  bool activate() override {
+    const esp_partition_t* p = target();
+    return p != NULL && esp_ota_set_boot_partition(p) == ESP_OK;
+  }
+
+private:
+  const esp_partition_t* target() { return esp_ota_get_next_update_partition(NULL); }
+};
+
+static PointerOtaFlash otaFlash;
+static OtaReceiver otaReceiver(otaFlash);
+static BLE2902 otaCccdDesc;
+static esp_pm_lock_handle_t otaPmLock = NULL;   // 升级期间禁止轻睡眠
+static bool otaPmHeld = false;
+static volatile bool otaRestartPending = false;
+static unsigned long otaRestartAt = 0;
+
+// =====================【电量/健康遥测 - 空闲时低频采样，主机顺带读取】=====================
+// 电池经 100k/100k 分压接 GPIO3（常态耗电约 20uA）；没装分压时上报 bat:0，主机只看温度和复位原因
+#define BATTERY_PIN         3       // GPIO3 = ADC1_CH3
+#define BATTERY_DIVIDER     2
+#define BATTERY_PRESENT_MV  2500    // 折算后低于此值视为没装分压
+#define TELEMETRY_SAMPLE_MS 20000   // 主机每 30 秒读一次，采样略快于读取
+#define TELEMETRY_QUIET_MS  1000    // 击中后至少安静这么久才采样
+#define TELEMETRY_ADC_READS 8
+static unsigned long lastTelemetryMs = 0;
+static uint16_t telemetrySample = 0;
+
+// =====================【剑路监测 - ADC 连续采样（DMA）查器材故障】=====================
+// GPIO8 不能做 ADC：剑路另并一根线到 GPIO4（ADC1_CH4），偏置仍靠 FENCING_PIN 的内部上拉。
+// 判定击中照旧走 FENCING_PIN 的数字输入+消抖；这里只给每次接通分类，接触不良/电阻偏高/短路时上报主机。
+// 连续采样期间不能轻睡眠，只在剑尖接通前后开（松开后再采 BLADE_TAIL_MS 等分类完），
+// 空闲时每 BLADE_IDLE_CHECK_MS 抽查一小段查漏电。故障帧排在击中之后：有未确认击中时不发
+#define BLADE_MONITOR_ENABLE  1
+#define BLADE_ADC_PIN         4       // GPIO4 = ADC1_CH4
+#define BLADE_FRAME_BYTES     256     // DMA 一帧：每个结果 4 字节 → 64 个样本，约 13ms
+#define BLADE_POOL_BYTES      1024    // 驱动缓存约 50ms，采样期间 loop 每 BLADE_POLL_MS 取一次
+#define BLADE_POLL_MS         5
+#define BLADE_TAIL_MS         200
+#define BLADE_IDLE_CHECK_MS   10000
+#define BLADE_IDLE_WINDOW_MS  60
+#define BLADE_REPORT_MIN_MS   1000    // 上报最小间隔，期间的故障合并成最严重的一条
+static adc_continuous_handle_t bladeAdc = NULL;
+static BladeMonitor bladeMonitor;
+static bool bladeRunning = false;
+static unsigned long bladeStopAt = 0;
+static unsigned long bladeLastActivity = 0;   // 上次接通/抽查，空闲抽查从这里算
+static bool bladeFaultPending = false;
+static BladeEvent bladeFault;
+static unsigned long bladeLastReport = 0;
+
 // =====================【BLE相关变量】=====================
 BLEServer* pServer = NULL;
 BLECharacteristic* pCharacteristic = NULL;
+BLECharacteristic* pOtaCharacteristic = NULL;
+BLECharacteristic* pTelemetryCharacteristic = NULL;
+BLECharacteristic* pLayoutCharacteristic = NULL;
+
+// 新固件先不自动确认：连上主机收到 hello 才确认，确认前重启由引导程序回滚到旧固件
+extern "C" bool verifyRollbackLater() { return true; }
+
+/**
+ * @brief 剑尖接通中断 - 只记录时间并唤醒loop
+ * 低电平触发，触发后立即关闭本中断，避免按住剑尖时中断风暴；松开后由loop重新使能
+ */
+static void IRAM_ATTR fencingIsr(void* arg) {
+  gpio_intr_disable((gpio_num_t)FENCING_PIN);
+  fencingIntrArmed = false;
+  fencingEdgeUs = esp_timer_get_time();
+  BaseType_t woken = pdFALSE;
+  xSemaphoreGiveFromISR(fencingWakeSem, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+/**
+ * @brief 初始化低功耗：动态调频+自动轻睡眠，剑尖引脚同时作为中断和轻睡眠唤醒源
+ */
+void powerInit() {
+  fencingWakeSem = xSemaphoreCreateBinary();
+
+  gpio_install_isr_service(0); // Arduino 可能已安装，重复调用返回错误可忽略
+  gpio_set_intr_type((gpio_num_t)FENCING_PIN, GPIO_INTR_LOW_LEVEL);
+  gpio_isr_handler_add((gpio_num_t)FENCING_PIN, fencingIsr, NULL);
+  gpio_wakeup_enable((gpio_num_t)FENCING_PIN, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  fencingIntrArmed = true;
+
+#if POWER_SAVE_ENABLE
+  esp_pm_config_t pm = {};
+  pm.max_freq_mhz = CPU_FREQ_MAX_MHZ;
+  pm.min_freq_mhz = CPU_FREQ_MIN_MHZ;
+  pm.light_sleep_enable = true;
+  esp_err_t err = esp_pm_configure(&pm);
+  if (err == ESP_OK) {
+    Serial.printf("🔋【红方-省电】轻睡眠+动态调频已开启 %d~%dMHz\n", CPU_FREQ_MIN_MHZ, CPU_FREQ_MAX_MHZ);
+  } else {
+    Serial.printf("⚠️【红方-省电】电源管理不可用(err=0x%x)，仅保留GPIO唤醒阻塞等待\n", err);
+  }
+#endif
+  measureStartUs = esp_timer_get_time();
+}
+
+/**
+ * @brief 计算本轮loop可以阻塞多久：剑尖接通或消抖未完成时按1ms采样，否则一直睡到GPIO唤醒
+ */
+TickType_t idleWaitTicks(bool reading) {
+  if (otaRestartPending) return pdMS_TO_TICKS(ACTIVE_POLL_MS);
+  if (bladeRunning && !reading) return pdMS_TO_TICKS(BLADE_POLL_MS); // 剑路采样中：定时取 DMA 数据
+  if (reading || reading != hitState || !fencingIntrArmed) {
+    return pdMS_TO_TICKS(ACTIVE_POLL_MS);
+  }
+  // 击中灯还亮着：睡到熄灭时刻（蜂鸣器由 ToneEngine 定时器自行结束）
+  if (hitLedIsOn) {
+    unsigned long elapsed = millis() - hitLedOnTime;
+    return pdMS_TO_TICKS(elapsed >= 500 ? ACTIVE_POLL_MS : 500 - elapsed);
+  }
+  if (deviceConnected && masterAckCapable && clockSamplesLeft > 0) return pdMS_TO_TICKS(CLOCK_SAMPLE_GAP_MS);
+  // 有未确认的击中：最多睡到下一条重发时刻
+  if (deviceConnected && masterAckCapable && hitOutbox.count() > 0) {
+    uint32_t due = hitOutbox.msUntilDue(millis());
+    if (due < IDLE_WAIT_MS) return pdMS_TO_TICKS(due > 0 ? due : ACTIVE_POLL_MS);
+  }
+  return pdMS_TO_TICKS(IDLE_WAIT_MS);
+}
+
+/**
+ * @brief 功耗测量：按loop醒着的时间占比估算平均电流和单次充电续航，并与旧固件对比
+ */
+void powerMeasureReport() {
+#if POWER_MEASURE_MODE
+  int64_t now = esp_timer_get_time();
+  int64_t span = now - measureStartUs;
+  if (span < (int64_t)MEASURE_INTERVAL_MS * 1000) return;
+
+  float awakeRatio = (float)awakeUs / (float)span;
+  float currentMa = awakeRatio * CURRENT_ACTIVE_MA + (1.0f - awakeRatio) * CURRENT_SLEEP_MA;
+  if (deviceConnected) currentMa += CURRENT_BLE_MA;
+  Serial.printf("📊【红方-功耗】醒着 %.2f%% (%lldms/%lldms) | 估算电流 %.2fmA | 续航约 %.1fh (旧固件约 %.1fh)\n",
+                awakeRatio * 100.0f, awakeUs / 1000, span / 1000, currentMa,
+                BATTERY_MAH / currentMa, BATTERY_MAH / CURRENT_LEGACY_MA);
+  Serial.printf("📊【红方-时延】唤醒→notify 最大 %lldus | 上限 %luus | 超限 %lu 次\n",
+                maxWakeToNotifyUs, WAKE_NOTIFY_BOUND_US, boundViolations);
+  awakeUs = 0;
+  measureStartUs = now;
+#endif
+}
+
+/**
+ * @brief 已配对时校验一条控制命令：随机数用它自己签（且本次上电没用过），hello/确认用当前随机数签；
+ * hello 要来自写当前随机数的主机，确认要来自写 hello 的主机。成功时 bodyLen 为去掉标签后的长度
+ */
+static bool verifyControl(const String& value, const uint8_t* bda, size_t& bodyLen) {
+  const uint8_t* data = (const uint8_t*)value.c_str();
+  if (value.startsWith("nonce:")) {
+    uint8_t nonce[HIT_AUTH_NONCE_LEN];
+    size_t hexLen = HIT_AUTH_NONCE_LEN * 2;
+    if (value.length() < 6 + hexLen || !HitAuth::parseHex(value.c_str() + 6, hexLen, nonce, sizeof(nonce))) return false;
+    for (uint8_t i = 0; i < usedNonceCount && i < NONCE_HISTORY; i++) {
+      if (memcmp(usedNonces[i], nonce, sizeof(nonce)) == 0) return false;
+    }
+    ctrlAuth.setNonce(nonce);
+    if (!ctrlAuth.verify(data, value.length(), bodyLen) || bodyLen != 6 + hexLen) {
+      if (ctrlNonceSet) ctrlAuth.setNonce(ctrlNonce); // 校验不过：恢复当前随机数
+      else ctrlAuth.clearNonce();
+      return false;
+    }
+    memcpy(usedNonces[usedNonceCount % NONCE_HISTORY], nonce, sizeof(nonce));
+    usedNonceCount++;
+    memcpy(ctrlNonce, nonce, sizeof(nonce));
+    ctrlNonceSet = true;
+    memcpy(nonceMasterBda, bda, sizeof(nonceMasterBda));
+    return true;
+  }
+  if (!ctrlNonceSet || !ctrlAuth.verify(data, value.length(), bodyLen)) return false;
+  if (value.startsWith("hello")) return memcmp(bda, nonceMasterBda, sizeof(nonceMasterBda)) == 0;
+  if (value.startsWith("ack:")) return masterAckCapable && memcmp(bda, ackMasterBda, sizeof(ackMasterBda)) == 0;
+  return false;
+}
+
+/**
+ * @brief 主机写入回调 - "hello" 表示主机支持确认，"ack:<序号>" 为累积确认，
+ * "nonce:<16位十六进制>" 为本次连接随机数，"pair:<32位十六进制>" 为配对密钥（仅配对模式下接受）
+ * 已配对时 hello/ack/nonce 必须带 "|mac:<标签>"（见 verifyControl），否则丢弃：连进来的手机改不了确认和随机数
+ * 运行在BLE任务里，只记录请求并唤醒loop，暂存环和密钥只在loop里操作
+ */
+class MyCharCallbacks: public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* pChar, esp_ble_gatts_cb_param_t* param) {
+    String value = pChar->getValue();
+    if (value.startsWith("pair:")) {
+      if (pairModeUntil == 0 || (long)(millis() - pairModeUntil) > 0) return; // 不在配对模式，忽略
+      if (!HitAuth::parseHex(value.c_str() + 5, value.length() - 5, pendingKey, HIT_AUTH_KEY_LEN)) return;
+      ctrlAuth.setKey(pendingKey);
+      ctrlAuth.clearNonce();
+      ctrlNonceSet = false;
+      pendingKeyReady = true;
+      pChar->setValue("paired"); // 主机读回确认后才保存密钥
+      xSemaphoreGive(fencingWakeSem);
+      return;
+    }
+    size_t bodyLen = value.length();
+    if (ctrlAuth.hasKey() && !verifyControl(value, param->write.bda, bodyLen)) {
+      ctrlRejected++;
+      return;
+    }
+    String body = value.substring(0, bodyLen);
+    if (body == "hello") {
+      memcpy(ackMasterBda, param->write.bda, sizeof(ackMasterBda));
+      masterAckCapable = true;
+      replayRequested = true;
+    } else if (body.startsWith("ack:")) {
+      pendingAckSeq = body.substring(4).toInt();
+    } else if (body.startsWith("nonce:")) {
+      if (!HitAuth::parseHex(body.c_str() + 6, body.length() - 6, pendingNonce, HIT_AUTH_NONCE_LEN)) return;
+      pendingNonceReady = true;
+    } else {
+      return;
+    }
+    xSemaphoreGive(fencingWakeSem);
+  }
+};
+
+/**
+ * @brief 升级期间的连接参数和电源锁：收数据时不睡眠、不跳连接事件，结束后恢复省电参数
+ */
+void otaPowerHold(bool hold, const esp_bd_addr_t bda) {
+  if (hold == otaPmHeld) return;
+  otaPmHeld = hold;
+  if (otaPmLock != NULL) {
+    if (hold) esp_pm_lock_acquire(otaPmLock);
+    else esp_pm_lock_release(otaPmLock);
+  }
+  if (bda == NULL) return;
+  if (hold) {
+    pServer->updateConnParams((uint8_t*)bda, OTA_CONN_INTERVAL, OTA_CONN_INTERVAL, 0, CONN_TIMEOUT_10MS);
+  } else {
+#if POWER_SAVE_ENABLE
+    pServer->updateConnParams((uint8_t*)bda, CONN_MIN_INTERVAL, CONN_MAX_INTERVAL,
+                              CONN_SLAVE_LATENCY, CONN_TIMEOUT_10MS);
+#endif
+  }
+}
+
+/**
+ * @brief 升级写入校验：未配对不接受蓝牙升级；BEGIN 要来自写过已认证 hello 的主机，带对 [0x01][镜像头] 的标签
+ * （当前随机数签，镜像头含整包 CRC32）；其余消息只认发 BEGIN 的那台主机
+ */
+static bool verifyOtaWrite(const uint8_t* data, size_t len, const uint8_t* bda) {
+  if (len == 0 || !ctrlAuth.hasKey()) return false;
+  if (data[0] != OTA_MSG_BEGIN) return otaMasterSet && memcmp(bda, otaMasterBda, sizeof(otaMasterBda)) == 0;
+  if (len != OTA_BEGIN_LEN || !ctrlNonceSet || !masterAckCapable) return false;
+  if (memcmp(bda, ackMasterBda, sizeof(ackMasterBda)) != 0) return false;
+  if (!ctrlAuth.check(data, 1 + OTA_HEADER_LEN, data + 1 + OTA_HEADER_LEN)) return false;
+  memcpy(otaMasterBda, bda, sizeof(otaMasterBda));
+  otaMasterSet = true;
+  return true;
+}
+
+/**
+ * @brief 升级特征值写入回调：校验来源后 BEGIN/DATA/END/ABORT/QUERY 交给 OtaReceiver，需要回状态时 notify
+ * 运行在BLE任务里；擦写闪存期间主机的无响应写在协议栈里排队
+ */
+class OtaCharCallbacks: public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* pChar, esp_ble_gatts_cb_param_t* param) {
+    uint8_t reply[OTA_STATUS_LEN];
+    size_t replyLen = 0;
+    const uint8_t* data = pChar->getData();
+    size_t len = pChar->getLength();
+    uint8_t type = len > 0 ? data[0] : 0;
+    if (!verifyOtaWrite(data, len, param->write.bda)) {
+      ctrlRejected++; // 不回状态：回了会通知到所有主机，打断正在升级的那台
+      if (type == OTA_MSG_BEGIN) {
+        Serial.println(ctrlAuth.hasKey() ? "⚠️【红方-升级】拒绝：BEGIN 未认证" : "⚠️【红方-升级】拒绝：未配对不接受蓝牙升级");
+      }
+      return;
+    }
+    if (type == OTA_MSG_BEGIN) len = 1 + OTA_HEADER_LEN; // 去掉标签
+    if (otaReceiver.handle(data, len, reply, replyLen)) {
+      pChar->setValue(reply, replyLen);
+      pChar->notify();
+    }
+    otaPowerHold(otaReceiver.active(), param->write.bda);
+    if (type == OTA_MSG_BEGIN) {
+      if (otaReceiver.active()) {
+        Serial.printf("⬇️【红方-升级】开始接收 %lu 字节，已写 %lu\n",
+                      (unsigned long)otaReceiver.outSize(), (unsigned long)otaReceiver.nextOut());
+      } else {
+        Serial.printf("⚠️【红方-升级】拒绝：%s\n", otaErrorName(otaReceiver.error()));
+      }
+    } else if (type == OTA_MSG_END && otaReceiver.done() && !otaRestartPending) {
+      Serial.println("✅【红方-升级】新固件校验通过，重启进入新固件");
+      otaRestartAt = millis() + OTA_RESTART_DELAY_MS;
+      otaRestartPending = true;
+      xSemaphoreGive(fencingWakeSem);
+    } else if (otaReceiver.state() == OTA_STATE_ERROR && type != OTA_MSG_QUERY) {
+      Serial.printf("❌【红方-升级】失败：%s\n", otaErrorName(otaReceiver.error()));
+    }
+  }
+};
 
 /**
  * @brief BLE连接回调类
  */
 class MyServerCallbacks: public BLEServerCallbacks {
-  void onConnect(BLEServer* pServer) {
+  void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
     deviceConnected = true;
+    centralCount++;
     digitalWrite(LED_BLUETOOTH, HIGH);
     Serial.println("✅【红方-蓝牙】BLE计分主机 已成功连接！");
+#if POWER_SAVE_ENABLE
+    // 请求带从机延迟的连接参数：空闲时射频少醒，有击中时下一个连接事件立即发送
+    pServer->updateConnParams(param->connect.remote_bda, CONN_MIN_INTERVAL, CONN_MAX_INTERVAL,
+                              CONN_SLAVE_LATENCY, CONN_TIMEOUT_10MS);
+#endif
+    // 连上后广播会停：已配对且还没满两台主机就继续广播，热备主机才能连进来
+    if (ctrlAuth.hasKey() && centralCount < MAX_CENTRALS) BLEDevice::startAdvertising();
   };
 
-  void onDisconnect(BLEServer* pServer) {
-    deviceConnected = false;
-    digitalWrite(LED_BLUETOOTH, LOW);
+  void onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    if (centralCount > 0) centralCount--;
+    deviceConnected = centralCount > 0;
+    // 热备主机断开不影响主用主机的确认和随机数
+    if (centralCount == 0 || memcmp(param->disconnect.remote_bda, ackMasterBda, sizeof(ackMasterBda)) == 0) {
+      masterAckCapable = false;
+      hitAuth.clearNonce(); // 随机数只对本次连接有效
+    }
+    if (centralCount == 0 || memcmp(param->disconnect.remote_bda, nonceMasterBda, sizeof(nonceMasterBda)) == 0) {
+      ctrlNonceSet = false;
+      ctrlAuth.clearNonce();
+    }
+    if (otaMasterSet && memcmp(param->disconnect.remote_bda, otaMasterBda, sizeof(otaMasterBda)) == 0) otaMasterSet = false;
+    // 升级中掉线：进度留在内存和 NVS，主机重连后续传；先放开电源锁
+    otaPowerHold(false, NULL);
+    if (!deviceConnected) digitalWrite(LED_BLUETOOTH, LOW);
     Serial.println("❌【红方-蓝牙】与BLE主机断开连接！");
     BLEDevice::startAdvertising();
     Serial.println("✅【红方-蓝牙】重新开启广播，等待主机重连...");
   }
 };
 
+// 把本机各特征值/CCCD 的句柄写进布局特征值：主机按地址缓存，重连时读一次核对后直接打开通知
+// 固件增删特征值后句柄变化，文本随之变化，主机的旧缓存自动作废
+void publishGattLayout() {
+  GattLayout layout;
+  layout.hit = pCharacteristic->getHandle();
+  layout.hitCccd = ble2902Desc.getHandle();
+  layout.ota = pOtaCharacteristic->getHandle();
+  layout.otaCccd = otaCccdDesc.getHandle();
+  layout.telemetry = pTelemetryCharacteristic->getHandle();
+  layout.layout = pLayoutCharacteristic->getHandle();
+  char text[GATT_LAYOUT_TEXT_MAX];
+  if (gattLayoutFormat(layout, text, sizeof(text)) == 0) return;
+  pLayoutCharacteristic->setValue(text);
+  Serial.printf("🧭【红方-蓝牙】句柄布局 %s\n", text);
+}
+
 void setup() {
   pinMode(LED_HIT, OUTPUT);
   pinMode(LED_BLUETOOTH, OUTPUT);
-  pinMode(BUZZER_PIN, OUTPUT);
   digitalWrite(LED_HIT, LOW);
   digitalWrite(LED_BLUETOOTH, LOW);
-  digitalWrite(BUZZER_PIN, LOW);
+  toneEngine.begin(BUZZER_PIN, false);
   pinMode(FENCING_PIN, INPUT_PULLUP); // 防浮空误触
 
-  Serial.begin(115200);
-  Serial.println("==================================");
-  Serial.println("=== 重剑计分器（红方-ESP32C3 完整版） ===");
-  Serial.println("==================================");
+  Serial.begin(115200); // 不等串口，先起广播，主机重启后能立刻连回
+
+  authInit(); // 密钥先于广播载入：第一台主机连上时控制命令就要验标签
 
   // BLE初始化核心 - 修复Notify权限 必加 INDICATE
   BLEDevice::init(DEVICE_NAME);
+  BLEDevice::setMTU(OTA_MTU); // 升级块一条写放得下；主机不请求大 MTU 时仍按 23
   pServer = BLEDevice::createServer();
   pServer->setCallbacks(new MyServerCallbacks());
 
@@ -74,13 +545,27 @@ void setup() {
                       CHARACTERISTIC_UUID,
                       BLECharacteristic::PROPERTY_READ |
                       BLECharacteristic::PROPERTY_WRITE |
+                      BLECharacteristic::PROPERTY_WRITE_NR |  // 主机确认用无响应写，不占用往返
                       BLECharacteristic::PROPERTY_NOTIFY |  // 原始保留
                       BLECharacteristic::PROPERTY_INDICATE  // ✅ 关键新增 缺一不可
                     );
   
   pCharacteristic->addDescriptor(&ble2902Desc);
+  pCharacteristic->setCallbacks(new MyCharCallbacks());
   pCharacteristic->setValue("RED:0");
+  pOtaCharacteristic = pService->createCharacteristic(
+                      OTA_CHAR_UUID,
+                      BLECharacteristic::PROPERTY_WRITE |
+                      BLECharacteristic::PROPERTY_WRITE_NR |
+                      BLECharacteristic::PROPERTY_NOTIFY
+                    );
+  pOtaCharacteristic->addDescriptor(&otaCccdDesc);
+  pOtaCharacteristic->setCallbacks(new OtaCharCallbacks());
+  pTelemetryCharacteristic = pService->createCharacteristic(TELEMETRY_CHAR_UUID, BLECharacteristic::PROPERTY_READ);
+  pTelemetryCharacteristic->setValue("bat:0|tc:0|rst:0|up:0|n:0");
+  pLayoutCharacteristic = pService->createCharacteristic(GATT_LAYOUT_CHAR_UUID, BLECharacteristic::PROPERTY_READ);
   pService->start();
+  publishGattLayout(); // 句柄在 start() 之后才分配好
 
   BLEAdvertising *pAdvertising = BLEDevice::getAdvertising();
   pAdvertising->addServiceUUID(SERVICE_UUID);
@@ -90,11 +575,32 @@ void setup() {
   pAdvertising->setMinPreferred(0x12);
   pAdvertising->start();
 
-  Serial.println("📶【红方-蓝牙】广播启动成功，设备名：epee_red");
+  Serial.println("==================================");
+  Serial.println("=== 重剑计分器（红方-ESP32C3 完整版） ===");
+  Serial.println("==================================");
+  Serial.printf("📶【红方-蓝牙】广播启动成功（上电后 %lu ms），设备名：epee_red\n", (unsigned long)(esp_timer_get_time() / 1000));
+
+  powerInit();
+  sessionId = (uint16_t)(esp_random() & 0xFFFF);
+  otaInit();
+  bladeInit();
   Serial.println("🟥【红方-就绪】重剑采集就绪，等待击中信号！");
 }
 
 void loop() {
+  // 阻塞等待：空闲时CPU交给IDLE任务进入轻睡眠，剑尖接通由GPIO中断立即唤醒
+  bool idleReading = !digitalRead(FENCING_PIN);
+  xSemaphoreTake(fencingWakeSem, idleWaitTicks(idleReading));
+  int64_t loopStart = esp_timer_get_time();
+
+  // 升级完成：等 DONE 通知发出去再重启
+  if (otaRestartPending && (long)(millis() - otaRestartAt) >= 0) {
+    ESP.restart();
+  }
+
+  // 处理主机确认/补发请求，并发出到期的击中记录
+  serviceHitOutbox();
+
   // 重剑信号采集+消抖逻辑 不变
   bool currentReading = digitalRead(FENCING_PIN);
   currentReading = !currentReading;
@@ -111,21 +617,243 @@ void loop() {
       }
     }
   }
-/*
-  // 击中指示灯+蜂鸣器时序控制
-  if (hitLedIsOn || buzzerIsOn) {
+
+  // 击中指示灯时序控制：指示灯亮500ms（蜂鸣200ms 由 ToneEngine 负责）
+  if (hitLedIsOn) {
     unsigned long now = millis();
-    if (buzzerIsOn && (now - hitLedOnTime) >= 200) {
-      digitalWrite(BUZZER_PIN, LOW);
-      buzzerIsOn = false;
-    }
-    if (hitLedIsOn && (now - hitLedOnTime) >= 500) {
+    if ((now - hitLedOnTime) >= 500) {
       digitalWrite(LED_HIT, LOW);
       hitLedIsOn = false;
     }
   }
-*/
+
   lastHitState = currentReading;
+
+  // 剑尖已松开且消抖完成：重新使能电平中断，等待下一次击中
+  if (!fencingIntrArmed && !currentReading && !hitState) {
+    fencingIntrArmed = true;
+    gpio_intr_enable((gpio_num_t)FENCING_PIN);
+  }
+
+  serviceBlade(currentReading);
+  serviceTelemetry(currentReading);
+
+  awakeUs += esp_timer_get_time() - loopStart;
+  powerMeasureReport();
+}
+
+/**
+ * @brief 认证初始化：读取配对密钥；上电时剑尖按住则进入配对模式，等主机下发新密钥
+ */
+void authInit() {
+  Preferences prefs;
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  if (prefs.begin(AUTH_NS, true)) {
+    if (prefs.getBytes("key", key, sizeof(key)) == sizeof(key)) {
+      hitAuth.setKey(key);
+      ctrlAuth.setKey(key);
+    }
+    prefs.end();
+  }
+  Serial.printf("🔐【红方-认证】%s\n", hitAuth.hasKey() ? "已配对，击中帧附认证标签" : "未配对，按旧格式上报");
+  if (digitalRead(FENCING_PIN) == LOW) {
+    pairModeUntil = millis() + PAIR_MODE_MS;
+    Serial.printf("🔐【红方-认证】剑尖按住上电，进入配对模式 %d 秒，请在主机串口按 p\n", PAIR_MODE_MS / 1000);
+  }
+}
+
+/**
+ * @brief 电量/健康采样：只在完全空闲时做（剑尖没接通、消抖和亮灯结束、没有待发击中），
+ * 和击中上报错开；结果只更新遥测特征值，由主机在链路探测时读走，不主动发包
+ */
+void serviceTelemetry(bool reading) {
+  unsigned long now = millis();
+  if (lastTelemetryMs != 0 && now - lastTelemetryMs < TELEMETRY_SAMPLE_MS) return;
+  if (reading || hitState || hitLedIsOn || !fencingIntrArmed || otaReceiver.active()) return;
+  if (bladeRunning) return; // ADC1 正被连续采样占用
+  if (deviceConnected && hitOutbox.count() > 0) return;
+  if (now - hitLedOnTime < TELEMETRY_QUIET_MS) return;
+  lastTelemetryMs = now;
+
+  uint32_t sum = 0;
+  for (int i = 0; i < TELEMETRY_ADC_READS; i++) sum += analogReadMilliVolts(BATTERY_PIN);
+  uint32_t mv = sum / TELEMETRY_ADC_READS * BATTERY_DIVIDER;
+  if (mv < BATTERY_PRESENT_MV) mv = 0;
+  int tempC = (int)temperatureRead();
+
+  char text[64];
+  snprintf(text, sizeof(text), "bat:%lu|tc:%d|rst:%d|up:%lu|n:%u", (unsigned long)mv, tempC,
+           (int)esp_reset_reason(), (unsigned long)(now / 1000), ++telemetrySample);
+  pTelemetryCharacteristic->setValue(text);
+}
+
+/**
+ * @brief 剑路采样初始化：配置 ADC 连续模式（先不启动），接通/抽查时再按需开关
+ */
+void bladeInit() {
+#if BLADE_MONITOR_ENABLE
+  adc_unit_t unit;
+  adc_channel_t channel;
+  if (adc_continuous_io_to_channel(BLADE_ADC_PIN, &unit, &channel) != ESP_OK || unit != ADC_UNIT_1) {
+    Serial.printf("⚠️【红方-剑路】GPIO%d 不是 ADC1 引脚，剑路监测关闭\n", BLADE_ADC_PIN);
+    return;
+  }
+  adc_continuous_handle_cfg_t handleCfg = {};
+  handleCfg.max_store_buf_size = BLADE_POOL_BYTES;
+  handleCfg.conv_frame_size = BLADE_FRAME_BYTES;
+  if (adc_continuous_new_handle(&handleCfg, &bladeAdc) != ESP_OK) {
+    Serial.println("⚠️【红方-剑路】ADC 连续模式不可用，剑路监测关闭");
+    bladeAdc = NULL;
+    return;
+  }
+  adc_digi_pattern_config_t pattern = {};
+  pattern.atten = ADC_ATTEN_DB_12;
+  pattern.channel = channel;
+  pattern.unit = unit;
+  pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  adc_continuous_config_t cfg = {};
+  cfg.pattern_num = 1;
+  cfg.adc_pattern = &pattern;
+  cfg.sample_freq_hz = BLADE_SAMPLE_HZ;
+  cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  if (adc_continuous_config(bladeAdc, &cfg) != ESP_OK) {
+    Serial.println("⚠️【红方-剑路】ADC 连续模式配置失败，剑路监测关闭");
+    adc_continuous_deinit(bladeAdc);
+    bladeAdc = NULL;
+    return;
+  }
+  Serial.printf("🩺【红方-剑路】剑路监测就绪 GPIO%d %dHz\n", BLADE_ADC_PIN, BLADE_SAMPLE_HZ);
+#endif
+}
+
+/**
+ * @brief 一次接通分类完成：正常的不管，故障打印并合并进待上报（保留最严重的一类）
+ */
+void bladeOnEvent(const BladeEvent& ev) {
+  if (ev.kind == BLADE_CLEAN) return;
+  Serial.printf("🩺【红方-剑路】%s：接通 %lu ms，平均电平 %u‰，稳定后断开 %u 次\n", BladeMonitor::className(ev.kind),
+                (unsigned long)ev.durationMs, ev.level, ev.edges);
+  if (!bladeFaultPending || ev.kind >= bladeFault.kind) bladeFault = ev;
+  bladeFaultPending = true;
+}
+
+/**
+ * @brief 取走 DMA 里已转换的样本喂给分类器（不等待）
+ */
+void bladeDrain() {
+  uint8_t buf[BLADE_FRAME_BYTES];
+  uint32_t n = 0;
+  const uint32_t fullScale = (1u << SOC_ADC_DIGI_MAX_BITWIDTH) - 1;
+  while (adc_continuous_read(bladeAdc, buf, sizeof(buf), &n, 0) == ESP_OK) {
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= n; i += SOC_ADC_DIGI_RESULT_BYTES) {
+      const adc_digi_output_data_t* d = (const adc_digi_output_data_t*)&buf[i];
+      BladeEvent ev;
+      if (bladeMonitor.feed((uint16_t)(d->type2.data * 1000 / fullScale), ev)) bladeOnEvent(ev);
+    }
+  }
+}
+
+void bladeStart(unsigned long stopAt) {
+  if (!bladeRunning) {
+    if (adc_continuous_start(bladeAdc) != ESP_OK) return;
+    bladeMonitor.reset();
+    bladeRunning = true;
+  }
+  bladeStopAt = stopAt;
+}
+
+// 停止前把剩下的样本取完；窗口结束时还没松开的接通按已采到的部分分类（空闲抽查据此发现漏电）
+void bladeStop() {
+  bladeDrain();
+  adc_continuous_stop(bladeAdc);
+  bladeRunning = false;
+  BladeEvent ev;
+  if (bladeMonitor.flush(ev)) bladeOnEvent(ev);
+}
+
+/**
+ * @brief 故障上报：经击中特征值通知 fault: 帧（已配对时带标签）；有未确认击中时让路，击中永远先发
+ * 只发给写过 hello 的主机：旧主机和 epee_sup_min 把每条通知都当击中，故障留到新主机连上再报
+ */
+void sendBladeFault(unsigned long now) {
+  if (!bladeFaultPending || !deviceConnected || !masterAckCapable || hitOutbox.count() > 0) return;
+  if (bladeLastReport != 0 && now - bladeLastReport < BLADE_REPORT_MIN_MS) return;
+  char text[BLADE_FAULT_TEXT_MAX + 16]; // 留出标签
+  if (bladeFaultFormat(bladeFault, bladeMonitor.faults(), text, sizeof(text)) == 0) {
+    bladeFaultPending = false;
+    return;
+  }
+  if (hitAuth.hasKey() && !hitAuth.sign(text, sizeof(text))) return; // 等主机下发随机数
+  pCharacteristic->setValue(text);
+  pCharacteristic->notify();
+  bladeFaultPending = false;
+  bladeLastReport = now;
+  Serial.printf("📤【红方-剑路】上报 %s\n", text);
+}
+
+/**
+ * @brief 剑路监测：剑尖接通（或消抖、等待松开）时采样，松开后再采一段；空闲时定期抽查
+ * 放在击中处理之后，只取 DMA 已有的数据，不阻塞
+ */
+void serviceBlade(bool reading) {
+#if BLADE_MONITOR_ENABLE
+  if (bladeAdc == NULL) return;
+  unsigned long now = millis();
+  if (otaReceiver.active()) {
+    if (bladeRunning) bladeStop();
+    return;
+  }
+  bool contact = reading || hitState || !fencingIntrArmed;
+  if (contact) {
+    bladeLastActivity = now;
+    bladeStart(now + BLADE_TAIL_MS);
+  } else if (!bladeRunning && now - bladeLastActivity >= BLADE_IDLE_CHECK_MS) {
+    bladeLastActivity = now;
+    bladeStart(now + BLADE_IDLE_WINDOW_MS);
+  }
+  if (bladeRunning) {
+    bladeDrain();
+    if (!contact && (long)(now - bladeStopAt) >= 0) bladeStop();
+  }
+  sendBladeFault(now);
+#endif
+}
+
+/**
+ * @brief 升级初始化：电源锁，打印当前分区；刚升级的新固件提示等待主机确认
+ */
+void otaInit() {
+  esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "ota", &otaPmLock);
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  esp_ota_img_states_t st;
+  bool pending = esp_ota_get_state_partition(running, &st) == ESP_OK && st == ESP_OTA_IMG_PENDING_VERIFY;
+  Serial.printf("⬇️【红方-升级】运行分区 %s%s\n", running->label, pending ? "（新固件，等主机 hello 确认）" : "");
+}
+
+/**
+ * @brief 新固件连上支持确认的主机：标记有效，取消回滚
+ */
+void otaConfirmImage() {
+  esp_ota_img_states_t st;
+  if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &st) != ESP_OK || st != ESP_OTA_IMG_PENDING_VERIFY) return;
+  if (esp_ota_mark_app_valid_cancel_rollback() == ESP_OK) {
+    Serial.println("✅【红方-升级】新固件已连上主机，确认有效（不再回滚）");
+  }
+}
+
+/**
+ * @brief 保存主机下发的配对密钥并立即生效
+ */
+void saveAuthKey(const uint8_t* key) {
+  Preferences prefs;
+  if (prefs.begin(AUTH_NS, false)) {
+    prefs.putBytes("key", key, HIT_AUTH_KEY_LEN);
+    prefs.end();
+  }
+  hitAuth.setKey(key);
+  pairModeUntil = 0;
+  Serial.println("🔐【红方-认证】配对完成，密钥已保存");
 }
 
 /**
@@ -133,26 +861,131 @@ void loop() {
  */
 void hitEvent() {
   digitalWrite(LED_HIT, HIGH);
-  digitalWrite(BUZZER_PIN, HIGH);
+  toneEngine.play(TONE_POINTER_HIT, true); // 蜂鸣200ms由定时器自行结束
   hitLedOnTime = millis();
   hitLedIsOn = true;
-  buzzerIsOn = true;
 
   if(redScore < 99) redScore++;
-  String timeStr = String(millis());  
-  Serial.print("🎯【红方-击中】时间戳：");
-  Serial.print(timeStr);
-  Serial.print(" | 红方得分：");
-  Serial.println(redScore);
+  uint32_t hitMs = millis();
+  uint16_t seq = hitOutbox.push(hitMs, redScore);
+  Serial.printf("🎯【红方-击中】时间戳：%lu | 红方得分：%d | 序号：%u\n", hitMs, redScore, seq);
 
   // ✅ 关键修复：使用库原生连接判断，杜绝发空包，适配最新Arduino BLE库
   BLEServer *pServer = BLEDevice::getServer();
   if (pServer != NULL && pServer->getConnectedCount() > 0) {
-    String scoreData = "time:" + timeStr + "|RED:" + String(redScore);
-    pCharacteristic->setValue(scoreData.c_str());
-    pCharacteristic->notify();
-    Serial.println("📤【红方-上报】成功推送数据 → " + scoreData + "\n");
+    if (masterAckCapable) {
+      sendDueHits();
+    } else if (hitAuth.hasKey()) {
+      Serial.println("⚠️【红方-认证】主机尚未下发随机数，击中暂存等待补发");
+    } else {
+      // 旧主机不发确认：新击中照旧只发一次，连同之前暂存的一起清掉（旧主机收不到补发）
+      sendHitRecord(hitOutbox.newest(), millis());
+      hitOutbox.ack(seq);
+    }
   } else {
-    Serial.println("⚠️【红方-提示】无BLE主机连接，得分暂存本地\n");
+    Serial.printf("⚠️【红方-提示】无BLE主机连接，击中已暂存本地（待发 %u 条）\n\n", (unsigned)hitOutbox.count());
+  }
+}
+
+/**
+ * @brief 处理主机写入的确认/补发请求，再把到期的记录发出去
+ */
+void serviceHitOutbox() {
+  static uint32_t ctrlRejectedShown = 0;
+  uint32_t rejected = ctrlRejected;
+  if (rejected != ctrlRejectedShown) {
+    ctrlRejectedShown = rejected;
+    Serial.printf("⚠️【红方-认证】丢弃未认证的主机命令，累计 %lu 条\n", (unsigned long)rejected);
+  }
+  if (pendingKeyReady) {
+    pendingKeyReady = false;
+    saveAuthKey(pendingKey);
+  }
+  if (pendingNonceReady) {
+    pendingNonceReady = false;
+    hitAuth.setNonce(pendingNonce);
+  }
+  int32_t ackSeq = pendingAckSeq;
+  if (ackSeq >= 0) {
+    pendingAckSeq = -1;
+    hitOutbox.ack((uint16_t)ackSeq);
+  }
+  if (replayRequested) {
+    replayRequested = false;
+    hitOutbox.resetSendState();
+    otaConfirmImage();
+    clockSamplesLeft = CLOCK_SAMPLES;
+    clockSampleAt = millis();
+    if (hitOutbox.count() > 0) {
+      Serial.printf("🔁【红方-补发】主机支持确认，补发暂存击中 %u 条\n", (unsigned)hitOutbox.count());
+    }
+  }
+  if (deviceConnected && masterAckCapable) {
+    sendDueHits();
+    sendClockSample();
+  }
+}
+
+/**
+ * @brief 发一帧时钟样本 "clk:<millis>|sid:<会话号>"（已配对时带标签）：主机据此把击中时刻换算到自己的时钟，
+ * 击中帧在空口多等的时间不算进击中时间。只发给写过 hello 的主机；有未确认击中时让路
+ */
+void sendClockSample() {
+  if (clockSamplesLeft == 0 || hitOutbox.count() > 0) return;
+  uint32_t now = millis();
+  if ((int32_t)(now - clockSampleAt) < 0) return;
+  char text[48];
+  snprintf(text, sizeof(text), "clk:%lu|sid:%04x", (unsigned long)now, sessionId);
+  if (hitAuth.hasKey() && !hitAuth.sign(text, sizeof(text))) return; // 等主机下发随机数
+  pCharacteristic->setValue(text);
+  pCharacteristic->notify();
+  clockSamplesLeft--;
+  clockSampleAt = now + CLOCK_SAMPLE_GAP_MS;
+}
+
+/**
+ * @brief 发送到期的击中记录：没发过的立即发，超时未确认的重发（仅限支持确认的主机）
+ */
+void sendDueHits() {
+  uint32_t now = millis();
+  HitRecord* rec;
+  while ((rec = hitOutbox.nextDue(now, true)) != nullptr) {
+    if (!sendHitRecord(rec, now)) break;
+  }
+}
+
+/**
+ * @brief 发出一条击中记录
+ * 在原格式后追加 序号/会话号/击中到发送的延迟/暂存环最旧序号，旧主机按 time: 解析不受影响
+ */
+bool sendHitRecord(HitRecord* rec, uint32_t now) {
+  if (rec == nullptr) return false;
+  bool isRetransmit = rec->sendCount > 0;
+  char scoreData[96];
+  snprintf(scoreData, sizeof(scoreData), "time:%lu|RED:%u|seq:%u|sid:%04x|age:%lu|old:%u",
+           (unsigned long)rec->timeMs, rec->score, rec->seq, sessionId, (unsigned long)(now - rec->timeMs),
+           hitOutbox.oldest()->seq);
+  // 已配对：附认证标签；还没拿到本次连接的随机数就先不发，留在暂存环里
+  if (hitAuth.hasKey() && !hitAuth.sign(scoreData, sizeof(scoreData))) return false;
+  pCharacteristic->setValue(scoreData);
+  pCharacteristic->notify();
+  hitOutbox.markSent(rec, now);
+  if (!isRetransmit) recordWakeToNotify();
+  Serial.printf("📤【红方-上报】%s → %s | 累计重发 %lu 次\n\n", isRetransmit ? "重发" : "推送",
+                scoreData, (unsigned long)hitOutbox.retransmits());
+  return true;
+}
+
+/**
+ * @brief 记录从剑尖接通中断到notify发出的时延，检查是否超过保证上限
+ */
+void recordWakeToNotify() {
+  if (fencingEdgeUs == 0) return;
+  int64_t latency = esp_timer_get_time() - fencingEdgeUs;
+  fencingEdgeUs = 0;
+  if (latency > maxWakeToNotifyUs) maxWakeToNotifyUs = latency;
+  if (latency > (int64_t)WAKE_NOTIFY_BOUND_US) {
+    boundViolations++;
+    Serial.printf("⚠️【红方-时延】唤醒→notify %lldus 超过上限 %luus\n", latency, WAKE_NOTIFY_BOUND_US);
   }
 }
\ No newline at end of file
@@ -0,0 +1,140 @@
+// 击中帧认证向量检查（Linux 主机端）：不用射频验证 HitAuth 的 CMAC 和帧格式
+//
+// 编译（主机端用 OpenSSL 代替 mbedtls，算法相同）：
+//   cd Arduino_code/host_tools/hit_auth_vectors
+//   g++ -O2 -DHIT_AUTH_HOST_OPENSSL -I../../epee_esp32_s3 -o hit_auth_vectors hit_auth_vectors.cpp ../../epee_esp32_s3/HitAuth.cpp -lcrypto
+//
+// 检查内容：
+//   1. RFC 4493 AES-CMAC 向量（随机数取消息前8字节，其余作为帧正文，标签截断为前4字节）
+//   2. 方案固定向量，签名/校验往返、篡改正文、换随机数（跨连接重放）、截断标签、未配对
+//   3. 二进制消息的 tag/check（热备心跳、剑端控制命令、升级镜像头）
+// 全部通过返回 0
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "HitAuth.h"
+
+static int g_failed = 0;
+
+static void check(bool ok, const char* name) {
+  printf("%s  %s\n", ok ? "PASS" : "FAIL", name);
+  if (!ok) g_failed++;
+}
+
+static void parse(const char* hex, uint8_t* out, size_t len) {
+  HitAuth::parseHex(hex, strlen(hex), out, len);
+}
+
+// RFC 4493 第4节：K = 2b7e1516 28aed2a6 abf71588 09cf4f3c
+static const char* RFC_KEY = "2b7e151628aed2a6abf7158809cf4f3c";
+static const char* RFC_MSG =
+  "6bc1bee22e409f96e93d7e117393172a"
+  "ae2d8a571e03ac9c9eb76fac45af8e51"
+  "30c81c46a35ce411e5fbc1191a0a52ef"
+  "f69f2445df4f9b17ad2b417be66c3710";
+
+struct RfcVector {
+  size_t msgLen;
+  const char* tag;
+};
+
+static const RfcVector RFC_VECTORS[] = {
+  {16, "070a16b46b4d4144f79bdd9dd04a287c"},
+  {40, "dfa66747de9ae63030ca32611497c827"},
+  {64, "51f0bebf7e3b9d92fc49741779363cfe"},
+};
+
+static void checkRfcVectors() {
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  uint8_t msg[64];
+  parse(RFC_KEY, key, sizeof(key));
+  parse(RFC_MSG, msg, sizeof(msg));
+
+  for (const RfcVector& v : RFC_VECTORS) {
+    HitAuth auth;
+    auth.setKey(key);
+    auth.setNonce(msg);
+
+    // 帧 = 正文(消息去掉前8字节) + "|mac:" + 期望标签前4字节
+    uint8_t frame[128];
+    size_t bodyLen = v.msgLen - HIT_AUTH_NONCE_LEN;
+    memcpy(frame, msg + HIT_AUTH_NONCE_LEN, bodyLen);
+    size_t len = bodyLen;
+    memcpy(frame + len, HIT_AUTH_TAG_FIELD, strlen(HIT_AUTH_TAG_FIELD));
+    len += strlen(HIT_AUTH_TAG_FIELD);
+    memcpy(frame + len, v.tag, HIT_AUTH_TAG_LEN * 2);
+    len += HIT_AUTH_TAG_LEN * 2;
+
+    size_t gotBody = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "RFC 4493 Mlen=%zu", v.msgLen);
+    check(auth.verify(frame, len, gotBody) && gotBody == bodyLen, name);
+  }
+}
+
+static void checkScheme() {
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  uint8_t nonceA[HIT_AUTH_NONCE_LEN];
+  uint8_t nonceB[HIT_AUTH_NONCE_LEN];
+  parse("000102030405060708090a0b0c0d0e0f", key, sizeof(key));
+  parse("a0a1a2a3a4a5a6a7", nonceA, sizeof(nonceA));
+  parse("b0b1b2b3b4b5b6b7", nonceB, sizeof(nonceB));
+
+  HitAuth pointer;
+  HitAuth master;
+  pointer.setKey(key);
+  master.setKey(key);
+  pointer.setNonce(nonceA);
+  master.setNonce(nonceA);
+
+  char frame[96] = "time:123456|RED:3|seq:7|sid:1a2b|age:0";
+  size_t plainLen = strlen(frame);
+  check(pointer.sign(frame, sizeof(frame)), "剑端签名");
+  // 固定向量：设备端串口日志里同样输入应得到同样的标签
+  check(strcmp(frame, "time:123456|RED:3|seq:7|sid:1a2b|age:0|mac:0c84c54c") == 0, "方案向量");
+
+  size_t bodyLen = 0;
+  check(master.verify((const uint8_t*)frame, strlen(frame), bodyLen) && bodyLen == plainLen, "主机校验往返");
+
+  char tampered[96];
+  strcpy(tampered, frame);
+  tampered[5] = '9';
+  check(!master.verify((const uint8_t*)tampered, strlen(tampered), bodyLen), "篡改正文被拒");
+
+  HitAuth nextConn;
+  nextConn.setKey(key);
+  nextConn.setNonce(nonceB);
+  check(!nextConn.verify((const uint8_t*)frame, strlen(frame), bodyLen), "上次连接的帧重放被拒");
+
+  check(!master.verify((const uint8_t*)frame, strlen(frame) - 1, bodyLen), "截断标签被拒");
+  check(!master.verify((const uint8_t*)frame, plainLen, bodyLen), "无标签帧被拒");
+
+  HitAuth unpaired;
+  unpaired.setNonce(nonceA);
+  char plain[96] = "time:1|RED:1|seq:1|sid:0001|age:0";
+  check(!unpaired.sign(plain, sizeof(plain)), "未配对不签名");
+
+  char small[40] = "time:123456|RED:3|seq:7|sid:1a2b|age:0";
+  check(!pointer.sign(small, sizeof(small)), "缓冲区不足不签名");
+
+  // 二进制消息：与文本帧同一算法，标签等于对同样字节 sign 出的标签
+  uint8_t tag[HIT_AUTH_TAG_LEN];
+  uint8_t want[HIT_AUTH_TAG_LEN];
+  check(pointer.tag((const uint8_t*)"time:123456|RED:3|seq:7|sid:1a2b|age:0", plainLen, tag), "二进制标签");
+  parse("0c84c54c", want, sizeof(want));
+  check(memcmp(tag, want, sizeof(want)) == 0, "二进制标签与文本帧标签一致");
+  uint8_t msg[5] = {0xEC, 0x02, 0x00, 0x01, 0x00};
+  check(pointer.tag(msg, sizeof(msg), tag) && master.check(msg, sizeof(msg), tag), "二进制校验往返");
+  msg[4] = 0x01;
+  check(!master.check(msg, sizeof(msg), tag), "二进制篡改被拒");
+  check(!nextConn.check(msg, sizeof(msg), tag), "二进制换随机数被拒");
+  check(!unpaired.check(msg, sizeof(msg), tag), "二进制未配对被拒");
+}
+
+int main() {
+  checkRfcVectors();
+  checkScheme();
+  printf(g_failed == 0 ? "全部通过\n" : "%d 项失败\n", g_failed);
+  return g_failed == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,355 @@
+// 赛场汇总仿真（Linux 主机端）：模拟几十台剑道主机，测汇总中心的吞吐和更新时延
+// 比赛表 BoutTable 和帧格式 HubFrame 与汇总中心固件同一份源码
+//
+// 编译：
+//   cd Arduino_code/host_tools/hub_sim
+//   g++ -O2 -I../../tournament_hub -o hub_sim hub_sim.cpp ../../tournament_hub/BoutTable.cpp ../../tournament_hub/HubFrame.cpp
+//
+// 用法：
+//   ./hub_sim local [主机数=60] [比赛秒数=600] [加速倍数=1] [丢帧%=0]
+//       进程内：按仿真时钟生成全部帧，测 BoutTable 每帧更新耗时、吞吐、JSON 生成耗时，
+//       并核对最终比分/击中次数/丢帧统计和各主机一致
+//   ./hub_sim udp <汇总中心IP> [主机数=60] [秒数=30] [加速倍数=1] [每包帧数=1]
+//       实时：电脑连上 epee_hub 热点，按真实时间发 UDP 帧；每 200ms 做一次探测
+//       （给一个剑道发新结果，轮询 /bouts?since= 直到看到），得出负载下的更新时延，最后打印 /stats
+// 加速倍数放大击中频率（1 = 平均每 8 秒一次击中），用来把状态帧之外的结果帧压上去
+// local 模式核对不一致、udp 模式有队列丢弃或探测超时返回 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "BoutTable.h"
+
+#define TOUCH_MEAN_MS   8000   // 平均击中间隔（加速倍数 1 时）
+#define LAMP_MS         3000   // 亮灯时长，与主机 LIGHT_DURATION 一致
+#define DOUBLE_PCT      20     // 互中比例
+#define PROBE_MS        200
+#define PROBE_TIMEOUT_MS 2000
+
+static double nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static double percentile(std::vector<double>& v, double pct) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[(size_t)(pct / 100.0 * (v.size() - 1))];
+}
+
+// ===================== 模拟一台剑道主机（与固件 serviceHub 同样的发帧规则）=====================
+struct SimMaster {
+  uint8_t piste;
+  uint16_t seq;
+  AppState st;
+  AppState last;
+  uint32_t lampOffMs;
+  uint32_t nextTouchMs;
+  uint32_t lastSendMs;
+  uint32_t periodStartMs;
+  uint32_t touches;
+  uint32_t startMs;        // 上电时间偏移（各主机不同）
+  double speed;
+
+  void init(uint8_t id, double spd) {
+    piste = id;
+    seq = 0;
+    memset(&st, 0, sizeof(st));
+    st.timerSec = 180;
+    st.lamps = APP_LAMP_RED_LINK | APP_LAMP_GRN_LINK;
+    last = st;
+    last.timerSec = 0;       // 第一帧一定发
+    lampOffMs = 0;
+    speed = spd;
+    startMs = (uint32_t)(rand() % 5000);
+    nextTouchMs = nextTouch(0);
+    lastSendMs = 0;
+    periodStartMs = 0;
+    touches = 0;
+  }
+
+  uint32_t nextTouch(uint32_t now) {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return now + 200 + (uint32_t)(-log(u) * TOUCH_MEAN_MS / speed);
+  }
+
+  void emit(uint8_t type, uint32_t now, std::vector<HubFrame>& out) {
+    HubFrame f;
+    f.type = type;
+    f.piste = piste;
+    f.seq = ++seq;
+    f.state = st;
+    f.uptimeMs = now + startMs;
+    out.push_back(f);
+    lastSendMs = now;
+    last = st;
+  }
+
+  // 每 50ms 调一次（固件轮询周期）
+  void step(uint32_t now, std::vector<HubFrame>& out) {
+    bool result = false;
+    if (lampOffMs != 0 && now >= lampOffMs) {
+      st.lamps &= ~(APP_LAMP_RED | APP_LAMP_GRN);
+      st.phase = APP_PHASE_IDLE;
+      lampOffMs = 0;
+    }
+    if (lampOffMs == 0 && now >= nextTouchMs) {
+      int r = rand() % 100;
+      if (r < DOUBLE_PCT) {
+        st.redScore++;
+        st.grnScore++;
+        st.lamps |= APP_LAMP_RED | APP_LAMP_GRN;
+        st.phase = APP_PHASE_DOUBLE;
+      } else if (r < 60) {
+        st.redScore++;
+        st.lamps |= APP_LAMP_RED;
+        st.phase = APP_PHASE_RED_HIT;
+      } else {
+        st.grnScore++;
+        st.lamps |= APP_LAMP_GRN;
+        st.phase = APP_PHASE_GRN_HIT;
+      }
+      touches++;
+      lampOffMs = now + LAMP_MS;
+      nextTouchMs = nextTouch(lampOffMs);
+      result = true;
+    }
+    uint32_t elapsed = (now - periodStartMs) / 1000;
+    st.timerSec = elapsed >= 180 ? 0 : (uint16_t)(180 - elapsed);
+    if (st.timerSec == 0) periodStartMs = now;   // 一局结束接着下一局
+
+    bool changed = memcmp(&st, &last, sizeof(st)) != 0;
+    if (result) emit(HUB_FRAME_RESULT, now, out);
+    else if (changed || now - lastSendMs >= HUB_KEEPALIVE_MS) emit(HUB_FRAME_STATE, now, out);
+  }
+};
+
+// ===================== local：进程内吞吐 + 一致性 =====================
+static int runLocal(int masters, int seconds, double speed, int lossPct) {
+  std::vector<SimMaster> sims(masters);
+  for (int i = 0; i < masters; i++) sims[i].init((uint8_t)(i + 1), speed);
+
+  // 按仿真时钟生成全部帧（生成不计入更新耗时）
+  std::vector<HubFrame> frames;
+  std::vector<HubFrame> tick;
+  std::vector<uint32_t> lost(HUB_MAX_PISTES, 0);
+  for (uint32_t t = 0; t <= (uint32_t)seconds * 1000; t += 50) {
+    for (auto& m : sims) {
+      tick.clear();
+      m.step(t, tick);
+      for (auto& f : tick) {
+        if (lossPct > 0 && rand() % 100 < lossPct) {
+          lost[f.piste]++;
+          continue;
+        }
+        frames.push_back(f);
+      }
+    }
+  }
+
+  BoutTable* table = new BoutTable();
+  double t0 = nowMs();
+  for (size_t i = 0; i < frames.size(); i++) table->apply(frames[i], (uint32_t)(i / 100));
+  double applyMs = nowMs() - t0;
+
+  static char json[1 << 16];
+  size_t fullLen = 0;
+  t0 = nowMs();
+  const int JSON_RUNS = 1000;
+  for (int i = 0; i < JSON_RUNS; i++) fullLen = table->toJson(json, sizeof(json), 0, 0);
+  double fullUs = (nowMs() - t0) * 1000 / JSON_RUNS;
+  t0 = nowMs();
+  size_t deltaLen = 0;
+  for (int i = 0; i < JSON_RUNS; i++) deltaLen = table->toJson(json, sizeof(json), table->version() - 5, 0);
+  double deltaUs = (nowMs() - t0) * 1000 / JSON_RUNS;
+
+  // 核对：最终比分、击中次数（结果帧丢了就少）、丢帧统计
+  int mismatches = 0;
+  for (auto& m : sims) {
+    const BoutEntry& e = table->entry(m.piste);
+    if (!e.active) {
+      mismatches++;
+      continue;
+    }
+    if (lossPct == 0 && (e.state.redScore != m.st.redScore || e.state.grnScore != m.st.grnScore || e.results != m.touches)) {
+      printf("剑道%d 不一致：表 %u:%u 击中%u，主机 %u:%u 击中%u\n", m.piste, e.state.redScore, e.state.grnScore,
+             e.results, m.st.redScore, m.st.grnScore, m.touches);
+      mismatches++;
+    }
+    // 只有最后几帧丢失时序号推算不出来，允许差几帧
+    if (e.gaps > lost[m.piste] || lost[m.piste] - e.gaps > 3) {
+      printf("剑道%d 丢帧统计 %u，实际丢 %u\n", m.piste, e.gaps, lost[m.piste]);
+      mismatches++;
+    }
+  }
+
+  printf("%d 台主机 × %d 秒（击中加速 %.1f 倍，丢帧 %d%%）：%zu 帧\n", masters, seconds, speed, lossPct, frames.size());
+  printf("实际比赛帧率 %.0f 帧/秒；更新 %.1f 纳秒/帧，单核上限约 %.0f 帧/秒\n", frames.size() / (double)seconds,
+         applyMs * 1e6 / frames.size(), frames.size() / (applyMs / 1000));
+  printf("JSON 全量 %zu 字节 %.1f 微秒，增量(5 次变化) %zu 字节 %.1f 微秒（本机）\n",
+         fullLen, fullUs, deltaLen, deltaUs);
+  printf("核对：%s（%d 处不一致）\n", mismatches ? "失败" : "通过", mismatches);
+  delete table;
+  return mismatches ? 1 : 0;
+}
+
+// ===================== udp：实时负载 + 探测时延 =====================
+static bool httpGet(const char* host, const char* path, std::string& body) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return false;
+  struct timeval tv = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(80);
+  inet_pton(AF_INET, host, &addr.sin_addr);
+  if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+    close(fd);
+    return false;
+  }
+  char req[256];
+  int n = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: %s\r\nConnection: close\r\n\r\n", path, host);
+  if (write(fd, req, n) != n) {
+    close(fd);
+    return false;
+  }
+  std::string resp;
+  char buf[4096];
+  ssize_t r;
+  while ((r = read(fd, buf, sizeof(buf))) > 0) resp.append(buf, r);
+  close(fd);
+  size_t hdr = resp.find("\r\n\r\n");
+  if (hdr == std::string::npos) return false;
+  body = resp.substr(hdr + 4);
+  return true;
+}
+
+static long jsonField(const std::string& s, const char* key, size_t from = 0) {
+  std::string k = std::string("\"") + key + "\":";
+  size_t p = s.find(k, from);
+  return p == std::string::npos ? -1 : strtol(s.c_str() + p + k.size(), nullptr, 10);
+}
+
+static int runUdp(const char* host, int masters, int seconds, double speed, int batch) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(HUB_UDP_PORT);
+  inet_pton(AF_INET, host, &addr.sin_addr);
+
+  // 探测用最后一个剑道号，不和模拟主机冲突
+  const uint8_t PROBE_PISTE = HUB_MAX_PISTES - 1;
+  std::vector<SimMaster> sims(masters);
+  for (int i = 0; i < masters; i++) sims[i].init((uint8_t)(i + 1), speed);
+
+  std::vector<HubFrame> tick;
+  std::vector<uint8_t> packet;
+  std::vector<double> latency;
+  unsigned long sent = 0, probeTimeouts = 0;
+  uint16_t probeSeq = 0;
+  uint8_t probeScore = 0;
+  long version = 0;
+  double start = nowMs();
+  double nextStep = start, nextProbe = start + 1000;
+
+  auto flush = [&]() {
+    if (packet.empty()) return;
+    sendto(fd, packet.data(), packet.size(), 0, (sockaddr*)&addr, sizeof(addr));
+    packet.clear();
+  };
+
+  while (nowMs() - start < seconds * 1000.0) {
+    if (nowMs() >= nextStep) {
+      uint32_t t = (uint32_t)(nextStep - start);
+      for (auto& m : sims) {
+        tick.clear();
+        m.step(t, tick);
+        for (auto& f : tick) {
+          uint8_t buf[HUB_FRAME_LEN];
+          hubFrameBuild(f, buf);
+          packet.insert(packet.end(), buf, buf + HUB_FRAME_LEN);
+          sent++;
+          if ((int)(packet.size() / HUB_FRAME_LEN) >= batch) flush();
+        }
+      }
+      flush();
+      nextStep += 50;
+    }
+    if (nowMs() >= nextProbe) {
+      // 探测：发一帧新结果，轮询增量直到看到它
+      HubFrame f = {};
+      f.type = HUB_FRAME_RESULT;
+      f.piste = PROBE_PISTE;
+      f.seq = ++probeSeq;
+      f.state.redScore = ++probeScore;
+      f.state.timerSec = APP_TIMER_NONE;
+      f.uptimeMs = (uint32_t)(nowMs() - start);
+      uint8_t buf[HUB_FRAME_LEN];
+      hubFrameBuild(f, buf);
+      double t0 = nowMs();
+      sendto(fd, buf, sizeof(buf), 0, (sockaddr*)&addr, sizeof(addr));
+      bool seen = false;
+      while (!seen && nowMs() - t0 < PROBE_TIMEOUT_MS) {
+        char path[48];
+        snprintf(path, sizeof(path), "/bouts?since=%ld", version);
+        std::string body;
+        if (!httpGet(host, path, body)) continue;
+        long v = jsonField(body, "v");
+        if (v > version) version = v;
+        char key[16];
+        snprintf(key, sizeof(key), "\"p\":%d,", PROBE_PISTE);
+        size_t p = body.find(key);
+        if (p != std::string::npos && jsonField(body, "r", p) == probeScore) seen = true;
+      }
+      if (seen) latency.push_back(nowMs() - t0);
+      else probeTimeouts++;
+      nextProbe = nowMs() + PROBE_MS;
+    }
+    usleep(500);
+  }
+
+  printf("%d 台主机 %d 秒：发出 %lu 帧（%.0f 帧/秒，每包 %d 帧）\n", masters, seconds, sent, sent / (double)seconds, batch);
+  printf("更新时延（发出→/bouts 可见）n=%zu p50 %.1f p95 %.1f p99 %.1f 最大 %.1f ms，超时 %lu\n", latency.size(),
+         percentile(latency, 50), percentile(latency, 95), percentile(latency, 99), percentile(latency, 100), probeTimeouts);
+  std::string stats;
+  long drops = 0;
+  if (httpGet(host, "/stats", stats)) {
+    printf("汇总中心 /stats：%s\n", stats.c_str());
+    drops = jsonField(stats, "drops");
+  }
+  close(fd);
+  return (drops > 0 || probeTimeouts > 0) ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "用法：%s local [主机数] [秒数] [加速] [丢帧%%] | udp <IP> [主机数] [秒数] [加速] [每包帧数]\n", argv[0]);
+    return 2;
+  }
+  srand(1);
+  if (strcmp(argv[1], "local") == 0) {
+    int masters = argc > 2 ? atoi(argv[2]) : 60;
+    if (masters < 1 || masters >= HUB_MAX_PISTES) masters = 60;
+    return runLocal(masters, argc > 3 ? atoi(argv[3]) : 600, argc > 4 ? atof(argv[4]) : 1,
+                    argc > 5 ? atoi(argv[5]) : 0);
+  }
+  if (strcmp(argv[1], "udp") == 0 && argc > 2) {
+    int masters = argc > 3 ? atoi(argv[3]) : 60;
+    if (masters < 1 || masters >= HUB_MAX_PISTES - 1) masters = 60;
+    return runUdp(argv[2], masters, argc > 4 ? atoi(argv[4]) : 30, argc > 5 ? atof(argv[5]) : 1,
+                  argc > 6 ? atoi(argv[6]) : 1);
+  }
+  fprintf(stderr, "未知模式 %s\n", argv[1]);
+  return 2;
+}
\ No newline at end of file
@@ -0,0 +1,306 @@
+// 串口注入压测工具（Linux 主机端）：经 S3 主机的二进制注入口高速注入合成击中/按键，
+// 统计处理耗时和判定回传时延，找出判定、显示、计分板哪一段先跟不上
+// 帧格式与固件共用 InjectPort.h/.cpp
+//
+// 编译：
+//   cd Arduino_code/host_tools/inject_load
+//   g++ -O2 -I../../epee_esp32_s3 -o inject_load inject_load.cpp ../../epee_esp32_s3/InjectPort.cpp
+//
+// 用法：./inject_load <串口> <模式> [参数...]
+//   ping  [次数=1000]              串口往返时延
+//   flood [每秒帧数=2000] [秒数=10]  红绿交替注入击中，统计确认丢失、主机处理耗时、串口往返
+//   bout  [剑数=200] [互中间隔ms=-1] 逐剑：注入击中 → 等判定 → 注入“下一分”按键；
+//                                  间隔≥0 时绿方在红方之后该毫秒数击中（≤40 应判互中）
+//   stats                          打印一次主机统计
+//   link  <red|green> [drop|rescan] 注入链路事件
+// 注入时自动关闭主机文字日志（quiet），退出前恢复；FencingCore 自身的少量日志会夹在帧之间，解析时跳过
+// 有击中确认丢失、判定丢失或判定结果不对时返回 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <vector>
+#include <algorithm>
+#include "InjectPort.h"
+
+static int g_fd = -1;
+static InjectParser g_parser;
+
+static double nowUs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool openSerial(const char* path) {
+  g_fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (g_fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct termios tio;
+  tcgetattr(g_fd, &tio);
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, B115200);   // S3 原生 USB 串口不受波特率限制
+  cfsetospeed(&tio, B115200);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tcsetattr(g_fd, TCSANOW, &tio);
+  tcflush(g_fd, TCIOFLUSH);
+  return true;
+}
+
+static void sendFrame(uint8_t type, const void* payload, uint8_t len) {
+  uint8_t buf[INJECT_FRAME_MAX];
+  size_t n = InjectParser::encode(type, payload, len, buf, sizeof(buf));
+  size_t off = 0;
+  while (off < n) {
+    ssize_t w = write(g_fd, buf + off, n - off);
+    if (w > 0) {
+      off += w;
+    } else {
+      struct pollfd p = {g_fd, POLLOUT, 0};
+      poll(&p, 1, 10);
+    }
+  }
+}
+
+// 读一条回传帧，超时返回 false
+static bool readFrame(InjectMsg& msg, double timeoutUs) {
+  double deadline = nowUs() + timeoutUs;
+  static uint8_t buf[4096];
+  static size_t used = 0, pos = 0;
+  for (;;) {
+    while (pos < used) {
+      if (g_parser.feed(buf[pos++], msg)) return true;
+    }
+    used = pos = 0;
+    double left = deadline - nowUs();
+    if (left <= 0) return false;
+    struct pollfd p = {g_fd, POLLIN, 0};
+    if (poll(&p, 1, (int)(left / 1000) + 1) <= 0) continue;
+    ssize_t r = read(g_fd, buf, sizeof(buf));
+    if (r > 0) used = r;
+  }
+}
+
+static double percentile(std::vector<double>& v, double pct) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(pct / 100.0 * (v.size() - 1));
+  return v[i];
+}
+
+static void printDist(const char* name, std::vector<double>& v, double scale) {
+  printf("%s  n=%zu  p50 %.2f  p95 %.2f  p99 %.2f  最大 %.2f\n", name, v.size(), percentile(v, 50) / scale,
+         percentile(v, 95) / scale, percentile(v, 99) / scale, percentile(v, 100) / scale);
+}
+
+static void setQuiet(bool quiet) {
+  InjectConfigMsg c = {(uint8_t)(quiet ? 1 : 0)};
+  sendFrame(INJECT_CONFIG, &c, sizeof(c));
+}
+
+static void sendButton(uint8_t button) {
+  InjectButtonMsg b = {button};
+  sendFrame(INJECT_BUTTON, &b, sizeof(b));
+}
+
+static void sendTouch(uint8_t side, uint16_t seq, uint16_t ageMs) {
+  InjectTouchMsg t;
+  t.side = side;
+  t.seq = seq;
+  t.ageMs = ageMs;
+  sendFrame(INJECT_TOUCH, &t, sizeof(t));
+}
+
+static bool queryStats(InjectStatsMsg& st) {
+  sendFrame(INJECT_STATS, nullptr, 0);
+  double deadline = nowUs() + 1e6;
+  InjectMsg msg;
+  while (nowUs() < deadline) {
+    if (!readFrame(msg, deadline - nowUs())) break;
+    if (msg.type == INJECT_STATS_REPLY && msg.len == sizeof(st)) {
+      memcpy(&st, msg.payload, sizeof(st));
+      return true;
+    }
+  }
+  return false;
+}
+
+static void printStats(const InjectStatsMsg& st) {
+  printf("[主机] 注入击中%u 判定回传%u 判定丢弃%u 校验错误%u | 判定循环%u次 最大延迟%u微秒 | 计分板背压跳过%u | %s %s\n",
+         st.touches, st.verdicts, st.verdictDrops, st.crcErrors, st.logicLoops, st.logicMaxLateUs,
+         st.boardSkipped, st.locked ? "已判定" : "未判定", st.timerRunning ? "计时中" : "暂停");
+}
+
+// ===================== ping =====================
+static int runPing(int count) {
+  std::vector<double> rtt;
+  InjectMsg msg;
+  for (int i = 0; i < count; i++) {
+    InjectEchoMsg e = {(uint32_t)i};
+    double t0 = nowUs();
+    sendFrame(INJECT_ECHO, &e, sizeof(e));
+    while (readFrame(msg, 200000)) {
+      InjectEchoMsg r;
+      if (msg.type != INJECT_ECHO_REPLY || msg.len != sizeof(r)) continue;
+      memcpy(&r, msg.payload, sizeof(r));
+      if (r.hostUs == (uint32_t)i) {
+        rtt.push_back(nowUs() - t0);
+        break;
+      }
+    }
+  }
+  printf("回显 %zu/%d\n", rtt.size(), count);
+  printDist("串口往返 ms", rtt, 1000);
+  return rtt.size() == (size_t)count ? 0 : 1;
+}
+
+// ===================== flood =====================
+static int runFlood(int rate, int seconds) {
+  setQuiet(true);
+  int total = rate * seconds;
+  std::vector<double> sentAt(total, 0);
+  std::vector<double> rtt, handle;
+  unsigned long results[8] = {0};
+  unsigned long acks = 0, verdicts = 0;
+  double t0 = nowUs();
+  double period = 1e6 / rate;
+  int next = 0;
+  uint16_t seq[2] = {1, 1};
+  std::vector<int> index[2];   // 每方序号 → 全局编号
+  index[0].resize(65536, -1);
+  index[1].resize(65536, -1);
+  InjectMsg msg;
+
+  double end = t0 + seconds * 1e6 + 1e6;   // 最后一帧后再等 1 秒收确认
+  while (nowUs() < end) {
+    while (next < total && nowUs() >= t0 + next * period) {
+      uint8_t side = next & 1;
+      index[side][seq[side]] = next;
+      sentAt[next] = nowUs();
+      sendTouch(side, seq[side]++, 0);
+      next++;
+    }
+    double wait = (next < total) ? (t0 + next * period - nowUs()) : 50000;
+    if (wait < 0) wait = 0;
+    if (!readFrame(msg, wait)) continue;
+    if (msg.type == INJECT_TOUCH_ACK && msg.len == sizeof(InjectTouchAckMsg)) {
+      InjectTouchAckMsg a;
+      memcpy(&a, msg.payload, sizeof(a));
+      if (a.side > 1 || index[a.side][a.seq] < 0) continue;
+      rtt.push_back(nowUs() - sentAt[index[a.side][a.seq]]);
+      handle.push_back(a.handleUs);
+      if (a.result < 8) results[a.result]++;
+      acks++;
+    } else if (msg.type == INJECT_VERDICT) {
+      verdicts++;
+    }
+  }
+  double elapsed = (nowUs() - t0) / 1e6 - 1;
+  printf("注入 %d 帧，%.1f 秒，实际 %.0f 帧/秒\n", total, elapsed, total / elapsed);
+  printf("确认 %lu（正常%lu 迟到%lu 过期%lu 重复%lu 格式错%lu 认证失败%lu 未就绪%lu）丢失 %lu，判定回传 %lu\n",
+         acks, results[0], results[1], results[2], results[3], results[4], results[5], results[6],
+         (unsigned long)total - acks, verdicts);
+  printDist("注入→确认 ms", rtt, 1000);
+  printDist("主机处理 us", handle, 1);
+  setQuiet(false);
+  InjectStatsMsg st;
+  if (queryStats(st)) printStats(st);
+  return acks == (unsigned long)total ? 0 : 1;
+}
+
+// ===================== bout =====================
+static int runBouts(int bouts, int doubleMs) {
+  setQuiet(true);
+  InjectStatsMsg st;
+  if (!queryStats(st)) {
+    printf("主机无应答（固件是否带注入口？）\n");
+    return 1;
+  }
+  if (st.locked) sendButton(INJECT_BTN_NEXT);                 // 上一剑还亮灯：灭灯并恢复计时
+  else if (!st.timerRunning) sendButton(INJECT_BTN_NEXT);     // 计时未开始：开始（判定只在计时中进行）
+  usleep(100000);
+
+  std::vector<double> hostLat, devLat;
+  unsigned long lost = 0, wrong = 0;
+  uint16_t seq = 1;
+  bool expectDouble = doubleMs >= 0 && doubleMs <= 40;
+  InjectMsg msg;
+  for (int i = 0; i < bouts; i++) {
+    uint16_t redSeq = seq++;
+    uint16_t greenSeq = seq++;
+    double t0 = nowUs();
+    sendTouch(0, redSeq, 0);
+    if (doubleMs >= 0) {
+      usleep(doubleMs * 1000);
+      sendTouch(1, greenSeq, 0);
+    }
+    bool got = false;
+    double deadline = t0 + 500000;
+    while (!got && nowUs() < deadline) {
+      if (!readFrame(msg, deadline - nowUs())) break;
+      if (msg.type != INJECT_VERDICT || msg.len != sizeof(InjectVerdictMsg)) continue;
+      InjectVerdictMsg v;
+      memcpy(&v, msg.payload, sizeof(v));
+      if (v.redSeq != redSeq) continue;   // 上一剑的补判等
+      got = true;
+      hostLat.push_back(nowUs() - t0);
+      devLat.push_back(v.latencyUs);
+      uint8_t want = expectDouble ? 3 : 1;
+      if (v.lamps != want) {
+        wrong++;
+        printf("第%d剑 判定灯 %u，应为 %u\n", i + 1, v.lamps, want);
+      }
+    }
+    if (!got) {
+      lost++;
+      printf("第%d剑 500ms 内没有判定\n", i + 1);
+    }
+    sendButton(INJECT_BTN_NEXT);
+    usleep(30000);   // 等下一分复位，和实际裁判节奏相比已经很快
+  }
+  printf("%d 剑：判定丢失 %lu，判定错误 %lu\n", bouts, lost, wrong);
+  printDist("注入→判定回传 ms（主机看）", hostLat, 1000);
+  printDist("到达→判定完成 ms（设备内）", devLat, 1000);
+  setQuiet(false);
+  if (queryStats(st)) printStats(st);
+  return (lost || wrong) ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "用法：%s <串口> ping|flood|bout|stats|link [参数...]\n", argv[0]);
+    return 2;
+  }
+  if (!openSerial(argv[1])) return 2;
+  const char* mode = argv[2];
+  int rc = 0;
+  if (strcmp(mode, "ping") == 0) {
+    rc = runPing(argc > 3 ? atoi(argv[3]) : 1000);
+  } else if (strcmp(mode, "flood") == 0) {
+    rc = runFlood(argc > 3 ? atoi(argv[3]) : 2000, argc > 4 ? atoi(argv[4]) : 10);
+  } else if (strcmp(mode, "bout") == 0) {
+    rc = runBouts(argc > 3 ? atoi(argv[3]) : 200, argc > 4 ? atoi(argv[4]) : -1);
+  } else if (strcmp(mode, "stats") == 0) {
+    InjectStatsMsg st;
+    if (queryStats(st)) printStats(st);
+    else rc = 1;
+  } else if (strcmp(mode, "link") == 0 && argc > 3) {
+    InjectLinkMsg l;
+    l.side = strcmp(argv[3], "green") == 0 ? 1 : 0;
+    l.event = (argc > 4 && strcmp(argv[4], "rescan") == 0) ? INJECT_LINK_RESCAN : INJECT_LINK_DROP;
+    sendFrame(INJECT_LINK, &l, sizeof(l));
+  } else {
+    fprintf(stderr, "未知模式 %s\n", mode);
+    rc = 2;
+  }
+  close(g_fd);
+  return rc;
+}
\ No newline at end of file
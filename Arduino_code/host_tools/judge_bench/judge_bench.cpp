@@ -0,0 +1,326 @@
+// 判定引擎一致性检查 + 单剑耗时测量（Linux 主机端）：不用射频验证 EpeeJudge.h
+//
+// 编译：
+//   cd Arduino_code/host_tools/judge_bench
+//   g++ -O2 -I../../epee_esp32_s3 -o judge_bench "$PWD/judge_bench.cpp"
+// （用绝对路径编译，副本检查就能按 __FILE__ 找到仓库，在哪个目录运行都行）
+//
+// 一致性检查：同一张场景表按每个主机目标的配置跑一遍（窗口/判定延时/自动解锁与各自源码一致），
+//   并检查各目录里的 EpeeJudge.h 副本与 epee_esp32_s3 的一致（读不到副本也算失败）
+// 耗时：单中/互中/乱序/补判混合的击中序列，每剑 = 喂击中 + 逐拍 poll 到出判定 + 重置，输出每剑纳秒数
+// 用法：./judge_bench [剑数，默认 1000000] [Arduino_code 目录，默认按源码路径]；一致性检查有失败时返回 1
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "EpeeJudge.h"
+
+static int g_failed = 0;
+
+static void check(bool ok, const char* target, const char* name) {
+  printf("%s  [%s] %s\n", ok ? "PASS" : "FAIL", target, name);
+  if (!ok) g_failed++;
+}
+
+// 主机端时钟：场景里手动拨
+struct HostClock {
+  uint32_t* t;
+  uint32_t now() const { return *t; }
+};
+
+// 记下最近一次判定
+struct RecordSink {
+  uint32_t count;
+  JudgeVerdict last;
+  void onVerdict(const JudgeVerdict& v) {
+    count++;
+    last = v;
+  }
+};
+
+typedef EpeeJudge<HostClock, RecordSink> HostJudge;
+
+// 各主机目标的配置（改了目标源码里的参数，这里同步改）
+struct Target {
+  const char* name;
+  uint16_t windowMs;
+  uint16_t evalDelayMs;
+  uint32_t rearmMs;
+};
+
+static const Target TARGETS[] = {
+  {"epee_esp32_s3", 40, 45, 0},    // FencingCore::HIT_TIME_WINDOW / HIT_EVAL_DELAY，裁判按下一剑
+  {"epee_sup_min", 40, 45, 0},     // HIT_WINDOW_MS / HIT_EVAL_DELAY_MS
+  {"esp32_repeater", 40, 45, 500}, // DOUBLE_HIT / JUDGE_EVAL_DELAY_MS，BUZZ_HIT 后自动解锁
+  {"Fencing_tst", 40, 45, 500},
+};
+
+struct Rig {
+  uint32_t clock;
+  HostJudge judge;
+  explicit Rig(const Target& t) : clock(0), judge(HostClock{&clock}, RecordSink(), t.windowMs, t.evalDelayMs, t.rearmMs) {}
+  RecordSink& sink() { return judge.sink(); }
+  // 按判定任务节拍（1ms）走到 until，返回途中出判定的次数
+  uint32_t runTo(uint32_t until) {
+    uint32_t before = sink().count;
+    while ((int32_t)(until - clock) > 0) {
+      clock++;
+      judge.poll();
+    }
+    return sink().count - before;
+  }
+};
+
+static void checkTarget(const Target& t) {
+  const char* n = t.name;
+  uint32_t w = t.windowMs;
+  uint32_t d = t.evalDelayMs;
+
+  {
+    Rig r(t);
+    r.clock = 1000;
+    check(r.judge.hit(JUDGE_RED, 1000) == JUDGE_HIT_FIRST, n, "首击开窗口");
+    check(r.runTo(1000 + d) == 0, n, "判定延时内不出判定");
+    check(r.runTo(1001 + d) == 1 && r.sink().last.red && !r.sink().last.green, n, "延时到期判红方单中");
+    check(r.judge.locked(), n, "判定后锁定");
+    check(r.judge.hit(JUDGE_GREEN, r.clock) == JUDGE_HIT_LOCKED, n, "锁定后新击中丢弃");
+  }
+  {
+    Rig r(t);
+    r.clock = 1000;
+    r.judge.hit(JUDGE_RED, 1000);
+    r.clock = 1000 + w;
+    check(r.judge.hit(JUDGE_GREEN, 1000 + w) == JUDGE_HIT_ACCEPTED, n, "窗口边界上的另一方计入");
+    r.runTo(1100);
+    check(r.sink().count == 1 && r.sink().last.red && r.sink().last.green, n, "窗口内互中");
+    check(r.sink().last.redMinusGreenMs == -(int32_t)w, n, "互中时间差");
+  }
+  {
+    Rig r(t);
+    r.judge.hit(JUDGE_RED, 1000);
+    check(r.judge.hit(JUDGE_GREEN, 1001 + w) == JUDGE_HIT_OUTSIDE, n, "窗口外的另一方丢弃");
+    check(r.judge.hit(JUDGE_RED, 1010) == JUDGE_HIT_REPEAT, n, "同一方重复不变");
+    r.clock = 1000;
+    r.runTo(1100);
+    check(r.sink().last.red && !r.sink().last.green, n, "窗口外只判首击方");
+  }
+  {
+    Rig r(t);
+    // 乱序到达：绿方先到，红方击中时间更早
+    r.judge.hit(JUDGE_GREEN, 1030);
+    check(r.judge.hit(JUDGE_RED, 1000) == JUDGE_HIT_FIRST && r.judge.firstHitMs() == 1000, n, "更早的迟到击中成为首击");
+    r.clock = 1030;
+    r.runTo(1100);
+    check(r.sink().last.red && r.sink().last.green && r.sink().last.firstHitMs == 1000, n, "乱序到达仍判互中");
+  }
+  {
+    Rig r(t);
+    r.judge.hit(JUDGE_GREEN, 1000);
+    r.judge.hit(JUDGE_RED, 999 - w);
+    r.clock = 1000;
+    r.runTo(1100);
+    check(r.sink().last.red && !r.sink().last.green, n, "更早首击把原首击挤出窗口");
+  }
+  {
+    Rig r(t);
+    // 已互中后又补到一条更早的同方击中：按另一方自己的击中时间比窗口，而不是按原首击
+    r.judge.hit(JUDGE_RED, 1000);
+    r.judge.hit(JUDGE_GREEN, 1000 + w / 2);
+    check(r.judge.hit(JUDGE_RED, 999 - w / 2) == JUDGE_HIT_FIRST && r.judge.firstHitMs() == 999 - w / 2, n,
+          "重发的更早击中成为首击");
+    check(!r.judge.received(JUDGE_GREEN), n, "另一方离新首击超过窗口被挤出");
+    r.clock = 1000;
+    r.runTo(1100);
+    check(r.sink().count == 1 && r.sink().last.red && !r.sink().last.green, n, "重发的更早击中不误判互中");
+  }
+  {
+    Rig r(t);
+    // 同一情形但另一方仍在新窗口内：保留互中，首击取最早的一击
+    r.judge.hit(JUDGE_RED, 1000);
+    r.judge.hit(JUDGE_GREEN, 1000 + w / 2);
+    r.judge.hit(JUDGE_RED, 1000 - w / 4);
+    r.clock = 1000;
+    r.runTo(1100);
+    check(r.sink().last.red && r.sink().last.green && r.sink().last.firstHitMs == 1000 - w / 4 &&
+              r.sink().last.redMinusGreenMs == -(int32_t)(w / 2 + w / 4),
+          n, "重发的更早击中仍在窗口内保留互中");
+  }
+  {
+    Rig r(t);
+    // 更早的另一方击中挤掉原首击后，首击时间要重新取
+    r.judge.hit(JUDGE_GREEN, 1000);
+    r.judge.hit(JUDGE_RED, 1000 + w / 2);
+    r.judge.hit(JUDGE_GREEN, 1000 + w / 2 - w - 5);
+    check(r.judge.firstHitMs() == 1000 + w / 2 - w - 5 && !r.judge.received(JUDGE_RED), n, "挤出后首击时间重新取");
+  }
+  {
+    Rig r(t);
+    // 对时后的击中时间可能略晚于本机当前时间，不能当成早已到期
+    r.clock = 1990;
+    r.judge.hit(JUDGE_RED, 2000);
+    check(r.runTo(1995) == 0, n, "击中时间晚于本机时钟不提前判定");
+    check(r.runTo(2001 + d) == 1, n, "击中时间晚于本机时钟按时判定");
+  }
+  {
+    Rig r(t);
+    // millis() 回绕
+    r.clock = 0xFFFFFFF0u;
+    r.judge.hit(JUDGE_RED, 0xFFFFFFF0u);
+    r.judge.hit(JUDGE_GREEN, 0x00000010u);
+    r.runTo(0x00000100u);
+    check(r.sink().count == 1 && r.sink().last.red && r.sink().last.green, n, "时钟回绕窗口内互中");
+  }
+  {
+    Rig r(t);
+    r.judge.hit(JUDGE_RED, 1000);
+    r.clock = 1000;
+    r.runTo(1001 + d);
+    check(r.judge.hit(JUDGE_GREEN, 1020, true) == JUDGE_HIT_AMENDED, n, "补发迟到击中在窗口内补判");
+    const JudgeVerdict& v = r.sink().last;
+    check(r.sink().count == 2 && v.amended && !v.amendRed && v.red && v.green && v.redMinusGreenMs == -20, n,
+          "补判结果为互中");
+    check(r.judge.hit(JUDGE_GREEN, 1020, true) == JUDGE_HIT_LATE_REJECTED, n, "已补判的一方不重复补");
+  }
+  {
+    Rig r(t);
+    r.judge.hit(JUDGE_RED, 1000);
+    r.clock = 1000;
+    r.runTo(1001 + d);
+    check(r.judge.hit(JUDGE_GREEN, 1001 + w, true) == JUDGE_HIT_LATE_REJECTED && r.judge.lateDiffMs() == (int32_t)w + 1, n,
+          "补发迟到击中在窗口外仅记录");
+    r.judge.lampOff();
+    check(r.judge.hit(JUDGE_GREEN, 1010, true) == JUDGE_HIT_LATE_REJECTED, n, "灯灭后不再补判");
+  }
+  {
+    Rig r(t);
+    r.judge.restore(true, true, false);
+    check(r.judge.locked() && r.judge.received(JUDGE_RED), n, "热备接管套用锁定状态");
+    check(r.judge.hit(JUDGE_GREEN, 1000, true) == JUDGE_HIT_LATE_REJECTED, n, "接管后没有首击时间不补判");
+    r.judge.reset();
+    check(!r.judge.locked() && r.judge.hit(JUDGE_GREEN, 2000) == JUDGE_HIT_FIRST, n, "重置后开始下一剑");
+  }
+  {
+    Rig r(t);
+    r.judge.hit(JUDGE_RED, 1000);
+    r.clock = 1000;
+    r.runTo(1001 + d);
+    if (t.rearmMs > 0) {
+      r.runTo(1000 + d + t.rearmMs);
+      check(r.judge.locked(), n, "自动解锁时间内保持锁定");
+      r.runTo(1001 + d + t.rearmMs);
+      check(!r.judge.locked(), n, "到时自动解锁");
+    } else {
+      r.runTo(60000);
+      check(r.judge.locked(), n, "等裁判按下一剑才解锁");
+    }
+  }
+}
+
+// 各目录里的副本要与 epee_esp32_s3 的一字不差
+// 仓库位置：命令行第二个参数给 Arduino_code 目录，否则按本文件编译时的路径（__FILE__）推出来；找不到算失败
+static bool readFile(const char* path, char* buf, size_t cap, size_t& len) {
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  len = fread(buf, 1, cap, f);
+  fclose(f);
+  return len < cap;
+}
+
+static void sourceRoot(const char* arg, char* out, size_t cap) {
+  if (arg != nullptr) {
+    snprintf(out, cap, "%s/", arg);
+    return;
+  }
+  // __FILE__ = <...>/host_tools/judge_bench/judge_bench.cpp，或在本目录编译时只有文件名
+  const char* slash = strrchr(__FILE__, '/');
+  int dirLen = slash != nullptr ? (int)(slash - __FILE__ + 1) : 0;
+  snprintf(out, cap, "%.*s../../", dirLen, __FILE__);
+}
+
+static void checkCopies(const char* rootArg) {
+  static const char* COPIES[] = {
+    "epee_sup_min/epee_sup_min/EpeeJudge.h",
+    "esp32_repeater/esp32_repeater/EpeeJudge.h",
+    "_fencing_txt_/Fencing_tst/EpeeJudge.h",
+  };
+  static char master[32768], copy[32768];
+  char root[512], path[768];
+  size_t masterLen = 0, copyLen = 0;
+  sourceRoot(rootArg, root, sizeof(root));
+  snprintf(path, sizeof(path), "%sepee_esp32_s3/EpeeJudge.h", root);
+  if (!readFile(path, master, sizeof(master), masterLen)) {
+    printf("FAIL  读不到 %s（第二个参数给出 Arduino_code 目录）\n", path);
+    g_failed++;
+    return;
+  }
+  for (size_t i = 0; i < sizeof(COPIES) / sizeof(COPIES[0]); i++) {
+    snprintf(path, sizeof(path), "%s%s", root, COPIES[i]);
+    bool ok = readFile(path, copy, sizeof(copy), copyLen) && copyLen == masterLen && memcmp(master, copy, masterLen) == 0;
+    check(ok, COPIES[i], "EpeeJudge.h 副本与 epee_esp32_s3 一致");
+  }
+}
+
+// 固定种子的伪随机（与 link_emulator 同一写法）
+static uint64_t g_rng = 0x9E3779B97F4A7C15ull;
+static uint32_t rnd32() {
+  g_rng ^= g_rng << 13;
+  g_rng ^= g_rng >> 7;
+  g_rng ^= g_rng << 17;
+  return (uint32_t)(g_rng >> 32);
+}
+
+static void bench(uint32_t touches) {
+  // 先生成击中序列，计时只算引擎
+  struct Touch {
+    uint8_t first;
+    uint8_t second;   // 0xFF = 单中
+    uint16_t gapMs;   // 第二击相对首击（可为负表示乱序到达的更早击中）
+    bool late;        // 第二击判定后才补发到
+  };
+  Touch* seq = (Touch*)malloc(sizeof(Touch) * touches);
+  if (seq == nullptr) return;
+  for (uint32_t i = 0; i < touches; i++) {
+    uint32_t r = rnd32();
+    seq[i].first = r & 1;
+    seq[i].second = (r >> 1) % 3 == 0 ? 0xFF : (uint8_t)(1 - seq[i].first);
+    seq[i].gapMs = (uint16_t)((r >> 8) % 60);
+    seq[i].late = ((r >> 16) & 7) == 0;
+  }
+
+  Target t = TARGETS[0];
+  Rig r(t);
+  uint32_t polls = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < touches; i++) {
+    const Touch& s = seq[i];
+    uint32_t first = r.clock + 1;
+    r.judge.hit(s.first, first);
+    if (s.second != 0xFF && !s.late) r.judge.hit(s.second, first + s.gapMs);
+    while (!r.judge.locked()) {
+      r.clock++;
+      r.judge.poll();
+      polls++;
+    }
+    if (s.second != 0xFF && s.late) r.judge.hit(s.second, first + s.gapMs, true);
+    r.judge.reset();
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+  printf("\n单剑耗时：%u 剑，%u 次 poll，判定 %u 次\n", touches, polls, r.sink().count);
+  printf("  每剑 %.1f ns（含约 %.1f 次 poll），每次 poll %.2f ns\n", ns / touches, (double)polls / touches,
+         ns / (polls > 0 ? polls : 1));
+  printf("  引擎状态 %u 字节，无堆分配\n", (unsigned)sizeof(HostJudge));
+  free(seq);
+}
+
+int main(int argc, char** argv) {
+  uint32_t touches = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1000000;
+  for (size_t i = 0; i < sizeof(TARGETS) / sizeof(TARGETS[0]); i++) checkTarget(TARGETS[i]);
+  checkCopies(argc > 2 ? argv[2] : nullptr);
+  printf(g_failed == 0 ? "全部通过\n" : "%d 项失败\n", g_failed);
+  if (touches > 0) bench(touches);
+  return g_failed == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,432 @@
+// 击中传输链路仿真（Linux 主机端）：不用离开赛道就能测重连、补发和判定
+// 剑端发送路径用 HitOutbox，主机接收路径用 HitLink（与固件同一份源码），
+// 中间是可配置的仿真无线链路：时延分布、抖动、突发丢包（Gilbert-Elliott）、乱序、周期性断线重连
+//
+// 编译：
+//   cd Arduino_code/host_tools/link_emulator
+//   g++ -O2 -I../../epee_esp32_s3 -I../../esp32_supermini_green -o link_emulator link_emulator.cpp ../../epee_esp32_s3/HitLink.cpp ../../esp32_supermini_green/HitOutbox.cpp
+//
+// 用法：./link_emulator scenarios/*.scn
+//   每个场景文件是 key = value 行（# 开头为注释），见 scenarios/ 下的例子
+//   每个场景输出：击中数、按时送达（≤45ms，首轮判定即可用）、迟到补判、过期、丢失、
+//   送达时延分位数、主机换算击中时间误差、互中判定正确率
+// 有击中丢失、过期（超过场景的 max_stale_pct）或互中误判时返回 1，方便脚本里批量跑；
+// 例外：击中时链路已断、或送达前链路断开的击中，恢复后超过 HIT_STALE_MS 的按设计只记录不计分
+// （裁判早已继续比赛），单独计为"断线过期"，含这种击中的互中不计入判对率
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "HitLink.h"
+#include "HitOutbox.h"
+#include "EpeeJudge.h"
+
+#define JUDGE_EVAL_MS    JUDGE_EVAL_DELAY_MS  // 主机首轮判定时刻（首击后），取判定引擎的参数
+#define DOUBLE_WINDOW_MS JUDGE_WINDOW_MS      // 互中窗口
+#define CLOCK_SAMPLES       4                 // 与剑端固件一致：收到 hello 后发几帧时钟样本
+#define CLOCK_SAMPLE_GAP_MS 40
+#define HELLO_RETRY_MS      100               // hello 没送到时的重发间隔
+
+// ===================== 场景参数 =====================
+struct Profile {
+  std::string name;
+  uint32_t durationS = 600;        // 仿真时长
+  uint32_t touchEveryMs = 3000;    // 平均击中间隔
+  uint32_t doublePct = 30;         // 互中比例
+  std::string dist = "exp";        // 时延分布：uniform / normal / exp
+  double latencyMs = 10;           // 基础单程时延
+  double jitterMs = 5;             // 抖动（uniform 为 ±，normal 为标准差，exp 为均值）
+  double lossGood = 0.0;           // 好状态丢包率
+  double lossBad = 0.0;            // 坏状态丢包率
+  double pGoodBad = 0.0;           // 每包 好→坏 概率
+  double pBadGood = 1.0;           // 每包 坏→好 概率
+  double reorderPct = 0;           // 额外延迟（乱序）的包占比
+  double reorderMs = 0;            // 额外延迟上限
+  uint32_t disconnectEveryS = 0;   // 平均每隔多久断一次（0=不断）
+  uint32_t disconnectMs = 0;       // 断线时长
+  uint32_t reconnectMs = 300;      // 恢复后重新连接+发现服务+hello 的时间
+  double maxStalePct = 0;          // 允许的过期比例（不含断线过期），默认一条都不许
+  uint32_t seed = 1;
+};
+
+static bool loadProfile(const char* path, Profile& p) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) return false;
+  const char* base = strrchr(path, '/');
+  p.name = base ? base + 1 : path;
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char* hash = strchr(line, '#');
+    if (hash) *hash = '\0';
+    char key[64], val[128];
+    if (sscanf(line, " %63[^= ] = %127s", key, val) != 2) continue;
+    std::string k = key;
+    if (k == "name") p.name = val;
+    else if (k == "duration_s") p.durationS = atoi(val);
+    else if (k == "touch_every_ms") p.touchEveryMs = atoi(val);
+    else if (k == "double_pct") p.doublePct = atoi(val);
+    else if (k == "dist") p.dist = val;
+    else if (k == "latency_ms") p.latencyMs = atof(val);
+    else if (k == "jitter_ms") p.jitterMs = atof(val);
+    else if (k == "loss_good") p.lossGood = atof(val);
+    else if (k == "loss_bad") p.lossBad = atof(val);
+    else if (k == "p_good_bad") p.pGoodBad = atof(val);
+    else if (k == "p_bad_good") p.pBadGood = atof(val);
+    else if (k == "reorder_pct") p.reorderPct = atof(val);
+    else if (k == "reorder_ms") p.reorderMs = atof(val);
+    else if (k == "disconnect_every_s") p.disconnectEveryS = atoi(val);
+    else if (k == "disconnect_ms") p.disconnectMs = atoi(val);
+    else if (k == "reconnect_ms") p.reconnectMs = atoi(val);
+    else if (k == "max_stale_pct") p.maxStalePct = atof(val);
+    else if (k == "seed") p.seed = atoi(val);
+    else fprintf(stderr, "%s: 未知参数 %s\n", path, key);
+  }
+  fclose(f);
+  return true;
+}
+
+// ===================== 随机数 =====================
+static uint64_t g_rng = 1;
+static double rnd() {  // [0,1)
+  g_rng ^= g_rng << 13;
+  g_rng ^= g_rng >> 7;
+  g_rng ^= g_rng << 17;
+  return (g_rng >> 11) * (1.0 / 9007199254740992.0);
+}
+static double rndNormal() {
+  double u = rnd() + 1e-12, v = rnd();
+  return sqrt(-2.0 * log(u)) * cos(2 * M_PI * v);
+}
+
+// ===================== 仿真无线链路（单方向） =====================
+struct Packet {
+  uint32_t deliverAt;
+  uint32_t order;   // 同一时刻按发送顺序交付
+  std::string data;
+};
+
+class Channel {
+public:
+  explicit Channel(const Profile& p) : m_p(p) {}
+
+  void send(uint32_t now, const std::string& data) {
+    m_sent++;
+    // Gilbert-Elliott：先转移状态，再按当前状态丢包
+    if (m_bad) { if (rnd() < m_p.pBadGood) m_bad = false; }
+    else if (rnd() < m_p.pGoodBad) m_bad = true;
+    if (rnd() < (m_bad ? m_p.lossBad : m_p.lossGood)) {
+      m_lost++;
+      return;
+    }
+    double d = m_p.latencyMs;
+    if (m_p.dist == "uniform") d += (rnd() * 2 - 1) * m_p.jitterMs;
+    else if (m_p.dist == "normal") d += rndNormal() * m_p.jitterMs;
+    else d += -log(1.0 - rnd()) * m_p.jitterMs;
+    if (m_p.reorderPct > 0 && rnd() * 100 < m_p.reorderPct) d += rnd() * m_p.reorderMs;
+    if (d < 1) d = 1;
+    m_queue.push_back({now + (uint32_t)d, m_order++, data});
+  }
+
+  // 取出到期的包（按到达时间、再按发送顺序）
+  void deliver(uint32_t now, std::vector<std::string>& out) {
+    std::sort(m_queue.begin(), m_queue.end(), [](const Packet& a, const Packet& b) {
+      return a.deliverAt != b.deliverAt ? a.deliverAt < b.deliverAt : a.order < b.order;
+    });
+    size_t n = 0;
+    while (n < m_queue.size() && m_queue[n].deliverAt <= now) out.push_back(m_queue[n++].data);
+    m_queue.erase(m_queue.begin(), m_queue.begin() + n);
+  }
+
+  // 断线：在途的包全部丢失
+  void drop() {
+    m_lost += m_queue.size();
+    m_queue.clear();
+  }
+
+  uint32_t sent() const { return m_sent; }
+  uint32_t lost() const { return m_lost; }
+
+private:
+  const Profile& m_p;
+  std::vector<Packet> m_queue;
+  bool m_bad = false;
+  uint32_t m_order = 0;
+  uint32_t m_sent = 0;
+  uint32_t m_lost = 0;
+};
+
+// ===================== 一方：剑端 + 链路 + 主机接收状态 =====================
+struct Touch {
+  uint32_t trueMs;        // 真实击中时刻（主机时钟）
+  bool judged = false;    // 以 FRESH/LATE 被主机接收
+  bool stale = false;
+  bool held = false;      // 击中时或送达前链路断开，在剑端暂存环里等重连
+  uint32_t arriveMs = 0;  // 首次被接收的时刻
+  uint32_t hitTimeMs = 0; // 主机换算出的击中时刻
+};
+
+struct Side {
+  const char* name;
+  HitSide hitSide;
+  HitOutbox outbox;
+  uint16_t sid;
+  uint32_t clockOffset;   // 剑端 millis() 与主机 millis() 的差
+  uint16_t score = 0;
+  bool connected = true;
+  bool ackCapable = false;
+  uint8_t clockLeft = 0;  // 收到 hello 后还要发的时钟样本帧
+  uint32_t clockAt = 0;
+  uint32_t helloAt = 0;   // 主机在这个时刻发 hello（连接建立后）
+  uint32_t downAt = 0;    // 下次断线时刻
+  uint32_t upAt = 0;      // 断线结束时刻
+  Channel up;             // 剑端 → 主机（通知）
+  Channel down;           // 主机 → 剑端（hello / ack）
+  std::map<uint16_t, size_t> seqToTouch;
+  std::vector<Touch> touches;
+  uint32_t disconnects = 0;
+
+  Side(const char* n, HitSide hs, const Profile& p) : name(n), hitSide(hs), up(p), down(p) {}
+};
+
+static uint32_t nextInterval(uint32_t meanMs) {
+  return (uint32_t)(-log(1.0 - rnd()) * meanMs) + 1;
+}
+
+static void scheduleDisconnect(Side& s, const Profile& p, uint32_t now) {
+  s.downAt = p.disconnectEveryS ? now + nextInterval(p.disconnectEveryS * 1000) : UINT32_MAX;
+}
+
+// 剑端：击中入队（对应固件 hitEvent）
+static void pointerHit(Side& s, uint32_t now) {
+  if (s.score < 99) s.score++;
+  uint16_t seq = s.outbox.push(now + s.clockOffset, s.score);
+  Touch t;
+  t.trueMs = now;
+  t.held = !s.connected;
+  s.seqToTouch[seq] = s.touches.size();
+  s.touches.push_back(t);
+}
+
+// 剑端 loop：处理主机写入，发送到期记录和时钟样本（对应固件 serviceHitOutbox / sendDueHits / sendClockSample）
+static void pointerService(Side& s, uint32_t now) {
+  std::vector<std::string> in;
+  s.down.deliver(now, in);
+  for (const std::string& m : in) {
+    if (m == "hello") {
+      s.ackCapable = true;
+      s.outbox.resetSendState();
+      s.clockLeft = CLOCK_SAMPLES;
+      s.clockAt = now;
+    } else if (m.compare(0, 4, "ack:") == 0) {
+      s.outbox.ack((uint16_t)atoi(m.c_str() + 4));
+    }
+  }
+  if (!s.connected || !s.ackCapable) return;
+  uint32_t pnow = now + s.clockOffset;
+  HitRecord* rec;
+  while ((rec = s.outbox.nextDue(pnow, true)) != nullptr) {
+    char frame[96];
+    snprintf(frame, sizeof(frame), "time:%lu|%s:%u|seq:%u|sid:%04x|age:%lu|old:%u", (unsigned long)rec->timeMs,
+             s.hitSide == HIT_SIDE_RED ? "RED" : "GREEN", rec->score, rec->seq, s.sid,
+             (unsigned long)(pnow - rec->timeMs), s.outbox.oldest()->seq);
+    s.up.send(now, frame);
+    s.outbox.markSent(rec, pnow);
+  }
+  if (s.clockLeft > 0 && s.outbox.count() == 0 && now >= s.clockAt) {
+    char frame[48];
+    snprintf(frame, sizeof(frame), "clk:%lu|sid:%04x", (unsigned long)pnow, s.sid);
+    s.up.send(now, frame);
+    s.clockLeft--;
+    s.clockAt = now + CLOCK_SAMPLE_GAP_MS;
+  }
+}
+
+// 主机：通知回调 + 蓝牙任务回确认（对应固件 handleHitFrame / sendHitAcks）
+static void masterService(Side& s, HitLink& link, uint32_t now) {
+  std::vector<std::string> in;
+  s.up.deliver(now, in);
+  for (const std::string& m : in) {
+    HitFrame frame;
+    if (!HitLink::parseFrame((const uint8_t*)m.data(), m.size(), frame)) {
+      link.countMalformed(s.hitSide);
+      continue;
+    }
+    uint32_t hitTime = now;
+    HitFrameResult r = link.accept(s.hitSide, frame, now, hitTime);
+    auto it = s.seqToTouch.find(frame.seq);
+    if (it == s.seqToTouch.end()) continue;
+    Touch& t = s.touches[it->second];
+    if (r == HIT_FRAME_FRESH || r == HIT_FRAME_LATE) {
+      if (!t.judged) {
+        t.judged = true;
+        t.arriveMs = now;
+        t.hitTimeMs = hitTime;
+      }
+    } else if (r == HIT_FRAME_STALE) {
+      t.stale = true;
+    }
+  }
+  char ack[16];
+  if (s.connected && link.takeAck(s.hitSide, ack, sizeof(ack))) s.down.send(now, ack);
+}
+
+// 连接状态：到点断线（在途包丢失，剑端不再发），断线结束后经 reconnectMs 重新连上并发 hello
+static void linkEvents(Side& s, const Profile& p, uint32_t now) {
+  if (s.connected && now >= s.downAt) {
+    s.connected = false;
+    s.ackCapable = false;
+    s.up.drop();
+    s.down.drop();
+    s.upAt = now + p.disconnectMs;
+    s.disconnects++;
+    for (Touch& t : s.touches) {
+      if (!t.judged && !t.stale) t.held = true;
+    }
+  }
+  if (!s.connected && now >= s.upAt + p.reconnectMs) {
+    s.connected = true;
+    s.helloAt = now;
+    scheduleDisconnect(s, p, now);
+  }
+  // hello 是有响应写：丢了由链路层重传，这里按超时重发近似，直到剑端收到
+  if (s.connected && s.helloAt != UINT32_MAX && now >= s.helloAt) {
+    if (s.ackCapable) {
+      s.helloAt = UINT32_MAX;
+    } else {
+      s.down.send(now, "hello");
+      s.helloAt = now + HELLO_RETRY_MS;
+    }
+  }
+}
+
+static double percentile(std::vector<uint32_t>& v, double pct) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  size_t i = (size_t)(pct / 100.0 * (v.size() - 1) + 0.5);
+  return v[i];
+}
+
+// 跑一个场景，返回是否有丢失/误判
+static bool runProfile(const Profile& p) {
+  g_rng = 0x9E3779B97F4A7C15ull ^ p.seed;
+  Side sides[2] = {Side("red", HIT_SIDE_RED, p), Side("green", HIT_SIDE_GREEN, p)};
+  HitLink link;
+  for (Side& s : sides) {
+    s.sid = (uint16_t)(rnd() * 65535);
+    s.clockOffset = (uint32_t)(rnd() * 1000000);
+    s.helloAt = 0;
+    scheduleDisconnect(s, p, 0);
+  }
+
+  // 互中记录：两方击中下标
+  std::vector<std::pair<size_t, size_t>> doubles;
+  uint32_t end = p.durationS * 1000;
+  uint32_t nextTouch = nextInterval(p.touchEveryMs);
+  uint32_t pendingSecondAt = UINT32_MAX;
+  int pendingSecondSide = -1;
+
+  for (uint32_t now = 0; now < end + 5000; now++) {
+    for (Side& s : sides) linkEvents(s, p, now);
+
+    if (now < end && now >= nextTouch && pendingSecondSide < 0) { // 互中的第二剑还没到就不开新一剑
+      nextTouch = now + nextInterval(p.touchEveryMs);
+      if (rnd() * 100 < p.doublePct) {
+        // 互中：第二剑在窗口内稍后到来
+        int first = rnd() < 0.5 ? 0 : 1;
+        pointerHit(sides[first], now);
+        pendingSecondSide = 1 - first;
+        pendingSecondAt = now + (uint32_t)(rnd() * (DOUBLE_WINDOW_MS - 5));
+        doubles.push_back({first == 0 ? sides[0].touches.size() - 1 : SIZE_MAX,
+                           first == 1 ? sides[1].touches.size() - 1 : SIZE_MAX});
+      } else {
+        pointerHit(sides[rnd() < 0.5 ? 0 : 1], now);
+      }
+    }
+    if (pendingSecondSide >= 0 && now >= pendingSecondAt) {
+      pointerHit(sides[pendingSecondSide], now);
+      if (pendingSecondSide == 0) doubles.back().first = sides[0].touches.size() - 1;
+      else doubles.back().second = sides[1].touches.size() - 1;
+      pendingSecondSide = -1;
+    }
+
+    for (Side& s : sides) pointerService(s, now);
+    for (Side& s : sides) masterService(s, link, now);
+  }
+
+  // ---------- 统计 ----------
+  uint32_t total = 0, onTime = 0, late = 0, stale = 0, heldStale = 0, lost = 0;
+  std::vector<uint32_t> latency, tsError;
+  for (Side& s : sides) {
+    for (const Touch& t : s.touches) {
+      total++;
+      if (t.judged) {
+        uint32_t lat = t.arriveMs - t.trueMs;
+        latency.push_back(lat);
+        tsError.push_back((uint32_t)abs((int32_t)(t.hitTimeMs - t.trueMs)));
+        if (lat <= JUDGE_EVAL_MS) onTime++;
+        else late++;
+      } else if (t.stale && t.held) {
+        heldStale++;
+      } else if (t.stale) {
+        stale++;
+      } else {
+        lost++;
+      }
+    }
+  }
+  uint32_t doubleOk = 0, doubleHeld = 0;
+  for (auto& d : doubles) {
+    const Touch& r = sides[0].touches[d.first];
+    const Touch& g = sides[1].touches[d.second];
+    if ((r.stale && r.held) || (g.stale && g.held)) {
+      doubleHeld++;
+      continue;
+    }
+    if (r.judged && g.judged && abs((int32_t)(r.hitTimeMs - g.hitTimeMs)) <= DOUBLE_WINDOW_MS) doubleOk++;
+  }
+  uint32_t dups = 0, retrans = 0, sent = 0, dropped = 0, disc = 0;
+  for (int i = 0; i < 2; i++) {
+    dups += link.stats((HitSide)i).duplicates;
+    retrans += sides[i].outbox.retransmits();
+    dropped += sides[i].outbox.dropped();
+    sent += sides[i].up.sent() + sides[i].down.sent();
+    disc += sides[i].disconnects;
+  }
+
+  printf("\n=== %s ===\n", p.name.c_str());
+  printf("时延 %s %.0f±%.0fms | 丢包 好%.1f%% 坏%.1f%% | 乱序 %.0f%%/%.0fms | 断线 每%us %ums 重连%ums\n",
+         p.dist.c_str(), p.latencyMs, p.jitterMs, p.lossGood * 100, p.lossBad * 100, p.reorderPct, p.reorderMs,
+         p.disconnectEveryS, p.disconnectMs, p.reconnectMs);
+  printf("击中 %u | 按时(≤%dms) %u | 迟到补判 %u | 过期 %u | 断线过期 %u | 丢失 %u | 暂存溢出 %u\n",
+         total, JUDGE_EVAL_MS, onTime, late, stale, heldStale, lost, dropped);
+  printf("送达时延 ms  p50 %.0f  p95 %.0f  p99 %.0f  最大 %.0f\n", percentile(latency, 50),
+         percentile(latency, 95), percentile(latency, 99), percentile(latency, 100));
+  printf("击中时间误差 ms  p50 %.0f  p99 %.0f  最大 %.0f\n", percentile(tsError, 50),
+         percentile(tsError, 99), percentile(tsError, 100));
+  printf("互中 %u/%zu 判对（断线过期 %u 对不计）| 重发 %u | 重复帧 %u | 断线 %u 次 | 空口包 %u\n",
+         doubleOk, doubles.size() - doubleHeld, doubleHeld, retrans, dups, disc, sent);
+  return lost > 0 || stale * 100.0 > p.maxStalePct * total || doubleOk + doubleHeld != doubles.size();
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "用法: %s <场景文件>...\n", argv[0]);
+    return 2;
+  }
+  bool anyFail = false;
+  for (int i = 1; i < argc; i++) {
+    Profile p;
+    if (!loadProfile(argv[i], p)) {
+      fprintf(stderr, "无法读取 %s\n", argv[i]);
+      return 2;
+    }
+    anyFail |= runProfile(p);
+  }
+  return anyFail ? 1 : 0;
+}
\ No newline at end of file
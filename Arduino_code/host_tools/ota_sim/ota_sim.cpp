@@ -0,0 +1,361 @@
+// 剑端蓝牙升级（Linux 主机端）：打包升级镜像，并在仿真链路上跑完整的收发流程
+// 收发两端 OtaSender/OtaReceiver 与主机、剑端固件同一份源码（OtaLink）
+//
+// 编译：
+//   cd Arduino_code/host_tools/ota_sim
+//   g++ -O2 -I../../epee_esp32_s3 -o ota_sim ota_sim.cpp ../../epee_esp32_s3/OtaLink.cpp
+//
+// 用法：
+//   ./ota_sim pack <新固件.bin> [基准固件.bin] -o <输出.img> [-c 块大小=480]
+//       打包镜像。给了基准（剑端当前运行的固件）就做差分：逐字节异或后游程编码，比整包小才用；
+//       否则整包（RAW）。输出 .img 放到主机 LittleFS 的 /ota/red.img、/ota/green.img
+//   ./ota_sim sim [镜像.img 基准.bin] [丢包%=2] [断线间隔秒=0] [断线后重启=0]
+//       仿真：内存模拟 NOR 闪存（只能 1→0，写前必须擦）和 7.5ms 连接间隔的链路，
+//       按丢包、周期断线（可选剑端重启，只保留闪存和进度）跑到完成，
+//       核对最终分区 CRC、续传不早于已存进度，打印估算用时和吞吐。
+//       不给镜像时自己生成 1MB 固件和小改动的新版本，整包和差分各跑一遍
+// 失败（校验不符、传输失败、续传倒退）返回 1
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include "OtaLink.h"
+
+#define CONN_INTERVAL_MS 7.5   // 连接间隔，与主机请求的 6*1.25ms 一致
+#define PACKETS_PER_EVENT 6    // 每个连接事件能塞进的无响应写
+#define ERASE_MS         25.0  // 擦一个 4KB 扇区
+#define WRITE_US_PER_KB  400.0
+#define RECONNECT_MS     1500
+#define PARTITION_SIZE   (1536 * 1024)
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char* path, Bytes& out) {
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr) return false;
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  out.resize(n);
+  bool ok = n == 0 || fread(out.data(), 1, n, f) == (size_t)n;
+  fclose(f);
+  return ok;
+}
+
+static bool writeFile(const char* path, const Bytes& data) {
+  FILE* f = fopen(path, "wb");
+  if (f == nullptr) return false;
+  bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  fclose(f);
+  return ok;
+}
+
+static void put16(uint8_t* p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static void put32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i)); }
+
+static void appendChunk(Bytes& stream, uint32_t outOff, const uint8_t* payload, size_t n) {
+  uint8_t h[OTA_CHUNK_HEADER_LEN];
+  put16(h, (uint16_t)n);
+  put32(h + 2, outOff);
+  put32(h + 6, otaCrc32(0, payload, n));
+  stream.insert(stream.end(), h, h + OTA_CHUNK_HEADER_LEN);
+  stream.insert(stream.end(), payload, payload + n);
+}
+
+// 与剑端 OtaReceiver::decodeChunk 对应：c<0x80 后跟 c+1 个异或字节；c>=0x80 两字节表示相同字节数-1
+static Bytes encodeXorRle(const Bytes& img, const Bytes& base, size_t chunkMax) {
+  Bytes stream;
+  size_t n = img.size();
+  std::vector<uint8_t> d(n);
+  for (size_t i = 0; i < n; i++) d[i] = img[i] ^ (i < base.size() ? base[i] : 0);
+  size_t pos = 0;
+  Bytes payload;
+  while (pos < n) {
+    uint32_t outOff = pos;
+    payload.clear();
+    while (pos < n && payload.size() + 2 <= chunkMax) {
+      size_t z = 0;
+      while (pos + z < n && d[pos + z] == 0 && z < 32768) z++;
+      if (z >= 3 || pos + z == n) {
+        payload.push_back(0x80 | (uint8_t)((z - 1) >> 8));
+        payload.push_back((uint8_t)((z - 1) & 0xFF));
+        pos += z;
+        continue;
+      }
+      size_t room = chunkMax - payload.size() - 1;
+      size_t lit = 0;
+      while (pos + lit < n && lit < 128 && lit < room) {
+        if (d[pos + lit] == 0 && pos + lit + 2 < n && d[pos + lit + 1] == 0 && d[pos + lit + 2] == 0) break;
+        lit++;
+      }
+      payload.push_back((uint8_t)(lit - 1));
+      payload.insert(payload.end(), d.begin() + pos, d.begin() + pos + lit);
+      pos += lit;
+    }
+    appendChunk(stream, outOff, payload.data(), payload.size());
+  }
+  return stream;
+}
+
+static Bytes encodeRaw(const Bytes& img, size_t chunkMax) {
+  Bytes stream;
+  for (size_t pos = 0; pos < img.size(); pos += chunkMax) {
+    size_t n = img.size() - pos < chunkMax ? img.size() - pos : chunkMax;
+    appendChunk(stream, pos, img.data() + pos, n);
+  }
+  return stream;
+}
+
+static Bytes pack(const Bytes& img, const Bytes& base, size_t chunkMax, bool quiet) {
+  Bytes raw = encodeRaw(img, chunkMax);
+  Bytes delta = base.empty() ? Bytes() : encodeXorRle(img, base, chunkMax);
+  bool useDelta = !delta.empty() && delta.size() < raw.size();
+  const Bytes& stream = useDelta ? delta : raw;
+
+  OtaHeader h;
+  h.codec = useDelta ? OTA_CODEC_XOR_RLE : OTA_CODEC_RAW;
+  h.chunkMax = (uint16_t)chunkMax;
+  h.outSize = img.size();
+  h.outCrc = otaCrc32(0, img.data(), img.size());
+  h.streamSize = stream.size();
+  h.baseSize = useDelta ? base.size() : 0;
+  h.baseCrc = useDelta ? otaCrc32(0, base.data(), base.size()) : 0;
+  Bytes out(OTA_HEADER_LEN);
+  otaHeaderBuild(h, out.data());
+  out.insert(out.end(), stream.begin(), stream.end());
+  if (!quiet) {
+    printf("新固件 %zu 字节  整包流 %zu", img.size(), raw.size());
+    if (!base.empty()) printf("  差分流 %zu (%.1f%%)", delta.size(), 100.0 * delta.size() / img.size());
+    printf("  → 用%s，镜像 %zu 字节\n", useDelta ? "差分" : "整包", out.size());
+  }
+  return out;
+}
+
+// ---------------- 仿真 ----------------
+class SimFlash : public OtaFlash {
+public:
+  Bytes part;             // 目标分区
+  Bytes base;             // 当前运行的固件
+  bool hasProgress = false;
+  OtaProgress progress;
+  uint32_t erases = 0;
+  uint32_t badWrites = 0; // 写到没擦过的位置（真闪存上会写坏）
+  uint32_t bytesWritten = 0;
+  bool activated = false;
+
+  SimFlash(const Bytes& running) : part(PARTITION_SIZE, 0x5A), base(running) {}
+
+  uint32_t capacity() override { return part.size(); }
+  uint32_t baseCapacity() override { return PARTITION_SIZE; }
+  bool readBase(uint32_t off, uint8_t* buf, size_t n) override {
+    for (size_t i = 0; i < n; i++) buf[i] = off + i < base.size() ? base[off + i] : 0xFF;
+    return true;
+  }
+  bool erase(uint32_t off, size_t n) override {
+    if (off % OTA_SECTOR != 0 || off + n > part.size()) return false;
+    memset(part.data() + off, 0xFF, n);
+    erases++;
+    return true;
+  }
+  bool write(uint32_t off, const uint8_t* data, size_t n) override {
+    if (off + n > part.size()) return false;
+    for (size_t i = 0; i < n; i++) {
+      if ((part[off + i] & data[i]) != data[i]) badWrites++;
+      part[off + i] &= data[i];
+    }
+    bytesWritten += n;
+    return true;
+  }
+  bool readBack(uint32_t off, uint8_t* buf, size_t n) override {
+    if (off + n > part.size()) return false;
+    memcpy(buf, part.data() + off, n);
+    return true;
+  }
+  bool loadProgress(OtaProgress& p) override {
+    if (!hasProgress) return false;
+    p = progress;
+    return true;
+  }
+  void saveProgress(const OtaProgress& p) override { progress = p; hasProgress = true; }
+  void clearProgress() override { hasProgress = false; }
+  bool activate() override { activated = true; return true; }
+};
+
+class MemReader : public OtaImageReader {
+public:
+  const Bytes& img;
+  explicit MemReader(const Bytes& i) : img(i) {}
+  bool read(uint32_t off, uint8_t* buf, size_t n) override {
+    if (off + n > img.size()) return false;
+    memcpy(buf, img.data() + off, n);
+    return true;
+  }
+};
+
+static bool lost(int lossPct) { return lossPct > 0 && rand() % 100 < lossPct; }
+
+static int runSim(const char* name, const Bytes& img, const Bytes& base, int lossPct, int dropEverySec, bool rebootOnDrop) {
+  OtaHeader h;
+  if (!otaHeaderParse(img.data(), img.size(), h)) {
+    printf("%s：镜像头无效\n", name);
+    return 1;
+  }
+  SimFlash flash(base);
+  OtaReceiver* rx = new OtaReceiver(flash);
+  MemReader reader(img);
+  OtaSender tx;
+
+  double now = 0, busyUntil = 0, linkUpAt = 0, nextDrop = dropEverySec > 0 ? dropEverySec * 1000.0 : 1e18;
+  bool linked = true;
+  uint32_t drops = 0, reboots = 0, badResume = 0;
+  uint32_t expectFrom = 0; // 重连时闪存里存的进度，续传不应早于它
+  std::vector<Bytes> notifies;
+  uint8_t buf[OTA_MTU], reply[OTA_STATUS_LEN];
+  tx.begin(&reader, 0);
+
+  while (now < 3600 * 1000.0) {
+    if (linked && now >= nextDrop) {
+      linked = false;
+      drops++;
+      notifies.clear();
+      linkUpAt = now + RECONNECT_MS;
+      nextDrop = now + dropEverySec * 1000.0;
+      if (rebootOnDrop) {
+        delete rx;                       // 内存状态丢失，只剩闪存和进度
+        rx = new OtaReceiver(flash);
+        reboots++;
+      }
+    }
+    if (!linked && now >= linkUpAt) {
+      linked = true;
+      expectFrom = flash.hasProgress ? flash.progress.nextStream : 0;
+      tx.begin(&reader, (uint32_t)now);  // 主机重连后自动续传
+    }
+    if (linked) {
+      // 上一事件剑端的通知
+      for (size_t i = 0; i < notifies.size(); i++) {
+        uint8_t stateBefore = tx.state();
+        tx.onStatus(notifies[i].data(), notifies[i].size(), (uint32_t)now);
+        if (stateBefore == OTA_SEND_STARTING && tx.state() == OTA_SEND_SENDING && tx.resumedFrom() < expectFrom) {
+          badResume++;
+        }
+      }
+      notifies.clear();
+      for (int k = 0; k < PACKETS_PER_EVENT && now >= busyUntil; k++) {
+        size_t n = tx.next((uint32_t)now, buf, sizeof(buf));
+        if (n == 0) break;
+        if (lost(lossPct)) continue;
+        uint32_t erasesBefore = flash.erases, writtenBefore = flash.bytesWritten;
+        size_t replyLen = 0;
+        if (rx->handle(buf, n, reply, replyLen) && !lost(lossPct)) {
+          notifies.push_back(Bytes(reply, reply + replyLen));
+        }
+        // 擦写占住剑端的蓝牙回调，期间主机的发送缓冲塞满
+        double cost = (flash.erases - erasesBefore) * ERASE_MS +
+                      (flash.bytesWritten - writtenBefore) / 1024.0 * WRITE_US_PER_KB / 1000.0;
+        if (buf[0] == OTA_MSG_END) cost += flash.part.size() / 1024.0 * 0.05; // 回读校验
+        if (cost > 0) busyUntil = (busyUntil > now ? busyUntil : now) + cost;
+      }
+    }
+    if (tx.state() == OTA_SEND_DONE || tx.state() == OTA_SEND_FAILED) break;
+    now += CONN_INTERVAL_MS;
+  }
+
+  uint32_t crc = otaCrc32(0, flash.part.data(), h.outSize);
+  bool ok = tx.state() == OTA_SEND_DONE && flash.activated && crc == h.outCrc && flash.badWrites == 0 && badResume == 0;
+  const OtaSenderStats& ts = tx.stats();
+  const OtaReceiverStats& rs = rx->stats();
+  printf("%s：%s  %s %u→%u 字节  用时 %.1fs  有效 %.1f KB/s（按固件大小）\n", name, ok ? "通过" : "失败",
+         h.codec == OTA_CODEC_XOR_RLE ? "差分" : "整包", h.streamSize, h.outSize, now / 1000.0,
+         h.outSize / 1024.0 / (now / 1000.0));
+  printf("  发送 %u 包 %u 字节（流 %u）  回退 %u  询问 %u  断线 %u  重启 %u\n", ts.packets, ts.bytes, h.streamSize,
+         ts.rewinds, ts.queries, drops, reboots);
+  printf("  剑端：块 %u  重复 %u  缺口 %u  校验错 %u  续传 %u  擦除 %u  未擦先写 %u\n", rs.chunks, rs.duplicates,
+         rs.gaps, rs.crcErrors, rs.resumes, flash.erases, flash.badWrites);
+  if (tx.state() == OTA_SEND_FAILED) printf("  主机失败：%s\n", otaErrorName(tx.error()));
+  if (crc != h.outCrc) printf("  分区 CRC %08X ≠ 镜像 %08X\n", crc, h.outCrc);
+  if (badResume) printf("  续传早于已存进度（%u 次）\n", badResume);
+  delete rx;
+  return ok ? 0 : 1;
+}
+
+// 生成一份像固件的数据：代码段有重复结构，末尾留空白
+static void makeFirmware(Bytes& base, Bytes& img) {
+  base.resize(1024 * 1024);
+  uint32_t x = 12345;
+  for (size_t i = 0; i < base.size(); i++) {
+    if (i > 900 * 1024) { base[i] = 0xFF; continue; }
+    x = x * 1103515245 + 12345;
+    base[i] = (i % 64 < 20) ? (uint8_t)(i / 64) : (uint8_t)(x >> 16);
+  }
+  img = base;
+  // 改几处函数、插一段新代码（后面整体后移），再改字符串
+  for (int k = 0; k < 40; k++) {
+    size_t at = (size_t)(rand() % (850 * 1024));
+    for (int i = 0; i < 64; i++) img[at + i] ^= (uint8_t)rand();
+  }
+  img.insert(img.begin() + 880 * 1024, 2048, 0x42);
+  img.resize(base.size() + 2048);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "用法：%s pack <新.bin> [基准.bin] -o <out.img> [-c 块大小] | sim [镜像.img 基准.bin] [丢包%%] [断线间隔秒] [重启0/1]\n", argv[0]);
+    return 2;
+  }
+  srand(1);
+  if (strcmp(argv[1], "pack") == 0) {
+    const char* in = nullptr;
+    const char* basePath = nullptr;
+    const char* out = nullptr;
+    size_t chunk = OTA_CHUNK_MAX;
+    for (int i = 2; i < argc; i++) {
+      if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out = argv[++i];
+      else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) chunk = atoi(argv[++i]);
+      else if (in == nullptr) in = argv[i];
+      else basePath = argv[i];
+    }
+    if (in == nullptr || out == nullptr || chunk < 16 || chunk > OTA_CHUNK_MAX) {
+      fprintf(stderr, "pack 需要 <新.bin> 和 -o <out.img>，块大小 16..%d\n", OTA_CHUNK_MAX);
+      return 2;
+    }
+    Bytes img, base;
+    if (!readFile(in, img) || (basePath != nullptr && !readFile(basePath, base))) {
+      fprintf(stderr, "读文件失败\n");
+      return 1;
+    }
+    if (!writeFile(out, pack(img, base, chunk, false))) {
+      fprintf(stderr, "写 %s 失败\n", out);
+      return 1;
+    }
+    return 0;
+  }
+  if (strcmp(argv[1], "sim") == 0) {
+    int arg = 2;
+    Bytes img, base;
+    bool given = argc > 3 && strstr(argv[2], ".img") != nullptr;
+    if (given) {
+      if (!readFile(argv[2], img) || !readFile(argv[3], base)) {
+        fprintf(stderr, "读文件失败\n");
+        return 1;
+      }
+      arg = 4;
+    }
+    int loss = argc > arg ? atoi(argv[arg]) : 2;
+    int dropEvery = argc > arg + 1 ? atoi(argv[arg + 1]) : 0;
+    bool reboot = argc > arg + 2 && atoi(argv[arg + 2]) != 0;
+    if (given) return runSim("镜像", img, base, loss, dropEvery, reboot);
+
+    Bytes fw;
+    makeFirmware(base, fw);
+    int fails = 0;
+    fails += runSim("整包", pack(fw, Bytes(), OTA_CHUNK_MAX, false), base, loss, dropEvery, reboot);
+    fails += runSim("差分", pack(fw, base, OTA_CHUNK_MAX, false), base, loss, dropEvery, reboot);
+    return fails ? 1 : 0;
+  }
+  fprintf(stderr, "未知模式 %s\n", argv[1]);
+  return 2;
+}
\ No newline at end of file
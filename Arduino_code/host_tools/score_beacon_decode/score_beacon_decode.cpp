@@ -0,0 +1,101 @@
+// 比分广播解码工具（Linux 主机端）：不用手机即可验证广播格式
+//
+// 编译：
+//   cd Arduino_code/host_tools/score_beacon_decode
+//   g++ -O2 -I../../esp32_repeater/esp32_repeater -o score_beacon_decode score_beacon_decode.cpp ../../esp32_repeater/esp32_repeater/ScoreBeacon.cpp
+//
+// 输入：每行一个十六进制广播包（空格、冒号可有可无），可以是完整的 AD 结构
+// （btmon / nRF Connect 的 Raw data），也可以只是厂商数据（ID 开头的 FFFF E9 ...）
+//   echo "02 01 06 0c ff ff ff e9 01 05 03 02 01 ff ff 01" | ./score_beacon_decode
+//
+// 输出每帧解码结果，并按序号检查丢帧/重复
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include "ScoreBeacon.h"
+
+static const char* phaseName(uint8_t phase) {
+  switch (phase) {
+    case APP_PHASE_IDLE: return "idle";
+    case APP_PHASE_RED_HIT: return "red_hit";
+    case APP_PHASE_GRN_HIT: return "grn_hit";
+    case APP_PHASE_DOUBLE: return "double";
+    case APP_PHASE_SCANNING: return "scanning";
+    default: return "?";
+  }
+}
+
+static int hexVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  c = (char)tolower((unsigned char)c);
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+// 十六进制行转字节，跳过空格/冒号/0x 前缀
+static size_t parseHex(const char* line, uint8_t* out, size_t cap) {
+  size_t n = 0;
+  int hi = -1;
+  for (const char* p = line; *p && n < cap; p++) {
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) { p++; continue; }
+    int v = hexVal(*p);
+    if (v < 0) { hi = -1; continue; }
+    if (hi < 0) { hi = v; continue; }
+    out[n++] = (uint8_t)((hi << 4) | v);
+    hi = -1;
+  }
+  return n;
+}
+
+// 在 AD 结构里找厂商数据；不是合法 AD 结构时把整行当作厂商数据
+static bool findBeacon(const uint8_t* data, size_t len, uint8_t& seq, AppState& st) {
+  size_t i = 0;
+  while (i < len) {
+    uint8_t adLen = data[i];
+    if (adLen == 0 || i + 1 + adLen > len) break;
+    if (data[i + 1] == 0xFF && ScoreBeacon::parse(&data[i + 2], adLen - 1, seq, st)) return true;
+    i += 1 + adLen;
+  }
+  return ScoreBeacon::parse(data, len, seq, st);
+}
+
+int main() {
+  char line[512];
+  uint8_t buf[256];
+  bool haveLast = false;
+  uint8_t lastSeq = 0;
+  unsigned long frames = 0, dups = 0, gaps = 0, ignored = 0;
+
+  while (fgets(line, sizeof(line), stdin) != nullptr) {
+    size_t n = parseHex(line, buf, sizeof(buf));
+    if (n == 0) continue;
+    uint8_t seq;
+    AppState st;
+    if (!findBeacon(buf, n, seq, st)) {
+      ignored++;
+      continue;
+    }
+    frames++;
+    const char* note = "";
+    if (haveLast) {
+      uint8_t step = (uint8_t)(seq - lastSeq);
+      if (step == 0) { dups++; note = "  (重复，同一状态的周期广播)"; }
+      else if (step > 1) { gaps += step - 1; note = "  (丢失中间状态)"; }
+    }
+    haveLast = true;
+    lastSeq = seq;
+
+    char timer[16];
+    if (st.timerSec == APP_TIMER_NONE) snprintf(timer, sizeof(timer), "--:--");
+    else snprintf(timer, sizeof(timer), "%02u:%02u", st.timerSec / 60, st.timerSec % 60);
+    printf("seq=%3u  红 %3u : %3u 绿  灯[%c%c] 连接[%c%c]  计时 %s  阶段 %s%s\n",
+           seq, st.redScore, st.grnScore,
+           (st.lamps & APP_LAMP_RED) ? 'R' : '-', (st.lamps & APP_LAMP_GRN) ? 'G' : '-',
+           (st.lamps & APP_LAMP_RED_LINK) ? 'R' : '-', (st.lamps & APP_LAMP_GRN_LINK) ? 'G' : '-',
+           timer, phaseName(st.phase), note);
+  }
+  fprintf(stderr, "帧:%lu 重复:%lu 丢失状态:%lu 非比分广播:%lu\n", frames, dups, gaps, ignored);
+  return 0;
+}
\ No newline at end of file
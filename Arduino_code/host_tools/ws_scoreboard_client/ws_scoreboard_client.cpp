@@ -0,0 +1,197 @@
+// 计分板 WebSocket 压测客户端（Linux 主机端）
+// 同时打开 N 个 WebSocket 连接到 S3 计分板，统计每个连接收到的消息数、序号跳变（被背压合并的状态）
+// 和最大消息间隔。配合 S3 串口 'w' 的判定循环最大延迟，找出判定开始受影响时的客户端数。
+//
+// 编译：g++ -O2 -o ws_scoreboard_client ws_scoreboard_client.cpp
+// 用法：./ws_scoreboard_client <主机> [客户端数=4] [秒数=30] [慢客户端数=0] [端口=80]
+//   慢客户端只连接不读取，用来验证一个卡住的浏览器不会拖慢其他客户端
+//   例：./ws_scoreboard_client 192.168.4.1 8 60 2
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define MAX_CLIENTS 64
+
+struct WsClient {
+  int fd;
+  bool slow;
+  bool open;
+  uint8_t buf[4096];
+  size_t used;
+  unsigned long msgs;
+  unsigned long seqJumps;   // 序号跳过的状态数（背压合并）
+  long lastSeq;
+  double lastMsgMs;
+  double maxGapMs;
+};
+
+static double nowMs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int connectTo(const char* host, const char* port) {
+  struct addrinfo hints = {}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+  int fd = socket(res->ai_family, res->ai_socktype, 0);
+  if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if (fd >= 0) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  return fd;
+}
+
+// 发握手请求并读到响应头结束（服务器不校验客户端 key 之外的内容，这里也不校验 accept）
+static bool handshake(int fd, const char* host) {
+  char req[512];
+  int n = snprintf(req, sizeof(req),
+                   "GET /ws HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                   "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", host);
+  if (write(fd, req, n) != n) return false;
+  char resp[1024];
+  size_t used = 0;
+  while (used < sizeof(resp) - 1) {
+    ssize_t r = read(fd, resp + used, 1);
+    if (r <= 0) return false;
+    used += r;
+    resp[used] = '\0';
+    if (used >= 4 && strcmp(resp + used - 4, "\r\n\r\n") == 0) break;
+  }
+  return strstr(resp, " 101 ") != nullptr;
+}
+
+// 从缓冲区取出完整帧（服务器帧不带掩码）
+static void drainFrames(WsClient& c) {
+  size_t pos = 0;
+  while (c.used - pos >= 2) {
+    uint8_t* p = c.buf + pos;
+    uint8_t opcode = p[0] & 0x0F;
+    uint64_t len = p[1] & 0x7F;
+    size_t hdr = 2;
+    if (len == 126) {
+      if (c.used - pos < 4) break;
+      len = (p[2] << 8) | p[3];
+      hdr = 4;
+    } else if (len == 127) {
+      if (c.used - pos < 10) break;
+      len = 0;
+      for (int i = 0; i < 8; i++) len = (len << 8) | p[2 + i];
+      hdr = 10;
+    }
+    if (c.used - pos < hdr + len) break;
+
+    if (opcode == 0x1) {
+      char text[512];
+      size_t tl = len < sizeof(text) - 1 ? len : sizeof(text) - 1;
+      memcpy(text, p + hdr, tl);
+      text[tl] = '\0';
+      const char* s = strstr(text, "\"seq\":");
+      if (s != nullptr) {
+        long seq = strtol(s + 6, nullptr, 10);
+        if (c.lastSeq >= 0 && seq > c.lastSeq + 1) c.seqJumps += seq - c.lastSeq - 1;
+        c.lastSeq = seq;
+      }
+      double t = nowMs();
+      if (c.msgs > 0 && t - c.lastMsgMs > c.maxGapMs) c.maxGapMs = t - c.lastMsgMs;
+      c.lastMsgMs = t;
+      c.msgs++;
+    } else if (opcode == 0x8) {
+      c.open = false;
+    }
+    pos += hdr + len;
+  }
+  memmove(c.buf, c.buf + pos, c.used - pos);
+  c.used -= pos;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "用法: %s <主机> [客户端数=4] [秒数=30] [慢客户端数=0] [端口=80]\n", argv[0]);
+    return 1;
+  }
+  const char* host = argv[1];
+  int count = argc > 2 ? atoi(argv[2]) : 4;
+  int seconds = argc > 3 ? atoi(argv[3]) : 30;
+  int slow = argc > 4 ? atoi(argv[4]) : 0;
+  const char* port = argc > 5 ? argv[5] : "80";
+  if (count < 1 || count > MAX_CLIENTS) count = 4;
+
+  static WsClient clients[MAX_CLIENTS];
+  int opened = 0;
+  for (int i = 0; i < count; i++) {
+    WsClient& c = clients[i];
+    memset(&c, 0, sizeof(c));
+    c.lastSeq = -1;
+    c.slow = i < slow;
+    c.fd = connectTo(host, port);
+    if (c.fd < 0 || !handshake(c.fd, host)) {
+      fprintf(stderr, "客户端 %d 连接/握手失败\n", i);
+      if (c.fd >= 0) close(c.fd);
+      c.fd = -1;
+      continue;
+    }
+    c.open = true;
+    opened++;
+  }
+  printf("已连接 %d/%d 个客户端（慢客户端 %d 个），测试 %d 秒\n", opened, count, slow, seconds);
+
+  double start = nowMs();
+  double nextReport = start + 1000;
+  struct pollfd pfds[MAX_CLIENTS];
+  while (nowMs() - start < seconds * 1000.0) {
+    int n = 0;
+    int map[MAX_CLIENTS];
+    for (int i = 0; i < count; i++) {
+      if (!clients[i].open || clients[i].slow) continue;
+      pfds[n].fd = clients[i].fd;
+      pfds[n].events = POLLIN;
+      map[n++] = i;
+    }
+    poll(pfds, n, 100);
+    for (int k = 0; k < n; k++) {
+      if (!(pfds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      WsClient& c = clients[map[k]];
+      ssize_t r = read(c.fd, c.buf + c.used, sizeof(c.buf) - c.used);
+      if (r <= 0) {
+        c.open = false;
+        continue;
+      }
+      c.used += r;
+      drainFrames(c);
+    }
+    if (nowMs() >= nextReport) {
+      unsigned long total = 0;
+      for (int i = 0; i < count; i++) total += clients[i].msgs;
+      printf("%5.0fs  累计消息 %lu\n", (nowMs() - start) / 1000.0, total);
+      nextReport += 1000;
+    }
+  }
+
+  printf("\n客户端  状态  消息数  消息/秒  序号跳过  最大间隔ms\n");
+  for (int i = 0; i < count; i++) {
+    WsClient& c = clients[i];
+    if (c.fd < 0) continue;
+    printf("%6d  %s  %6lu  %7.1f  %8lu  %10.1f\n", i, c.slow ? "慢  " : (c.open ? "正常" : "断开"),
+           c.msgs, c.msgs / (double)seconds, c.seqJumps, c.maxGapMs);
+    close(c.fd);
+  }
+  printf("\n在 S3 串口输入 'w' 查看判定循环最大延迟，逐步增加客户端数直到该值明显上升\n");
+  return 0;
+}
\ No newline at end of file
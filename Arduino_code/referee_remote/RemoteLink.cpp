@@ -0,0 +1,58 @@
+#include "RemoteLink.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+RemoteLink::RemoteLink() : m_synced(false), m_sid(0), m_lastSeq(0) {
+  memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool RemoteLink::parseCommand(const uint8_t* data, size_t len, RemoteCommand& out) {
+  if (data == nullptr || len == 0) return false;
+  char buf[REMOTE_FRAME_LEN];
+  if (len >= sizeof(buf)) len = sizeof(buf) - 1;
+  memcpy(buf, data, len);
+  buf[len] = '\0';
+
+  memset(&out, 0, sizeof(out));
+  bool hasCmd = false, hasSeq = false, hasSid = false;
+  char* save = nullptr;
+  for (char* tok = strtok_r(buf, "|", &save); tok != nullptr; tok = strtok_r(nullptr, "|", &save)) {
+    char* colon = strchr(tok, ':');
+    if (colon == nullptr) continue;
+    *colon = '\0';
+    const char* val = colon + 1;
+    if (strcmp(tok, "cmd") == 0) {
+      out.cmd = (uint8_t)strtoul(val, nullptr, 10);
+      hasCmd = true;
+    } else if (strcmp(tok, "seq") == 0) {
+      out.seq = (uint16_t)strtoul(val, nullptr, 10);
+      hasSeq = true;
+    } else if (strcmp(tok, "sid") == 0) {
+      out.sid = (uint16_t)strtoul(val, nullptr, 16);
+      hasSid = true;
+    }
+  }
+  return hasCmd && hasSeq && hasSid;
+}
+
+int RemoteLink::formatCommand(const RemoteCommand& c, char* buf, size_t len) {
+  return snprintf(buf, len, "cmd:%u|seq:%u|sid:%04x", c.cmd, c.seq, c.sid);
+}
+
+RemoteAckResult RemoteLink::accept(const RemoteCommand& c) {
+  if (m_synced && c.sid == m_sid && (int16_t)(c.seq - m_lastSeq) <= 0) {
+    // 确认丢了遥控器才会重发：已执行过，只回确认
+    m_stats.duplicates++;
+    return REMOTE_ACK_DUPLICATE;
+  }
+  m_synced = true;
+  m_sid = c.sid;
+  m_lastSeq = c.seq;
+  if (c.cmd >= REMOTE_CMD_COUNT) {
+    m_stats.rejected++;
+    return REMOTE_ACK_REJECTED;
+  }
+  m_stats.applied++;
+  return REMOTE_ACK_APPLIED;
+}
\ No newline at end of file
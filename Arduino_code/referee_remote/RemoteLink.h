@@ -0,0 +1,77 @@
+#ifndef REMOTE_LINK_H
+#define REMOTE_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 无线裁判遥控器协议（ESP-NOW，文本帧，与击中帧同样的 key:value 写法）
+//   遥控器→主机："hello|sid:<会话>"                         上电/丢失随机数后请求本次随机数
+//                "cmd:<命令>|seq:<序号>|sid:<会话>|mac:<标签>" 命令，HitAuth 签名（密钥+主机随机数）
+//                "pair?" / "paired"                          配对请求 / 已保存密钥
+//   主机→遥控器："nonce:<16位十六进制>"                       本次随机数（校验失败时也重发）
+//                "pair:<32位十六进制>"                        配对密钥（仅主机配对窗口内）
+//                "ack:<序号>|r:<结果>"                        命令已执行/重复/拒绝
+// 遥控器同一时刻只有一条命令在途，收到确认才发下一条，超时按原序号重发；主机按序号去重
+// 不依赖 Arduino.h，主机端工具可直接编译
+
+#define REMOTE_CHANNEL         1     // 固定信道（主机开计分板热点时热点也用这个信道）
+#define REMOTE_ACK_TIMEOUT_MS  25    // 等确认超时，超时按原序号重发
+#define REMOTE_MAX_TRIES       4     // 总发送次数，全部超时则震动报错
+#define REMOTE_FRAME_LEN       96
+
+// 命令编号（与 FencingCore::CoreButton 一致，主机直接当按键编号用）
+enum RemoteCmd {
+  REMOTE_CMD_NEXT = 0,
+  REMOTE_CMD_RESET,
+  REMOTE_CMD_PHASE,
+  REMOTE_CMD_MODE,
+  REMOTE_CMD_RED_ADD,
+  REMOTE_CMD_RED_SUB,
+  REMOTE_CMD_GREEN_ADD,
+  REMOTE_CMD_GREEN_SUB,
+  REMOTE_CMD_COUNT
+};
+
+enum RemoteAckResult {
+  REMOTE_ACK_APPLIED = 0,   // 已交给判定任务执行
+  REMOTE_ACK_DUPLICATE,     // 重发的旧命令，之前已执行过，不再执行
+  REMOTE_ACK_REJECTED       // 命令编号无效
+};
+
+struct RemoteCommand {
+  uint8_t cmd;
+  uint16_t seq;
+  uint16_t sid;
+};
+
+// 主机端每个遥控器的接收状态
+struct RemoteLinkStats {
+  uint32_t applied;
+  uint32_t duplicates;
+  uint32_t rejected;
+  uint32_t authFailed;
+};
+
+class RemoteLink {
+public:
+  RemoteLink();
+
+  // 解析 "cmd:..|seq:..|sid:.."（标签已由 HitAuth 去掉），字段不全返回 false
+  static bool parseCommand(const uint8_t* data, size_t len, RemoteCommand& out);
+  // 生成命令正文（不含标签），返回长度
+  static int formatCommand(const RemoteCommand& c, char* buf, size_t len);
+
+  // 主机：按会话+序号去重，新会话（遥控器重启）从当前序号重新开始
+  RemoteAckResult accept(const RemoteCommand& c);
+  void countAuthFailed() { m_stats.authFailed++; }
+
+  const RemoteLinkStats& stats() const { return m_stats; }
+
+private:
+  bool m_synced;
+  uint16_t m_sid;
+  uint16_t m_lastSeq;
+  RemoteLinkStats m_stats;
+};
+
+#endif // REMOTE_LINK_H
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
+#include <Preferences.h>
+#include "HitAuth.h"
+#include "RemoteLink.h"
+
+// =====================【引脚定义 - ESP32C3 Supermini 无线裁判遥控器】=====================
+// 按键顺序与 S3 主机的实体按键一致，按下接地（内部上拉）
+#define BTN_NEXT        0     // 下一分 / 开始暂停（上电时按住进入配对模式）
+#define BTN_RESET       1     // 全局重置
+#define BTN_PHASE       2     // 比赛/休息
+#define BTN_MODE        3     // 赛制切换
+#define BTN_RED_ADD     4
+#define BTN_RED_SUB     5
+#define BTN_GREEN_ADD   6
+#define BTN_GREEN_SUB   7
+#define LED_STATUS      8     // 板载灯（低电平亮）
+#define VIBRATE_PIN     10    // 震动马达（经三极管驱动，高电平震动）
+#define DEBOUNCE_DELAY  20
+
+// =====================【反馈时长】=====================
+#define VIBRATE_ACK_MS     40     // 主机确认：短震
+#define VIBRATE_FAIL_MS    400    // 重发用完仍无确认：长震
+#define HELLO_RETRY_MS     500    // 没拿到随机数时每隔这么久请求一次
+
+// =====================【配对 - 与剑端同样的做法：按住按键上电】=====================
+#define AUTH_NS            "epee_auth"
+#define PAIR_MODE_MS       60000  // 上电时按住“下一分”进入配对模式，持续这么久（主机串口 p 开窗口）
+#define PAIR_RETRY_MS      500
+static const uint8_t BROADCAST_MAC[6] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+static const int buttonPins[REMOTE_CMD_COUNT] = {
+  BTN_NEXT, BTN_RESET, BTN_PHASE, BTN_MODE, BTN_RED_ADD, BTN_RED_SUB, BTN_GREEN_ADD, BTN_GREEN_SUB
+};
+
+// =====================【状态变量】=====================
+HitAuth hitAuth;                          // 命令签名（配对密钥 + 主机本次随机数）
+uint8_t masterMac[6];
+bool masterKnown = false;
+static uint16_t sessionId = 0;            // 本次上电会话号，主机据此区分重启前后的序号
+static uint16_t nextSeq = 1;
+static unsigned long pairModeUntil = 0;
+static unsigned long lastHelloMs = 0;
+static unsigned long lastPairMs = 0;
+
+// 命令队列：同一时刻只有一条在途，收到确认才发下一条
+#define CMD_QUEUE_LEN 8
+static uint8_t cmdQueue[CMD_QUEUE_LEN];
+static int cmdHead = 0, cmdCount = 0;
+static bool inFlight = false;
+static RemoteCommand current;
+static int tries = 0;
+static int64_t sentUs = 0;                // 首次发送时间（算确认往返）
+static unsigned long lastSendMs = 0;
+
+// 按键消抖
+static bool lastReading[REMOTE_CMD_COUNT];
+static bool stableState[REMOTE_CMD_COUNT];
+static unsigned long lastChange[REMOTE_CMD_COUNT];
+
+// 震动/指示灯
+static unsigned long vibrateUntil = 0;
+
+// ESP-NOW 回调（Wi-Fi 任务）只把收到的帧放进队列，loop 里处理
+struct RemoteRx {
+  uint8_t mac[6];
+  uint8_t len;
+  char data[REMOTE_FRAME_LEN];
+};
+static QueueHandle_t rxQueue = NULL;
+
+// 往返统计（串口打印）
+static uint32_t ackCount = 0;
+static uint32_t failCount = 0;
+static uint32_t retryCount = 0;
+static uint32_t rttMaxUs = 0;
+
+// =====================【ESP-NOW】=====================
+static void onRecv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+  if (len <= 0 || len >= REMOTE_FRAME_LEN) return;
+  RemoteRx rx;
+  memcpy(rx.mac, info->src_addr, 6);
+  rx.len = (uint8_t)len;
+  memcpy(rx.data, data, len);
+  rx.data[len] = '\0';
+  xQueueSend(rxQueue, &rx, 0);
+}
+
+void addPeer(const uint8_t* mac) {
+  if (esp_now_is_peer_exist(mac)) return;
+  esp_now_peer_info_t p = {};
+  memcpy(p.peer_addr, mac, 6);
+  p.channel = REMOTE_CHANNEL;
+  p.ifidx = WIFI_IF_STA;
+  p.encrypt = false;
+  esp_now_add_peer(&p);
+}
+
+void sendText(const uint8_t* mac, const char* text) {
+  esp_now_send(mac, (const uint8_t*)text, strlen(text));
+}
+
+void sendHello() {
+  char msg[24];
+  snprintf(msg, sizeof(msg), "hello|sid:%04x", sessionId);
+  sendText(masterMac, msg);
+  lastHelloMs = millis();
+}
+
+// 签名并发出当前命令（重发时随机数可能已换，每次重签）
+void sendCurrent() {
+  char frame[REMOTE_FRAME_LEN];
+  RemoteLink::formatCommand(current, frame, sizeof(frame));
+  if (!hitAuth.sign(frame, sizeof(frame))) return;
+  sendText(masterMac, frame);
+  lastSendMs = millis();
+  tries++;
+}
+
+// =====================【反馈】=====================
+void vibrate(unsigned long ms) {
+  digitalWrite(VIBRATE_PIN, HIGH);
+  digitalWrite(LED_STATUS, LOW);
+  vibrateUntil = millis() + ms;
+}
+
+void updateFeedback() {
+  if (vibrateUntil != 0 && (long)(millis() - vibrateUntil) >= 0) {
+    digitalWrite(VIBRATE_PIN, LOW);
+    vibrateUntil = 0;
+  }
+  if (vibrateUntil != 0) return;
+  // 指示灯：配对模式快闪，未拿到随机数慢闪，就绪常灭
+  bool on = false;
+  if (pairModeUntil != 0) on = (millis() / 100) % 2;
+  else if (!hitAuth.hasNonce()) on = (millis() / 500) % 2;
+  digitalWrite(LED_STATUS, on ? LOW : HIGH);
+}
+
+// =====================【收包处理】=====================
+void handleRx(const RemoteRx& rx) {
+  const char* text = rx.data;
+  if (strncmp(text, "pair:", 5) == 0) {
+    if (pairModeUntil == 0 || (long)(millis() - pairModeUntil) >= 0) return;
+    uint8_t key[HIT_AUTH_KEY_LEN];
+    if (!HitAuth::parseHex(text + 5, strlen(text + 5), key, sizeof(key))) return;
+    Preferences prefs;
+    if (prefs.begin(AUTH_NS, false)) {
+      prefs.putBytes("key", key, sizeof(key));
+      prefs.putBytes("master", rx.mac, 6);
+      prefs.end();
+    }
+    hitAuth.setKey(key);
+    memcpy(masterMac, rx.mac, 6);
+    masterKnown = true;
+    addPeer(masterMac);
+    sendText(masterMac, "paired");
+    pairModeUntil = 0;
+    Serial.println("✅ 【配对】已保存主机密钥");
+    vibrate(VIBRATE_ACK_MS);
+    sendHello();
+    return;
+  }
+  if (!masterKnown || memcmp(rx.mac, masterMac, 6) != 0) return;
+
+  if (strncmp(text, "nonce:", 6) == 0) {
+    uint8_t nonce[HIT_AUTH_NONCE_LEN];
+    if (!HitAuth::parseHex(text + 6, strlen(text + 6), nonce, sizeof(nonce))) return;
+    hitAuth.setNonce(nonce);
+    // 主机重启或随机数换了：在途命令按原序号重签立即重发
+    if (inFlight) sendCurrent();
+    return;
+  }
+  if (strncmp(text, "ack:", 4) == 0 && inFlight) {
+    unsigned seq = 0, result = 0;
+    if (sscanf(text, "ack:%u|r:%u", &seq, &result) != 2 || seq != current.seq) return;
+    uint32_t rtt = (uint32_t)(esp_timer_get_time() - sentUs);
+    if (rtt > rttMaxUs) rttMaxUs = rtt;
+    ackCount++;
+    inFlight = false;
+    if (result == REMOTE_ACK_REJECTED) {
+      vibrate(VIBRATE_FAIL_MS);
+    } else {
+      vibrate(VIBRATE_ACK_MS);
+    }
+    Serial.printf("[遥控] 命令%u 确认 seq=%u 往返%lu微秒%s\n", current.cmd, current.seq, (unsigned long)rtt,
+                  result == REMOTE_ACK_DUPLICATE ? "（重发命令，主机已执行过）" : "");
+  }
+}
+
+// =====================【命令发送】=====================
+void enqueueCommand(uint8_t cmd) {
+  if (cmdCount >= CMD_QUEUE_LEN) return; // 满了丢最新的（裁判连按远超这个数不现实）
+  cmdQueue[(cmdHead + cmdCount) % CMD_QUEUE_LEN] = cmd;
+  cmdCount++;
+}
+
+void serviceCommands() {
+  if (!masterKnown) return;
+  if (!hitAuth.hasNonce()) {
+    if (millis() - lastHelloMs >= HELLO_RETRY_MS) sendHello();
+    return;
+  }
+  if (inFlight) {
+    if (millis() - lastSendMs < REMOTE_ACK_TIMEOUT_MS) return;
+    if (tries < REMOTE_MAX_TRIES) {
+      retryCount++;
+      sendCurrent();
+      return;
+    }
+    // 重发用完：长震报错，丢弃该命令并重新请求随机数（多半是主机重启或离得太远）
+    failCount++;
+    inFlight = false;
+    hitAuth.clearNonce();
+    vibrate(VIBRATE_FAIL_MS);
+    Serial.printf("❌ 【遥控】命令%u 未确认 seq=%u\n", current.cmd, current.seq);
+    return;
+  }
+  if (cmdCount == 0) return;
+  current.cmd = cmdQueue[cmdHead];
+  current.seq = nextSeq++;
+  current.sid = sessionId;
+  cmdHead = (cmdHead + 1) % CMD_QUEUE_LEN;
+  cmdCount--;
+  inFlight = true;
+  tries = 0;
+  sentUs = esp_timer_get_time();
+  sendCurrent();
+}
+
+void checkButtons() {
+  unsigned long now = millis();
+  for (int i = 0; i < REMOTE_CMD_COUNT; i++) {
+    bool reading = digitalRead(buttonPins[i]);
+    if (reading != lastReading[i]) {
+      lastChange[i] = now;
+      lastReading[i] = reading;
+    }
+    if (now - lastChange[i] >= DEBOUNCE_DELAY && reading != stableState[i]) {
+      stableState[i] = reading;
+      if (reading == LOW) enqueueCommand((uint8_t)i);
+    }
+  }
+}
+
+// =====================【初始化】=====================
+void loadPairing() {
+  Preferences prefs;
+  if (!prefs.begin(AUTH_NS, true)) return;
+  uint8_t key[HIT_AUTH_KEY_LEN];
+  if (prefs.getBytes("key", key, sizeof(key)) == sizeof(key) &&
+      prefs.getBytes("master", masterMac, sizeof(masterMac)) == sizeof(masterMac)) {
+    hitAuth.setKey(key);
+    masterKnown = true;
+  }
+  prefs.end();
+}
+
+void setup() {
+  Serial.begin(115200);
+  for (int i = 0; i < REMOTE_CMD_COUNT; i++) {
+    pinMode(buttonPins[i], INPUT_PULLUP);
+    lastReading[i] = stableState[i] = HIGH;
+  }
+  pinMode(LED_STATUS, OUTPUT);
+  digitalWrite(LED_STATUS, HIGH);
+  pinMode(VIBRATE_PIN, OUTPUT);
+  digitalWrite(VIBRATE_PIN, LOW);
+
+  esp_fill_random(&sessionId, sizeof(sessionId));
+  rxQueue = xQueueCreate(8, sizeof(RemoteRx));
+
+  // 固定信道，与主机一致（主机开热点时热点也在这个信道）
+  WiFi.mode(WIFI_STA);
+  WiFi.disconnect();
+  esp_wifi_set_promiscuous(true);
+  esp_wifi_set_channel(REMOTE_CHANNEL, WIFI_SECOND_CHAN_NONE);
+  esp_wifi_set_promiscuous(false);
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("❌ 【ESP-NOW】初始化失败");
+    return;
+  }
+  esp_now_register_recv_cb(onRecv);
+
+  loadPairing();
+  if (digitalRead(BTN_NEXT) == LOW) {
+    pairModeUntil = millis() + PAIR_MODE_MS;
+    stableState[REMOTE_CMD_NEXT] = lastReading[REMOTE_CMD_NEXT] = LOW; // 松开前不算一次按键
+    addPeer(BROADCAST_MAC);
+    Serial.println("🔑 【配对】配对模式：主机串口 p 打开配对窗口");
+  }
+  if (masterKnown) {
+    addPeer(masterMac);
+    sendHello();
+  } else if (pairModeUntil == 0) {
+    Serial.println("⚠️ 【配对】未配对：按住“下一分”重新上电进入配对模式");
+  }
+  Serial.printf("✅ 【遥控器】启动完成 会话%04x 信道%d\n", sessionId, REMOTE_CHANNEL);
+}
+
+void loop() {
+  RemoteRx rx;
+  while (xQueueReceive(rxQueue, &rx, 0) == pdTRUE) handleRx(rx);
+
+  if (pairModeUntil != 0) {
+    if ((long)(millis() - pairModeUntil) >= 0) {
+      pairModeUntil = 0;
+      Serial.println("⚠️ 【配对】配对模式结束");
+    } else if (millis() - lastPairMs >= PAIR_RETRY_MS) {
+      sendText(BROADCAST_MAC, "pair?");
+      lastPairMs = millis();
+    }
+  }
+
+  checkButtons();
+  serviceCommands();
+  updateFeedback();
+
+  if (Serial.available() && Serial.read() == 's') {
+    Serial.printf("[遥控] 确认%lu 重发%lu 失败%lu 最大往返%lu微秒\n", (unsigned long)ackCount,
+                  (unsigned long)retryCount, (unsigned long)failCount, (unsigned long)rttMaxUs);
+  }
+  delay(1);
+}
\ No newline at end of file
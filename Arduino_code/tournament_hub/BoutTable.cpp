@@ -0,0 +1,80 @@
+#include "BoutTable.h"
+#include <string.h>
+#include <stdio.h>
+
+BoutTable::BoutTable() : m_version(0), m_active(0) {
+  memset(m_entries, 0, sizeof(m_entries));
+}
+
+BoutApplyResult BoutTable::apply(const HubFrame& f, uint32_t nowMs) {
+  if (f.piste >= HUB_MAX_PISTES) return BOUT_INVALID;
+  BoutEntry& e = m_entries[f.piste];
+
+  if (e.active) {
+    int16_t ahead = (int16_t)(f.seq - e.lastSeq);
+    // 主机重启：上电时间变小，序号从头开始
+    bool restarted = f.uptimeMs < e.masterUptimeMs;
+    if (ahead <= 0 && !restarted) {
+      e.duplicates++;
+      return BOUT_DUPLICATE;
+    }
+    if (!restarted && ahead > 1) e.gaps += ahead - 1;
+  } else {
+    e.active = true;
+    m_active++;
+  }
+
+  e.state = f.state;
+  e.lastSeq = f.seq;
+  e.masterUptimeMs = f.uptimeMs;
+  e.rxMs = nowMs;
+  e.version = ++m_version;
+  e.frames++;
+  if (f.type == HUB_FRAME_RESULT) {
+    e.results++;
+    e.lastResult = f.state;
+  }
+  return BOUT_APPLIED;
+}
+
+// 条目按版本号从小到大输出：截断时已输出的都不晚于 "v"，没输出的都晚于 "v"，客户端下次 since=v 能接着拿到
+size_t BoutTable::toJson(char* buf, size_t cap, uint32_t since, uint32_t nowMs) const {
+  static const int HEAD_MAX = 32;   // {"v":<最多10位>,"bouts":[ 的最大长度
+  if (cap < HEAD_MAX + 8) return 0;
+  int n = HEAD_MAX;                  // 先从表头预留位置之后写条目，最后补表头
+  uint32_t emitted = m_version;
+  uint32_t last = since;
+  bool first = true;
+  for (;;) {
+    // 找版本号大于上一条的最小条目
+    int next = -1;
+    for (int i = 0; i < HUB_MAX_PISTES; i++) {
+      const BoutEntry& e = m_entries[i];
+      if (!e.active || e.version <= last) continue;
+      if (next < 0 || e.version < m_entries[next].version) next = i;
+    }
+    if (next < 0) break;
+    const BoutEntry& e = m_entries[next];
+    char item[192];
+    int len = snprintf(item, sizeof(item),
+      "%s{\"p\":%d,\"r\":%u,\"g\":%u,\"l\":%u,\"ph\":%u,\"t\":%u,\"hits\":%lu,\"lr\":%u,\"lg\":%u,\"off\":%d,\"age\":%lu,\"gap\":%lu}",
+      first ? "" : ",", next, e.state.redScore, e.state.grnScore, e.state.lamps, e.state.phase,
+      e.state.timerSec, (unsigned long)e.results, e.lastResult.redScore, e.lastResult.grnScore,
+      (nowMs - e.rxMs) > HUB_OFFLINE_MS ? 1 : 0, (unsigned long)(nowMs - e.rxMs), (unsigned long)e.gaps);
+    if (n + len + 3 > (int)cap) {  // 留 "]}" 和结尾
+      emitted = last;                // 截断：只承认到已输出的最后一条
+      break;
+    }
+    memcpy(buf + n, item, len);
+    n += len;
+    last = e.version;
+    first = false;
+  }
+  n += snprintf(buf + n, cap - n, "]}");
+
+  char head[HEAD_MAX + 1];
+  int headLen = snprintf(head, sizeof(head), "{\"v\":%lu,\"bouts\":[", (unsigned long)emitted);
+  memmove(buf + headLen, buf + HEAD_MAX, n - HEAD_MAX + 1);
+  memcpy(buf, head, headLen);
+  return (size_t)(n - HEAD_MAX + headLen);
+}
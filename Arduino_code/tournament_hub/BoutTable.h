@@ -0,0 +1,54 @@
+#ifndef BOUT_TABLE_H
+#define BOUT_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "HubFrame.h"
+
+// 汇总中心的比赛表：按剑道号直接索引，每帧更新 O(1)
+// 每个条目带版本号（全表递增计数），客户端带上次拿到的版本号只取变化的条目
+// 不依赖 Arduino.h，时间由调用方传入，主机端仿真直接编译
+
+#define HUB_OFFLINE_MS  3000   // 这么久没收到帧的剑道标为离线
+
+enum BoutApplyResult {
+  BOUT_APPLIED,     // 新帧，已更新
+  BOUT_DUPLICATE,   // 重复或乱序的旧帧，丢弃
+  BOUT_INVALID      // 剑道号越界
+};
+
+struct BoutEntry {
+  bool active;          // 收到过该剑道的帧
+  AppState state;
+  uint16_t lastSeq;
+  uint32_t masterUptimeMs;
+  uint32_t rxMs;        // 汇总中心收到最近一帧的时间
+  uint32_t version;     // 最近一次变化时的全表版本号
+  uint32_t frames;      // 接受的帧
+  uint32_t gaps;        // 按序号推算丢掉的帧
+  uint32_t duplicates;
+  uint32_t results;     // 判定结果帧（击中次数）
+  AppState lastResult;  // 最近一次判定
+};
+
+class BoutTable {
+public:
+  BoutTable();
+
+  BoutApplyResult apply(const HubFrame& f, uint32_t nowMs);
+
+  const BoutEntry& entry(uint8_t piste) const { return m_entries[piste]; }
+  uint32_t version() const { return m_version; }
+  uint32_t activeCount() const { return m_active; }
+
+  // 输出 JSON：{"v":版本,"bouts":[...]}，只含 version > since 的条目（since=0 为全量）
+  // 条目按版本号升序；缓冲区不够时截断到最后一个完整条目，"v" 改为已输出的最大版本号，返回长度
+  size_t toJson(char* buf, size_t cap, uint32_t since, uint32_t nowMs) const;
+
+private:
+  BoutEntry m_entries[HUB_MAX_PISTES];
+  uint32_t m_version;
+  uint32_t m_active;
+};
+
+#endif // BOUT_TABLE_H
\ No newline at end of file
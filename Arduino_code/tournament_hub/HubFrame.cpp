@@ -0,0 +1,37 @@
+#include "HubFrame.h"
+#include <string.h>
+
+size_t hubFrameBuild(const HubFrame& f, uint8_t* buf) {
+  buf[0] = HUB_MAGIC;
+  buf[1] = HUB_VERSION;
+  buf[2] = f.type;
+  buf[3] = f.piste;
+  buf[4] = (uint8_t)(f.seq & 0xFF);
+  buf[5] = (uint8_t)(f.seq >> 8);
+  buf[6] = f.state.redScore;
+  buf[7] = f.state.grnScore;
+  buf[8] = f.state.lamps;
+  buf[9] = f.state.phase;
+  buf[10] = (uint8_t)(f.state.timerSec & 0xFF);
+  buf[11] = (uint8_t)(f.state.timerSec >> 8);
+  for (int i = 0; i < 4; i++) buf[12 + i] = (uint8_t)(f.uptimeMs >> (8 * i));
+  return HUB_FRAME_LEN;
+}
+
+bool hubFrameParse(const uint8_t* data, size_t len, HubFrame& out) {
+  if (data == nullptr || len < HUB_FRAME_LEN) return false;
+  if (data[0] != HUB_MAGIC || data[1] != HUB_VERSION) return false;
+  if (data[2] != HUB_FRAME_STATE && data[2] != HUB_FRAME_RESULT) return false;
+  if (data[3] >= HUB_MAX_PISTES) return false;
+  out.type = data[2];
+  out.piste = data[3];
+  out.seq = (uint16_t)(data[4] | (data[5] << 8));
+  out.state.redScore = data[6];
+  out.state.grnScore = data[7];
+  out.state.lamps = data[8];
+  out.state.phase = data[9];
+  out.state.timerSec = (uint16_t)(data[10] | (data[11] << 8));
+  out.uptimeMs = 0;
+  for (int i = 0; i < 4; i++) out.uptimeMs |= (uint32_t)data[12 + i] << (8 * i);
+  return true;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef HUB_FRAME_H
+#define HUB_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AppStateChannel.h"
+
+// 赛场汇总帧：各剑道主机把比分状态和每次判定结果发给汇总中心（ESP-NOW 广播，或 Wi-Fi UDP）
+// 比分/灯/计时/阶段沿用小程序状态帧的 AppState 取值
+// 不依赖 Arduino.h，汇总中心、主机和主机端仿真共用
+//
+// 帧格式（16 字节，小端）：
+//   [0] 标识 0xEB  [1] 版本 1  [2] 类型 HubFrameType  [3] 剑道号
+//   [4..5] 序号（每发一帧 +1，汇总中心据此去重/统计丢帧）
+//   [6] 红分 [7] 绿分 [8] 灯（APP_LAMP_*） [9] 阶段（AppPhase） [10..11] 计时剩余秒
+//   [12..15] 主机上电以来毫秒（判断主机重启；仿真用它算更新时延）
+
+#define HUB_MAGIC          0xEB
+#define HUB_VERSION        1
+#define HUB_FRAME_LEN      16
+#define HUB_CHANNEL        1       // ESP-NOW 信道，与主机的 REMOTE_CHANNEL 一致
+#define HUB_UDP_PORT       4210    // Wi-Fi UDP 收帧端口（连汇总中心热点的设备/仿真用）
+#define HUB_KEEPALIVE_MS   1000    // 主机状态不变时也按这个间隔重发
+#define HUB_MAX_PISTES     128     // 剑道号 0..127，汇总表按剑道号直接索引
+
+enum HubFrameType {
+  HUB_FRAME_STATE = 1,    // 比分状态（变化时 + 定期）
+  HUB_FRAME_RESULT = 2    // 一次判定结果（亮灯时刻的比分和灯）
+};
+
+struct HubFrame {
+  uint8_t type;
+  uint8_t piste;
+  uint16_t seq;
+  AppState state;
+  uint32_t uptimeMs;
+};
+
+size_t hubFrameBuild(const HubFrame& f, uint8_t* buf);
+bool hubFrameParse(const uint8_t* data, size_t len, HubFrame& out);
+
+#endif // HUB_FRAME_H
\ No newline at end of file
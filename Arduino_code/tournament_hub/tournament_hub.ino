@@ -0,0 +1,218 @@
+#include <WiFi.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <esp_timer.h>
+#include <esp_http_server.h>
+#include <AsyncUDP.h>
+#include "HubFrame.h"
+#include "BoutTable.h"
+
+// =====================【赛场汇总中心】=====================
+// 收各剑道主机的比分/判定帧（ESP-NOW 广播 + 热点上的 UDP），维护全部剑道的比赛表，
+// 浏览器打开 http://192.168.4.1/ 看全场，脚本取 /bouts?since=<版本号> 只拿变化的剑道
+// 收帧回调只入队，汇总任务单独更新表，HTTP 服务读表时加锁
+// 剑道主机/计分端的汇总广播默认关闭，接入前把它们的 HUB_ENABLE 改成 1
+// 用 ESP32-S3（双核）：汇总任务在核心1，Wi-Fi/HTTP 在核心0
+
+#define HUB_SSID          "epee_hub"
+#define HUB_PASS          "epee1234"      // 至少8位
+#define HUB_QUEUE_LEN     256             // 收帧队列（突发时几十台主机同时发）
+#define HUB_JSON_LEN      16384           // 全量 JSON 缓冲（128 个剑道满载约 14KB）
+
+struct HubRx {
+  uint8_t data[HUB_FRAME_LEN];
+  int64_t rxUs;
+};
+
+BoutTable boutTable;
+SemaphoreHandle_t tableMutex;
+QueueHandle_t rxQueue;
+httpd_handle_t httpServer = nullptr;
+AsyncUDP udp;
+static char jsonBuf[HUB_JSON_LEN];        // 只在持有 tableMutex 时使用
+
+// 统计（串口 s、/stats）
+volatile uint32_t rxFrames = 0;           // 收到的帧（两路合计）
+volatile uint32_t rxUdp = 0;
+volatile uint32_t queueDrops = 0;         // 队列满丢弃
+volatile uint32_t badFrames = 0;
+volatile uint32_t appliedFrames = 0;
+volatile uint32_t duplicateFrames = 0;
+volatile uint32_t queueMaxDepth = 0;
+volatile uint32_t applyMaxUs = 0;         // 收到 → 更新进表的最大时延
+volatile uint64_t applyTotalUs = 0;
+
+// 全场页面：每秒取一次全量，离线剑道变灰
+static const char HUB_HTML[] =
+    "<!DOCTYPE html><html><head><meta charset=utf-8>"
+    "<meta name=viewport content='width=device-width,initial-scale=1'><title>epee hub</title>"
+    "<style>body{background:#000;color:#fff;font-family:sans-serif}table{width:100%;border-collapse:collapse;font-size:4vh}"
+    "td{padding:.3em;text-align:center;border-bottom:1px solid #333}.r{color:#f33}.g{color:#3f3}.off{opacity:.3}"
+    ".lr{background:#f33;color:#000}.lg{background:#3f3;color:#000}</style></head><body>"
+    "<table><thead><tr><td>剑道</td><td>红</td><td>绿</td><td>计时</td><td>击中</td></tr></thead><tbody id=b></tbody></table>"
+    "<script>function f(){fetch('/bouts').then(r=>r.json()).then(d=>{var h='';d.bouts.forEach(b=>{"
+    "var t=b.t==65535?'--':(b.t/60|0)+':'+('0'+b.t%60).slice(-2);"
+    "h+='<tr class='+(b.off?'off':'')+'><td>'+b.p+'</td><td class=\"r '+(b.l&1?'lr':'')+'\">'+b.r+'</td>'"
+    "+'<td class=\"g '+(b.l&2?'lg':'')+'\">'+b.g+'</td><td>'+t+'</td><td>'+b.hits+'</td></tr>'});"
+    "document.getElementById('b').innerHTML=h}).finally(()=>setTimeout(f,1000))}f()</script></body></html>";
+
+// =====================【收帧（Wi-Fi 任务回调，只入队）】=====================
+static void enqueueFrame(const uint8_t* data, size_t len) {
+  rxFrames++;
+  if (len != HUB_FRAME_LEN || data[0] != HUB_MAGIC) {
+    badFrames++;
+    return;
+  }
+  HubRx rx;
+  memcpy(rx.data, data, HUB_FRAME_LEN);
+  rx.rxUs = esp_timer_get_time();
+  if (xQueueSend(rxQueue, &rx, 0) != pdTRUE) queueDrops++;
+}
+
+static void onEspNowRecv(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+  if (len > 0) enqueueFrame(data, (size_t)len);
+}
+
+// =====================【汇总任务：出队更新比赛表】=====================
+void TaskHub(void* pvParameters) {
+  HubRx rx;
+  for (;;) {
+    if (xQueueReceive(rxQueue, &rx, portMAX_DELAY) != pdTRUE) continue;
+    uint32_t depth = uxQueueMessagesWaiting(rxQueue) + 1;
+    if (depth > queueMaxDepth) queueMaxDepth = depth;
+    HubFrame f;
+    if (!hubFrameParse(rx.data, HUB_FRAME_LEN, f)) {
+      badFrames++;
+      continue;
+    }
+    xSemaphoreTake(tableMutex, portMAX_DELAY);
+    BoutApplyResult r = boutTable.apply(f, millis());
+    xSemaphoreGive(tableMutex);
+    if (r == BOUT_APPLIED) {
+      uint32_t us = (uint32_t)(esp_timer_get_time() - rx.rxUs);
+      appliedFrames++;
+      applyTotalUs += us;
+      if (us > applyMaxUs) applyMaxUs = us;
+    } else if (r == BOUT_DUPLICATE) {
+      duplicateFrames++;
+    } else {
+      badFrames++;
+    }
+  }
+}
+
+// =====================【HTTP：页面 / 比赛表 / 统计】=====================
+static esp_err_t indexHandler(httpd_req_t* req) {
+  httpd_resp_set_type(req, "text/html; charset=utf-8");
+  return httpd_resp_send(req, HUB_HTML, HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t boutsHandler(httpd_req_t* req) {
+  uint32_t since = 0;
+  char query[32], val[12];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+      httpd_query_key_value(query, "since", val, sizeof(val)) == ESP_OK) {
+    since = strtoul(val, nullptr, 10);
+  }
+  httpd_resp_set_type(req, "application/json");
+  xSemaphoreTake(tableMutex, portMAX_DELAY);
+  size_t n = boutTable.toJson(jsonBuf, sizeof(jsonBuf), since, millis());
+  esp_err_t err = httpd_resp_send(req, jsonBuf, n);
+  xSemaphoreGive(tableMutex);
+  return err;
+}
+
+static esp_err_t statsHandler(httpd_req_t* req) {
+  char buf[320];
+  uint32_t applied = appliedFrames;
+  int n = snprintf(buf, sizeof(buf),
+    "{\"rx\":%lu,\"udp\":%lu,\"applied\":%lu,\"dup\":%lu,\"bad\":%lu,\"drops\":%lu,\"qmax\":%lu,"
+    "\"avgUs\":%lu,\"maxUs\":%lu,\"pistes\":%lu,\"v\":%lu,\"uptime\":%lu}",
+    (unsigned long)rxFrames, (unsigned long)rxUdp, (unsigned long)applied, (unsigned long)duplicateFrames,
+    (unsigned long)badFrames, (unsigned long)queueDrops, (unsigned long)queueMaxDepth,
+    (unsigned long)(applied ? applyTotalUs / applied : 0), (unsigned long)applyMaxUs,
+    (unsigned long)boutTable.activeCount(), (unsigned long)boutTable.version(), (unsigned long)millis());
+  httpd_resp_set_type(req, "application/json");
+  return httpd_resp_send(req, buf, n);
+}
+
+void startHttp() {
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.core_id = 0;
+  if (httpd_start(&httpServer, &config) != ESP_OK) {
+    Serial.println("[汇总] HTTP 服务启动失败");
+    return;
+  }
+  httpd_uri_t uris[3] = {};
+  const char* paths[3] = {"/", "/bouts", "/stats"};
+  esp_err_t (*handlers[3])(httpd_req_t*) = {indexHandler, boutsHandler, statsHandler};
+  for (int i = 0; i < 3; i++) {
+    uris[i].uri = paths[i];
+    uris[i].method = HTTP_GET;
+    uris[i].handler = handlers[i];
+    httpd_register_uri_handler(httpServer, &uris[i]);
+  }
+}
+
+// 串口 's'：收帧统计；'t'：打印比赛表
+void printStats() {
+  uint32_t applied = appliedFrames;
+  Serial.printf("[汇总] 收%lu (UDP %lu) 更新%lu 重复%lu 错误%lu 队列丢弃%lu 队列最深%lu | 入表时延 均%lu 最大%lu微秒 | 剑道%lu\n",
+                (unsigned long)rxFrames, (unsigned long)rxUdp, (unsigned long)applied, (unsigned long)duplicateFrames,
+                (unsigned long)badFrames, (unsigned long)queueDrops, (unsigned long)queueMaxDepth,
+                (unsigned long)(applied ? applyTotalUs / applied : 0), (unsigned long)applyMaxUs,
+                (unsigned long)boutTable.activeCount());
+  applyMaxUs = 0;
+  queueMaxDepth = 0;
+}
+
+void printTable() {
+  uint32_t now = millis();
+  xSemaphoreTake(tableMutex, portMAX_DELAY);
+  for (int i = 0; i < HUB_MAX_PISTES; i++) {
+    const BoutEntry& e = boutTable.entry(i);
+    if (!e.active) continue;
+    Serial.printf("[剑道%3d] 红%2u 绿%2u 击中%lu 丢帧%lu %s\n", i, e.state.redScore, e.state.grnScore,
+                  (unsigned long)e.results, (unsigned long)e.gaps, now - e.rxMs > HUB_OFFLINE_MS ? "离线" : "");
+  }
+  xSemaphoreGive(tableMutex);
+}
+
+void setup() {
+  Serial.begin(115200);
+  tableMutex = xSemaphoreCreateMutex();
+  rxQueue = xQueueCreate(HUB_QUEUE_LEN, sizeof(HubRx));
+
+  // 热点和 ESP-NOW 同信道：主机广播的帧和热点上的 UDP 都能收
+  WiFi.mode(WIFI_AP_STA);
+  WiFi.softAP(HUB_SSID, HUB_PASS, HUB_CHANNEL);
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("[汇总] ESP-NOW 初始化失败");
+  } else {
+    esp_now_register_recv_cb(onEspNowRecv);
+  }
+  if (udp.listen(HUB_UDP_PORT)) {
+    // 一个 UDP 包可以连着放多帧（仿真批量发送）
+    udp.onPacket([](AsyncUDPPacket packet) {
+      rxUdp++;
+      size_t len = packet.length();
+      if (len < HUB_FRAME_LEN) enqueueFrame(packet.data(), len);
+      for (size_t off = 0; off + HUB_FRAME_LEN <= len; off += HUB_FRAME_LEN) {
+        enqueueFrame(packet.data() + off, HUB_FRAME_LEN);
+      }
+    });
+  }
+  xTaskCreatePinnedToCore(TaskHub, "Hub", 4096, NULL, 2, NULL, 1);
+  startHttp();
+  Serial.printf("[汇总] 热点 %s 信道%d 地址 %s，UDP 端口 %d\n", HUB_SSID, HUB_CHANNEL,
+                WiFi.softAPIP().toString().c_str(), HUB_UDP_PORT);
+}
+
+void loop() {
+  if (Serial.available()) {
+    char cmd = Serial.read();
+    if (cmd == 's') printStats();
+    if (cmd == 't') printTable();
+  }
+  delay(100);
+}
\ No newline at end of file